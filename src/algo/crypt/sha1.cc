@@ -16,6 +16,7 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "algo/crypt/sha1.h"
+#include <algorithm>
 #include <openssl/sha.h>
 
 using namespace au;
@@ -29,3 +30,19 @@ bstr algo::crypt::sha1(const bstr &input)
     SHA1_Final(output, &ctx);
     return bstr(output, SHA_DIGEST_LENGTH);
 }
+
+bstr algo::crypt::sha1(io::BaseByteStream &input_stream)
+{
+    static const size_t chunk_size = 1024 * 1024;
+    SHA_CTX ctx;
+    SHA1_Init(&ctx);
+    while (input_stream.left())
+    {
+        const auto chunk = input_stream.read(
+            std::min<uoff_t>(chunk_size, input_stream.left()));
+        SHA1_Update(&ctx, chunk.get<const u8>(), chunk.size());
+    }
+    u8 output[SHA_DIGEST_LENGTH];
+    SHA1_Final(output, &ctx);
+    return bstr(output, SHA_DIGEST_LENGTH);
+}
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include "io/base_byte_stream.h"
 #include "types.h"
 
 namespace au {
@@ -25,4 +26,8 @@ namespace crypt {
 
     bstr sha1(const bstr &input);
 
+    // hashes everything from the current position to the end of the stream
+    // without holding it all in memory
+    bstr sha1(io::BaseByteStream &input_stream);
+
 } } }
@@ -0,0 +1,503 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "algo/jpeg.h"
+#include <algorithm>
+#include <cstring>
+#include "algo/range.h"
+#include "algo/simd.h"
+
+using namespace au;
+using namespace au::algo::jpeg;
+
+static const size_t block_dim = 8;
+static const size_t block_dim2 = block_dim * block_dim;
+
+const std::array<u8, 64> algo::jpeg::zigzag_order =
+{
+    0,  1,  8,  16, 9,  2,  3,  10,
+    17, 24, 32, 25, 18, 11, 4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13, 6,  7,  14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63
+};
+
+static const FloatBlock aan_scale_factors =
+{
+    1.0f,      1.38704f,  1.30656f,  1.17588f,
+    1.0f,      0.785695f, 0.541196f, 0.275899f,
+    1.38704f,  1.92388f,  1.81225f,  1.63099f,
+    1.38704f,  1.08979f,  0.750661f, 0.382683f,
+    1.30656f,  1.81225f,  1.70711f,  1.53636f,
+    1.30656f,  1.02656f,  0.707107f, 0.36048f,
+    1.17588f,  1.63099f,  1.53636f,  1.38268f,
+    1.17588f,  0.92388f,  0.636379f, 0.324423f,
+    1.0f,      1.38704f,  1.30656f,  1.17588f,
+    1.0f,      0.785695f, 0.541196f, 0.275899f,
+    0.785695f, 1.08979f,  1.02656f,  0.92388f,
+    0.785695f, 0.617317f, 0.425215f, 0.216773f,
+    0.541196f, 0.750661f, 0.707107f, 0.636379f,
+    0.541196f, 0.425215f, 0.292893f, 0.149316f,
+    0.275899f, 0.382683f, 0.36048f,  0.324423f,
+    0.275899f, 0.216773f, 0.149316f, 0.0761205f
+};
+
+#ifdef AU_USE_SSE2
+    // Vector counterpart of the passes in the scalar IDCT below. The column
+    // pass there uses libjpeg 6b's form of the odd part and the row pass
+    // uses the later one; they differ only by exact negations, so a single
+    // kernel serves both.
+    static inline void idct_pass(__m128 *v)
+    {
+        const auto sqrt2 = _mm_set1_ps(1.414213562f);
+
+        const auto tmp10 = _mm_add_ps(v[0], v[4]);
+        const auto tmp11 = _mm_sub_ps(v[0], v[4]);
+        const auto tmp13 = _mm_add_ps(v[2], v[6]);
+        const auto tmp12 = _mm_sub_ps(
+            _mm_mul_ps(_mm_sub_ps(v[2], v[6]), sqrt2), tmp13);
+
+        const auto even0 = _mm_add_ps(tmp10, tmp13);
+        const auto even3 = _mm_sub_ps(tmp10, tmp13);
+        const auto even1 = _mm_add_ps(tmp11, tmp12);
+        const auto even2 = _mm_sub_ps(tmp11, tmp12);
+
+        const auto z13 = _mm_add_ps(v[5], v[3]);
+        const auto z10 = _mm_sub_ps(v[5], v[3]);
+        const auto z11 = _mm_add_ps(v[1], v[7]);
+        const auto z12 = _mm_sub_ps(v[1], v[7]);
+
+        const auto odd7 = _mm_add_ps(z11, z13);
+        const auto odd11 = _mm_mul_ps(_mm_sub_ps(z11, z13), sqrt2);
+        const auto z5 = _mm_mul_ps(
+            _mm_add_ps(z10, z12), _mm_set1_ps(1.847759065f));
+        const auto odd10 = _mm_sub_ps(
+            z5, _mm_mul_ps(z12, _mm_set1_ps(1.082392200f)));
+        const auto odd12 = _mm_sub_ps(
+            z5, _mm_mul_ps(z10, _mm_set1_ps(2.613125930f)));
+
+        const auto odd6 = _mm_sub_ps(odd12, odd7);
+        const auto odd5 = _mm_sub_ps(odd11, odd6);
+        const auto odd4 = _mm_sub_ps(odd10, odd5);
+
+        v[0] = _mm_add_ps(even0, odd7);
+        v[7] = _mm_sub_ps(even0, odd7);
+        v[1] = _mm_add_ps(even1, odd6);
+        v[6] = _mm_sub_ps(even1, odd6);
+        v[2] = _mm_add_ps(even2, odd5);
+        v[5] = _mm_sub_ps(even2, odd5);
+        v[3] = _mm_add_ps(even3, odd4);
+        v[4] = _mm_sub_ps(even3, odd4);
+    }
+
+    // input[h][r] holds the columns 4h..4h+3 of the row r; output[h][c]
+    // receives the rows 4h..4h+3 of the column c.
+    static inline void transpose(const __m128 input[2][8], __m128 output[2][8])
+    {
+        for (const auto h : algo::range(2))
+        for (const auto q : algo::range(2))
+        {
+            auto r0 = input[h][4 * q + 0];
+            auto r1 = input[h][4 * q + 1];
+            auto r2 = input[h][4 * q + 2];
+            auto r3 = input[h][4 * q + 3];
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            output[q][4 * h + 0] = r0;
+            output[q][4 * h + 1] = r1;
+            output[q][4 * h + 2] = r2;
+            output[q][4 * h + 3] = r3;
+        }
+    }
+
+    // Same as range_limit below, for eight samples at once.
+    static inline __m128i range_limit(const __m128 lo, const __m128 hi)
+    {
+        const auto bias = _mm_set1_epi32(0x80);
+        const auto wrap = _mm_set1_epi32(0x17F);
+        const auto a_lo = _mm_add_epi32(
+            _mm_srai_epi32(_mm_cvttps_epi32(lo), 3), bias);
+        const auto a_hi = _mm_add_epi32(
+            _mm_srai_epi32(_mm_cvttps_epi32(hi), 3), bias);
+        const auto wrapped = _mm_packs_epi32(
+            _mm_cmpgt_epi32(a_lo, wrap), _mm_cmpgt_epi32(a_hi, wrap));
+        const auto a = _mm_andnot_si128(wrapped, _mm_packs_epi32(a_lo, a_hi));
+        return _mm_packus_epi16(a, a);
+    }
+
+    static inline __m128 load_samples(const u8 *input)
+    {
+        s32 packed;
+        std::memcpy(&packed, input, 4);
+        const auto zero = _mm_setzero_si128();
+        return _mm_cvtepi32_ps(_mm_unpacklo_epi16(
+            _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero));
+    }
+
+    static inline __m128i clamp_sample(const __m128 value)
+    {
+        return _mm_cvttps_epi32(_mm_max_ps(
+            _mm_setzero_ps(), _mm_min_ps(value, _mm_set1_ps(255.0f))));
+    }
+#else
+    // Out of range values above 0x17F wrap around to 0, as they do with
+    // libjpeg's range limit table.
+    static u8 range_limit(const f32 value)
+    {
+        const int a = 0x80 + ((static_cast<int>(value)) >> 3);
+        if (a < 0)
+            return 0;
+        if (a < 0xFF)
+            return a;
+        if (a < 0x180)
+            return 0xFF;
+        return 0;
+    }
+#endif
+
+FloatBlock algo::jpeg::make_float_dequantization_table(
+    const u8 *quantization_table)
+{
+    FloatBlock output;
+    for (const auto i : algo::range(block_dim2))
+        output[i] = quantization_table[i] * aan_scale_factors[i];
+    return output;
+}
+
+void algo::jpeg::idct_float(
+    const s16 *input, const FloatBlock &dequantization_table, u8 *output)
+{
+#ifdef AU_USE_SSE2
+    __m128 rows[2][8];
+    __m128 columns[2][8];
+    for (const auto r : algo::range(block_dim))
+    {
+        const auto packed = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(&input[r * block_dim]));
+        const auto lo = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+        const auto hi = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+        rows[0][r] = _mm_mul_ps(
+            _mm_cvtepi32_ps(lo),
+            _mm_loadu_ps(&dequantization_table[r * block_dim]));
+        rows[1][r] = _mm_mul_ps(
+            _mm_cvtepi32_ps(hi),
+            _mm_loadu_ps(&dequantization_table[r * block_dim + 4]));
+    }
+
+    idct_pass(rows[0]);
+    idct_pass(rows[1]);
+    transpose(rows, columns);
+    idct_pass(columns[0]);
+    idct_pass(columns[1]);
+    transpose(columns, rows);
+
+    for (const auto r : algo::range(block_dim))
+    {
+        _mm_storel_epi64(
+            reinterpret_cast<__m128i*>(&output[r * block_dim]),
+            range_limit(rows[0][r], rows[1][r]));
+    }
+#else
+    const auto &dv = dequantization_table;
+    f32 tp[block_dim2];
+    f32 tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+    f32 tmp10, tmp11, tmp12, tmp13;
+    f32 z5, z10, z11, z12, z13;
+
+    for (const auto i : algo::range(block_dim))
+    {
+        if (!input[8 + i] && !input[16 + i]
+            && !input[24 + i] && !input[32 + i]
+            && !input[40 + i] && !input[48 + i]
+            && !input[56 + i])
+        {
+            tmp0 = input[i] * dv[i];
+            for (const auto j : algo::range(block_dim))
+                tp[j * block_dim + i] = tmp0;
+            continue;
+        }
+
+        tmp0 = input[i] * dv[i];
+        tmp1 = input[16 + i] * dv[16 + i];
+        tmp2 = input[32 + i] * dv[32 + i];
+        tmp3 = input[48 + i] * dv[48 + i];
+        tmp10 = tmp0 + tmp2;
+        tmp11 = tmp0 - tmp2;
+        tmp13 = tmp1 + tmp3;
+        tmp12 = (tmp1 - tmp3) * 1.414213562f - tmp13;
+        tmp0 = tmp10 + tmp13;
+        tmp3 = tmp10 - tmp13;
+        tmp1 = tmp11 + tmp12;
+        tmp2 = tmp11 - tmp12;
+        tmp4 = input[8 + i] * dv[8 + i];
+        tmp5 = input[24 + i] * dv[24 + i];
+        tmp6 = input[40 + i] * dv[40 + i];
+        tmp7 = input[56 + i] * dv[56 + i];
+        z13 = tmp6 + tmp5;
+        z10 = tmp6 - tmp5;
+        z11 = tmp4 + tmp7;
+        z12 = tmp4 - tmp7;
+
+        tmp7 = z11 + z13;
+        tmp11 = (z11 - z13) * 1.414213562f;
+        z5 = (z10 + z12) * 1.847759065f;
+        tmp10 = z12 * 1.082392200f - z5;
+        tmp12 = z10 * (-2.613125930f) + z5;
+
+        tmp6 = tmp12 - tmp7;
+        tmp5 = tmp11 - tmp6;
+        tmp4 = tmp10 + tmp5;
+
+        tp[i] = tmp0 + tmp7;
+        tp[56 + i] = tmp0 - tmp7;
+        tp[8 + i] = tmp1 + tmp6;
+        tp[48 + i] = tmp1 - tmp6;
+        tp[16 + i] = tmp2 + tmp5;
+        tp[40 + i] = tmp2 - tmp5;
+        tp[32 + i] = tmp3 + tmp4;
+        tp[24 + i] = tmp3 - tmp4;
+    }
+
+    for (const auto i : algo::range(block_dim))
+    {
+        const auto row = &tp[i * block_dim];
+        z5 = row[0];
+        tmp10 = z5 + row[4];
+        tmp11 = z5 - row[4];
+
+        tmp13 = row[2] + row[6];
+        tmp12 = (row[2] - row[6]) * 1.414213562f - tmp13;
+
+        tmp0 = tmp10 + tmp13;
+        tmp3 = tmp10 - tmp13;
+        tmp1 = tmp11 + tmp12;
+        tmp2 = tmp11 - tmp12;
+
+        z13 = row[5] + row[3];
+        z10 = row[5] - row[3];
+        z11 = row[1] + row[7];
+        z12 = row[1] - row[7];
+
+        tmp7 = z11 + z13;
+        tmp11 = (z11 - z13) * 1.414213562f;
+
+        z5 = (z10 + z12) * 1.847759065f;
+        tmp10 = z5 - z12 * 1.082392200f;
+        tmp12 = z5 - z10 * 2.613125930f;
+
+        tmp6 = tmp12 - tmp7;
+        tmp5 = tmp11 - tmp6;
+        tmp4 = tmp10 - tmp5;
+
+        const auto out = &output[i * block_dim];
+        out[0] = range_limit(tmp0 + tmp7);
+        out[7] = range_limit(tmp0 - tmp7);
+        out[1] = range_limit(tmp1 + tmp6);
+        out[6] = range_limit(tmp1 - tmp6);
+        out[2] = range_limit(tmp2 + tmp5);
+        out[5] = range_limit(tmp2 - tmp5);
+        out[3] = range_limit(tmp3 + tmp4);
+        out[4] = range_limit(tmp3 - tmp4);
+    }
+#endif
+}
+
+// The products need more than 32 bits, so unlike idct_float this stays
+// scalar.
+void algo::jpeg::idct_int(s16 *block, const s16 *quantization_table)
+{
+    long a, b, c, d;
+    long w, x, y, z;
+    long s, t, u, v, n;
+
+    auto lp1 = block;
+    auto lp2 = quantization_table;
+
+    for (const auto i : algo::range(block_dim))
+    {
+        if (lp1[0x08] == 0 &&
+            lp1[0x10] == 0 &&
+            lp1[0x18] == 0 &&
+            lp1[0x20] == 0 &&
+            lp1[0x28] == 0 &&
+            lp1[0x30] == 0 &&
+            lp1[0x38] == 0)
+        {
+            lp1[0x00] =
+            lp1[0x08] =
+            lp1[0x10] =
+            lp1[0x18] =
+            lp1[0x20] =
+            lp1[0x28] =
+            lp1[0x30] =
+            lp1[0x38] = lp1[0] * lp2[0];
+        }
+
+        else
+        {
+            c = lp2[0x10] * lp1[0x10];
+            d = lp2[0x30] * lp1[0x30];
+            x = ((c + d) * 35467) >> 16;
+            c = ((c * 50159) >> 16) + x;
+            d = ((d * -121094) >> 16) + x;
+            a = lp1[0x00] * lp2[0x00];
+            b = lp1[0x20] * lp2[0x20];
+            w = a + b + c;
+            x = a + b - c;
+            y = a - b + d;
+            z = a - b - d;
+
+            c = lp1[0x38] * lp2[0x38];
+            d = lp1[0x28] * lp2[0x28];
+            a = lp1[0x18] * lp2[0x18];
+            b = lp1[0x08] * lp2[0x08];
+            n = ((a + b + c + d) * 77062) >> 16;
+
+            u = n
+                + ((c * 19571) >> 16)
+                + (((c + a) * -128553) >> 16)
+                + (((c + b) * -58980) >> 16);
+            v = n
+                + ((d * 134553) >> 16)
+                + (((d + b) * -25570) >> 16)
+                + (((d + a) * -167963) >> 16);
+            t = n
+                + ((b * 98390) >> 16)
+                + (((d + b) * -25570) >> 16)
+                + (((c + b) * -58980) >> 16);
+            s = n
+                + ((a * 201373) >> 16)
+                + (((c + a) * -128553) >> 16)
+                + (((d + a) * -167963) >> 16);
+
+            lp1[0x00] = w + t;
+            lp1[0x38] = w - t;
+            lp1[0x08] = y + s;
+            lp1[0x30] = y - s;
+            lp1[0x10] = z + v;
+            lp1[0x28] = z - v;
+            lp1[0x18] = x + u;
+            lp1[0x20] = x - u;
+        }
+
+        lp1++;
+        lp2++;
+    }
+
+    lp1 = block;
+
+    for (const auto i : algo::range(block_dim))
+    {
+        a = lp1[0];
+        c = lp1[2];
+        b = lp1[4];
+        d = lp1[6];
+        x = (((c + d) * 35467) >> 16);
+        c = ((c * 50159) >> 16) + x;
+        d = ((d * -121094) >> 16) + x;
+        w = a + b + c;
+        x = a + b - c;
+        y = a - b + d;
+        z = a - b - d;
+
+        d = lp1[5];
+        b = lp1[1];
+        c = lp1[7];
+        a = lp1[3];
+        n = (((a + b + c + d) * 77062) >> 16);
+
+        s = n + ((a * 201373) >> 16)
+              + (((a + c) * -128553) >> 16)
+              + (((a + d) * -167963) >> 16);
+
+        t = n + ((b * 98390) >> 16)
+              + (((b + d) * -25570) >> 16)
+              + (((b + c) * -58980) >> 16);
+
+        u = n + ((c * 19571) >> 16)
+              + (((b + c) * -58980) >> 16)
+              + (((a + c) * -128553) >> 16);
+
+        v = n + ((d * 134553) >> 16)
+              + (((b + d) * -25570) >> 16)
+              + (((a + d) * -167963) >> 16);
+
+        lp1[0] = (w + t) >> 3;
+        lp1[7] = (w - t) >> 3;
+        lp1[1] = (y + s) >> 3;
+        lp1[6] = (y - s) >> 3;
+        lp1[2] = (z + v) >> 3;
+        lp1[5] = (z - v) >> 3;
+        lp1[3] = (x + u) >> 3;
+        lp1[4] = (x - u) >> 3;
+
+        lp1 += 8;
+    }
+}
+
+void algo::jpeg::ycbcr_to_bgra(
+    const u8 *y, const u8 *cb, const u8 *cr, u8 *output, const size_t n)
+{
+    size_t i = 0;
+#ifdef AU_USE_SSE2
+    for (; i + 4 <= n; i += 4)
+    {
+        const auto cy = load_samples(&y[i]);
+        const auto cb_samples = load_samples(&cb[i]);
+        const auto cr_samples = load_samples(&cr[i]);
+
+        const auto r = _mm_sub_ps(
+            _mm_add_ps(cy, _mm_mul_ps(_mm_set1_ps(1.402f), cr_samples)),
+            _mm_set1_ps(178.956f));
+        const auto g = _mm_sub_ps(
+            _mm_add_ps(
+                _mm_sub_ps(
+                    _mm_add_ps(cy, _mm_set1_ps(44.04992f)),
+                    _mm_mul_ps(_mm_set1_ps(0.34414f), cb_samples)),
+                _mm_set1_ps(91.90992f)),
+            _mm_mul_ps(_mm_set1_ps(0.71414f), cr_samples));
+        const auto b = _mm_sub_ps(
+            _mm_add_ps(cy, _mm_mul_ps(_mm_set1_ps(1.772f), cb_samples)),
+            _mm_set1_ps(226.316f));
+
+        const auto pixels = _mm_or_si128(
+            _mm_or_si128(
+                clamp_sample(b), _mm_slli_epi32(clamp_sample(g), 8)),
+            _mm_or_si128(
+                _mm_slli_epi32(clamp_sample(r), 16),
+                _mm_set1_epi32(static_cast<s32>(0xFF000000))));
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(&output[i * 4]), pixels);
+    }
+#endif
+    for (; i < n; i++)
+    {
+        const f32 cy = y[i];
+        const f32 cb_sample = cb[i];
+        const f32 cr_sample = cr[i];
+        const auto r = cy + 1.402f * cr_sample - 178.956f;
+        const auto g = cy + 44.04992f - 0.34414f * cb_sample
+            + 91.90992f - 0.71414f * cr_sample;
+        const auto b = cy + 1.772f * cb_sample - 226.316f;
+        output[i * 4 + 0] = std::max(0.0f, std::min(255.0f, b));
+        output[i * 4 + 1] = std::max(0.0f, std::min(255.0f, g));
+        output[i * 4 + 2] = std::max(0.0f, std::min(255.0f, r));
+        output[i * 4 + 3] = 0xFF;
+    }
+}
@@ -0,0 +1,54 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <array>
+#include "types.h"
+
+namespace au {
+namespace algo {
+namespace jpeg {
+
+    // Building blocks shared by the JPEG-like codecs of the engines: the
+    // 8x8 blocks are stored in natural (row major) order.
+    using FloatBlock = std::array<f32, 64>;
+
+    // Maps positions in the zigzag scan to natural block positions.
+    extern const std::array<u8, 64> zigzag_order;
+
+    // Premultiplies an 8-bit quantization table by the AAN scale factors,
+    // so that idct_float can dequantize and descale in a single product.
+    FloatBlock make_float_dequantization_table(const u8 *quantization_table);
+
+    // Float AAN IDCT (as in libjpeg's jidctflt) that dequantizes the input
+    // with a table made by make_float_dequantization_table. The samples are
+    // level shifted and range limited to 0..255.
+    void idct_float(
+        const s16 *input, const FloatBlock &dequantization_table, u8 *output);
+
+    // Integer AAN IDCT with 16.16 fixed point factors, done in place. The
+    // block is dequantized by multiplying it with the quantization table.
+    // The samples are descaled, but neither level shifted nor clamped.
+    void idct_int(s16 *block, const s16 *quantization_table);
+
+    // JFIF YCbCr to BGRA conversion of level shifted samples, in floating
+    // point with rounding. The alpha channel is set to 0xFF.
+    void ycbcr_to_bgra(
+        const u8 *y, const u8 *cb, const u8 *cr, u8 *output, const size_t n);
+
+} } }
@@ -38,72 +38,171 @@ static bstr replace(const bstr &input, const bstr &from, const bstr &to)
     return output;
 }
 
-static bstr convert_locale(
-    const bstr &input, const std::string &from, const std::string &to)
+namespace
 {
-    iconv_t conv = iconv_open(to.c_str(), from.c_str());
-    if (!conv)
+    // iconv_open is expensive, so each thread keeps one converter per
+    // encoding pair for its whole lifetime.
+    class Converter final
+    {
+    public:
+        Converter(const std::string &from, const std::string &to);
+        ~Converter();
+        bstr convert(const bstr &input, const size_t max_growth);
+
+    private:
+        iconv_t conv;
+    };
+}
+
+Converter::Converter(const std::string &from, const std::string &to)
+    : conv(iconv_open(to.c_str(), from.c_str()))
+{
+    if (conv == reinterpret_cast<iconv_t>(-1))
         throw std::logic_error("Failed to initialize iconv");
+}
+
+Converter::~Converter()
+{
+    iconv_close(conv);
+}
 
-    bstr output;
-    output.reserve(input.size() * 2);
+bstr Converter::convert(const bstr &input, const size_t max_growth)
+{
+    // reset shift state possibly left by previous failed conversion
+    iconv(conv, nullptr, nullptr, nullptr, nullptr);
 
+    // sized for the worst case, so that a single pass is enough
+    bstr output(input.size() * max_growth + 16);
     auto input_ptr = const_cast<char*>(input.get<const char>());
     auto input_bytes_left = input.size();
-    bstr buffer(32);
+    size_t output_size = 0;
 
     while (true)
     {
-        auto output_buffer = buffer.get<char>();
-        auto output_bytes_left = buffer.size();
-        int ret = iconv(
+        auto output_ptr = output.get<char>() + output_size;
+        auto output_bytes_left = output.size() - output_size;
+        const auto ret = iconv(
             conv,
             &input_ptr,
             &input_bytes_left,
-            &output_buffer,
+            &output_ptr,
             &output_bytes_left);
         const auto err = errno;
+        output_size = output.size() - output_bytes_left;
 
-        output += buffer.substr(0, buffer.size() - output_bytes_left);
-
-        if (ret != -1 && input_bytes_left == 0)
+        if (ret != static_cast<size_t>(-1) && input_bytes_left == 0)
             break;
 
-        // repeat the iteration unless nothing was parsed at all
-        if (err == E2BIG && output_bytes_left != buffer.size())
+        if (err == E2BIG)
+        {
+            output.resize(output.size() * 2);
             continue;
+        }
 
-        iconv_close(conv);
-        if (err == E2BIG)
-            throw err::CorruptDataError("Code point too large to decode (?)");
-        else if (err == EINVAL || err == EILSEQ)
+        if (err == EINVAL || err == EILSEQ)
             throw err::CorruptDataError("Invalid byte sequence");
         else
             throw err::CorruptDataError("Unknown iconv error");
     }
 
-    iconv_close(conv);
+    output.resize(output_size);
     return output;
 }
 
+static bool is_ascii(const bstr &input)
+{
+    for (const auto c : input)
+        if (c & 0x80)
+            return false;
+    return true;
+}
+
+static void write_utf8(bstr &output, size_t &output_pos, const u32 code_point)
+{
+    auto output_ptr = output.get<u8>() + output_pos;
+    if (code_point < 0x80)
+    {
+        output_ptr[0] = code_point;
+        output_pos += 1;
+    }
+    else if (code_point < 0x800)
+    {
+        output_ptr[0] = 0xC0 | (code_point >> 6);
+        output_ptr[1] = 0x80 | (code_point & 0x3F);
+        output_pos += 2;
+    }
+    else if (code_point < 0x10000)
+    {
+        output_ptr[0] = 0xE0 | (code_point >> 12);
+        output_ptr[1] = 0x80 | ((code_point >> 6) & 0x3F);
+        output_ptr[2] = 0x80 | (code_point & 0x3F);
+        output_pos += 3;
+    }
+    else
+    {
+        output_ptr[0] = 0xF0 | (code_point >> 18);
+        output_ptr[1] = 0x80 | ((code_point >> 12) & 0x3F);
+        output_ptr[2] = 0x80 | ((code_point >> 6) & 0x3F);
+        output_ptr[3] = 0x80 | (code_point & 0x3F);
+        output_pos += 4;
+    }
+}
+
 bstr algo::sjis_to_utf8(const bstr &input)
 {
-    return convert_locale(input, "cp932", "utf-8");
+    if (is_ascii(input))
+        return input;
+    // half-width katakana take 1 byte in SJIS and 3 bytes in UTF-8
+    static thread_local Converter converter("cp932", "utf-8");
+    return converter.convert(input, 3);
 }
 
 bstr algo::utf16_to_utf8(const bstr &input)
 {
-    return convert_locale(input, "utf-16le", "utf-8");
+    if (input.size() % 2)
+        throw err::CorruptDataError("Invalid byte sequence");
+
+    // each UTF-16 code unit yields at most 3 bytes of UTF-8, and each
+    // surrogate pair 4 bytes
+    bstr output(input.size() / 2 * 3);
+    size_t output_pos = 0;
+    const auto input_ptr = input.get<const u8>();
+    const auto input_size = input.size() / 2;
+    for (size_t i = 0; i < input_size; i++)
+    {
+        u32 code_point = input_ptr[i * 2] | (input_ptr[i * 2 + 1] << 8);
+        if (code_point >= 0xD800 && code_point < 0xDC00)
+        {
+            if (i + 1 >= input_size)
+                throw err::CorruptDataError("Invalid byte sequence");
+            ++i;
+            const u32 low
+                = input_ptr[i * 2] | (input_ptr[i * 2 + 1] << 8);
+            if (low < 0xDC00 || low >= 0xE000)
+                throw err::CorruptDataError("Invalid byte sequence");
+            code_point = 0x10000 + ((code_point - 0xD800) << 10)
+                + (low - 0xDC00);
+        }
+        else if (code_point >= 0xDC00 && code_point < 0xE000)
+            throw err::CorruptDataError("Invalid byte sequence");
+        write_utf8(output, output_pos, code_point);
+    }
+    output.resize(output_pos);
+    return output;
 }
 
 bstr algo::utf8_to_sjis(const bstr &input)
 {
-    return convert_locale(input, "utf-8", "cp932");
+    if (is_ascii(input))
+        return input;
+    static thread_local Converter converter("utf-8", "cp932");
+    return converter.convert(input, 1);
 }
 
 bstr algo::utf8_to_utf16(const bstr &input)
 {
-    return convert_locale(input, "utf-8", "utf-16le");
+    static thread_local Converter converter("utf-8", "utf-16le");
+    return converter.convert(input, 2);
 }
 
 bstr algo::normalize_sjis(const bstr &utf8_input)
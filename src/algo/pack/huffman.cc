@@ -16,36 +16,131 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "algo/pack/huffman.h"
-#include "io/msb_bit_stream.h"
+#include <algorithm>
+#include "algo/range.h"
+#include "err.h"
 
 using namespace au;
 using namespace au::algo::pack;
 
-static int init_huffman_impl(
-    io::BaseBitStream &input_stream, u16 nodes[2][512], int &size)
+// longer codes than that can only come from a tree that loops back on itself
+static const size_t max_code_length = 1024;
+static const size_t max_subtable_bits = 6;
+
+template<typename TReader> static int init_huffman_impl(
+    TReader &reader, u16 nodes[2][512], int &size)
 {
-    if (!input_stream.read(1))
-        return input_stream.read(8);
+    if (!reader.read(1))
+        return reader.read(8);
     const auto pos = size;
     if (pos > 511)
         return -1;
     size++;
-    nodes[0][pos] = init_huffman_impl(input_stream, nodes, size);
-    nodes[1][pos] = init_huffman_impl(input_stream, nodes, size);
+    nodes[0][pos] = init_huffman_impl(reader, nodes, size);
+    nodes[1][pos] = init_huffman_impl(reader, nodes, size);
     return pos;
 }
 
+static size_t get_depth(
+    const std::vector<HuffmanTable::Node> &nodes,
+    const size_t node,
+    const size_t limit)
+{
+    if (node >= nodes.size())
+        throw err::CorruptDataError("Invalid Huffman tree node");
+    if (nodes[node].is_leaf || !limit)
+        return 0;
+    return 1 + std::max(
+        get_depth(nodes, nodes[node].children[0], limit - 1),
+        get_depth(nodes, nodes[node].children[1], limit - 1));
+}
+
 HuffmanTree::HuffmanTree(io::BaseBitStream &input_stream)
 {
     size = 256;
     root = init_huffman_impl(input_stream, nodes, size);
 }
 
+HuffmanTree::HuffmanTree(io::MsbBitReader &reader)
+{
+    size = 256;
+    root = init_huffman_impl(reader, nodes, size);
+}
+
 HuffmanTree::HuffmanTree(const bstr &data)
 {
-    io::MsbBitStream input_stream(data);
+    io::MsbBitReader reader(data);
     size = 256;
-    root = init_huffman_impl(input_stream, nodes, size);
+    root = init_huffman_impl(reader, nodes, size);
+}
+
+HuffmanTable::HuffmanTable(
+    const std::vector<Node> &nodes,
+    const size_t root,
+    const size_t max_root_bits)
+{
+    root_bits = get_depth(nodes, root, max_root_bits);
+    build_table(nodes, root, root_bits, 0);
+}
+
+HuffmanTable::HuffmanTable(const HuffmanTree &tree)
+{
+    // node values below 256 are literals, 256..511 are branches and anything
+    // above (the -1 returned for an overflowing tree) decodes to its low byte
+    std::vector<Node> nodes(513);
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        nodes[i].is_leaf = i < 256 || i >= static_cast<size_t>(tree.size);
+        nodes[i].symbol = i & 0xFF;
+        if (nodes[i].is_leaf)
+            continue;
+        for (const auto j : algo::range(2))
+            nodes[i].children[j] = std::min<size_t>(tree.nodes[j][i], 512);
+    }
+    *this = HuffmanTable(nodes, std::min<size_t>(tree.root, 512));
+}
+
+size_t HuffmanTable::build_table(
+    const std::vector<Node> &nodes,
+    const size_t node,
+    const size_t bits,
+    const size_t depth)
+{
+    if (depth + bits > max_code_length)
+        throw err::CorruptDataError("Huffman code is too long");
+
+    const auto offset = entries.size();
+    const auto entry_count = static_cast<size_t>(1) << bits;
+    entries.resize(offset + entry_count);
+    for (const auto index : algo::range(entry_count))
+    {
+        auto current = node;
+        size_t length = 0;
+        while (length < bits && !nodes[current].is_leaf)
+        {
+            const auto bit = (index >> (bits - 1 - length)) & 1;
+            current = nodes[current].children[bit];
+            if (current >= nodes.size())
+                throw err::CorruptDataError("Invalid Huffman tree node");
+            length++;
+        }
+
+        Entry entry;
+        entry.length = length;
+        if (nodes[current].is_leaf)
+        {
+            entry.value = nodes[current].symbol;
+            entry.subtable_bits = 0;
+        }
+        else
+        {
+            entry.subtable_bits = get_depth(nodes, current, max_subtable_bits);
+            entry.value = build_table(
+                nodes, current, entry.subtable_bits, depth + length);
+        }
+        entries[offset + index] = entry;
+    }
+    return offset;
 }
 
 bstr algo::pack::decode_huffman(
@@ -53,15 +148,21 @@ bstr algo::pack::decode_huffman(
     const bstr &input,
     const size_t target_size)
 {
-    bstr output;
-    output.resize(target_size);
-    io::MsbBitStream input_stream(input);
-    while (output.size() < target_size && input_stream.left())
-    {
-        auto byte = huffman_tree.root;
-        while (byte >= 256 && byte <= 511)
-            byte = huffman_tree.nodes[input_stream.read(1)][byte];
-        output += static_cast<const u8>(byte);
-    }
+    io::MsbBitReader reader(input);
+    return decode_huffman(huffman_tree, reader, target_size);
+}
+
+bstr algo::pack::decode_huffman(
+    const HuffmanTree &huffman_tree,
+    io::MsbBitReader &reader,
+    const size_t target_size)
+{
+    const HuffmanTable table(huffman_tree);
+    bstr output(target_size);
+    auto output_ptr = output.get<u8>();
+    const auto output_end = output.end<const u8>();
+    while (output_ptr < output_end && reader.left())
+        *output_ptr++ = table.decode(reader);
+    output.resize(output_ptr - output.get<u8>());
     return output;
 }
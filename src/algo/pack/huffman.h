@@ -17,7 +17,9 @@
 
 #pragma once
 
+#include <vector>
 #include "io/base_bit_stream.h"
+#include "io/bit_reader.h"
 
 namespace au {
 namespace algo {
@@ -27,15 +29,77 @@ namespace pack {
     {
         HuffmanTree(const bstr &data);
         HuffmanTree(io::BaseBitStream &input_stream);
+        HuffmanTree(io::MsbBitReader &reader);
 
         int size;
         u16 root;
         u16 nodes[2][512];
     };
 
+    // Decodes prefix codes through lookup tables rather than walking the
+    // tree a bit at a time. The next root_bits bits of the input index the
+    // root table; codes longer than that continue in subtables, so most
+    // symbols take a single peek and consume. TReader is expected to read
+    // bits MSB-first and to provide peek(bits) and consume(bits), like
+    // io::MsbBitReader.
+    class HuffmanTable final
+    {
+    public:
+        struct Node final
+        {
+            bool is_leaf;
+            u16 symbol;
+            size_t children[2];
+        };
+
+        HuffmanTable(
+            const std::vector<Node> &nodes,
+            const size_t root,
+            const size_t max_root_bits = 10);
+
+        HuffmanTable(const HuffmanTree &tree);
+
+        template<typename TReader> inline u16 decode(TReader &reader) const
+        {
+            auto entry = &entries[reader.peek(root_bits)];
+            while (entry->subtable_bits)
+            {
+                reader.consume(entry->length);
+                entry = &entries[
+                    entry->value + reader.peek(entry->subtable_bits)];
+            }
+            reader.consume(entry->length);
+            return entry->value;
+        }
+
+    private:
+        struct Entry final
+        {
+            u32 value;
+            u8 length;
+            u8 subtable_bits;
+        };
+
+        size_t build_table(
+            const std::vector<Node> &nodes,
+            const size_t node,
+            const size_t bits,
+            const size_t depth);
+
+        size_t root_bits;
+        std::vector<Entry> entries;
+    };
+
     bstr decode_huffman(
         const HuffmanTree &huffman_tree,
         const bstr &input,
         const size_t target_size);
 
+    // Decodes until either target_size bytes are produced or the input runs
+    // out, whichever comes first.
+    bstr decode_huffman(
+        const HuffmanTree &huffman_tree,
+        io::MsbBitReader &reader,
+        const size_t target_size);
+
 } } }
@@ -16,9 +16,10 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "algo/pack/lzss.h"
-#include <array>
-#include "algo/ptr.h"
+#include <algorithm>
+#include <cstring>
 #include "algo/range.h"
+#include "io/bit_reader.h"
 #include "io/memory_byte_stream.h"
 #include "io/msb_bit_stream.h"
 
@@ -159,13 +160,127 @@ algo::pack::BytewiseLzssSettings::BytewiseLzssSettings()
 {
 }
 
+// The decoders below don't keep a separate ring dictionary. Since the
+// dictionary starts zeroed and is fed exactly with what's written to the
+// output, a reference to dictionary position P is the same as a reference to
+// the output D bytes back, where D is the distance between P and the current
+// dictionary position; bytes from before the start of the output are zeros.
+// This lets the matches be copied straight from the output buffer, 8 bytes
+// at a time whenever the source doesn't overlap the copied chunk.
+
+static const size_t copy_slack = 8;
+
+static inline void copy_match(
+    u8 *&output_ptr,
+    const u8 *output_start,
+    const u8 *output_end,
+    const size_t distance,
+    size_t size)
+{
+    if (size > static_cast<size_t>(output_end - output_ptr))
+        size = output_end - output_ptr;
+
+    const auto written = static_cast<size_t>(output_ptr - output_start);
+    if (distance > written)
+    {
+        const auto zeros = std::min(size, distance - written);
+        std::memset(output_ptr, 0, zeros);
+        output_ptr += zeros;
+        size -= zeros;
+    }
+
+    const u8 *source_ptr = output_ptr - distance;
+    if (distance >= copy_slack)
+    {
+        // may overshoot by up to 7 bytes; the output buffer has room for it
+        // and the garbage gets overwritten by whatever comes next
+        auto target_ptr = output_ptr;
+        const auto target_end = output_ptr + size;
+        while (target_ptr < target_end)
+        {
+            std::memcpy(target_ptr, source_ptr, copy_slack);
+            target_ptr += copy_slack;
+            source_ptr += copy_slack;
+        }
+    }
+    else
+    {
+        for (const auto i : algo::range(size))
+            output_ptr[i] = source_ptr[i];
+    }
+    output_ptr += size;
+}
+
+// position_bits and size_bits are passed as template arguments for the common
+// settings so that the compiler can fold the masks and shifts; 0 means the
+// value is taken from the runtime settings instead.
+template<size_t fixed_position_bits, size_t fixed_size_bits, typename TReader>
+static bstr decompress_bitwise(
+    TReader &reader,
+    const size_t output_size,
+    const algo::pack::BitwiseLzssSettings &settings)
+{
+    const auto position_bits = fixed_position_bits
+        ? fixed_position_bits
+        : settings.position_bits;
+    const auto size_bits = fixed_size_bits ? fixed_size_bits : settings.size_bits;
+    const auto dict_size = static_cast<size_t>(1) << position_bits;
+    const auto dict_mask = dict_size - 1;
+
+    bstr output(output_size + copy_slack);
+    const auto output_start = output.get<u8>();
+    const auto output_end = output_start + output_size;
+    auto output_ptr = output_start;
+    while (output_ptr < output_end)
+    {
+        if (reader.read(1))
+        {
+            *output_ptr++ = reader.read(8);
+            continue;
+        }
+        const auto look_behind_pos = reader.read(position_bits);
+        const auto size = reader.read(size_bits) + settings.min_match_size;
+        const auto dict_pos = settings.initial_dictionary_pos
+            + (output_ptr - output_start);
+        auto distance = (dict_pos - look_behind_pos) & dict_mask;
+        if (!distance)
+            distance = dict_size;
+        copy_match(output_ptr, output_start, output_end, distance, size);
+    }
+    output.resize(output_size);
+    return output;
+}
+
+template<typename TReader>
+static bstr decompress_bitwise(
+    TReader &reader,
+    const size_t output_size,
+    const algo::pack::BitwiseLzssSettings &settings)
+{
+    if (settings.size_bits == 4)
+    {
+        switch (settings.position_bits)
+        {
+            case 8:
+                return decompress_bitwise<8, 4>(reader, output_size, settings);
+            case 11:
+                return decompress_bitwise<11, 4>(reader, output_size, settings);
+            case 12:
+                return decompress_bitwise<12, 4>(reader, output_size, settings);
+            case 13:
+                return decompress_bitwise<13, 4>(reader, output_size, settings);
+        }
+    }
+    return decompress_bitwise<0, 0>(reader, output_size, settings);
+}
+
 bstr algo::pack::lzss_decompress(
     const bstr &input,
     const size_t output_size,
     const BitwiseLzssSettings &settings)
 {
-    io::MsbBitStream bit_stream(input);
-    return lzss_decompress(bit_stream, output_size, settings);
+    io::MsbBitReader reader(input);
+    return decompress_bitwise(reader, output_size, settings);
 }
 
 bstr algo::pack::lzss_decompress(
@@ -173,38 +288,7 @@ bstr algo::pack::lzss_decompress(
     const size_t output_size,
     const BitwiseLzssSettings &settings)
 {
-    std::vector<u8> dict(1 << settings.position_bits, 0);
-    auto dict_ptr
-        = algo::make_cyclic_ptr(dict.data(), dict.size())
-        + settings.initial_dictionary_pos;
-
-    bstr output(output_size);
-    auto output_ptr = algo::make_ptr(output);
-    while (output_ptr.left())
-    {
-        if (input_stream.read(1))
-        {
-            const auto b = input_stream.read(8);
-            *output_ptr++ = b;
-            *dict_ptr++ = b;
-        }
-        else
-        {
-            auto look_behind_pos = input_stream.read(settings.position_bits);
-            auto repetitions = input_stream.read(settings.size_bits)
-                + settings.min_match_size;
-            auto source_ptr
-                = algo::make_cyclic_ptr(dict.data(), dict.size())
-                + look_behind_pos;
-            while (repetitions-- && output_ptr.left())
-            {
-                const auto b = *source_ptr++;
-                *output_ptr++ = b;
-                *dict_ptr++ = b;
-            }
-        }
-    }
-    return output;
+    return decompress_bitwise(input_stream, output_size, settings);
 }
 
 bstr algo::pack::lzss_decompress(
@@ -212,49 +296,45 @@ bstr algo::pack::lzss_decompress(
     const size_t output_size,
     const BytewiseLzssSettings &settings)
 {
-    std::array<u8, 0x1000> dict = {0};
-    auto dict_ptr
-        = algo::make_cyclic_ptr(dict.data(), dict.size())
-        + settings.initial_dictionary_pos;
+    static const size_t dict_size = 0x1000;
 
-    bstr output(output_size);
-    auto output_ptr = algo::make_ptr(output);
-    auto input_ptr = algo::make_ptr(input);
+    bstr output(output_size + copy_slack);
+    const auto output_start = output.get<u8>();
+    const auto output_end = output_start + output_size;
+    auto output_ptr = output_start;
+    auto input_ptr = input.get<const u8>();
+    const auto input_end = input.end<const u8>();
 
     u16 control = 0;
-    while (output_ptr.left())
+    while (output_ptr < output_end)
     {
         control >>= 1;
         if (!(control & 0x100))
         {
-            if (!input_ptr.left()) break;
+            if (input_ptr >= input_end) break;
             control = *input_ptr++ | 0xFF00;
         }
         if (control & 1)
         {
-            if (!input_ptr.left()) break;
-            const auto b = *input_ptr++;
-            *output_ptr++ = b;
-            *dict_ptr++ = b;
+            if (input_ptr >= input_end) break;
+            *output_ptr++ = *input_ptr++;
         }
         else
         {
-            if (input_ptr.left() < 2) break;
+            if (input_end - input_ptr < 2) break;
             const auto lo = *input_ptr++;
             const auto hi = *input_ptr++;
             const auto look_behind_pos = lo | ((hi & 0xF0) << 4);
-            auto repetitions = (hi & 0xF) + 3;
-            auto source_ptr
-                = algo::make_cyclic_ptr(dict.data(), dict.size())
-                + look_behind_pos;
-            while (repetitions-- && output_ptr.left())
-            {
-                const auto b = *source_ptr++;
-                *output_ptr++ = b;
-                *dict_ptr++ = b;
-            }
+            const auto size = (hi & 0xF) + 3;
+            const auto dict_pos = settings.initial_dictionary_pos
+                + (output_ptr - output_start);
+            auto distance = (dict_pos - look_behind_pos) & (dict_size - 1);
+            if (!distance)
+                distance = dict_size;
+            copy_match(output_ptr, output_start, output_end, distance, size);
         }
     }
+    output.resize(output_size);
     return output;
 }
 
@@ -16,6 +16,7 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "algo/pack/zlib.h"
+#include <algorithm>
 #include <cstring>
 #include <memory>
 #include <zlib.h>
@@ -28,13 +29,23 @@ using namespace au::algo::pack;
 
 static const int buffer_size = 8192;
 
-static bstr process_stream(
-    io::BaseByteStream &input_stream,
-    const ZlibKind kind,
-    const std::function<int(z_stream &s, const int window_bits)> &init_func,
-    const std::function<int(z_stream &s)> &process_func,
-    const std::function<int(z_stream &s)> &end_func,
-    const std::string &error_message)
+namespace
+{
+    // Keeps the zlib state between calls on the same thread, so that each
+    // inflation costs an inflateReset rather than a full initialization.
+    class Inflater final
+    {
+    public:
+        Inflater(const int window_bits);
+        ~Inflater();
+        z_stream &reset();
+
+    private:
+        z_stream s;
+    };
+}
+
+static int get_window_bits(const ZlibKind kind)
 {
     const int window_bits
         = kind == ZlibKind::RawDeflate ? -MAX_WBITS
@@ -43,19 +54,104 @@ static bstr process_stream(
         : 0;
     if (!window_bits)
         throw std::logic_error("Bad zlib kind");
+    return window_bits;
+}
+
+static void throw_corrupt_data_error(
+    const std::string &message, const z_stream &s, const size_t pos)
+{
+    throw err::CorruptDataError(algo::format(
+        "%s (%s near %x)",
+        message.c_str(),
+        s.msg ? s.msg : "unknown error",
+        pos));
+}
+
+Inflater::Inflater(const int window_bits)
+{
+    std::memset(&s, 0, sizeof(s));
+    if (inflateInit2(&s, window_bits) != Z_OK)
+        throw std::logic_error("Failed to initialize zlib stream");
+}
+
+Inflater::~Inflater()
+{
+    inflateEnd(&s);
+}
+
+z_stream &Inflater::reset()
+{
+    inflateReset(&s);
+    return s;
+}
+
+static z_stream &get_inflater(const ZlibKind kind)
+{
+    static thread_local std::unique_ptr<Inflater> inflaters[3];
+    const auto index = static_cast<size_t>(kind);
+    if (index >= 3)
+        throw std::logic_error("Bad zlib kind");
+    if (!inflaters[index])
+        inflaters[index] = std::make_unique<Inflater>(get_window_bits(kind));
+    return inflaters[index]->reset();
+}
 
+static bstr inflate_with_size_hint(
+    const bstr &input, const size_t size_hint, const ZlibKind kind)
+{
+    auto &s = get_inflater(kind);
+    bstr output(std::max<size_t>(size_hint, 1));
+    s.next_in = const_cast<Bytef*>(input.get<const Bytef>());
+    s.avail_in = input.size();
+    s.next_out = output.get<Bytef>();
+    s.avail_out = output.size();
+
+    int ret;
+    while (true)
+    {
+        ret = inflate(&s, Z_FINISH);
+        if (ret != Z_BUF_ERROR || s.avail_out)
+            break;
+        // the hint was too small
+        const auto written = s.total_out;
+        output.resize(output.size() * 2);
+        s.next_out = output.get<Bytef>() + written;
+        s.avail_out = output.size() - written;
+    }
+
+    if (ret != Z_STREAM_END)
+    {
+        throw_corrupt_data_error(
+            "Failed to inflate zlib stream",
+            s,
+            s.next_in - input.get<const Bytef>());
+    }
+    // a guessed hint usually overshoots, and resizing down keeps the
+    // capacity, so the result is copied rather than kept oversized
+    if (output.size() != s.total_out)
+        return bstr(output.get<const u8>(), s.total_out);
+    return output;
+}
+
+static bstr process_stream(
+    io::BaseByteStream &input_stream,
+    const ZlibKind kind,
+    const std::function<int(z_stream &s, const int window_bits)> &init_func,
+    const std::function<int(z_stream &s)> &process_func,
+    const std::function<int(z_stream &s)> &end_func,
+    const std::string &error_message)
+{
     z_stream s;
     std::memset(&s, 0, sizeof(s));
-    if (init_func(s, window_bits) != Z_OK)
+    if (init_func(s, get_window_bits(kind)) != Z_OK)
         throw std::logic_error("Failed to initialize zlib stream");
 
-    bstr output, input_chunk, output_chunk(buffer_size);
-    size_t written = 0;
+    bstr output, input_chunk;
     int ret;
     const auto initial_pos = input_stream.pos();
     do
     {
-        if (s.avail_in == 0)
+        if (s.avail_in == 0 && input_stream.left())
         {
             input_chunk = input_stream.read(
                 std::min<size_t>(input_stream.left(), buffer_size));
@@ -63,33 +159,26 @@ static bstr process_stream(
             s.avail_in = input_chunk.size();
         }
 
-        s.next_out = output_chunk.get<Bytef>();
-        s.avail_out = output_chunk.size();
+        // inflate straight into the output, which grows geometrically
+        const auto written = s.total_out;
+        output.resize(written + buffer_size);
+        s.next_out = output.get<Bytef>() + written;
+        s.avail_out = buffer_size;
 
         ret = process_func(s);
-        output += output_chunk.substr(0, s.total_out - written);
-        written = s.total_out;
-        if (ret == Z_BUF_ERROR)
-        {
-            input_chunk += input_stream.read(
-                std::min<size_t>(input_stream.left(), buffer_size));
-            s.next_in = const_cast<Bytef*>(input_chunk.get<const Bytef>());
-            s.avail_in = input_chunk.size();
-        }
+        output.resize(s.total_out);
+
+        // no progress is possible without more input
+        if (ret == Z_BUF_ERROR && (s.avail_in || !input_stream.left()))
+            break;
     }
-    while (ret == Z_OK);
+    while (ret == Z_OK || ret == Z_BUF_ERROR);
 
     input_stream.seek(initial_pos + s.total_in);
     const auto pos = s.next_in - input_chunk.get<const Bytef>();
     end_func(s);
     if (ret != Z_STREAM_END)
-    {
-        throw err::CorruptDataError(algo::format(
-            "%s (%s near %x)",
-            error_message.c_str(),
-            s.msg ? s.msg : "unknown error",
-            pos));
-    }
+        throw_corrupt_data_error(error_message, s, pos);
     return output;
 }
 
@@ -116,8 +205,40 @@ bstr algo::pack::zlib_inflate(
 
 bstr algo::pack::zlib_inflate(const bstr &input, const ZlibKind kind)
 {
-    io::MemoryByteStream input_stream(input);
-    return ::zlib_inflate(input_stream, kind);
+    // typical compression ratio, so that most inputs need no regrowth; the
+    // output is trimmed to its real size afterwards
+    return ::inflate_with_size_hint(input, input.size() * 4, kind);
+}
+
+bstr algo::pack::zlib_inflate(
+    const bstr &input, const size_t size_orig, const ZlibKind kind)
+{
+    return ::inflate_with_size_hint(input, size_orig, kind);
+}
+
+void algo::pack::zlib_inflate(
+    const bstr &input,
+    u8 *output,
+    const size_t output_size,
+    const ZlibKind kind)
+{
+    auto &s = get_inflater(kind);
+    s.next_in = const_cast<Bytef*>(input.get<const Bytef>());
+    s.avail_in = input.size();
+    s.next_out = output;
+    s.avail_out = output_size;
+    const auto ret = inflate(&s, Z_FINISH);
+    if (ret == Z_BUF_ERROR && !s.avail_out)
+        throw err::BadDataSizeError();
+    if (ret != Z_STREAM_END)
+    {
+        throw_corrupt_data_error(
+            "Failed to inflate zlib stream",
+            s,
+            s.next_in - input.get<const Bytef>());
+    }
+    if (s.avail_out)
+        throw err::BadDataSizeError();
 }
 
 bstr algo::pack::zlib_deflate(
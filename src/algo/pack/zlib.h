@@ -39,6 +39,20 @@ namespace pack {
     bstr zlib_inflate(
         const bstr &input, const ZlibKind kind = ZlibKind::PlainZlib);
 
+    // Inflates in a single pass into a buffer of size_orig bytes, which is
+    // grown only if the data turns out to be bigger.
+    bstr zlib_inflate(
+        const bstr &input,
+        const size_t size_orig,
+        const ZlibKind kind = ZlibKind::PlainZlib);
+
+    // Inflates into the given buffer, which the data must fill exactly.
+    void zlib_inflate(
+        const bstr &input,
+        u8 *output,
+        const size_t output_size,
+        const ZlibKind kind = ZlibKind::PlainZlib);
+
     bstr zlib_deflate(
         const bstr &input,
         const ZlibKind kind = ZlibKind::PlainZlib,
@@ -0,0 +1,181 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "algo/pack/zlib_inflate_stream.h"
+#include <cstring>
+#include <zlib.h>
+#include "err.h"
+
+using namespace au;
+using namespace au::algo::pack;
+
+static const size_t buffer_size = 8192;
+
+struct ZlibInflateStream::Priv final
+{
+    Priv(
+        std::unique_ptr<io::BaseByteStream> input_stream,
+        const uoff_t size_orig,
+        const ZlibKind kind);
+    ~Priv();
+
+    void reset();
+    void inflate_into(u8 *output, const size_t output_size);
+
+    std::unique_ptr<io::BaseByteStream> input_stream;
+    const uoff_t input_offset;
+    const uoff_t size_orig;
+    const ZlibKind kind;
+    uoff_t output_pos;
+    bstr input_chunk;
+    z_stream s;
+};
+
+ZlibInflateStream::Priv::Priv(
+    std::unique_ptr<io::BaseByteStream> input_stream,
+    const uoff_t size_orig,
+    const ZlibKind kind) :
+        input_stream(std::move(input_stream)),
+        input_offset(this->input_stream->pos()),
+        size_orig(size_orig),
+        kind(kind),
+        output_pos(0)
+{
+    const int window_bits
+        = kind == ZlibKind::RawDeflate ? -MAX_WBITS
+        : kind == ZlibKind::PlainZlib ? MAX_WBITS
+        : kind == ZlibKind::Gzip ? MAX_WBITS | 16
+        : 0;
+    if (!window_bits)
+        throw std::logic_error("Bad zlib kind");
+
+    std::memset(&s, 0, sizeof(s));
+    if (inflateInit2(&s, window_bits) != Z_OK)
+        throw std::logic_error("Failed to initialize zlib stream");
+}
+
+ZlibInflateStream::Priv::~Priv()
+{
+    inflateEnd(&s);
+}
+
+void ZlibInflateStream::Priv::reset()
+{
+    inflateReset(&s);
+    s.avail_in = 0;
+    input_stream->seek(input_offset);
+    output_pos = 0;
+}
+
+void ZlibInflateStream::Priv::inflate_into(
+    u8 *output, const size_t output_size)
+{
+    if (output_pos + output_size > size_orig)
+        throw err::EofError();
+
+    s.next_out = reinterpret_cast<Bytef*>(output);
+    s.avail_out = output_size;
+    while (s.avail_out)
+    {
+        if (!s.avail_in)
+        {
+            const auto chunk_size
+                = std::min<uoff_t>(input_stream->left(), buffer_size);
+            if (!chunk_size)
+                throw err::CorruptDataError("Premature end of zlib stream");
+            input_chunk = input_stream->read(chunk_size);
+            s.next_in = input_chunk.get<Bytef>();
+            s.avail_in = input_chunk.size();
+        }
+
+        const auto ret = ::inflate(&s, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END && s.avail_out)
+            throw err::CorruptDataError("Premature end of zlib stream");
+        if (ret != Z_OK
+            && ret != Z_STREAM_END
+            && !(ret == Z_BUF_ERROR && !s.avail_in))
+        {
+            throw err::CorruptDataError(
+                std::string("Failed to inflate zlib stream (")
+                + (s.msg ? s.msg : "unknown error") + ")");
+        }
+    }
+    output_pos += output_size;
+}
+
+ZlibInflateStream::ZlibInflateStream(
+    std::unique_ptr<io::BaseByteStream> input_stream,
+    const uoff_t size_orig,
+    const ZlibKind kind)
+        : p(new Priv(std::move(input_stream), size_orig, kind))
+{
+}
+
+ZlibInflateStream::~ZlibInflateStream()
+{
+}
+
+void ZlibInflateStream::seek_impl(const uoff_t offset)
+{
+    if (offset > p->size_orig)
+        throw err::EofError();
+    if (offset < p->output_pos)
+        p->reset();
+    bstr discarded(std::min<uoff_t>(buffer_size, offset - p->output_pos));
+    while (p->output_pos < offset)
+    {
+        p->inflate_into(
+            discarded.get<u8>(),
+            std::min<uoff_t>(discarded.size(), offset - p->output_pos));
+    }
+}
+
+void ZlibInflateStream::read_impl(void *destination, const size_t size)
+{
+    // destination MUST exist and size MUST be at least 1
+    p->inflate_into(reinterpret_cast<u8*>(destination), size);
+}
+
+void ZlibInflateStream::write_impl(const void *source, const size_t size)
+{
+    throw err::NotSupportedError("Not implemented");
+}
+
+uoff_t ZlibInflateStream::pos() const
+{
+    return p->output_pos;
+}
+
+uoff_t ZlibInflateStream::size() const
+{
+    return p->size_orig;
+}
+
+void ZlibInflateStream::resize_impl(const uoff_t new_size)
+{
+    throw err::NotSupportedError("Not implemented");
+}
+
+std::unique_ptr<io::BaseByteStream> ZlibInflateStream::clone() const
+{
+    auto input_stream = p->input_stream->clone();
+    input_stream->seek(p->input_offset);
+    auto ret = std::make_unique<ZlibInflateStream>(
+        std::move(input_stream), p->size_orig, p->kind);
+    ret->seek(pos());
+    return std::move(ret);
+}
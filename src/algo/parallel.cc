@@ -0,0 +1,88 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "algo/parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "algo/range.h"
+
+using namespace au;
+
+static thread_local size_t thread_budget = 1;
+
+void algo::run_in_parallel(
+    const size_t task_count,
+    size_t thread_count,
+    const std::function<void(const size_t)> &func)
+{
+    if (!thread_count)
+        thread_count = get_thread_budget();
+    if (thread_count <= 1 || task_count <= 1)
+    {
+        for (const auto i : algo::range(task_count))
+            func(i);
+        return;
+    }
+
+    std::atomic<size_t> next_task(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    std::vector<std::thread> threads;
+    for (const auto i : algo::range(std::min(thread_count, task_count)))
+    {
+        threads.emplace_back([&]()
+        {
+            try
+            {
+                size_t task;
+                while ((task = next_task++) < task_count)
+                    func(task);
+            }
+            catch (...)
+            {
+                std::unique_lock<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+                next_task = task_count;
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+size_t algo::get_thread_budget()
+{
+    return thread_budget;
+}
+
+algo::ThreadBudget::ThreadBudget(const size_t thread_count)
+    : previous_thread_count(thread_budget)
+{
+    thread_budget = std::max<size_t>(thread_count, 1);
+}
+
+algo::ThreadBudget::~ThreadBudget()
+{
+    thread_budget = previous_thread_count;
+}
@@ -0,0 +1,52 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <functional>
+#include "types.h"
+
+namespace au {
+namespace algo {
+
+    // Calls func for every task index on up to thread_count threads, or on
+    // up to get_thread_budget() threads if thread_count is 0. With a single
+    // thread the tasks run in order on the calling thread. The first
+    // exception thrown by a task cancels the remaining tasks and is
+    // rethrown once all the threads have finished.
+    void run_in_parallel(
+        const size_t task_count,
+        const size_t thread_count,
+        const std::function<void(const size_t)> &func);
+
+    // The number of threads that parallel work started from the calling
+    // thread may use. It is 1 unless raised by a ThreadBudget, so that code
+    // running inside a thread pool doesn't multiply its threads; the
+    // unpacker raises it for the tasks that start while workers are idle.
+    size_t get_thread_budget();
+
+    class ThreadBudget final
+    {
+    public:
+        ThreadBudget(const size_t thread_count);
+        ~ThreadBudget();
+
+    private:
+        const size_t previous_thread_count;
+    };
+
+} }
@@ -0,0 +1,25 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// SSE2 is part of the x86-64 baseline, so kernels guarded by AU_USE_SSE2 need
+// no runtime detection; everything else gets the scalar fallbacks.
+#if defined(__SSE2__) || defined(_M_X64)
+    #define AU_USE_SSE2
+    #include <emmintrin.h>
+#endif
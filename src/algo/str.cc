@@ -143,6 +143,14 @@ namespace algo {
         return boost::lexical_cast<int>(input);
     }
 
+    template<> u64 from_string(const std::string &input)
+    {
+        // lexical_cast wraps negative numbers around instead of failing
+        if (!input.empty() && input[0] == '-')
+            throw boost::bad_lexical_cast();
+        return boost::lexical_cast<u64>(input);
+    }
+
     template<> float from_string(const std::string &input)
     {
         return boost::lexical_cast<float>(input);
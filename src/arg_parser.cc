@@ -57,6 +57,7 @@ namespace
 
         std::string value_name;
         std::string value;
+        std::vector<std::string> values;
         std::vector<std::pair<std::string, std::string>> possible_values;
         bool possible_values_hidden;
     };
@@ -283,6 +284,7 @@ struct ArgParser::Priv final
     std::vector<FlagImpl*> flags;
     std::vector<SwitchImpl*> switches;
     std::vector<std::string> stray;
+    std::vector<std::string> recognized;
 };
 
 void ArgParser::Priv::check_names(const std::vector<std::string> &names)
@@ -312,6 +314,7 @@ void ArgParser::Priv::parse_single_arg(const std::string &arg)
         if (!flag->has_name(arg))
             continue;
         flag->is_set = true;
+        recognized.push_back(arg);
         return;
     }
 
@@ -339,6 +342,8 @@ void ArgParser::Priv::parse_single_arg(const std::string &arg)
 
         sw->is_set = true;
         sw->value = value;
+        sw->values.push_back(value);
+        recognized.push_back(arg);
         return;
     }
 }
@@ -394,6 +399,15 @@ const std::string ArgParser::get_switch(const std::string &name) const
     throw std::logic_error("Trying to use undefined switch \"" + name + "\"");
 }
 
+const std::vector<std::string> ArgParser::get_switch_values(
+    const std::string &name) const
+{
+    for (const auto &sw : p->switches)
+        if (sw->has_name(name))
+            return sw->values;
+    throw std::logic_error("Trying to use undefined switch \"" + name + "\"");
+}
+
 bool ArgParser::has_flag(const std::string &name) const
 {
     for (const auto &f : p->flags)
@@ -407,6 +421,11 @@ const std::vector<std::string> ArgParser::get_stray() const
     return p->stray;
 }
 
+const std::vector<std::string> ArgParser::get_recognized() const
+{
+    return p->recognized;
+}
+
 void ArgParser::print_help(const Logger &logger) const
 {
     if (!p->options.size())
@@ -66,8 +66,16 @@ namespace au {
         bool has_switch(const std::string &name) const;
 
         const std::string get_switch(const std::string &name) const;
+
+        // all the values of a switch given multiple times, in order
+        const std::vector<std::string> get_switch_values(
+            const std::string &name) const;
         const std::vector<std::string> get_stray() const;
 
+        // arguments that matched registered flags or switches, in the order
+        // they were given
+        const std::vector<std::string> get_recognized() const;
+
     private:
         struct Priv;
         std::unique_ptr<Priv> p;
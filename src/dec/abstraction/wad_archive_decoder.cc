@@ -18,6 +18,7 @@
 #include "dec/abstraction/wad_archive_decoder.h"
 #include "algo/locale.h"
 #include "algo/range.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::abstraction;
@@ -82,8 +83,10 @@ std::unique_ptr<io::File> WadArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
 std::vector<std::string> WadArchiveDecoder::get_linked_formats() const
@@ -91,4 +94,5 @@ std::vector<std::string> WadArchiveDecoder::get_linked_formats() const
     return {"truevision/tga"};
 }
 
-static auto _ = dec::register_decoder<WadArchiveDecoder>("abstraction/wad");
+static auto _ = dec::register_decoder<WadArchiveDecoder>(
+    "abstraction/wad").with_magic(magic);
@@ -132,4 +132,5 @@ res::Image EdtImageDecoder::decode_impl(
     return image;
 }
 
-static auto _ = dec::register_decoder<EdtImageDecoder>("active-soft/edt");
+static auto _ = dec::register_decoder<EdtImageDecoder>(
+    "active-soft/edt").with_magic(magic);
@@ -55,7 +55,7 @@ std::unique_ptr<dec::ArchiveMeta> AfaArchiveDecoder::read_meta_impl(
 
     io::MemoryByteStream table_stream(
         algo::pack::zlib_inflate(
-            input_file.stream.read(table_size_comp)));
+            input_file.stream.read(table_size_comp), table_size_orig));
 
     auto meta = std::make_unique<ArchiveMeta>();
     for (const auto i : algo::range(file_count))
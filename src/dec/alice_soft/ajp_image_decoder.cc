@@ -75,4 +75,5 @@ res::Image AjpImageDecoder::decode_impl(
     return image;
 }
 
-static auto _ = dec::register_decoder<AjpImageDecoder>("alice-soft/ajp");
+static auto _ = dec::register_decoder<AjpImageDecoder>(
+    "alice-soft/ajp").with_magic(magic);
@@ -59,4 +59,5 @@ res::Image DcfImageDecoder::decode_impl(
     return qnt_decoder.decode(logger, qnt_file);
 }
 
-static auto _ = dec::register_decoder<DcfImageDecoder>("alice-soft/dcf");
+static auto _ = dec::register_decoder<DcfImageDecoder>(
+    "alice-soft/dcf").with_magic(magic1);
@@ -95,4 +95,4 @@ std::vector<std::string> Pac2ArchiveDecoder::get_linked_formats() const
 }
 
 static auto _ = dec::register_decoder<Pac2ArchiveDecoder>(
-    "almond-collective/pac2");
+    "almond-collective/pac2").with_magic(magic);
@@ -442,4 +442,4 @@ std::unique_ptr<io::File> Pac3ArchiveDecoder::read_file_impl(
 }
 
 static auto _ = dec::register_decoder<Pac3ArchiveDecoder>(
-    "almond-collective/pac3");
+    "almond-collective/pac3").with_magic(magic);
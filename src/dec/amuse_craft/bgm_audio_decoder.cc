@@ -43,4 +43,5 @@ std::unique_ptr<io::File> BgmAudioDecoder::decode_impl(
     return output_file;
 }
 
-static auto _ = dec::register_decoder<BgmAudioDecoder>("amuse-craft/bgm");
+static auto _ = dec::register_decoder<BgmAudioDecoder>(
+    "amuse-craft/bgm").with_magic(magic);
@@ -84,4 +84,5 @@ res::Image AgfImageDecoder::decode_impl(
     return res::Image(width, height, output, res::PixelFormat::BGRA8888);
 }
 
-static auto _ = dec::register_decoder<AgfImageDecoder>("aoi/agf");
+static auto _ = dec::register_decoder<AgfImageDecoder>(
+    "aoi/agf").with_magic(magic);
@@ -87,4 +87,5 @@ std::unique_ptr<io::File> GxpArchiveDecoder::read_file_impl(
     return std::make_unique<io::File>(entry->path, decrypt(data));
 }
 
-static auto _ = dec::register_decoder<GxpArchiveDecoder>("avg/gxp");
+static auto _ = dec::register_decoder<GxpArchiveDecoder>(
+    "avg/gxp").with_magic(magic);
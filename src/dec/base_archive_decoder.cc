@@ -18,13 +18,25 @@
 #include "dec/base_archive_decoder.h"
 #include <algorithm>
 #include <cmath>
+#include <typeinfo>
 #include "algo/format.h"
+#include "algo/range.h"
 #include "dec/idecoder_visitor.h"
 #include "err.h"
+#include "io/memory_byte_stream.h"
 
 using namespace au;
 using namespace au::dec;
 
+namespace
+{
+    enum class SerializedEntryType : u8
+    {
+        Plain = 1,
+        Compressed = 2,
+    };
+}
+
 algo::NamingStrategy BaseArchiveDecoder::naming_strategy() const
 {
     return algo::NamingStrategy::Child;
@@ -109,3 +121,96 @@ std::unique_ptr<io::File> BaseArchiveDecoder::read_file(
     // wrapper reserved for future usage
     return read_file_impl(logger, input_file, e, m);
 }
+
+bstr BaseArchiveDecoder::serialize_meta(const ArchiveMeta &meta) const
+{
+    return serialize_meta_impl(meta);
+}
+
+std::unique_ptr<ArchiveMeta> BaseArchiveDecoder::deserialize_meta(
+    const Logger &logger, io::File &input_file, const bstr &data) const
+{
+    io::MemoryByteStream input_stream(data);
+    auto meta = deserialize_meta_impl(logger, input_file, input_stream);
+    if (!meta)
+        throw err::NotSupportedError("Archive index can't be deserialized");
+    if (input_stream.left())
+        throw err::CorruptDataError("Archive index contains data beyond EOF");
+    return meta;
+}
+
+bstr BaseArchiveDecoder::serialize_meta_impl(const ArchiveMeta &meta) const
+{
+    // subclasses might carry state that would be lost
+    if (typeid(meta) != typeid(ArchiveMeta))
+        return ""_b;
+
+    io::MemoryByteStream output_stream;
+    output_stream.write_le<u32>(meta.entries.size());
+    for (const auto &entry : meta.entries)
+    {
+        const auto &entry_type = typeid(*entry);
+        if (entry_type == typeid(PlainArchiveEntry))
+        {
+            const auto plain_entry
+                = static_cast<const PlainArchiveEntry*>(entry.get());
+            output_stream.write<u8>(
+                static_cast<u8>(SerializedEntryType::Plain));
+            output_stream.write_le<u64>(plain_entry->offset);
+            output_stream.write_le<u64>(plain_entry->size);
+        }
+        else if (entry_type == typeid(CompressedArchiveEntry))
+        {
+            const auto compressed_entry
+                = static_cast<const CompressedArchiveEntry*>(entry.get());
+            output_stream.write<u8>(
+                static_cast<u8>(SerializedEntryType::Compressed));
+            output_stream.write_le<u64>(compressed_entry->offset);
+            output_stream.write_le<u64>(compressed_entry->size_orig);
+            output_stream.write_le<u64>(compressed_entry->size_comp);
+        }
+        else
+            return ""_b;
+
+        const auto path = entry->path.str();
+        output_stream.write_le<u32>(path.size());
+        output_stream.write(path);
+    }
+    return output_stream.seek(0).read_to_eof();
+}
+
+std::unique_ptr<ArchiveMeta> BaseArchiveDecoder::deserialize_meta_impl(
+    const Logger &logger,
+    io::File &input_file,
+    io::BaseByteStream &input_stream) const
+{
+    auto meta = std::make_unique<ArchiveMeta>();
+    const auto entry_count = input_stream.read_le<u32>();
+    for (const auto i : algo::range(entry_count))
+    {
+        std::unique_ptr<ArchiveEntry> entry;
+        const auto entry_type
+            = static_cast<SerializedEntryType>(input_stream.read<u8>());
+        if (entry_type == SerializedEntryType::Plain)
+        {
+            auto plain_entry = std::make_unique<PlainArchiveEntry>();
+            plain_entry->offset = input_stream.read_le<u64>();
+            plain_entry->size = input_stream.read_le<u64>();
+            entry = std::move(plain_entry);
+        }
+        else if (entry_type == SerializedEntryType::Compressed)
+        {
+            auto compressed_entry = std::make_unique<CompressedArchiveEntry>();
+            compressed_entry->offset = input_stream.read_le<u64>();
+            compressed_entry->size_orig = input_stream.read_le<u64>();
+            compressed_entry->size_comp = input_stream.read_le<u64>();
+            entry = std::move(compressed_entry);
+        }
+        else
+            throw err::CorruptDataError("Unknown archive index entry type");
+
+        entry->path = input_stream.read(input_stream.read_le<u32>()).str();
+        meta->entries.push_back(std::move(entry));
+    }
+    return meta;
+}
@@ -68,17 +68,36 @@ namespace dec {
             const ArchiveMeta &m,
             const ArchiveEntry &e) const;
 
+        // Lets the archive index be cached between runs. An empty result
+        // means that given meta can't be serialized.
+        bstr serialize_meta(const ArchiveMeta &meta) const;
+        std::unique_ptr<ArchiveMeta> deserialize_meta(
+            const Logger &logger,
+            io::File &input_file,
+            const bstr &data) const;
+
     protected:
         virtual std::unique_ptr<ArchiveMeta> read_meta_impl(
             const Logger &logger,
             io::File &input_file) const = 0;
 
+        // The returned file may be backed by a stream that decodes the
+        // entry lazily (e.g. a slice of the input stream), so that large
+        // entries are never materialized in memory as a whole.
         virtual std::unique_ptr<io::File> read_file_impl(
             const Logger &logger,
             io::File &input_file,
             const ArchiveMeta &m,
             const ArchiveEntry &e) const = 0;
 
+        // The default implementations handle metas made only of plain and
+        // compressed entries. Decoders with richer metas can override both.
+        virtual bstr serialize_meta_impl(const ArchiveMeta &meta) const;
+        virtual std::unique_ptr<ArchiveMeta> deserialize_meta_impl(
+            const Logger &logger,
+            io::File &input_file,
+            io::BaseByteStream &input_stream) const;
+
     private:
         bool numeric_file_names;
     };
@@ -28,8 +28,16 @@ namespace cbg {
     class Cbg2Decoder final
     {
     public:
+        // Rows of blocks are spread over thread_count threads; 0 stands for
+        // the thread budget of the calling thread (see
+        // algo::get_thread_budget).
+        Cbg2Decoder(const size_t thread_count = 0);
+
         std::unique_ptr<res::Image> decode(
             io::BaseByteStream &input_stream) const;
+
+    private:
+        const size_t thread_count;
     };
 
 } } } }
@@ -16,29 +16,16 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "dec/bgi/dsc_file_decoder.h"
+#include "algo/pack/huffman.h"
 #include "algo/range.h"
 #include "dec/bgi/common.h"
 #include "enc/png/png_image_encoder.h"
 #include "err.h"
 #include "io/memory_byte_stream.h"
-#include "io/msb_bit_stream.h"
 
 using namespace au;
 using namespace au::dec::bgi;
 
-namespace
-{
-    struct NodeInfo final
-    {
-        bool has_children;
-        bool look_behind;
-        u8 value;
-        u32 children[2];
-    };
-
-    using NodeList = std::vector<std::unique_ptr<NodeInfo>>;
-}
-
 static const bstr magic = "DSC FORMAT 1.00\x00"_b;
 
 static int is_image(const bstr &input)
@@ -54,15 +41,16 @@ static int is_image(const bstr &input)
     return width && height && (bpp == 8 || bpp == 24 || bpp == 32);
 }
 
-static NodeList get_nodes(io::BaseByteStream &input_stream, u32 key)
+// Leaf symbols carry the byte value in the low 8 bits, and the 9th bit tells
+// whether it's a literal or the size of a look-behind copy.
+static algo::pack::HuffmanTable read_table(
+    io::BaseByteStream &input_stream, u32 key)
 {
-    NodeList nodes;
-    for (const auto i : algo::range(1024))
+    std::vector<algo::pack::HuffmanTable::Node> nodes(1024);
+    for (auto &node : nodes)
     {
-        auto node_info = std::make_unique<NodeInfo>();
-        node_info->has_children = false;
-        node_info->value = 0;
-        nodes.push_back(std::move(node_info));
+        node.is_leaf = true;
+        node.symbol = 0;
     }
 
     std::vector<u32> arr0;
@@ -90,9 +78,8 @@ static NodeList get_nodes(io::BaseByteStream &input_stream, u32 key)
             const u32 c = arr0_pos < arr0.size() ? arr0[arr0_pos] : 0;
             if (n != (c >> 16))
                 break;
-            nodes[*node_ptr]->has_children = false;
-            nodes[*node_ptr]->look_behind = (arr0[arr0_pos] & 0x100) != 0;
-            nodes[*node_ptr]->value = arr0[arr0_pos] & 0xFF;
+            nodes.at(*node_ptr).is_leaf = true;
+            nodes.at(*node_ptr).symbol = arr0[arr0_pos] & 0x1FF;
             arr0_pos++;
             node_ptr++;
             group_count++;
@@ -104,9 +91,10 @@ static NodeList get_nodes(io::BaseByteStream &input_stream, u32 key)
             unk1 = unk1 - group_count;
             for (const auto i : algo::range(unk1))
             {
-                nodes[*node_ptr]->has_children = true;
+                auto &node = nodes.at(*node_ptr);
+                node.is_leaf = false;
                 for (const auto j : algo::range(2))
-                    *arr1_ptr++ = nodes[*node_ptr]->children[j] = node_index++;
+                    *arr1_ptr++ = node.children[j] = node_index++;
                 node_ptr++;
             }
         }
@@ -114,31 +102,28 @@ static NodeList get_nodes(io::BaseByteStream &input_stream, u32 key)
         node_ptr = arr1_old_ptr;
         unk0 ^= 0x200;
     }
-    return nodes;
+    return algo::pack::HuffmanTable(nodes, 0);
 }
 
 static bstr decompress(
     io::BaseByteStream &input_stream,
-    const NodeList &nodes,
+    const algo::pack::HuffmanTable &table,
     size_t output_size)
 {
     bstr output(output_size);
     u8 *output_ptr = output.get<u8>();
     const u8 *output_start = output_ptr;
     const u8 *output_end = output_ptr + output.size();
-    io::MsbBitStream bit_stream(input_stream.read_to_eof());
+    const auto input = input_stream.read_to_eof();
+    io::MsbBitReader reader(input);
 
-    u32 bits = 0, bit_count = 0;
     while (output_ptr < output_end)
     {
-        u32 node_index = 0;
-        while (nodes[node_index]->has_children)
-            node_index = nodes[node_index]->children[bit_stream.read(1)];
-
-        if (nodes[node_index]->look_behind)
+        const auto symbol = table.decode(reader);
+        if (symbol & 0x100)
         {
-            auto offset = bit_stream.read(12);
-            size_t repetitions = nodes[node_index]->value + 2;
+            auto offset = reader.read(12);
+            size_t repetitions = (symbol & 0xFF) + 2;
             u8 *look_behind = output_ptr - offset - 2;
             if (look_behind < output_start)
                 break;
@@ -149,7 +134,7 @@ static bstr decompress(
         }
         else
         {
-            *output_ptr++ = nodes[node_index]->value;
+            *output_ptr++ = symbol;
         }
     }
 
@@ -169,9 +154,8 @@ std::unique_ptr<io::File> DscFileDecoder::decode_impl(
     const auto output_size = input_file.stream.read_le<u32>();
     input_file.stream.skip(8);
 
-    const auto nodes = get_nodes(input_file.stream, key);
-    const auto data = decompress(
-        input_file.stream, std::move(nodes), output_size);
+    const auto table = read_table(input_file.stream, key);
+    const auto data = decompress(input_file.stream, table, output_size);
 
     if (is_image(data))
     {
@@ -210,4 +194,5 @@ std::unique_ptr<io::File> DscFileDecoder::decode_impl(
     return output_file;
 }
 
-static auto _ = dec::register_decoder<DscFileDecoder>("bgi/dsc");
+static auto _ = dec::register_decoder<DscFileDecoder>(
+    "bgi/dsc").with_magic(magic);
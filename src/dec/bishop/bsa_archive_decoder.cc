@@ -18,6 +18,7 @@
 #include "dec/bishop/bsa_archive_decoder.h"
 #include "algo/range.h"
 #include "err.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::bishop;
@@ -105,8 +106,10 @@ std::unique_ptr<io::File> BsaArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
 std::vector<std::string> BsaArchiveDecoder::get_linked_formats() const
@@ -114,4 +117,5 @@ std::vector<std::string> BsaArchiveDecoder::get_linked_formats() const
     return {"bishop/bsc", "bishop/bsg"};
 }
 
-static auto _ = dec::register_decoder<BsaArchiveDecoder>("bishop/bsa");
+static auto _ = dec::register_decoder<BsaArchiveDecoder>(
+    "bishop/bsa").with_magic(magic);
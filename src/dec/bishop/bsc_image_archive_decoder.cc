@@ -16,6 +16,7 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "dec/bishop/bsc_image_archive_decoder.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::bishop;
@@ -56,8 +57,11 @@ std::unique_ptr<io::File> BscImageArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
-static auto _ = dec::register_decoder<BscImageArchiveDecoder>("bishop/bsc");
+static auto _ = dec::register_decoder<BscImageArchiveDecoder>(
+    "bishop/bsc").with_magic(magic);
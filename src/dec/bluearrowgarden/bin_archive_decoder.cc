@@ -109,4 +109,5 @@ std::vector<std::string> BinArchiveDecoder::get_linked_formats() const
     return {"bluearrowgarden/images"};
 }
 
-static auto _ = dec::register_decoder<BinArchiveDecoder>("bluearrowgarden/bin");
+static auto _ = dec::register_decoder<BinArchiveDecoder>(
+    "bluearrowgarden/bin").with_extension("bin");
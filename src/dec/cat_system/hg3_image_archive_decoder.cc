@@ -230,4 +230,5 @@ algo::NamingStrategy Hg3ImageArchiveDecoder::naming_strategy() const
     return algo::NamingStrategy::Sibling;
 }
 
-static auto _ = dec::register_decoder<Hg3ImageArchiveDecoder>("cat-system/hg3");
+static auto _ = dec::register_decoder<Hg3ImageArchiveDecoder>(
+    "cat-system/hg3").with_magic(magic);
@@ -17,6 +17,7 @@
 
 #include "dec/cherry_soft/myk_archive_decoder.h"
 #include "algo/range.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::cherry_soft;
@@ -57,8 +58,11 @@ std::unique_ptr<io::File> MykArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
-static auto _ = dec::register_decoder<MykArchiveDecoder>("cherry-soft/myk");
+static auto _ = dec::register_decoder<MykArchiveDecoder>(
+    "cherry-soft/myk").with_magic(magic);
@@ -423,4 +423,5 @@ std::vector<std::string> CpkArchiveDecoder::get_linked_formats() const
     return {"cri/hca", "cri/xtx", "playstation/gxt", "playstation/gtf"};
 }
 
-static auto _ = dec::register_decoder<CpkArchiveDecoder>("cri/cpk");
+static auto _ = dec::register_decoder<CpkArchiveDecoder>(
+    "cri/cpk").with_magic(magic);
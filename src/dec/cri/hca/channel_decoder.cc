@@ -17,11 +17,19 @@
 
 #include "dec/cri/hca/channel_decoder.h"
 #include "algo/range.h"
+#include "algo/simd.h"
 #include "err.h"
 
 using namespace au;
 using namespace au::dec::cri::hca;
 
+#ifdef AU_USE_SSE2
+static inline __m128 reverse(const __m128 x)
+{
+    return _mm_shuffle_ps(x, x, _MM_SHUFFLE(0, 1, 2, 3));
+}
+#endif
+
 static void decode5_copy1(f32 *s, f32 *d)
 {
     for (const auto i : algo::range(7))
@@ -32,7 +40,22 @@ static void decode5_copy1(f32 *s, f32 *d)
         auto d2 = &d[count2];
         for (const auto j : algo::range(count1))
         {
-            for (const auto k : algo::range(count2))
+            auto k = 0;
+#ifdef AU_USE_SSE2
+            for (; k + 4 <= count2; k += 4)
+            {
+                const auto x0 = _mm_loadu_ps(s);
+                const auto x1 = _mm_loadu_ps(s + 4);
+                const auto a = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0));
+                const auto b = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1));
+                _mm_storeu_ps(d1, _mm_add_ps(b, a));
+                _mm_storeu_ps(d2, _mm_sub_ps(a, b));
+                s += 8;
+                d1 += 4;
+                d2 += 4;
+            }
+#endif
+            for (; k < count2; k++)
             {
                 const auto a = *s++;
                 const auto b = *s++;
@@ -322,7 +345,27 @@ static f32 *decode5_copy2(f32 *&s, f32 *d)
         auto d2 = &d1[count2 * 2 - 1];
         for (const auto j : algo::range(count1))
         {
-            for (const auto k : algo::range(count2))
+            auto k = 0;
+#ifdef AU_USE_SSE2
+            for (; k + 4 <= count2; k += 4)
+            {
+                const auto a = _mm_loadu_ps(s1);
+                const auto b = _mm_loadu_ps(s2);
+                const auto c = _mm_loadu_ps(list1_f32);
+                const auto d = _mm_loadu_ps(list2_f32);
+                _mm_storeu_ps(
+                    d1, _mm_sub_ps(_mm_mul_ps(a, c), _mm_mul_ps(b, d)));
+                const auto e = _mm_add_ps(_mm_mul_ps(a, d), _mm_mul_ps(b, c));
+                _mm_storeu_ps(d2 - 3, reverse(e));
+                s1 += 4;
+                s2 += 4;
+                list1_f32 += 4;
+                list2_f32 += 4;
+                d1 += 4;
+                d2 -= 4;
+            }
+#endif
+            for (; k < count2; k++)
             {
                 const auto a = *s1++;
                 const auto b = *s2++;
@@ -350,7 +393,7 @@ static void decode5_copy3(f32 *&s, f32 *d)
 }
 
 ChannelDecoder::ChannelDecoder(const int type, const int idx, const int count)
-    : type(type), count(count), value3(&value[idx])
+    : value2_reused(false), type(type), count(count), value3(&value[idx])
 {
     for (const auto i : algo::range(128))
     {
@@ -359,7 +402,7 @@ ChannelDecoder::ChannelDecoder(const int type, const int idx, const int count)
     }
     for (const auto i : algo::range(8))
     {
-        for (const auto j : algo::range(8))
+        for (const auto j : algo::range(128))
             wave[i][j] = 0;
         value2[i] = 0;
     }
@@ -456,6 +499,7 @@ void ChannelDecoder::decode1(
             value[i] = 0;
     }
 
+    value2_reused = false;
     if (type == 2)
     {
         v = bit_stream.read(4);
@@ -466,6 +510,8 @@ void ChannelDecoder::decode1(
             for (const auto i : algo::range(8))
                 value2[i] = bit_stream.read(4);
         }
+        else
+            value2_reused = true;
     }
     else
     {
@@ -714,15 +760,41 @@ void ChannelDecoder::decode5(const int index)
         }
     };
 
-    auto s3 = reinterpret_cast<const f32*>(list3_u32[0]);
-    auto d = wave[index];
-    f32 *s1, *s2;
-    s1 = &wav2[64];
-    s2 = wav3;
-    for (const auto i : algo::range(64)) *d++ = *s1++ * *s3++ + *s2++;
-    for (const auto i : algo::range(64)) *d++ = *s3++ * *--s1 - *s2++;
-    s1 = &wav2[64-1];
-    s2 = wav3;
-    for (const auto i : algo::range(64)) *s2++ = *s1-- * *--s3;
-    for (const auto i : algo::range(64)) *s2++ = *--s3 * *++s1;
+    // overlap the window with the previous subframe and keep the second
+    // half for the next one
+    const auto window = reinterpret_cast<const f32*>(list3_u32);
+    const auto d = wave[index];
+    int i = 0;
+#ifdef AU_USE_SSE2
+    for (; i < 64; i += 4)
+    {
+        const auto w1 = _mm_loadu_ps(&window[i]);
+        const auto w2 = _mm_loadu_ps(&window[64 + i]);
+        const auto w3 = reverse(_mm_loadu_ps(&window[124 - i]));
+        const auto w4 = reverse(_mm_loadu_ps(&window[60 - i]));
+        const auto s1 = _mm_loadu_ps(&wav2[64 + i]);
+        const auto s2 = reverse(_mm_loadu_ps(&wav2[124 - i]));
+        const auto s3 = reverse(_mm_loadu_ps(&wav2[60 - i]));
+        const auto s4 = _mm_loadu_ps(&wav2[i]);
+        _mm_storeu_ps(
+            &d[i], _mm_add_ps(_mm_mul_ps(s1, w1), _mm_loadu_ps(&wav3[i])));
+        _mm_storeu_ps(
+            &d[64 + i],
+            _mm_sub_ps(_mm_mul_ps(w2, s2), _mm_loadu_ps(&wav3[64 + i])));
+        _mm_storeu_ps(&wav3[i], _mm_mul_ps(s3, w3));
+        _mm_storeu_ps(&wav3[64 + i], _mm_mul_ps(w4, s4));
+    }
+#endif
+    for (; i < 64; i++)
+    {
+        d[i] = wav2[64 + i] * window[i] + wav3[i];
+        d[64 + i] = window[64 + i] * wav2[127 - i] - wav3[64 + i];
+        wav3[i] = wav2[63 - i] * window[127 - i];
+        wav3[64 + i] = window[63 - i] * wav2[i];
+    }
+}
+
+bool ChannelDecoder::depends_on_previous_block() const
+{
+    return value2_reused;
 }
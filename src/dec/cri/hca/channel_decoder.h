@@ -53,9 +53,14 @@ namespace hca {
 
         void decode5(const int index);
 
+        // Whether the last decode1 kept some of the values read for the
+        // previous block, in which case the decoded block depends on it.
+        bool depends_on_previous_block() const;
+
         f32 wave[8][128];
 
     private:
+        bool value2_reused;
         int type;
         unsigned int count;
         u8 scale[128];
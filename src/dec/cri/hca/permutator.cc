@@ -130,10 +130,8 @@ Permutator::~Permutator()
 {
 }
 
-bstr Permutator::permute(const bstr &input)
+void Permutator::permute(bstr &data) const
 {
-    bstr output(input.size());
-    for (const auto i : algo::range(input.size()))
-        output[i] = p->table[input[i]];
-    return output;
+    for (auto &c : data)
+        c = p->table[c];
 }
@@ -31,7 +31,7 @@ namespace hca {
     public:
         Permutator(const u16 type, const u32 key1, const u32 key2);
         ~Permutator();
-        bstr permute(const bstr &data);
+        void permute(bstr &data) const;
 
     private:
         struct Priv;
@@ -17,6 +17,7 @@
 
 #include "dec/cri/hca_audio_decoder.h"
 #include "algo/locale.h"
+#include "algo/parallel.h"
 #include "algo/range.h"
 #include "dec/cri/hca/ath_table.h"
 #include "dec/cri/hca/channel_decoder.h"
@@ -31,6 +32,9 @@ using namespace au::dec::cri::hca;
 
 static const bstr magic = "HCA\x00"_b;
 
+// 8 subframes of 128 samples per channel
+static const size_t samples_per_block = 8 * 128;
+
 static inline f32 clamp(const f32 input)
 {
     if (input > 1)
@@ -138,60 +142,153 @@ static std::vector<u8> get_types(
     return types;
 }
 
-static void decode_block(
-    const Meta &meta,
-    const AthTable &ath_table,
-    std::vector<std::shared_ptr<ChannelDecoder>> &channel_decoders,
-    const std::array<u8, 9> params,
-    const bstr &block_data)
+namespace
+{
+    struct DecodingContext final
+    {
+        const Meta &meta;
+        const AthTable &ath_table;
+        const std::array<u8, 9> &params;
+        const std::vector<u8> &types;
+        const bstr &data;
+    };
+
+    using ChannelDecoders = std::vector<std::unique_ptr<ChannelDecoder>>;
+}
+
+static ChannelDecoders create_channel_decoders(const DecodingContext &context)
 {
+    const auto &params = context.params;
+    ChannelDecoders channel_decoders;
+    for (const auto i : algo::range(context.meta.fmt->channel_count))
+    {
+        channel_decoders.push_back(std::make_unique<ChannelDecoder>(
+            context.types[i],
+            params[5] + params[6],
+            params[5] + ((context.types[i] != 2) ? params[6] : 0)));
+    }
+    return channel_decoders;
+}
+
+// Returns whether the decoded block didn't depend on the previous ones, in
+// which case the state of the channel decoders is the same as if they had
+// decoded all the blocks before it.
+static bool decode_block(
+    const DecodingContext &context,
+    ChannelDecoders &channel_decoders,
+    const size_t block_number)
+{
+    const auto &meta = context.meta;
+    const auto &params = context.params;
+    const auto block_size = meta.comp->block_size;
+    const auto block_data = context.data.substr(
+        block_number * block_size, block_size);
     if (crc16(block_data) != 0)
         throw err::CorruptDataError("Block checksum failed");
 
     // suspicion: I believe the last 2 bytes are used as a CRC16 manipulator
     // (so that the checksum computes to 0.)
-    io::MsbBitStream bit_stream(block_data.substr(0, block_data.size()));
+    io::MsbBitStream bit_stream(block_data);
 
     int magic = bit_stream.read(16);
-    if (magic == 0xFFFF)
+    if (magic != 0xFFFF)
+        return false;
+
+    int tmp = (bit_stream.read(9) << 8) - bit_stream.read(7);
+    for (const auto i : algo::range(meta.fmt->channel_count))
     {
-        int tmp = (bit_stream.read(9) << 8) - bit_stream.read(7);
-        for (const auto i : algo::range(meta.fmt->channel_count))
+        channel_decoders[i]->decode1(
+            bit_stream, params[8], tmp, context.ath_table);
+    }
+
+    for (const auto i : algo::range(8))
+    {
+        for (const auto j : algo::range(meta.fmt->channel_count))
+            channel_decoders[j]->decode2(bit_stream);
+
+        for (const auto j : algo::range(meta.fmt->channel_count))
+        {
+            channel_decoders[j]->decode3(
+                params[8],
+                params[7],
+                params[6] + params[5],
+                params[4]);
+        }
+
+        for (const auto j : algo::range(meta.fmt->channel_count - 1))
         {
-            channel_decoders[i]->decode1(
-                bit_stream, params[8], tmp, ath_table);
+            channel_decoders[j]->decode4(
+                i,
+                params[4] - params[5],
+                params[5],
+                params[6],
+                *channel_decoders[j + 1]);
         }
 
+        for (const auto j : algo::range(meta.fmt->channel_count))
+            channel_decoders[j]->decode5(i);
+    }
+
+    for (const auto &channel_decoder : channel_decoders)
+        if (channel_decoder->depends_on_previous_block())
+            return false;
+    return true;
+}
+
+static void write_samples(const ChannelDecoders &channel_decoders, s16 *output)
+{
+    const auto channel_count = channel_decoders.size();
+    for (const auto k : algo::range(channel_count))
+    {
+        const auto &wave = channel_decoders[k]->wave;
+        auto output_ptr = output + k;
         for (const auto i : algo::range(8))
+        for (const auto j : algo::range(128))
         {
-            for (const auto j : algo::range(meta.fmt->channel_count))
-                channel_decoders[j]->decode2(bit_stream);
-
-            for (const auto j : algo::range(meta.fmt->channel_count))
-            {
-                channel_decoders[j]->decode3(
-                    params[8],
-                    params[7],
-                    params[6] + params[5],
-                    params[4]);
-            }
-
-            for (const auto j : algo::range(meta.fmt->channel_count - 1))
-            {
-                channel_decoders[j]->decode4(
-                    i,
-                    params[4] - params[5],
-                    params[5],
-                    params[6],
-                    *channel_decoders[j + 1]);
-            }
-
-            for (const auto j : algo::range(meta.fmt->channel_count))
-                channel_decoders[j]->decode5(i);
+            *output_ptr = static_cast<s16>(clamp(wave[i][j]) * 0x7FFF);
+            output_ptr += channel_count;
         }
     }
 }
 
+static void decode_segment(
+    const DecodingContext &context,
+    const size_t first_block,
+    const size_t last_block,
+    s16 *output)
+{
+    // The decoders carry some state from one block to the next, so each
+    // segment starts decoding a block earlier. If that block happens to
+    // depend on its predecessors as well, the pre-roll reaches further back
+    // until it starts with a self-contained block.
+    auto channel_decoders = create_channel_decoders(context);
+    auto preroll_start = first_block;
+    while (preroll_start > 0)
+    {
+        preroll_start--;
+        channel_decoders = create_channel_decoders(context);
+        if (decode_block(context, channel_decoders, preroll_start))
+            break;
+    }
+    for (const auto b : algo::range(preroll_start + 1, first_block))
+        decode_block(context, channel_decoders, b);
+
+    const auto channel_count = context.meta.fmt->channel_count;
+    for (const auto b : algo::range(first_block, last_block))
+    {
+        decode_block(context, channel_decoders, b);
+        write_samples(
+            channel_decoders,
+            output + b * samples_per_block * channel_count);
+    }
+}
+
+HcaAudioDecoder::HcaAudioDecoder(
+    const size_t thread_count, const size_t blocks_per_segment)
+    : thread_count(thread_count), blocks_per_segment(blocks_per_segment)
+{
+}
+
 bool HcaAudioDecoder::is_recognized_impl(io::File &input_file) const
 {
     return input_file.stream.read(magic.size()) == magic;
@@ -205,7 +302,7 @@ res::Audio HcaAudioDecoder::decode_impl(
     const u32 ciph_key2 = 0xCC554639;
 
     input_file.stream.seek(6);
-    static const u16 meta_size = input_file.stream.read_be<u16>();
+    const u16 meta_size = input_file.stream.read_be<u16>();
 
     input_file.stream.seek(0);
     auto meta = read_meta(input_file.stream.read(meta_size));
@@ -224,7 +321,6 @@ res::Audio HcaAudioDecoder::decode_impl(
     const auto channel_count = meta.fmt->channel_count;
     const auto block_size = meta.comp->block_size;
     const auto block_count = meta.fmt->block_count;
-    const auto volume = meta.rva->volume;
 
     AthTable ath_table(meta.ath->type, sample_rate);
     Permutator permutator(meta.ciph->type, ciph_key1, ciph_key2);
@@ -237,44 +333,34 @@ res::Audio HcaAudioDecoder::decode_impl(
     params[8] = ceil2(params[4] - (params[5] + params[6]), params[7]);
 
     const auto types = get_types(meta, params);
-    std::vector<std::shared_ptr<ChannelDecoder>> channel_decoders;
-    for (const auto i : algo::range(channel_count))
-    {
-        auto channel_decoder = std::make_shared<ChannelDecoder>(
-            types[i],
-            params[5] + params[6],
-            params[5] + ((types[i] != 2) ? params[6] : 0));
-        channel_decoders.push_back(channel_decoder);
-    }
 
     input_file.stream.seek(meta.hca->data_offset);
-    std::vector<s16> samples;
-    samples.reserve(128 * 8 * channel_count * block_count);
-    for (const auto b : algo::range(block_count))
-    {
-        decode_block(
-            meta,
-            ath_table,
-            channel_decoders,
-            params,
-            permutator.permute(input_file.stream.read(block_size)));
-
-        for (const auto i : algo::range(8))
-        for (const auto j : algo::range(128))
-        for (const auto k : algo::range(channel_count))
-        {
-            const auto value = clamp(channel_decoders[k]->wave[i][j]);
-            samples.push_back(static_cast<s16>(value * 0x7FFF));
-        }
-    }
+    auto data = input_file.stream.read(block_size * block_count);
+    permutator.permute(data);
 
     res::Audio audio;
     audio.codec = 1;
     audio.channel_count = channel_count;
     audio.sample_rate = sample_rate;
     audio.bits_per_sample = 16;
-    audio.samples
-        = bstr(reinterpret_cast<const u8*>(samples.data()), samples.size() * 2);
+    audio.samples = bstr(
+        block_count * samples_per_block * channel_count * sizeof(s16));
+
+    const DecodingContext context {meta, ath_table, params, types, data};
+    const auto segment_count
+        = (block_count + blocks_per_segment - 1) / blocks_per_segment;
+    algo::run_in_parallel(
+        segment_count,
+        thread_count,
+        [&](const size_t segment)
+        {
+            const auto first_block = segment * blocks_per_segment;
+            const auto last_block = std::min<size_t>(
+                block_count, first_block + blocks_per_segment);
+            decode_segment(
+                context, first_block, last_block, audio.samples.get<s16>());
+        });
+
     if (meta.loop)
     {
         audio.loops.push_back(res::AudioLoopInfo
@@ -287,4 +373,5 @@ res::Audio HcaAudioDecoder::decode_impl(
     return audio;
 }
 
-static auto _ = dec::register_decoder<HcaAudioDecoder>("cri/hca");
+static auto _ = dec::register_decoder<HcaAudioDecoder>(
+    "cri/hca").with_magic(magic);
@@ -25,10 +25,22 @@ namespace cri {
 
     class HcaAudioDecoder final : public BaseAudioDecoder
     {
+    public:
+        // Blocks are decoded in segments of blocks_per_segment blocks,
+        // spread over thread_count threads; 0 stands for the thread budget
+        // of the calling thread (see algo::get_thread_budget).
+        HcaAudioDecoder(
+            const size_t thread_count = 0,
+            const size_t blocks_per_segment = 64);
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
         res::Audio decode_impl(
             const Logger &logger, io::File &input_file) const override;
+
+    private:
+        const size_t thread_count;
+        const size_t blocks_per_segment;
     };
 
 } } }
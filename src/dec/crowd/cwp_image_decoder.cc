@@ -65,4 +65,5 @@ res::Image CwpImageDecoder::decode_impl(
     return image;
 }
 
-static auto _ = dec::register_decoder<CwpImageDecoder>("crowd/cwp");
+static auto _ = dec::register_decoder<CwpImageDecoder>(
+    "crowd/cwp").with_magic(magic);
@@ -18,6 +18,7 @@
 #include "dec/crowd/pck_archive_decoder.h"
 #include "algo/locale.h"
 #include "algo/range.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::crowd;
@@ -62,8 +63,10 @@ std::unique_ptr<io::File> PckArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
 std::vector<std::string> PckArchiveDecoder::get_linked_formats() const
@@ -71,4 +74,5 @@ std::vector<std::string> PckArchiveDecoder::get_linked_formats() const
     return {"crowd/eog"};
 }
 
-static auto _ = dec::register_decoder<PckArchiveDecoder>("crowd/pck");
+static auto _ = dec::register_decoder<PckArchiveDecoder>(
+    "crowd/pck").with_extension("pck");
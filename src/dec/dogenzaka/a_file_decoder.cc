@@ -78,4 +78,5 @@ std::unique_ptr<io::File> AFileDecoder::decode_impl(
     return output_file;
 }
 
-static auto _ = dec::register_decoder<AFileDecoder>("dogenzaka/a");
+static auto _ = dec::register_decoder<AFileDecoder>(
+    "dogenzaka/a").with_magic(magic);
@@ -108,4 +108,5 @@ std::unique_ptr<io::File> AcpFileDecoder::decode_impl(
     return std::make_unique<io::File>(input_file.path, data);
 }
 
-static auto _ = dec::register_decoder<AcpFileDecoder>("escude/acp");
+static auto _ = dec::register_decoder<AcpFileDecoder>(
+    "escude/acp").with_magic(magic);
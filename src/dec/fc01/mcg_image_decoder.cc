@@ -150,4 +150,5 @@ res::Image McgImageDecoder::decode_impl(
     return res::Image(width, height, data, res::PixelFormat::BGR888);
 }
 
-static auto _ = dec::register_decoder<McgImageDecoder>("fc01/mcg");
+static auto _ = dec::register_decoder<McgImageDecoder>(
+    "fc01/mcg").with_magic(magic);
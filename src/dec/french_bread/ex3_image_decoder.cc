@@ -110,4 +110,5 @@ res::Image Ex3ImageDecoder::decode_impl(
     return bmp_file_decoder.decode(logger, bmp_file);
 }
 
-static auto _ = dec::register_decoder<Ex3ImageDecoder>("french-bread/ex3");
+static auto _ = dec::register_decoder<Ex3ImageDecoder>(
+    "french-bread/ex3").with_magic(magic);
@@ -50,4 +50,5 @@ res::Image PgxImageDecoder::decode_impl(
     return image;
 }
 
-static auto _ = dec::register_decoder<PgxImageDecoder>("glib/pgx");
+static auto _ = dec::register_decoder<PgxImageDecoder>(
+    "glib/pgx").with_magic(magic);
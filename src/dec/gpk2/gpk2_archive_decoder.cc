@@ -17,6 +17,7 @@
 
 #include "dec/gpk2/gpk2_archive_decoder.h"
 #include "algo/range.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::gpk2;
@@ -55,8 +56,10 @@ std::unique_ptr<io::File> Gpk2ArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
 std::vector<std::string> Gpk2ArchiveDecoder::get_linked_formats() const
@@ -64,4 +67,5 @@ std::vector<std::string> Gpk2ArchiveDecoder::get_linked_formats() const
     return {"gpk2/gfb"};
 }
 
-static auto _ = dec::register_decoder<Gpk2ArchiveDecoder>("gpk2/gpk2");
+static auto _ = dec::register_decoder<Gpk2ArchiveDecoder>(
+    "gpk2/gpk2").with_magic(magic);
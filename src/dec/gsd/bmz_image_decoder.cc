@@ -39,4 +39,5 @@ res::Image BmzImageDecoder::decode_impl(
     return dec::microsoft::BmpImageDecoder().decode(logger, *pseudo_file);
 }
 
-static auto _ = dec::register_decoder<BmzImageDecoder>("gsd/bmz");
+static auto _ = dec::register_decoder<BmzImageDecoder>(
+    "gsd/bmz").with_magic(magic);
@@ -18,6 +18,7 @@
 #include "dec/ism/isa_archive_decoder.h"
 #include "algo/range.h"
 #include "io/memory_byte_stream.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::ism;
@@ -56,8 +57,10 @@ std::unique_ptr<io::File> IsaArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
 std::vector<std::string> IsaArchiveDecoder::get_linked_formats() const
@@ -65,4 +68,5 @@ std::vector<std::string> IsaArchiveDecoder::get_linked_formats() const
     return {"ism/isg"};
 }
 
-static auto _ = dec::register_decoder<IsaArchiveDecoder>("ism/isa");
+static auto _ = dec::register_decoder<IsaArchiveDecoder>(
+    "ism/isa").with_magic(magic);
@@ -126,4 +126,5 @@ res::Image IsgImageDecoder::decode_impl(
     return ret;
 }
 
-static auto _ = dec::register_decoder<IsgImageDecoder>("ism/isg");
+static auto _ = dec::register_decoder<IsgImageDecoder>(
+    "ism/isg").with_magic(magic);
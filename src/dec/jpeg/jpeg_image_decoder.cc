@@ -73,4 +73,5 @@ res::Image JpegImageDecoder::decode_impl(
     return res::Image(width, height, raw_data, format);
 }
 
-static auto _ = dec::register_decoder<JpegImageDecoder>("jpeg/jpeg");
+static auto _ = dec::register_decoder<JpegImageDecoder>(
+    "jpeg/jpeg").with_magic(magic);
@@ -135,4 +135,5 @@ std::unique_ptr<io::File> An21ImageArchiveDecoder::read_file_impl(
     return enc::png::PngImageEncoder().encode(logger, image, entry->path);
 }
 
-static auto _ = dec::register_decoder<An21ImageArchiveDecoder>("kaguya/an21");
+static auto _ = dec::register_decoder<An21ImageArchiveDecoder>(
+    "kaguya/an21").with_magic(magic);
@@ -43,4 +43,5 @@ res::Image AoImageDecoder::decode_impl(
         overlay, x, y, res::Image::OverlayKind::OverwriteNonTransparent);
 }
 
-static auto _ = dec::register_decoder<AoImageDecoder>("kaguya/ao");
+static auto _ = dec::register_decoder<AoImageDecoder>(
+    "kaguya/ao").with_magic(magic);
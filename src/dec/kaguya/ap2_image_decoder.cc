@@ -44,4 +44,5 @@ res::Image Ap2ImageDecoder::decode_impl(
         .flip_vertically();
 }
 
-static auto _ = dec::register_decoder<Ap2ImageDecoder>("kaguya/ap2");
+static auto _ = dec::register_decoder<Ap2ImageDecoder>(
+    "kaguya/ap2").with_magic(magic);
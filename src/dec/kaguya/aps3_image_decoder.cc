@@ -86,4 +86,5 @@ res::Image Aps3ImageDecoder::decode_impl(
     throw err::RecognitionError();
 }
 
-static auto _ = dec::register_decoder<Aps3ImageDecoder>("kaguya/aps3");
+static auto _ = dec::register_decoder<Aps3ImageDecoder>(
+    "kaguya/aps3").with_magic(magic);
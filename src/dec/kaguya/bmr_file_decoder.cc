@@ -189,4 +189,5 @@ std::unique_ptr<io::File> BmrFileDecoder::decode_impl(
     return output_file;
 }
 
-static auto _ = dec::register_decoder<BmrFileDecoder>("kaguya/bmr");
+static auto _ = dec::register_decoder<BmrFileDecoder>(
+    "kaguya/bmr").with_magic(magic);
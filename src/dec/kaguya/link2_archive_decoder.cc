@@ -90,4 +90,5 @@ std::vector<std::string> Link2ArchiveDecoder::get_linked_formats() const
     return {"kaguya/ap", "kaguya/raw-mask", "microsoft/bmp"};
 }
 
-static auto _ = dec::register_decoder<Link2ArchiveDecoder>("kaguya/link2");
+static auto _ = dec::register_decoder<Link2ArchiveDecoder>(
+    "kaguya/link2").with_magic(magic);
@@ -32,4 +32,5 @@ int Link4ArchiveDecoder::get_version() const
     return 4;
 }
 
-static auto _ = dec::register_decoder<Link4ArchiveDecoder>("kaguya/link4");
+static auto _ = dec::register_decoder<Link4ArchiveDecoder>(
+    "kaguya/link4").with_magic(magic);
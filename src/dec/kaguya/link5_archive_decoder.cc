@@ -32,4 +32,5 @@ int Link5ArchiveDecoder::get_version() const
     return 5;
 }
 
-static auto _ = dec::register_decoder<Link5ArchiveDecoder>("kaguya/link5");
+static auto _ = dec::register_decoder<Link5ArchiveDecoder>(
+    "kaguya/link5").with_magic(magic);
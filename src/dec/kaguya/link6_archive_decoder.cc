@@ -32,4 +32,5 @@ int Link6ArchiveDecoder::get_version() const
     return 6;
 }
 
-static auto _ = dec::register_decoder<Link6ArchiveDecoder>("kaguya/link6");
+static auto _ = dec::register_decoder<Link6ArchiveDecoder>(
+    "kaguya/link6").with_magic(magic);
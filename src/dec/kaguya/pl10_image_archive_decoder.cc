@@ -115,4 +115,5 @@ std::unique_ptr<io::File> Pl10ImageArchiveDecoder::read_file_impl(
     return enc::png::PngImageEncoder().encode(logger, image, entry->path);
 }
 
-static auto _ = dec::register_decoder<Pl10ImageArchiveDecoder>("kaguya/pl10");
+static auto _ = dec::register_decoder<Pl10ImageArchiveDecoder>(
+    "kaguya/pl10").with_magic(magic);
@@ -84,4 +84,5 @@ std::unique_ptr<io::File> CpsFileDecoder::decode_impl(
     return output_file;
 }
 
-static auto _ = dec::register_decoder<CpsFileDecoder>("kid/cps");
+static auto _ = dec::register_decoder<CpsFileDecoder>(
+    "kid/cps").with_magic(magic);
@@ -116,4 +116,5 @@ std::unique_ptr<io::File> LndFileDecoder::decode_impl(
     return std::make_unique<io::File>(input_file.path, data);
 }
 
-static auto _ = dec::register_decoder<LndFileDecoder>("kid/lnd");
+static auto _ = dec::register_decoder<LndFileDecoder>(
+    "kid/lnd").with_magic(magic);
@@ -47,4 +47,5 @@ res::Audio WafAudioDecoder::decode_impl(
     return audio;
 }
 
-static auto _ = dec::register_decoder<WafAudioDecoder>("kid/waf");
+static auto _ = dec::register_decoder<WafAudioDecoder>(
+    "kid/waf").with_magic(magic);
@@ -16,6 +16,11 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "dec/kirikiri/cxdec.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include "algo/range.h"
 #include "err.h"
 #include "io/file_byte_stream.h"
@@ -28,6 +33,14 @@ static const size_t control_block_size = 4096;
 static const bstr control_block_magic =
     "\x20\x45\x6E\x63\x72\x79\x70\x74\x69\x6F\x6E\x20\x63\x6F\x6E\x74"_b;
 
+// The original routine assembles x86 code for every key; the code depends
+// only on the seed, so it is compiled once per seed into a small stack
+// program that only gets evaluated for each parameter.
+static const size_t seed_count = 0x80;
+static const size_t max_shellcode_size = 128;
+static const size_t max_stack_depth = 8;
+static const size_t memo_size = 16; // per seed
+
 namespace
 {
     class KeyDerivationError final : public std::runtime_error
@@ -44,51 +57,189 @@ namespace
         std::array<size_t, 6> key_derivation_order3;
     };
 
-    class KeyDeriver final
+    enum class Opcode : u8
+    {
+        // push a value
+        PushImmediate,
+        PushParameter,
+
+        // replace the top value
+        Not,
+        Dec,
+        Neg,
+        Inc,
+        LoadFromControlBlock,
+        SwapBitPairs,
+        XorImmediate,
+        AddImmediate,
+        SubImmediate,
+
+        // pop eax, pop ebx, push the result
+        ShrByEbx,
+        ShlByEbx,
+        AddEbx,
+        SubFromEbx,
+        MulByEbx,
+        SubEbx,
+    };
+
+    struct Instruction final
+    {
+        Opcode opcode;
+        u32 immediate;
+    };
+
+    struct KeyDerivationProgram final
+    {
+        u32 run(const u32 parameter, const u32 *control_block) const;
+
+        std::vector<Instruction> instructions;
+    };
+
+    class KeyDerivationCompiler final
     {
     public:
-        KeyDeriver(const CxdecSettings &settings);
-        u32 derive(u32 seed, u32 parameter);
+        KeyDerivationCompiler(const CxdecSettings &settings);
+        KeyDerivationProgram compile(const u32 seed);
 
     private:
-        void add_shellcode(const bstr &bytes_s);
+        void add_shellcode(const size_t size);
+        void add_instruction(const Opcode opcode, const u32 immediate = 0);
         u32 rand();
-        u32 derive_for_stage(size_t stage);
-        u32 run_first_stage();
-        u32 run_stage_strategy_0(size_t stage);
-        u32 run_stage_strategy_1(size_t stage);
+        void compile_stage(const size_t stage);
+        void compile_first_stage();
+        void compile_stage_strategy_0(const size_t stage);
+        void compile_stage_strategy_1(const size_t stage);
 
         const CxdecSettings &settings;
-        bstr shellcode;
+        KeyDerivationProgram program;
+        size_t shellcode_size;
+        size_t stack_depth;
         u32 seed;
-        size_t parameter;
-        u32 control_block_addr;
+    };
+
+    class KeyDeriver final
+    {
+    public:
+        KeyDeriver(const CxdecSettings &settings);
+        u32 derive(const u32 seed, const u32 parameter) const;
+
+    private:
+        const CxdecSettings settings;
+        std::array<KeyDerivationProgram, seed_count> programs;
+
+        // (parameter, key) pairs, indexed by the low bits of the parameter
+        mutable std::array<std::array<std::atomic<u64>, memo_size>, seed_count>
+            memo;
     };
 }
 
-static bstr u32_to_string(u32 value)
+u32 KeyDerivationProgram::run(
+    const u32 parameter, const u32 *control_block) const
 {
-    return bstr(reinterpret_cast<char*>(&value), 4);
+    if (instructions.empty())
+    {
+        throw err::NotSupportedError(
+            "Failed to derive the key from the parameter");
+    }
+
+    u32 stack[max_stack_depth];
+    size_t sp = 0;
+    for (const auto &instruction : instructions)
+    {
+        switch (instruction.opcode)
+        {
+            case Opcode::PushImmediate:
+                stack[sp++] = instruction.immediate;
+                break;
+            case Opcode::PushParameter:
+                stack[sp++] = parameter;
+                break;
+
+            case Opcode::Not:
+                stack[sp - 1] ^= 0xFFFFFFFF;
+                break;
+            case Opcode::Dec:
+                stack[sp - 1]--;
+                break;
+            case Opcode::Neg:
+                stack[sp - 1]
+                    = static_cast<u32>(-static_cast<s32>(stack[sp - 1]));
+                break;
+            case Opcode::Inc:
+                stack[sp - 1]++;
+                break;
+            case Opcode::LoadFromControlBlock:
+                stack[sp - 1] = control_block[stack[sp - 1] & 0x3FF];
+                break;
+            case Opcode::SwapBitPairs:
+            {
+                const auto eax = stack[sp - 1];
+                stack[sp - 1] = ((eax & 0xAAAAAAAA) >> 1)
+                    | ((eax & 0x55555555) << 1);
+                break;
+            }
+            case Opcode::XorImmediate:
+                stack[sp - 1] ^= instruction.immediate;
+                break;
+            case Opcode::AddImmediate:
+                stack[sp - 1] += instruction.immediate;
+                break;
+            case Opcode::SubImmediate:
+                stack[sp - 1] -= instruction.immediate;
+                break;
+
+            default:
+            {
+                const auto eax = stack[--sp];
+                const auto ebx = stack[sp - 1];
+                auto &result = stack[sp - 1];
+                switch (instruction.opcode)
+                {
+                    case Opcode::ShrByEbx:
+                        result = eax >> (ebx & 0x0F);
+                        break;
+                    case Opcode::ShlByEbx:
+                        result = eax << (ebx & 0x0F);
+                        break;
+                    case Opcode::AddEbx:
+                        result = eax + ebx;
+                        break;
+                    case Opcode::SubFromEbx:
+                        result = ebx - eax;
+                        break;
+                    case Opcode::MulByEbx:
+                        result = eax * ebx;
+                        break;
+                    case Opcode::SubEbx:
+                        result = eax - ebx;
+                        break;
+                    default:
+                        throw std::logic_error("Bad opcode");
+                }
+                break;
+            }
+        }
+    }
+    return stack[0];
 }
 
-KeyDeriver::KeyDeriver(const CxdecSettings &settings) : settings(settings)
+KeyDerivationCompiler::KeyDerivationCompiler(const CxdecSettings &settings)
+    : settings(settings)
 {
-    seed = 0;
-    parameter = 0;
-    control_block_addr = reinterpret_cast<size_t>(&settings.control_block);
 }
 
-u32 KeyDeriver::derive(u32 seed, u32 parameter)
+KeyDerivationProgram KeyDerivationCompiler::compile(const u32 seed)
 {
     this->seed = seed;
-    this->parameter = parameter;
 
-    // What we do: we try to run a code a few times for different "stages".
-    // The first one to succeed yields the key.
+    // What we do: we try to generate code a few times for different
+    // "stages". The first one to fit in the shellcode buffer yields the
+    // program.
 
     // This mechanism of figuring out the valid stage number is really poor,
     // but it's important we do it this way. This is because we initialize the
-    // seed only once, and even if we fail to get a number from the given
+    // seed only once, and even if we fail to generate the code for the given
     // stage, the internal state of randomizer is preserved to the next
     // iteration.
 
@@ -97,28 +248,47 @@ u32 KeyDeriver::derive(u32 seed, u32 parameter)
 
     for (size_t stage = 5; stage > 0; stage--)
     {
+        program.instructions.clear();
+        shellcode_size = 0;
+        stack_depth = 0;
         try
         {
-            return derive_for_stage(stage);
+            compile_stage(stage);
+            return program;
         }
-        catch (const KeyDerivationError)
+        catch (const KeyDerivationError &)
         {
             continue;
         }
     }
 
-    throw err::NotSupportedError("Failed to derive the key from the parameter");
+    // an empty program makes the derivation fail
+    return KeyDerivationProgram();
 }
 
-void KeyDeriver::add_shellcode(const bstr &bytes)
+void KeyDerivationCompiler::add_shellcode(const size_t size)
 {
     // The execution for current stage must fail when we run code for too long.
-    shellcode += bytes;
-    if (shellcode.size() > 128)
+    // Only the size of the machine code matters, so it is not assembled.
+    shellcode_size += size;
+    if (shellcode_size > max_shellcode_size)
         throw KeyDerivationError();
 }
 
-u32 KeyDeriver::rand()
+void KeyDerivationCompiler::add_instruction(
+    const Opcode opcode, const u32 immediate)
+{
+    if (opcode == Opcode::PushImmediate || opcode == Opcode::PushParameter)
+    {
+        if (++stack_depth > max_stack_depth)
+            throw std::logic_error("Key derivation stack overflow");
+    }
+    else if (opcode >= Opcode::ShrByEbx)
+        stack_depth--;
+    program.instructions.push_back({opcode, immediate});
+}
+
+u32 KeyDerivationCompiler::rand()
 {
     // This is a modified glibc LCG randomization routine. It is used to make
     // the key as random as possible for each file, which is supposed to
@@ -128,80 +298,77 @@ u32 KeyDeriver::rand()
     return seed ^ (old_seed << 16) ^ (old_seed >> 16);
 }
 
-u32 KeyDeriver::derive_for_stage(size_t stage)
+void KeyDerivationCompiler::compile_stage(const size_t stage)
 {
-    shellcode = ""_b;
-
     // push edi, push esi, push ebx, push ecx, push edx
-    add_shellcode("\x57\x56\x53\x51\x52"_b);
+    add_shellcode(5);
 
     // mov edi, dword ptr ss:[esp+18] (esp+18 == parameter)
-    add_shellcode("\x86\x7C\x24\x18"_b);
+    add_shellcode(4);
 
-    const auto eax = run_stage_strategy_1(stage);
+    compile_stage_strategy_1(stage);
 
     // pop edx, pop ecx, pop ebx, pop esi, pop edi
-    add_shellcode("\x5A\x59\x5B\x5E\x5F"_b);
+    add_shellcode(5);
 
     // retn
-    add_shellcode("\xC3"_b);
-
-    return eax;
+    add_shellcode(1);
 }
 
-u32 KeyDeriver::run_first_stage()
+void KeyDerivationCompiler::compile_first_stage()
 {
     const auto routine_number = settings.key_derivation_order1[rand() % 3];
 
-    u32 eax;
     switch (routine_number)
     {
         case 0:
         {
             // mov eax, rand()
-            add_shellcode("\xB8"_b);
+            add_shellcode(1);
             const auto tmp = rand();
-            add_shellcode(u32_to_string(tmp));
-            eax = tmp;
+            add_shellcode(4);
+            add_instruction(Opcode::PushImmediate, tmp);
             break;
         }
 
         case 1:
             // mov eax, edi
-            add_shellcode("\xB8\xC7"_b);
-            eax = parameter;
+            add_shellcode(2);
+            add_instruction(Opcode::PushParameter);
             break;
 
         case 2:
         {
             // mov esi, &settings.control_block
-            add_shellcode("\xBE"_b);
-            add_shellcode(u32_to_string(control_block_addr));
+            add_shellcode(1);
+            add_shellcode(4);
 
             // mov eax, dword ptr ds:[esi+((rand() & 0x3FF) * 4]
-            add_shellcode("\x8B\x86"_b);
+            add_shellcode(2);
             const auto pos = (rand() & 0x3FF) * 4;
-            add_shellcode(u32_to_string(pos));
+            add_shellcode(4);
 
-            eax = *reinterpret_cast<const u32*>(&settings.control_block[pos]);
+            // the control block is constant, so is the loaded value
+            add_instruction(
+                Opcode::PushImmediate,
+                *reinterpret_cast<const u32*>(&settings.control_block[pos]));
             break;
         }
 
         default:
             throw std::logic_error("Bad routine number");
     }
-
-    return eax;
 }
 
-u32 KeyDeriver::run_stage_strategy_0(size_t stage)
+void KeyDerivationCompiler::compile_stage_strategy_0(const size_t stage)
 {
     if (stage == 1)
-        return run_first_stage();
+        return compile_first_stage();
 
-    auto eax = (rand() & 1)
-        ? run_stage_strategy_1(stage - 1)
-        : run_stage_strategy_0(stage - 1);
+    if (rand() & 1)
+        compile_stage_strategy_1(stage - 1);
+    else
+        compile_stage_strategy_0(stage - 1);
 
     const auto routine_number = settings.key_derivation_order2[rand() % 8];
 
@@ -209,86 +376,69 @@ u32 KeyDeriver::run_stage_strategy_0(size_t stage)
     {
         case 0:
             // not eax
-            add_shellcode("\xF7\xD0"_b);
-            eax ^= 0xFFFFFFFF;
+            add_shellcode(2);
+            add_instruction(Opcode::Not);
             break;
 
         case 1:
             // dec eax
-            add_shellcode("\x48"_b);
-            eax--;
+            add_shellcode(1);
+            add_instruction(Opcode::Dec);
             break;
 
         case 2:
             // neg eax
-            add_shellcode("\xF7\xD8"_b);
-            eax = static_cast<u32>(-static_cast<s32>(eax));
+            add_shellcode(2);
+            add_instruction(Opcode::Neg);
             break;
 
         case 3:
             // inc eax
-            add_shellcode("\x40"_b);
-            eax++;
+            add_shellcode(1);
+            add_instruction(Opcode::Inc);
             break;
 
         case 4:
             // mov esi, &settings.control_block
-            add_shellcode("\xBE"_b);
-            add_shellcode(u32_to_string(control_block_addr));
+            add_shellcode(1);
+            add_shellcode(4);
 
             // and eax, 3ff
-            add_shellcode("\x25\xFF\x03\x00\x00"_b);
+            add_shellcode(5);
 
             // mov eax, dword ptr ds:[esi+eax*4]
-            add_shellcode("\x8B\x04\x86"_b);
+            add_shellcode(3);
 
-            eax = *reinterpret_cast<const u32*>(
-                &settings.control_block[(eax & 0x3FF) * 4]);
+            add_instruction(Opcode::LoadFromControlBlock);
             break;
 
         case 5:
-        {
             // push ebx
-            add_shellcode("\x53"_b);
-
             // mov ebx, eax
-            add_shellcode("\x89\xC3"_b);
-
             // and ebx, aaaaaaaa
-            add_shellcode("\x81\xE3\xAA\xAA\xAA\xAA"_b);
-
             // and eax, 55555555
-            add_shellcode("\x25\x55\x55\x55\x55"_b);
-
             // shr ebx, 1
-            add_shellcode("\xD1\xEB"_b);
-
             // shl eax, 1
-            add_shellcode("\xD1\xE0"_b);
-
             // or eax, ebx
-            add_shellcode("\x09\xD8"_b);
-
             // pop ebx
-            add_shellcode("\x5B"_b);
-
-            auto ebx = eax;
-            ebx &= 0xAAAAAAAA;
-            eax &= 0x55555555;
-            ebx >>= 1;
-            eax <<= 1;
-            eax |= ebx;
+            add_shellcode(1);
+            add_shellcode(2);
+            add_shellcode(6);
+            add_shellcode(5);
+            add_shellcode(2);
+            add_shellcode(2);
+            add_shellcode(2);
+            add_shellcode(1);
+            add_instruction(Opcode::SwapBitPairs);
             break;
-        }
 
         case 6:
         {
             // xor eax, rand()
-            add_shellcode("\x35"_b);
+            add_shellcode(1);
             const auto tmp = rand();
-            add_shellcode(u32_to_string(tmp));
-
-            eax ^= tmp;
+            add_shellcode(4);
+            add_instruction(Opcode::XorImmediate, tmp);
             break;
         }
 
@@ -297,20 +447,18 @@ u32 KeyDeriver::run_stage_strategy_0(size_t stage)
             if (rand() & 1)
             {
                 // add eax, rand()
-                add_shellcode("\x05"_b);
+                add_shellcode(1);
                 const auto tmp = rand();
-                add_shellcode(u32_to_string(tmp));
-
-                eax += tmp;
+                add_shellcode(4);
+                add_instruction(Opcode::AddImmediate, tmp);
             }
             else
             {
                 // sub eax, rand()
-                add_shellcode("\x2D"_b);
+                add_shellcode(1);
                 const auto tmp = rand();
-                add_shellcode(u32_to_string(tmp));
-
-                eax -= tmp;
+                add_shellcode(4);
+                add_instruction(Opcode::SubImmediate, tmp);
             }
             break;
         }
@@ -318,101 +466,84 @@ u32 KeyDeriver::run_stage_strategy_0(size_t stage)
         default:
             throw std::logic_error("Bad routine number");
     }
-
-    return eax;
 }
 
-u32 KeyDeriver::run_stage_strategy_1(size_t stage)
+void KeyDerivationCompiler::compile_stage_strategy_1(const size_t stage)
 {
     if (stage == 1)
-        return run_first_stage();
+        return compile_first_stage();
 
     // push ebx
-    add_shellcode("\x53"_b);
+    add_shellcode(1);
 
-    auto eax = (rand() & 1)
-        ? run_stage_strategy_1(stage - 1)
-        : run_stage_strategy_0(stage - 1);
+    if (rand() & 1)
+        compile_stage_strategy_1(stage - 1);
+    else
+        compile_stage_strategy_0(stage - 1);
 
     // mov ebx, eax
-    add_shellcode("\x89\xC3"_b);
-    const auto ebx = eax;
+    add_shellcode(2);
 
-    eax = (rand() & 1)
-        ? run_stage_strategy_1(stage - 1)
-        : run_stage_strategy_0(stage - 1);
+    if (rand() & 1)
+        compile_stage_strategy_1(stage - 1);
+    else
+        compile_stage_strategy_0(stage - 1);
 
     const auto routine_number = settings.key_derivation_order3[rand() % 6];
     switch (routine_number)
     {
         case 0:
-        {
             // push ecx
-            add_shellcode("\x51"_b);
-
             // mov ecx, ebx
-            add_shellcode("\x89\xD9"_b);
-
             // and ecx, 0f
-            add_shellcode("\x83\xE1\x0F"_b);
-
             // shr eax, cl
-            add_shellcode("\xD3\xE8"_b);
-
             // pop ecx
-            add_shellcode("\x59"_b);
-
-            const auto ecx = ebx & 0x0F;
-            eax >>= ecx;
+            add_shellcode(1);
+            add_shellcode(2);
+            add_shellcode(3);
+            add_shellcode(2);
+            add_shellcode(1);
+            add_instruction(Opcode::ShrByEbx);
             break;
-        }
 
         case 1:
-        {
             // push ecx
-            add_shellcode("\x51"_b);
-
             // mov ecx, ebx
-            add_shellcode("\x89\xD9"_b);
-
             // and ecx, 0f
-            add_shellcode("\x83\xE1\x0F"_b);
-
             // shl eax, cl
-            add_shellcode("\xD3\xE0"_b);
-
             // pop ecx
-            add_shellcode("\x59"_b);
-
-            const auto ecx = ebx & 0x0F;
-            eax <<= ecx;
+            add_shellcode(1);
+            add_shellcode(2);
+            add_shellcode(3);
+            add_shellcode(2);
+            add_shellcode(1);
+            add_instruction(Opcode::ShlByEbx);
             break;
-        }
 
         case 2:
             // add eax, ebx
-            add_shellcode("\x01\xD8"_b);
-            eax += ebx;
+            add_shellcode(2);
+            add_instruction(Opcode::AddEbx);
             break;
 
         case 3:
             // neg eax
-            add_shellcode("\xF7\xD8"_b);
             // add eax, ebx
-            add_shellcode("\x01\xD8"_b);
-            eax = ebx - eax;
+            add_shellcode(2);
+            add_shellcode(2);
+            add_instruction(Opcode::SubFromEbx);
             break;
 
         case 4:
             // imul eax, ebx
-            add_shellcode("\x0F\xAF\xC3"_b);
-            eax *= ebx;
+            add_shellcode(3);
+            add_instruction(Opcode::MulByEbx);
             break;
 
         case 5:
             // sub eax, ebx
-            add_shellcode("\x29\xD8"_b);
-            eax -= ebx;
+            add_shellcode(2);
+            add_instruction(Opcode::SubEbx);
             break;
 
         default:
@@ -420,13 +551,40 @@ u32 KeyDeriver::run_stage_strategy_1(size_t stage)
     }
 
     // pop ebx
-    add_shellcode("\x5B"_b);
+    add_shellcode(1);
+}
 
-    return eax;
+KeyDeriver::KeyDeriver(const CxdecSettings &settings) : settings(settings)
+{
+    KeyDerivationCompiler compiler(this->settings);
+    for (const auto seed : algo::range(seed_count))
+    {
+        programs[seed] = compiler.compile(seed);
+        // make every slot miss until it gets filled
+        for (const auto i : algo::range(memo_size))
+            memo[seed][i].store(
+                static_cast<u64>(i ^ 1) << 32, std::memory_order_relaxed);
+    }
+}
+
+u32 KeyDeriver::derive(const u32 seed, const u32 parameter) const
+{
+    // Both the parameter and the key fit in a single atomic, so the slots
+    // can be shared by all the threads decrypting the archive entries.
+    auto &slot = memo[seed][parameter % memo_size];
+    const auto cached = slot.load(std::memory_order_relaxed);
+    if ((cached >> 32) == parameter)
+        return cached & 0xFFFFFFFF;
+
+    const auto key = programs[seed].run(
+        parameter, settings.control_block.get<const u32>());
+    slot.store(
+        (static_cast<u64>(parameter) << 32) | key, std::memory_order_relaxed);
+    return key;
 }
 
 static void decrypt_chunk(
-    KeyDeriver &key_deriver,
+    const KeyDeriver &key_deriver,
     bstr &data,
     u32 hash,
     size_t base_offset,
@@ -456,9 +614,8 @@ static void decrypt_chunk(
         data_ptr[i] ^= xor2;
 }
 
-static bstr find_control_block(const io::path &path)
+static bstr read_control_block(const io::path &dir)
 {
-    const auto dir = path.parent();
     for (const auto &path : io::recursive_directory_range(dir))
     {
         if (!io::is_regular_file(path))
@@ -486,6 +643,23 @@ static bstr find_control_block(const io::path &path)
     throw err::FileNotFoundError("TPM file not found");
 }
 
+static bstr find_control_block(const io::path &path)
+{
+    // All the archives of a game usually sit in the same directory, which
+    // needs to be searched only once.
+    static std::mutex mutex;
+    static std::map<io::path, bstr> control_blocks;
+
+    const auto dir = path.parent();
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = control_blocks.find(dir);
+    if (it != control_blocks.end())
+        return it->second;
+    const auto control_block = read_control_block(dir);
+    control_blocks[dir] = control_block;
+    return control_block;
+}
+
 Xp3Plugin au::dec::kirikiri::create_cxdec_plugin(
     const u16 key1,
     const u16 key2,
@@ -506,17 +680,19 @@ Xp3Plugin au::dec::kirikiri::create_cxdec_plugin(
         settings.key_derivation_order2 = key_derivation_order2;
         settings.key_derivation_order3 = key_derivation_order3;
 
+        const std::shared_ptr<const KeyDeriver> key_deriver
+            = std::make_shared<KeyDeriver>(settings);
+
         return [=](bstr &data, u32 adlr_key)
         {
-            KeyDeriver key_deriver(settings);
             const auto hash1 = adlr_key;
             const auto hash2 = (adlr_key >> 16) ^ adlr_key;
             const auto offset1 = 0;
             const auto offset2 = std::min<size_t>(
                 data.size(), (adlr_key & key1) + key2);
-            decrypt_chunk(key_deriver, data, hash1, offset1, offset2);
+            decrypt_chunk(*key_deriver, data, hash1, offset1, offset2);
             decrypt_chunk(
-                key_deriver, data, hash2, offset2, data.size() - offset2);
+                *key_deriver, data, hash2, offset2, data.size() - offset2);
         };
     };
     return plugin;
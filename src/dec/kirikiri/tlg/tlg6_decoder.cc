@@ -16,7 +16,13 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "dec/kirikiri/tlg/tlg6_decoder.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "algo/parallel.h"
 #include "algo/range.h"
+#include "algo/simd.h"
 #include "dec/kirikiri/tlg/lzss_decompressor.h"
 #include "err.h"
 
@@ -47,6 +53,14 @@ namespace
         size_t y_block_count;
     };
 
+    struct Band final
+    {
+        size_t y;
+        size_t height;
+        std::vector<bstr> bit_pools; // one for each channel
+        bstr pixels;
+    };
+
     struct FilterTypes final
     {
         FilterTypes(io::BaseByteStream &input_stream);
@@ -84,112 +98,210 @@ void FilterTypes::decompress(const Header &header)
     data = decompressor.decompress(data, output_size);
 }
 
-static inline u32 to_bgra(res::Pixel p)
-{
-    return p.b | (p.g << 8) | (p.r << 16) | (p.a << 24);
-}
+// byte positions of the channels within packed BGRA pixels
+static const int chan_b = 0;
+static const int chan_g = 1;
+static const int chan_r = 2;
 
-static void transformer0(res::Pixel &)
+// adds one channel of each pixel to another one (without carrying over to
+// the neighboring channels); the source channel is rotated into place, which
+// works the same regardless of which channel comes first
+template<int dst, int src> static inline u32 add_channel(const u32 p)
 {
+    static const int shift = ((dst - src) * 8 + 32) % 32;
+    static const u32 dst_mask = 0xFF << (dst * 8);
+    const auto value = p & (0xFF << (src * 8));
+    const auto rotated = (value << shift) | (value >> (32 - shift));
+    return (p & ~dst_mask) | ((p + rotated) & dst_mask);
 }
 
-static void transformer1(res::Pixel &p)
+#ifdef AU_USE_SSE2
+template<int dst, int src> static inline __m128i add_channel(const __m128i p)
 {
-    p.r += p.g;
-    p.b += p.g;
+    static const int shift = ((dst - src) * 8 + 32) % 32;
+    const auto value = _mm_and_si128(p, _mm_set1_epi32(0xFF << (src * 8)));
+    const auto rotated = _mm_or_si128(
+        _mm_slli_epi32(value, shift), _mm_srli_epi32(value, 32 - shift));
+    return _mm_add_epi8(p, rotated);
 }
+#endif
 
-static void transformer2(res::Pixel &p)
+namespace
 {
-    p.g += p.b;
-    p.r += p.g;
-}
+    struct Transformer0 final
+    {
+        template<typename T> static inline T apply(T p)
+        {
+            return p;
+        }
+    };
 
-static void transformer3(res::Pixel &p)
-{
-    p.g += p.r;
-    p.b += p.g;
-}
+    struct Transformer1 final
+    {
+        template<typename T> static inline T apply(T p)
+        {
+            p = add_channel<chan_r, chan_g>(p);
+            return add_channel<chan_b, chan_g>(p);
+        }
+    };
 
-static void transformer4(res::Pixel &p)
-{
-    p.b += p.r;
-    p.g += p.b;
-    p.r += p.g;
-}
+    struct Transformer2 final
+    {
+        template<typename T> static inline T apply(T p)
+        {
+            p = add_channel<chan_g, chan_b>(p);
+            return add_channel<chan_r, chan_g>(p);
+        }
+    };
 
-static void transformer5(res::Pixel &p)
-{
-    p.b += p.r;
-    p.g += p.b;
-}
+    struct Transformer3 final
+    {
+        template<typename T> static inline T apply(T p)
+        {
+            p = add_channel<chan_g, chan_r>(p);
+            return add_channel<chan_b, chan_g>(p);
+        }
+    };
 
-static void transformer6(res::Pixel &p)
-{
-    p.b += p.g;
-}
+    struct Transformer4 final
+    {
+        template<typename T> static inline T apply(T p)
+        {
+            p = add_channel<chan_b, chan_r>(p);
+            p = add_channel<chan_g, chan_b>(p);
+            return add_channel<chan_r, chan_g>(p);
+        }
+    };
 
-static void transformer7(res::Pixel &p)
-{
-    p.g += p.b;
-}
+    struct Transformer5 final
+    {
+        template<typename T> static inline T apply(T p)
+        {
+            p = add_channel<chan_b, chan_r>(p);
+            return add_channel<chan_g, chan_b>(p);
+        }
+    };
 
-static void transformer8(res::Pixel &p)
-{
-    p.r += p.g;
-}
+    struct Transformer6 final
+    {
+        template<typename T> static inline T apply(T p)
+        {
+            return add_channel<chan_b, chan_g>(p);
+        }
+    };
 
-static void transformer9(res::Pixel &p)
-{
-    p.r += p.b;
-    p.g += p.r;
-    p.b += p.g;
-}
+    struct Transformer7 final
+    {
+        template<typename T> static inline T apply(T p)
+        {
+            return add_channel<chan_g, chan_b>(p);
+        }
+    };
 
-static void transformerA(res::Pixel &p)
-{
-    p.b += p.r;
-    p.g += p.r;
-}
+    struct Transformer8 final
+    {
+        template<typename T> static inline T apply(T p)
+        {
+            return add_channel<chan_r, chan_g>(p);
+        }
+    };
 
-static void transformerB(res::Pixel &p)
-{
-    p.r += p.b;
-    p.g += p.b;
-}
+    struct Transformer9 final
+    {
+        template<typename T> static inline T apply(T p)
+        {
+            p = add_channel<chan_r, chan_b>(p);
+            p = add_channel<chan_g, chan_r>(p);
+            return add_channel<chan_b, chan_g>(p);
+        }
+    };
 
-static void transformerC(res::Pixel &p)
-{
-    p.r += p.b;
-    p.g += p.r;
-}
+    struct TransformerA final
+    {
+        template<typename T> static inline T apply(T p)
+        {
+            p = add_channel<chan_b, chan_r>(p);
+            return add_channel<chan_g, chan_r>(p);
+        }
+    };
 
-static void transformerD(res::Pixel &p)
-{
-    p.b += p.g;
-    p.r += p.b;
-    p.g += p.r;
-}
+    struct TransformerB final
+    {
+        template<typename T> static inline T apply(T p)
+        {
+            p = add_channel<chan_r, chan_b>(p);
+            return add_channel<chan_g, chan_b>(p);
+        }
+    };
 
-static void transformerE(res::Pixel &p)
-{
-    p.g += p.r;
-    p.b += p.g;
-    p.r += p.b;
+    struct TransformerC final
+    {
+        template<typename T> static inline T apply(T p)
+        {
+            p = add_channel<chan_r, chan_b>(p);
+            return add_channel<chan_g, chan_r>(p);
+        }
+    };
+
+    struct TransformerD final
+    {
+        template<typename T> static inline T apply(T p)
+        {
+            p = add_channel<chan_b, chan_g>(p);
+            p = add_channel<chan_r, chan_b>(p);
+            return add_channel<chan_g, chan_r>(p);
+        }
+    };
+
+    struct TransformerE final
+    {
+        template<typename T> static inline T apply(T p)
+        {
+            p = add_channel<chan_g, chan_r>(p);
+            p = add_channel<chan_b, chan_g>(p);
+            return add_channel<chan_r, chan_b>(p);
+        }
+    };
+
+    struct TransformerF final
+    {
+        // adds twice the blue channel
+        template<typename T> static inline T apply(T p)
+        {
+            p = add_channel<chan_g, chan_b>(p);
+            p = add_channel<chan_g, chan_b>(p);
+            p = add_channel<chan_r, chan_b>(p);
+            return add_channel<chan_r, chan_b>(p);
+        }
+    };
 }
 
-static void transformerF(res::Pixel &p)
+// transforms a whole block row at once instead of calling through a function
+// pointer for every pixel
+template<typename T> static void transform_block(u32 *pixels, const size_t size)
 {
-    p.g += (p.b << 1);
-    p.r += (p.b << 1);
+    size_t i = 0;
+#ifdef AU_USE_SSE2
+    for (; i + 4 <= size; i += 4)
+    {
+        const auto ptr = reinterpret_cast<__m128i*>(pixels + i);
+        _mm_storeu_si128(ptr, T::apply(_mm_loadu_si128(ptr)));
+    }
+#endif
+    for (; i < size; i++)
+        pixels[i] = T::apply(pixels[i]);
 }
 
-static void (*transformers[16])(res::Pixel &p) =
+static void (*const block_transformers[16])(u32 *, const size_t) =
 {
-    &transformer0, &transformer1, &transformer2, &transformer3,
-    &transformer4, &transformer5, &transformer6, &transformer7,
-    &transformer8, &transformer9, &transformerA, &transformerB,
-    &transformerC, &transformerD, &transformerE, &transformerF,
+    &transform_block<Transformer0>, &transform_block<Transformer1>,
+    &transform_block<Transformer2>, &transform_block<Transformer3>,
+    &transform_block<Transformer4>, &transform_block<Transformer5>,
+    &transform_block<Transformer6>, &transform_block<Transformer7>,
+    &transform_block<Transformer8>, &transform_block<Transformer9>,
+    &transform_block<TransformerA>, &transform_block<TransformerB>,
+    &transform_block<TransformerC>, &transform_block<TransformerD>,
+    &transform_block<TransformerE>, &transform_block<TransformerF>,
 };
 
 static inline u32 make_gt_mask(u32 a, u32 b)
@@ -224,13 +336,8 @@ static inline u32 avg(u32 a, u32 b, u32, u32 v)
         + ((a ^ b) & 0x01010101), v);
 }
 
-static void init_table()
+static void init_tables()
 {
-    static bool initialized = false;
-    if (initialized)
-        return;
-    initialized = true;
-
     short golomb_compression_table[golomb_n_count][9] =
     {
         {3, 7, 15, 27, 63, 108, 223, 448, 130},
@@ -386,20 +493,39 @@ static void decode_golomb_values(u8 *pixel_buf, int pixel_count, u8 *bit_pool)
     }
 }
 
+template<u32 (*filter)(u32, u32, u32, u32)> static u32 reconstruct_block(
+    u32 left,
+    u32 top_left,
+    const u32 *prev_line,
+    u32 *current_line,
+    const u32 *input,
+    const size_t size,
+    const u32 alpha_mask)
+{
+    for (const auto x : algo::range(size))
+    {
+        const auto top = prev_line[x];
+        left = filter(left, top, top_left, input[x]) | alpha_mask;
+        top_left = top;
+        current_line[x] = left;
+    }
+    return left;
+}
+
 static void decode_line(
-    res::Pixel *prev_line,
-    res::Pixel *current_line,
+    const u32 *prev_line,
+    u32 *current_line,
     int start_block,
     int block_limit,
-    u8 *filter_types,
+    const u8 *filter_types,
     int skip_block_bytes,
-    u32 *in,
+    const u32 *in,
     int odd_skip,
     int dir,
     const Header &header)
 {
-    res::Pixel left, top_left;
-    int step;
+    const u32 alpha_mask = header.channel_count == 3 ? 0xFF000000 : 0;
+    u32 left, top_left;
 
     if (start_block)
     {
@@ -410,84 +536,127 @@ static void decode_line(
     }
     else
     {
-        left.r = left.g = left.b = 0;
-        top_left.r = top_left.g = top_left.b = 0;
-        left.a = top_left.a = header.channel_count == 3 ? 0xFF : 0;
+        left = top_left = alpha_mask;
     }
 
     in += skip_block_bytes * start_block;
-    step = (dir & 1) ? 1 : -1;
 
+    u32 block[w_block_size];
     for (const auto i : algo::range(start_block, block_limit))
     {
         int w = header.image_width - i * w_block_size;
         if (w > w_block_size)
             w = w_block_size;
 
-        int ww = w;
-        if (step == -1)
-            in += ww - 1;
+        // the blocks are stored in a zigzag order
+        const auto block_in = in + ((i & 1) ? odd_skip * w : 0);
+        for (const auto x : algo::range(w))
+            block[x] = (dir & 1) ? block_in[x] : block_in[w - 1 - x];
+        in += skip_block_bytes;
+
+        block_transformers[filter_types[i] >> 1](block, w);
+        const auto reconstruct = filter_types[i] & 1
+            ? &reconstruct_block<avg>
+            : &reconstruct_block<med>;
+        left = reconstruct(
+            left, top_left, prev_line, current_line, block, w, alpha_mask);
+
+        top_left = prev_line[w - 1];
+        prev_line += w;
+        current_line += w;
+    }
+}
+
+static void decode_band(Band &band, const Header &header)
+{
+    const auto pixel_count = band.height * header.image_width;
+    band.pixels = bstr(4 * pixel_count);
+    for (const auto c : algo::range(header.channel_count))
+    {
+        decode_golomb_values(
+            band.pixels.get<u8>() + c,
+            pixel_count,
+            band.bit_pools[c].get<u8>());
+    }
+    band.bit_pools.clear();
+}
+
+static void reconstruct_band(
+    const Band &band,
+    const FilterTypes &filter_types,
+    const u32 *&prev_line,
+    res::Image &image,
+    const Header &header)
+{
+    const size_t main_count = header.image_width / w_block_size;
+    const auto y = band.y;
+    const auto ylim = band.y + band.height;
+    const auto pixels = band.pixels.get<const u32>();
+
+    const u8 *ft = filter_types.data.get<const u8>()
+        + (y / h_block_size) * header.x_block_count;
+    int skip_bytes = (ylim - y) * w_block_size;
+
+    for (const auto yy : algo::range(y, ylim))
+    {
+        auto current_line = reinterpret_cast<u32*>(&image.at(0, yy));
 
-        if (i & 1)
-            in += odd_skip * ww;
+        int dir = (yy & 1) ^ 1;
+        int odd_skip = ((ylim - yy -1) - (yy - y));
 
-        auto filter = filter_types[i] & 1 ? &avg : &med;
-        auto transformer = transformers[filter_types[i] >> 1];
+        if (main_count)
+        {
+            int start = ((header.image_width < w_block_size)
+                ? header.image_width
+                : w_block_size) * (yy - y);
+
+            decode_line(
+                prev_line,
+                current_line,
+                0,
+                main_count,
+                ft,
+                skip_bytes,
+                pixels + start,
+                odd_skip,
+                dir,
+                header);
+        }
 
-        do
+        if (main_count != header.x_block_count)
         {
-            res::Pixel inn;
-            inn.a = *in >> 24;
-            inn.r = *in >> 16;
-            inn.g = *in >> 8;
-            inn.b = *in;
-            transformer(inn);
-
-            res::Pixel top = *prev_line;
-            auto result = filter(
-                to_bgra(left),
-                to_bgra(top),
-                to_bgra(top_left),
-                to_bgra(inn));
-            left.a = result >> 24;
-            left.r = result >> 16;
-            left.g = result >> 8;
-            left.b = result;
-            if (header.channel_count == 3)
-                left.a = 0xFF;
-
-            top_left = top;
-            *current_line++ = left;
-
-            prev_line++;
-            in += step;
+            int ww = header.image_width - main_count * w_block_size;
+            if (ww > w_block_size)
+                ww = w_block_size;
+
+            int start = ww * (yy - y);
+            decode_line(
+                prev_line,
+                current_line,
+                main_count,
+                header.x_block_count,
+                ft,
+                skip_bytes,
+                pixels + start,
+                odd_skip,
+                dir,
+                header);
         }
-        while (--w);
 
-        in += skip_block_bytes + (step == 1 ? - ww : 1);
-        if (i & 1)
-            in -= odd_skip * ww;
+        prev_line = current_line;
     }
 }
 
-static void read_image(
-    io::BaseByteStream &input_stream, res::Image &image, const Header &header)
+static std::vector<Band> read_bands(
+    io::BaseByteStream &input_stream, const Header &header)
 {
-    FilterTypes filter_types(input_stream);
-    filter_types.decompress(header);
-
-    bstr pixel_buf(4 * header.image_width * h_block_size);
-    auto zero_line = std::make_unique<res::Pixel[]>(header.image_width);
-    res::Pixel *prev_line = zero_line.get();
-
-    u32 main_count = header.image_width / w_block_size;
-    for (const auto y : algo::range(0, header.image_height, h_block_size))
+    std::vector<Band> bands(header.y_block_count);
+    for (const auto i : algo::range(bands.size()))
     {
-        u32 ylim = y + h_block_size;
-        if (ylim >= header.image_height)
-            ylim = header.image_height;
-
-        int pixel_count = (ylim - y) * header.image_width;
+        auto &band = bands[i];
+        band.y = i * h_block_size;
+        band.height = std::min<size_t>(
+            h_block_size, header.image_height - band.y);
         for (const auto c : algo::range(header.channel_count))
         {
             u32 bit_size = input_stream.read_le<u32>();
@@ -506,68 +675,137 @@ static void read_image(
             if (method != 0)
                 throw err::NotSupportedError("Unsupported encoding method");
 
-            decode_golomb_values(
-                pixel_buf.get<u8>() + c, pixel_count, bit_pool.get<u8>());
+            band.bit_pools.push_back(std::move(bit_pool));
         }
+    }
+    return bands;
+}
+
+static void read_image(
+    io::BaseByteStream &input_stream,
+    res::Image &image,
+    const Header &header,
+    const size_t thread_count)
+{
+    FilterTypes filter_types(input_stream);
+    filter_types.decompress(header);
 
-        u8 *ft = filter_types.data.get<u8>()
-            + (y / h_block_size) * header.x_block_count;
-        int skip_bytes = (ylim - y) * w_block_size;
+    auto bands = read_bands(input_stream, header);
+    const auto zero_line = std::make_unique<u32[]>(header.image_width);
+    const u32 *prev_line = zero_line.get();
 
-        for (const auto yy : algo::range(y, ylim))
+    if (thread_count <= 1 || bands.size() <= 1)
+    {
+        for (auto &band : bands)
         {
-            auto *current_line = &image.at(0, yy);
-
-            int dir = (yy & 1) ^ 1;
-            int odd_skip = ((ylim - yy -1) - (yy - y));
+            decode_band(band, header);
+            reconstruct_band(band, filter_types, prev_line, image, header);
+            band.pixels = bstr();
+        }
+        return;
+    }
 
-            if (main_count)
+    // Golomb decoding of each band is independent, but reconstructing a band
+    // needs the last row of the previous one. The workers decode the bands
+    // ahead (at most a few at a time, to bound the memory usage) while this
+    // thread reconstructs them in order.
+    const auto max_bands_ahead = 2 * thread_count;
+    std::mutex mutex;
+    std::condition_variable state_changed;
+    std::vector<bool> band_ready(bands.size(), false);
+    size_t next_band = 0;
+    size_t reconstructed_band_count = 0;
+    bool aborted = false;
+    std::exception_ptr error;
+
+    std::vector<std::thread> workers;
+    const auto worker_count = std::min(thread_count, bands.size()) - 1;
+    for (const auto i : algo::range(worker_count))
+    {
+        workers.emplace_back([&]()
+        {
+            while (true)
             {
-                int start = ((header.image_width < w_block_size)
-                    ? header.image_width
-                    : w_block_size) * (yy - y);
-
-                decode_line(
-                    prev_line,
-                    current_line,
-                    0,
-                    main_count,
-                    ft,
-                    skip_bytes,
-                    pixel_buf.get<u32>() + start,
-                    odd_skip,
-                    dir,
-                    header);
+                size_t band;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    state_changed.wait(lock, [&]()
+                    {
+                        return aborted
+                            || next_band >= bands.size()
+                            || next_band
+                                < reconstructed_band_count + max_bands_ahead;
+                    });
+                    if (aborted || next_band >= bands.size())
+                        return;
+                    band = next_band++;
+                }
+
+                try
+                {
+                    decode_band(bands[band], header);
+                }
+                catch (...)
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    error = std::current_exception();
+                    aborted = true;
+                    state_changed.notify_all();
+                    return;
+                }
+
+                std::unique_lock<std::mutex> lock(mutex);
+                band_ready[band] = true;
+                state_changed.notify_all();
             }
+        });
+    }
 
-            if (main_count != header.x_block_count)
+    try
+    {
+        for (const auto i : algo::range(bands.size()))
+        {
             {
-                int ww = header.image_width - main_count * w_block_size;
-                if (ww > w_block_size)
-                    ww = w_block_size;
-
-                int start = ww * (yy - y);
-                decode_line(
-                    prev_line,
-                    current_line,
-                    main_count,
-                    header.x_block_count,
-                    ft,
-                    skip_bytes,
-                    pixel_buf.get<u32>() + start,
-                    odd_skip,
-                    dir,
-                    header);
+                std::unique_lock<std::mutex> lock(mutex);
+                state_changed.wait(lock, [&]()
+                {
+                    return aborted || band_ready[i];
+                });
+                if (aborted)
+                    break;
             }
 
-            prev_line = current_line;
+            reconstruct_band(bands[i], filter_types, prev_line, image, header);
+            bands[i].pixels = bstr();
+
+            std::unique_lock<std::mutex> lock(mutex);
+            reconstructed_band_count = i + 1;
+            state_changed.notify_all();
         }
     }
+    catch (...)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        error = std::current_exception();
+        aborted = true;
+        state_changed.notify_all();
+    }
+
+    for (auto &worker : workers)
+        worker.join();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+Tlg6Decoder::Tlg6Decoder(const size_t thread_count)
+    : thread_count(thread_count)
+{
 }
 
 res::Image Tlg6Decoder::decode(io::File &file)
 {
-    init_table();
+    static std::once_flag tables_initialized;
+    std::call_once(tables_initialized, &init_tables);
 
     Header header;
     header.channel_count = file.stream.read<u8>();
@@ -584,6 +822,10 @@ res::Image Tlg6Decoder::decode(io::File &file)
         throw err::UnsupportedChannelCountError(header.channel_count);
 
     res::Image image(header.image_width, header.image_height);
-    read_image(file.stream, image, header);
+    read_image(
+        file.stream,
+        image,
+        header,
+        thread_count ? thread_count : algo::get_thread_budget());
     return image;
 }
@@ -28,7 +28,15 @@ namespace tlg {
     class Tlg6Decoder final
     {
     public:
+        // Bands are Golomb decoded ahead on thread_count - 1 workers; 0
+        // stands for the thread budget of the calling thread (see
+        // algo::get_thread_budget).
+        Tlg6Decoder(const size_t thread_count = 0);
+
         res::Image decode(io::File &file);
+
+    private:
+        const size_t thread_count;
     };
 
 } } } }
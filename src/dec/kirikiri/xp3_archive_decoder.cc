@@ -16,11 +16,15 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "dec/kirikiri/xp3_archive_decoder.h"
+#include <cstring>
 #include "algo/locale.h"
 #include "algo/pack/zlib.h"
+#include "algo/pack/zlib_inflate_stream.h"
 #include "algo/range.h"
 #include "err.h"
+#include "io/concat_byte_stream.h"
 #include "io/memory_byte_stream.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::kirikiri;
@@ -234,7 +238,7 @@ std::unique_ptr<dec::ArchiveMeta> Xp3ArchiveDecoder::read_meta_impl(
 
     auto table_data = input_file.stream.read(table_size_comp);
     if (table_is_compressed)
-        table_data = algo::pack::zlib_inflate(table_data);
+        table_data = algo::pack::zlib_inflate(table_data, table_size_orig);
     io::MemoryByteStream table_stream(table_data);
 
     auto meta = std::make_unique<CustomArchiveMeta>();
@@ -270,15 +274,59 @@ std::unique_ptr<io::File> Xp3ArchiveDecoder::read_file_impl(
     const auto meta = static_cast<const CustomArchiveMeta*>(&m);
     const auto entry = static_cast<const CustomArchiveEntry*>(&e);
 
-    bstr data;
+    // without encryption, stream the segments lazily rather than holding
+    // the whole (possibly huge) file in memory
+    if (!meta->decrypt_func)
+    {
+        std::vector<std::unique_ptr<io::BaseByteStream>> segm_streams;
+        for (const auto &segm_chunk : entry->segm_chunks)
+        {
+            const auto data_is_compressed = segm_chunk->flags & 7;
+            std::unique_ptr<io::BaseByteStream> segm_stream
+                = std::make_unique<io::SliceByteStream>(
+                    input_file.stream,
+                    segm_chunk->offset,
+                    data_is_compressed
+                        ? segm_chunk->size_comp
+                        : segm_chunk->size_orig);
+            if (data_is_compressed)
+            {
+                segm_stream = std::make_unique<algo::pack::ZlibInflateStream>(
+                    std::move(segm_stream), segm_chunk->size_orig);
+            }
+            segm_streams.push_back(std::move(segm_stream));
+        }
+        if (segm_streams.size() == 1)
+            return std::make_unique<io::File>(
+                entry->path, std::move(segm_streams[0]));
+        return std::make_unique<io::File>(
+            entry->path,
+            std::make_unique<io::ConcatByteStream>(std::move(segm_streams)));
+    }
+
+    size_t data_size = 0;
+    for (const auto &segm_chunk : entry->segm_chunks)
+        data_size += segm_chunk->size_orig;
+
+    bstr data(data_size);
+    auto data_ptr = data.get<u8>();
     for (const auto &segm_chunk : entry->segm_chunks)
     {
         const auto data_is_compressed = segm_chunk->flags & 7;
         input_file.stream.seek(segm_chunk->offset);
-        data += data_is_compressed
-            ? algo::pack::zlib_inflate(
-                input_file.stream.read(segm_chunk->size_comp))
-            : input_file.stream.read(segm_chunk->size_orig);
+        if (data_is_compressed)
+        {
+            algo::pack::zlib_inflate(
+                input_file.stream.read(segm_chunk->size_comp),
+                data_ptr,
+                segm_chunk->size_orig);
+        }
+        else
+        {
+            const auto chunk = input_file.stream.read(segm_chunk->size_orig);
+            std::memcpy(data_ptr, chunk.get<const u8>(), chunk.size());
+        }
+        data_ptr += segm_chunk->size_orig;
     }
 
     if (meta->decrypt_func)
@@ -287,9 +335,93 @@ std::unique_ptr<io::File> Xp3ArchiveDecoder::read_file_impl(
     return std::make_unique<io::File>(entry->path, data);
 }
 
+bstr Xp3ArchiveDecoder::serialize_meta_impl(const dec::ArchiveMeta &m) const
+{
+    io::MemoryByteStream output_stream;
+    output_stream.write_le<u32>(m.entries.size());
+    for (const auto &e : m.entries)
+    {
+        const auto entry = static_cast<const CustomArchiveEntry*>(e.get());
+        const auto path = entry->path.str();
+        output_stream.write_le<u32>(path.size());
+        output_stream.write(path);
+
+        const auto &info_chunk = *entry->info_chunk;
+        output_stream.write_le<u32>(info_chunk.flags);
+        output_stream.write_le<u64>(info_chunk.file_size_orig);
+        output_stream.write_le<u64>(info_chunk.file_size_comp);
+        output_stream.write_le<u32>(info_chunk.name.size());
+        output_stream.write(info_chunk.name);
+
+        output_stream.write_le<u32>(entry->segm_chunks.size());
+        for (const auto &segm_chunk : entry->segm_chunks)
+        {
+            output_stream.write_le<u32>(segm_chunk->flags);
+            output_stream.write_le<u64>(segm_chunk->offset);
+            output_stream.write_le<u64>(segm_chunk->size_orig);
+            output_stream.write_le<u64>(segm_chunk->size_comp);
+        }
+
+        output_stream.write_le<u32>(entry->adlr_chunk->key);
+
+        output_stream.write<u8>(entry->time_chunk ? 1 : 0);
+        if (entry->time_chunk)
+            output_stream.write_le<u64>(entry->time_chunk->timestamp);
+    }
+    return output_stream.seek(0).read_to_eof();
+}
+
+std::unique_ptr<dec::ArchiveMeta> Xp3ArchiveDecoder::deserialize_meta_impl(
+    const Logger &logger,
+    io::File &input_file,
+    io::BaseByteStream &input_stream) const
+{
+    auto meta = std::make_unique<CustomArchiveMeta>();
+    meta->decrypt_func = plugin_manager.get()
+        .create_decrypt_func(input_file.path);
+
+    const auto entry_count = input_stream.read_le<u32>();
+    for (const auto i : algo::range(entry_count))
+    {
+        auto entry = std::make_unique<CustomArchiveEntry>();
+        entry->path = input_stream.read(input_stream.read_le<u32>()).str();
+
+        entry->info_chunk = std::make_unique<InfoChunk>();
+        entry->info_chunk->flags = input_stream.read_le<u32>();
+        entry->info_chunk->file_size_orig = input_stream.read_le<u64>();
+        entry->info_chunk->file_size_comp = input_stream.read_le<u64>();
+        entry->info_chunk->name
+            = input_stream.read(input_stream.read_le<u32>()).str();
+
+        const auto segm_chunk_count = input_stream.read_le<u32>();
+        for (const auto j : algo::range(segm_chunk_count))
+        {
+            auto segm_chunk = std::make_unique<SegmChunk>();
+            segm_chunk->flags = input_stream.read_le<u32>();
+            segm_chunk->offset = input_stream.read_le<u64>();
+            segm_chunk->size_orig = input_stream.read_le<u64>();
+            segm_chunk->size_comp = input_stream.read_le<u64>();
+            entry->segm_chunks.push_back(std::move(segm_chunk));
+        }
+
+        entry->adlr_chunk = std::make_unique<AdlrChunk>();
+        entry->adlr_chunk->key = input_stream.read_le<u32>();
+
+        if (input_stream.read<u8>())
+        {
+            entry->time_chunk = std::make_unique<TimeChunk>();
+            entry->time_chunk->timestamp = input_stream.read_le<u64>();
+        }
+
+        meta->entries.push_back(std::move(entry));
+    }
+    return meta;
+}
+
 std::vector<std::string> Xp3ArchiveDecoder::get_linked_formats() const
 {
     return {"kirikiri/tlg"};
 }
 
-static auto _ = dec::register_decoder<Xp3ArchiveDecoder>("kirikiri/xp3");
+static auto _ = dec::register_decoder<Xp3ArchiveDecoder>(
+    "kirikiri/xp3").with_magic(xp3_magic);
@@ -44,6 +44,13 @@ namespace kirikiri {
             const ArchiveMeta &m,
             const ArchiveEntry &e) const override;
 
+        bstr serialize_meta_impl(const ArchiveMeta &meta) const override;
+
+        std::unique_ptr<ArchiveMeta> deserialize_meta_impl(
+            const Logger &logger,
+            io::File &input_file,
+            io::BaseByteStream &input_stream) const override;
+
     public:
         PluginManager<Xp3Plugin> plugin_manager;
     };
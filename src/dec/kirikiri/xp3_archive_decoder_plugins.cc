@@ -46,7 +46,7 @@ Xp3ArchiveDecoder::Xp3ArchiveDecoder()
 {
     plugin_manager.add(
         "noop", "Unecrypted games",
-        create_simple_plugin([](bstr &data, u32 key) { }));
+        create_simple_plugin(nullptr));
 
     plugin_manager.add(
         "xor", "Basic XOR encryption",
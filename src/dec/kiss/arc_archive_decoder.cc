@@ -19,6 +19,7 @@
 #include "algo/locale.h"
 #include "algo/range.h"
 #include "err.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::kiss;
@@ -69,8 +70,10 @@ std::unique_ptr<io::File> ArcArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
 std::vector<std::string> ArcArchiveDecoder::get_linked_formats() const
@@ -78,4 +81,5 @@ std::vector<std::string> ArcArchiveDecoder::get_linked_formats() const
     return {"kiss/plg"};
 }
 
-static auto _ = dec::register_decoder<ArcArchiveDecoder>("kiss/arc");
+static auto _ = dec::register_decoder<ArcArchiveDecoder>(
+    "kiss/arc").with_extension("arc");
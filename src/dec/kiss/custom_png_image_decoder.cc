@@ -57,4 +57,5 @@ res::Image CustomPngImageDecoder::decode_impl(
     return image;
 }
 
-static auto _ = dec::register_decoder<CustomPngImageDecoder>("kiss/custom-png");
+static auto _ = dec::register_decoder<CustomPngImageDecoder>(
+    "kiss/custom-png").with_magic(magic);
@@ -90,4 +90,5 @@ std::vector<std::string> Ar10ArchiveDecoder::get_linked_formats() const
     return {"leaf/cz10"};
 }
 
-static auto _ = dec::register_decoder<Ar10ArchiveDecoder>("leaf/ar10");
+static auto _ = dec::register_decoder<Ar10ArchiveDecoder>(
+    "leaf/ar10").with_magic(magic);
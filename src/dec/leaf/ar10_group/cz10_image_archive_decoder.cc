@@ -153,4 +153,5 @@ algo::NamingStrategy Cz10ImageArchiveDecoder::naming_strategy() const
     return algo::NamingStrategy::Sibling;
 }
 
-static auto _ = dec::register_decoder<Cz10ImageArchiveDecoder>("leaf/cz10");
+static auto _ = dec::register_decoder<Cz10ImageArchiveDecoder>(
+    "leaf/cz10").with_magic(magic);
@@ -155,4 +155,5 @@ std::vector<std::string> KcapArchiveDecoder::get_linked_formats() const
     return {"truevision/tga", "leaf/bbm", "leaf/bjr"};
 }
 
-static auto _ = dec::register_decoder<KcapArchiveDecoder>("leaf/kcap");
+static auto _ = dec::register_decoder<KcapArchiveDecoder>(
+    "leaf/kcap").with_magic(magic);
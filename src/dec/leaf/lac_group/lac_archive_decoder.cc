@@ -17,6 +17,7 @@
 
 #include "dec/leaf/lac_group/lac_archive_decoder.h"
 #include "algo/range.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::leaf;
@@ -56,8 +57,11 @@ std::unique_ptr<io::File> LacArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
-static auto _ = dec::register_decoder<LacArchiveDecoder>("leaf/lac");
+static auto _ = dec::register_decoder<LacArchiveDecoder>(
+    "leaf/lac").with_magic(magic);
@@ -167,4 +167,5 @@ res::Image LfgImageDecoder::decode_impl(
     return image;
 }
 
-static auto _ = dec::register_decoder<LfgImageDecoder>("leaf/lfg");
+static auto _ = dec::register_decoder<LfgImageDecoder>(
+    "leaf/lfg").with_magic(magic);
@@ -17,6 +17,7 @@
 
 #include "dec/leaf/pak2_group/pak2_archive_decoder.h"
 #include "algo/range.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::leaf;
@@ -74,8 +75,10 @@ std::unique_ptr<io::File> Pak2ArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
 std::vector<std::string> Pak2ArchiveDecoder::get_linked_formats() const
@@ -89,4 +92,5 @@ std::vector<std::string> Pak2ArchiveDecoder::get_linked_formats() const
     };
 }
 
-static auto _ = dec::register_decoder<Pak2ArchiveDecoder>("leaf/pak2");
+static auto _ = dec::register_decoder<Pak2ArchiveDecoder>(
+    "leaf/pak2").with_extension("pak");
@@ -88,4 +88,4 @@ std::unique_ptr<io::File> Pak2CompressedFileDecoder::decode_impl(
 }
 
 static auto _ = dec::register_decoder<Pak2CompressedFileDecoder>(
-    "leaf/pak2-compressed-file");
+    "leaf/pak2-compressed-file").with_magic(magic, 4);
@@ -146,4 +146,4 @@ algo::NamingStrategy Pak2TextureArchiveDecoder::naming_strategy() const
 }
 
 static auto _ = dec::register_decoder<Pak2TextureArchiveDecoder>(
-    "leaf/pak2-texture");
+    "leaf/pak2-texture").with_magic(magic, 4);
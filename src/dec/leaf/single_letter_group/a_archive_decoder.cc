@@ -142,4 +142,5 @@ std::vector<std::string> AArchiveDecoder::get_linked_formats() const
     return {"leaf/w", "leaf/g", "leaf/px"};
 }
 
-static auto _ = dec::register_decoder<AArchiveDecoder>("leaf/a");
+static auto _ = dec::register_decoder<AArchiveDecoder>(
+    "leaf/a").with_magic(magic);
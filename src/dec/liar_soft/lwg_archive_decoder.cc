@@ -19,6 +19,7 @@
 #include "algo/locale.h"
 #include "algo/range.h"
 #include "dec/liar_soft/wcg_image_decoder.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::liar_soft;
@@ -64,8 +65,10 @@ std::unique_ptr<io::File> LwgArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
 std::vector<std::string> LwgArchiveDecoder::get_linked_formats() const
@@ -73,4 +76,5 @@ std::vector<std::string> LwgArchiveDecoder::get_linked_formats() const
     return {"liar-soft/wcg", "liar-soft/lwg"};
 }
 
-static auto _ = dec::register_decoder<LwgArchiveDecoder>("liar-soft/lwg");
+static auto _ = dec::register_decoder<LwgArchiveDecoder>(
+    "liar-soft/lwg").with_magic(magic);
@@ -67,4 +67,5 @@ std::vector<std::string> XflArchiveDecoder::get_linked_formats() const
     return {"liar-soft/xfl", "liar-soft/wcg", "liar-soft/lwg", "vorbis/wav"};
 }
 
-static auto _ = dec::register_decoder<XflArchiveDecoder>("liar-soft/xfl");
+static auto _ = dec::register_decoder<XflArchiveDecoder>(
+    "liar-soft/xfl").with_magic(magic);
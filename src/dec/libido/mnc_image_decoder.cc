@@ -51,4 +51,5 @@ res::Image MncImageDecoder::decode_impl(
     return image;
 }
 
-static auto _ = dec::register_decoder<MncImageDecoder>("libido/mnc");
+static auto _ = dec::register_decoder<MncImageDecoder>(
+    "libido/mnc").with_magic(magic);
@@ -18,6 +18,7 @@
 #include "dec/lilim/aos2_archive_decoder.h"
 #include "algo/range.h"
 #include "io/msb_bit_stream.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::lilim;
@@ -63,8 +64,10 @@ std::unique_ptr<io::File> Aos2ArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
 std::vector<std::string> Aos2ArchiveDecoder::get_linked_formats() const
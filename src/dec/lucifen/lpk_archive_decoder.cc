@@ -233,4 +233,5 @@ std::vector<std::string> LpkArchiveDecoder::get_linked_formats() const
     return {"lucifen/elg"};
 }
 
-static auto _ = dec::register_decoder<LpkArchiveDecoder>("lucifen/lpk");
+static auto _ = dec::register_decoder<LpkArchiveDecoder>(
+    "lucifen/lpk").with_magic(magic);
@@ -17,6 +17,7 @@
 
 #include "dec/mages/mpk_archive_decoder.h"
 #include "algo/range.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::mages;
@@ -65,8 +66,10 @@ std::unique_ptr<io::File> MpkArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
 std::vector<std::string> MpkArchiveDecoder::get_linked_formats() const
@@ -74,4 +77,5 @@ std::vector<std::string> MpkArchiveDecoder::get_linked_formats() const
     return {"microsoft/dds", "png/png"};
 }
 
-static auto _ = dec::register_decoder<MpkArchiveDecoder>("mages/mpk");
+static auto _ = dec::register_decoder<MpkArchiveDecoder>(
+    "mages/mpk").with_magic(magic);
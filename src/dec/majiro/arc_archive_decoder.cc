@@ -21,6 +21,7 @@
 #include "algo/str.h"
 #include "err.h"
 #include "io/memory_byte_stream.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::majiro;
@@ -74,8 +75,10 @@ std::unique_ptr<io::File> ArcArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
 std::vector<std::string> ArcArchiveDecoder::get_linked_formats() const
@@ -83,4 +86,5 @@ std::vector<std::string> ArcArchiveDecoder::get_linked_formats() const
     return {"majiro/rc8", "majiro/rct"};
 }
 
-static auto _ = dec::register_decoder<ArcArchiveDecoder>("majiro/arc");
+static auto _ = dec::register_decoder<ArcArchiveDecoder>(
+    "majiro/arc").with_magic(magic);
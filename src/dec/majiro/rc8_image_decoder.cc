@@ -104,4 +104,5 @@ res::Image Rc8ImageDecoder::decode_impl(
     return res::Image(width, height, data_orig, palette);
 }
 
-static auto _ = dec::register_decoder<Rc8ImageDecoder>("majiro/rc8");
+static auto _ = dec::register_decoder<Rc8ImageDecoder>(
+    "majiro/rc8").with_magic(magic);
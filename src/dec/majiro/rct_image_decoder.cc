@@ -231,4 +231,5 @@ res::Image RctImageDecoder::decode_impl(
     return output_image;
 }
 
-static auto _ = dec::register_decoder<RctImageDecoder>("majiro/rct");
+static auto _ = dec::register_decoder<RctImageDecoder>(
+    "majiro/rct").with_magic(magic);
@@ -17,12 +17,50 @@
 
 #include "dec/malie/common/camellia_stream.h"
 #include <cstring>
+#include "algo/endian.h"
 #include "algo/range.h"
-#include "io/memory_byte_stream.h"
+#include "err.h"
 
 using namespace au;
 using namespace au::dec::malie::common;
 
+static const size_t block_size = 0x10;
+static const size_t window_size = 0x10000;
+
+static uoff_t align_down(const uoff_t offset)
+{
+    return offset & ~static_cast<uoff_t>(block_size - 1);
+}
+
+static uoff_t align_up(const uoff_t offset)
+{
+    return align_down(offset + block_size - 1);
+}
+
+// Decrypts whole blocks in place; offset is their absolute position in the
+// archive, which the cipher mixes into each block.
+static void decrypt_blocks(
+    const algo::crypt::Camellia &camellia,
+    const uoff_t offset,
+    u8 *data,
+    const size_t block_count)
+{
+    for (const auto i : algo::range(block_count))
+    {
+        u32 input_block[4];
+        u32 output_block[4];
+        std::memcpy(input_block, data, block_size);
+        for (const auto j : algo::range(4))
+            input_block[j] = algo::from_little_endian(input_block[j]);
+        camellia.decrypt_block_128(
+            offset + i * block_size, input_block, output_block);
+        for (const auto j : algo::range(4))
+            output_block[j] = algo::to_big_endian(output_block[j]);
+        std::memcpy(data, output_block, block_size);
+        data += block_size;
+    }
+}
+
 CamelliaStream::CamelliaStream(
     io::BaseByteStream &parent_stream, const std::vector<u32> &key)
         : CamelliaStream(parent_stream, key, 0, parent_stream.size())
@@ -37,10 +75,12 @@ CamelliaStream::CamelliaStream(
         key(key),
         parent_stream(parent_stream.clone()),
         parent_stream_offset(offset),
-        parent_stream_size(size)
+        parent_stream_size(size),
+        window_offset(0)
 {
     if (key.size())
         camellia = std::make_unique<algo::crypt::Camellia>(key);
+    this->parent_stream->seek(parent_stream_offset);
 }
 
 CamelliaStream::~CamelliaStream()
@@ -52,43 +92,65 @@ void CamelliaStream::seek_impl(const uoff_t offset)
     parent_stream->seek(parent_stream_offset + offset);
 }
 
+void CamelliaStream::fill_window(const uoff_t offset)
+{
+    // The blocks are aligned to the archive rather than to the entry, so
+    // the window may extend slightly past the entry boundaries.
+    window_offset = align_down(offset);
+    const auto window_end = std::max(
+        align_up(offset + 1),
+        std::min(
+            window_offset + window_size,
+            align_up(parent_stream_offset + parent_stream_size)));
+    parent_stream->seek(window_offset);
+    window = parent_stream->read(window_end - window_offset);
+    decrypt_blocks(
+        *camellia,
+        window_offset,
+        window.get<u8>(),
+        window.size() / block_size);
+}
+
 void CamelliaStream::read_impl(void *destination, const size_t size)
 {
     if (!camellia)
     {
-        const auto chunk = parent_stream->read(size);
-        std::memcpy(destination, chunk.get<u8>(), size);
+        parent_stream->read(destination, size);
         return;
     }
 
-    const auto old_pos = parent_stream->pos();
-    const auto offset_pad = parent_stream->pos() & 0xF;
-    const auto offset_start = parent_stream->pos() & ~0xF;
-    const auto aligned_size = (offset_pad + size + 0xF) & ~0xF;
-    const auto block_count = (aligned_size + 0xF) / 0x10;
-    if (block_count == 0)
-        return;
+    auto output = reinterpret_cast<u8*>(destination);
+    auto offset = parent_stream->pos();
+    const auto end = offset + size;
+    while (offset < end)
+    {
+        if (offset >= window_offset && offset < window_offset + window.size())
+        {
+            const auto chunk_size = std::min<uoff_t>(
+                window_offset + window.size() - offset, end - offset);
+            std::memcpy(
+                output,
+                window.get<const u8>() + (offset - window_offset),
+                chunk_size);
+            output += chunk_size;
+            offset += chunk_size;
+            continue;
+        }
 
-    parent_stream->seek(parent_stream_offset
-        + ((parent_stream->pos() - parent_stream_offset) - offset_pad));
+        if (offset % block_size == 0 && end - offset >= window_size)
+        {
+            const auto chunk_size = align_down(end - offset);
+            parent_stream->seek(offset);
+            parent_stream->read(output, chunk_size);
+            decrypt_blocks(*camellia, offset, output, chunk_size / block_size);
+            output += chunk_size;
+            offset += chunk_size;
+            continue;
+        }
 
-    io::MemoryByteStream output_stream;
-    output_stream.resize(block_count * 16);
-    output_stream.seek(0);
-    for (const auto i : algo::range(block_count))
-    {
-        u32 input_block[4];
-        u32 output_block[4];
-        for (const auto j : algo::range(4))
-            input_block[j] = parent_stream->read_le<u32>();
-        camellia->decrypt_block_128(
-            offset_start + i * 0x10, input_block, output_block);
-        for (const auto j : algo::range(4))
-            output_stream.write_be<u32>(output_block[j]);
+        fill_window(offset);
     }
-    const auto chunk = output_stream.seek(offset_pad).read(size);
-    std::memcpy(destination, chunk.get<u8>(), size);
-    parent_stream->seek(old_pos + size);
+    parent_stream->seek(end);
 }
 
 void CamelliaStream::write_impl(const void *source, const size_t size)
@@ -108,6 +170,7 @@ uoff_t CamelliaStream::size() const
 
 void CamelliaStream::resize_impl(const uoff_t new_size)
 {
+    window = ""_b;
     parent_stream->resize(new_size);
 }
 
@@ -26,7 +26,9 @@ namespace malie {
 namespace common {
 
     // Rather than decrypting to bstr, the decryption is implemented as stream,
-    // so that huge files occupy as little memory as possible
+    // so that huge files occupy as little memory as possible. Small reads are
+    // served from a window of decrypted blocks, while large reads are
+    // decrypted directly into the destination.
     class CamelliaStream final : public io::BaseByteStream
     {
     public:
@@ -55,6 +57,10 @@ namespace common {
         std::unique_ptr<io::BaseByteStream> parent_stream;
         const uoff_t parent_stream_offset;
         const uoff_t parent_stream_size;
+
+        void fill_window(const uoff_t offset);
+        bstr window;
+        uoff_t window_offset; // absolute offset in the parent stream
     };
 
 } } } }
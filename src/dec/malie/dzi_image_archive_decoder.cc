@@ -164,4 +164,5 @@ std::unique_ptr<io::File> DziImageArchiveDecoder::read_file_impl(
     return enc::png::PngImageEncoder().encode(logger, image, entry->path);
 }
 
-static auto _ = dec::register_decoder<DziImageArchiveDecoder>("malie/dzi");
+static auto _ = dec::register_decoder<DziImageArchiveDecoder>(
+    "malie/dzi").with_magic(magic);
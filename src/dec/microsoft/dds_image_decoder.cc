@@ -196,4 +196,5 @@ res::Image DdsImageDecoder::decode_impl(
     return *image;
 }
 
-static auto _ = dec::register_decoder<DdsImageDecoder>("microsoft/dds");
+static auto _ = dec::register_decoder<DdsImageDecoder>(
+    "microsoft/dds").with_magic(magic);
@@ -111,7 +111,7 @@ std::unique_ptr<io::File> PacArchiveDecoder::read_file_impl(
     const auto entry = static_cast<const CompressedArchiveEntry*>(&e);
     auto data = input_file.stream.seek(entry->offset).read(entry->size_comp);
     if (entry->size_orig != entry->size_comp)
-        data = algo::pack::zlib_inflate(data);
+        data = algo::pack::zlib_inflate(data, entry->size_orig);
     return std::make_unique<io::File>(entry->path, data);
 }
 
@@ -120,4 +120,5 @@ std::vector<std::string> PacArchiveDecoder::get_linked_formats() const
     return {"minato-soft/fil"};
 }
 
-static auto _ = dec::register_decoder<PacArchiveDecoder>("minato-soft/pac");
+static auto _ = dec::register_decoder<PacArchiveDecoder>(
+    "minato-soft/pac").with_magic(magic);
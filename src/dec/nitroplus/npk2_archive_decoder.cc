@@ -128,4 +128,5 @@ std::vector<std::string> Npk2ArchiveDecoder::get_linked_formats() const
     return {"microsoft/dds"};
 }
 
-static auto _ = dec::register_decoder<Npk2ArchiveDecoder>("nitroplus/npk2");
+static auto _ = dec::register_decoder<Npk2ArchiveDecoder>(
+    "nitroplus/npk2").with_magic(magic);
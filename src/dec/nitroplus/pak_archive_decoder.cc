@@ -54,7 +54,7 @@ std::unique_ptr<dec::ArchiveMeta> PakArchiveDecoder::read_meta_impl(
 
     io::MemoryByteStream table_stream(
         algo::pack::zlib_inflate(
-            input_file.stream.read(table_size_comp)));
+            input_file.stream.read(table_size_comp), table_size_orig));
 
     auto meta = std::make_unique<ArchiveMeta>();
     const auto file_data_offset = input_file.stream.pos();
@@ -83,7 +83,8 @@ std::unique_ptr<io::File> PakArchiveDecoder::read_file_impl(
     const auto entry = static_cast<const CustomArchiveEntry*>(&e);
     input_file.stream.seek(entry->offset);
     const auto data = entry->compressed
-        ? algo::pack::zlib_inflate(input_file.stream.read(entry->size_comp))
+        ? algo::pack::zlib_inflate(
+            input_file.stream.read(entry->size_comp), entry->size_orig)
         : input_file.stream.read(entry->size_orig);
     return std::make_unique<io::File>(entry->path, data);
 }
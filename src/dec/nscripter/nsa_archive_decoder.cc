@@ -22,6 +22,7 @@
 #include "dec/nscripter/spb_image_decoder.h"
 #include "enc/png/png_image_encoder.h"
 #include "err.h"
+#include "io/memory_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::nscripter;
@@ -72,14 +73,20 @@ std::unique_ptr<dec::ArchiveMeta> NsaArchiveDecoder::read_meta_impl(
     auto meta = std::make_unique<ArchiveMeta>();
     const auto file_count = input_stream.read_be<u16>();
     const auto offset_to_data = input_stream.read_be<u32>();
+    if (offset_to_data < input_stream.pos())
+        throw err::CorruptDataError("Bad offset to data");
+
+    // decrypt the whole table at once
+    io::MemoryByteStream table_stream(
+        input_stream.read(offset_to_data - input_stream.pos()));
     for (const auto i : algo::range(file_count))
     {
         auto entry = std::make_unique<CustomArchiveEntry>();
-        entry->path = input_stream.read_to_zero().str(true);
-        entry->compression_type = input_stream.read<CompressionType>();
-        entry->offset = input_stream.read_be<u32>() + offset_to_data;
-        entry->size_comp = input_stream.read_be<u32>();
-        entry->size_orig = input_stream.read_be<u32>();
+        entry->path = table_stream.read_to_zero().str(true);
+        entry->compression_type = table_stream.read<CompressionType>();
+        entry->offset = table_stream.read_be<u32>() + offset_to_data;
+        entry->size_comp = table_stream.read_be<u32>();
+        entry->size_orig = table_stream.read_be<u32>();
         meta->entries.push_back(std::move(entry));
     }
     return meta;
@@ -18,6 +18,7 @@
 #include "dec/nscripter/nsa_encrypted_stream.h"
 #include <array>
 #include <cstring>
+#include <mutex>
 #include "algo/binary.h"
 #include "algo/crypt/hmac.h"
 #include "algo/crypt/md5.h"
@@ -28,9 +29,63 @@
 using namespace au;
 using namespace au::dec::nscripter;
 
-static const auto block_size = 1024;
+static const size_t block_size = 1024;
+static const size_t keystream_slot_count = 64;
+static const size_t decrypted_block_count = 4;
 
-static void transform_block(const bstr &key, size_t block_num, bstr &block)
+namespace
+{
+    using Keystream = std::array<u8, block_size>;
+
+    struct KeystreamSlot final
+    {
+        bstr key; // empty for unused slots
+        uoff_t block_num = 0;
+        Keystream keystream;
+    };
+
+    // Keystreams depend only on the key and the block number, so they are
+    // shared by all the streams, which in practice means that the blocks
+    // straddling adjacent archive entries get derived only once.
+    class KeystreamCache final
+    {
+    public:
+        void apply(
+            const bstr &key,
+            const uoff_t block_num,
+            u8 *data,
+            const size_t offset,
+            const size_t size);
+
+    private:
+        std::mutex mutex;
+        std::array<KeystreamSlot, keystream_slot_count> slots;
+    };
+
+    struct DecryptedBlock final
+    {
+        uoff_t block_num = 0;
+        bstr data; // empty for unused blocks
+        size_t last_use = 0;
+    };
+}
+
+struct NsaEncryptedStream::BlockCache final
+{
+    const bstr &get(
+        io::BaseByteStream &parent_stream,
+        const bstr &key,
+        const uoff_t block_num);
+    void clear();
+
+    std::array<DecryptedBlock, decrypted_block_count> blocks;
+    size_t use_counter = 0;
+};
+
+static KeystreamCache keystream_cache;
+
+static void derive_keystream(
+    const bstr &key, uoff_t block_num, Keystream &keystream)
 {
     bstr bn(8);
 
@@ -68,18 +123,92 @@ static void transform_block(const bstr &key, size_t block_num, bstr &block)
         std::swap(box[i0], box[i1]);
     }
 
-    for (const auto i : algo::range(block.size()))
+    for (const auto i : algo::range(block_size))
     {
         i0++;
         i1 += box[i0];
         std::swap(box[i0], box[i1]);
-        block[i] ^= box[(box[i0] + box[i1]) & 0xFF];
+        keystream[i] = box[(box[i0] + box[i1]) & 0xFF];
+    }
+}
+
+void KeystreamCache::apply(
+    const bstr &key,
+    const uoff_t block_num,
+    u8 *data,
+    const size_t offset,
+    const size_t size)
+{
+    auto &slot = slots[block_num % slots.size()];
+    Keystream keystream;
+    bool found;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        found = slot.block_num == block_num && slot.key == key;
+        if (found)
+            keystream = slot.keystream;
+    }
+
+    if (!found)
+    {
+        derive_keystream(key, block_num, keystream);
+        std::lock_guard<std::mutex> lock(mutex);
+        slot.key = key;
+        slot.block_num = block_num;
+        slot.keystream = keystream;
+    }
+
+    for (const auto i : algo::range(size))
+        data[i] ^= keystream[offset + i];
+}
+
+const bstr &NsaEncryptedStream::BlockCache::get(
+    io::BaseByteStream &parent_stream,
+    const bstr &key,
+    const uoff_t block_num)
+{
+    use_counter++;
+    auto *oldest_block = &blocks[0];
+    for (auto &block : blocks)
+    {
+        if (!block.data.empty() && block.block_num == block_num)
+        {
+            block.last_use = use_counter;
+            return block.data;
+        }
+        if (block.last_use < oldest_block->last_use)
+            oldest_block = &block;
+    }
+
+    const auto block_start = block_num * block_size;
+    parent_stream.seek(block_start);
+    oldest_block->block_num = block_num;
+    oldest_block->last_use = use_counter;
+    oldest_block->data = parent_stream.read(
+        std::min<uoff_t>(parent_stream.size() - block_start, block_size));
+    keystream_cache.apply(
+        key,
+        block_num,
+        oldest_block->data.get<u8>(),
+        0,
+        oldest_block->data.size());
+    return oldest_block->data;
+}
+
+void NsaEncryptedStream::BlockCache::clear()
+{
+    for (auto &block : blocks)
+    {
+        block.data = ""_b;
+        block.last_use = 0;
     }
 }
 
 NsaEncryptedStream::NsaEncryptedStream(
     io::BaseByteStream &parent_stream, const bstr &key)
-    : parent_stream(parent_stream.clone()), key(key)
+    : parent_stream(parent_stream.clone()),
+        key(key),
+        block_cache(std::make_unique<BlockCache>())
 {
 }
 
@@ -96,29 +225,48 @@ void NsaEncryptedStream::read_impl(void *destination, const size_t size)
 {
     if (key.empty())
     {
-        const auto chunk = parent_stream->read(size);
-        std::memcpy(destination, chunk.get<u8>(), size);
+        parent_stream->read(destination, size);
         return;
     }
 
-    const auto orig_pos = parent_stream->pos();
-    const auto padded_pos = orig_pos & ~(block_size - 1);
-    const auto offset_pad = orig_pos % block_size;
-    parent_stream->seek(padded_pos);
+    const auto start = parent_stream->pos();
+    const auto end = start + size;
+    if (end > parent_stream->size())
+        throw err::EofError();
+
+    auto output = reinterpret_cast<u8*>(destination);
+
+    // Small reads, such as the ones issued while parsing the archive index,
+    // are served from the recently decrypted blocks.
+    if (size < block_size)
+    {
+        for (auto pos = start; pos < end; )
+        {
+            const auto &block = block_cache->get(
+                *parent_stream, key, pos / block_size);
+            const auto offset = pos % block_size;
+            const auto chunk_size = std::min<uoff_t>(
+                block.size() - offset, end - pos);
+            std::memcpy(output, block.get<const u8>() + offset, chunk_size);
+            output += chunk_size;
+            pos += chunk_size;
+        }
+        parent_stream->seek(end);
+        return;
+    }
 
-    bstr full_buffer;
-    while (full_buffer.size() < size + offset_pad)
+    // Larger reads are decrypted in place, in a single pass.
+    parent_stream->read(output, size);
+    for (auto pos = start; pos < end; )
     {
-        const auto block_num = parent_stream->pos() / block_size;
-        auto block = parent_stream->read(
-            std::min<uoff_t>(parent_stream->left(), block_size));
-        transform_block(key, block_num, block);
-        full_buffer += block;
+        const auto offset = pos % block_size;
+        const auto chunk_size = std::min<uoff_t>(
+            block_size - offset, end - pos);
+        keystream_cache.apply(
+            key, pos / block_size, output, offset, chunk_size);
+        output += chunk_size;
+        pos += chunk_size;
     }
-    if (full_buffer.size() < size)
-        throw err::BadDataSizeError();
-    std::memcpy(destination, full_buffer.get<const u8>() + offset_pad, size);
-    parent_stream->seek(orig_pos + size);
 }
 
 void NsaEncryptedStream::write_impl(const void *source, const size_t size)
@@ -138,6 +286,7 @@ uoff_t NsaEncryptedStream::size() const
 
 void NsaEncryptedStream::resize_impl(const uoff_t new_size)
 {
+    block_cache->clear();
     parent_stream->resize(new_size);
 }
 
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <memory>
 #include "io/base_byte_stream.h"
 
 namespace au {
@@ -40,8 +41,11 @@ namespace nscripter {
         void resize_impl(const uoff_t new_size) override;
 
     private:
+        struct BlockCache;
+
         std::unique_ptr<io::BaseByteStream> parent_stream;
         const bstr key;
+        std::unique_ptr<BlockCache> block_cache;
     };
 
 } } }
@@ -104,4 +104,5 @@ res::Image SpbImageDecoder::decode_impl(
     return decode_image(bit_stream, width, height);
 }
 
-static auto _ = dec::register_decoder<SpbImageDecoder>("nscripter/spb");
+static auto _ = dec::register_decoder<SpbImageDecoder>(
+    "nscripter/spb").with_extension("bmp");
@@ -122,4 +122,4 @@ std::unique_ptr<io::File> GxtImageArchiveDecoder::read_file_impl(
 }
 
 static auto _ = dec::register_decoder<GxtImageArchiveDecoder>(
-    "playstation/gxt");
+    "playstation/gxt").with_magic(magic);
@@ -16,7 +16,6 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "dec/png/png_image_decoder.h"
-#include <cstring>
 #include <png.h>
 #include "algo/range.h"
 #include "err.h"
@@ -30,8 +29,7 @@ static void read_handler(png_structp png_ptr, png_bytep output, png_size_t size)
 {
     auto input_stream
         = reinterpret_cast<io::BaseByteStream*>(png_get_io_ptr(png_ptr));
-    const auto input = input_stream->read(size);
-    std::memcpy(output, input.get<u8>(), size);
+    input_stream->read(output, size);
 }
 
 static int custom_chunk_handler(png_structp png_ptr, png_unknown_chunkp chunk)
@@ -137,4 +135,5 @@ res::Image PngImageDecoder::decode(
     return ::decode(logger, input_file, chunk_handler);
 }
 
-static auto _ = dec::register_decoder<PngImageDecoder>("png/png");
+static auto _ = dec::register_decoder<PngImageDecoder>(
+    "png/png").with_magic(magic);
@@ -17,10 +17,12 @@
 
 #include "dec/purple_software/jbp1.h"
 #include <array>
+#include "algo/jpeg.h"
+#include "algo/pack/huffman.h"
+#include "algo/parallel.h"
 #include "algo/range.h"
 #include "err.h"
 #include "io/memory_byte_stream.h"
-#include "io/msb_bit_stream.h"
 
 using namespace au;
 
@@ -54,38 +56,29 @@ namespace
         size_t input_size;
     };
 
-    class CustomBitStream final : public io::BaseBitStream
-    {
-    public:
-        CustomBitStream(const bstr &str);
-        u32 read(const size_t bits) override;
-    };
+    // Four luma blocks followed by the two chroma blocks; ycc2rgb relies on
+    // the chroma blocks being adjacent.
+    using MacroBlock = std::array<std::array<s16, 64>, 6>;
 }
 
 Tree::Tree() : base(), neighbour(), other()
 {
 }
 
-CustomBitStream::CustomBitStream(const bstr &input) : io::BaseBitStream(input)
-{
-}
-
-u32 CustomBitStream::read(const size_t bits)
+// The bits are taken starting from the least significant bit of each byte,
+// but the values are assembled MSB-first. That's the same as reading the
+// input MSB-first after reversing the bits of every byte.
+static bstr reverse_bits(const bstr &input)
 {
-    u32 ret = 0;
-    for (const auto i : algo::range(bits))
+    bstr output(input);
+    for (auto &c : output)
     {
-        if (!bits_available)
-        {
-            buffer = input_stream->read<u8>();
-            bits_available = 8;
-        }
-        ret <<= 1;
-        ret |= (buffer & 1);
-        buffer >>= 1;
-        bits_available--;
+        u8 reversed = 0;
+        for (const auto i : algo::range(8))
+            reversed |= ((c >> i) & 1) << (7 - i);
+        c = reversed;
     }
-    return ret;
+    return output;
 }
 
 static Tree make_tree(const bstr &input, std::array<u32, 0x80> &freq)
@@ -149,164 +142,38 @@ static Tree make_tree(const bstr &input, std::array<u32, 0x80> &freq)
     return ret;
 }
 
-static int read_from_tree(const Tree &tree, io::BaseBitStream &bit_stream)
-{
-    size_t ret = tree.root;
-    while (ret >= tree.input_size)
-        ret = tree.neighbour.at((bit_stream.read(1) << 9) + ret);
-    return ret;
-}
-
-static void dct(
-    std::array<s16, 64> &dct_table, const std::array<s16, 64> &quant)
+static algo::pack::HuffmanTable make_table(const Tree &tree)
 {
-    long a, b, c, d;
-    long w, x, y, z;
-    long s, t, u, v, n;
-
-    auto lp1 = dct_table.data();
-    auto lp2 = quant.data();
-
-    for (const auto i : algo::range(8))
+    std::vector<algo::pack::HuffmanTable::Node> nodes(0x200);
+    for (size_t i = 0; i < nodes.size(); i++)
     {
-        if (lp1[0x08] == 0 &&
-            lp1[0x10] == 0 &&
-            lp1[0x18] == 0 &&
-            lp1[0x20] == 0 &&
-            lp1[0x28] == 0 &&
-            lp1[0x30] == 0 &&
-            lp1[0x38] == 0)
-        {
-            lp1[0x00] =
-            lp1[0x08] =
-            lp1[0x10] =
-            lp1[0x18] =
-            lp1[0x20] =
-            lp1[0x28] =
-            lp1[0x30] =
-            lp1[0x38] = lp1[0] * lp2[0];
-        }
-
-        else
-        {
-            c = lp2[0x10] * lp1[0x10];
-            d = lp2[0x30] * lp1[0x30];
-            x = ((c + d) * 35467) >> 16;
-            c = ((c * 50159) >> 16) + x;
-            d = ((d * -121094) >> 16) + x;
-            a = lp1[0x00] * lp2[0x00];
-            b = lp1[0x20] * lp2[0x20];
-            w = a + b + c;
-            x = a + b - c;
-            y = a - b + d;
-            z = a - b - d;
-
-            c = lp1[0x38] * lp2[0x38];
-            d = lp1[0x28] * lp2[0x28];
-            a = lp1[0x18] * lp2[0x18];
-            b = lp1[0x08] * lp2[0x08];
-            n = ((a + b + c + d) * 77062) >> 16;
-
-            u = n
-                + ((c * 19571) >> 16)
-                + (((c + a) * -128553) >> 16)
-                + (((c + b) * -58980) >> 16);
-            v = n
-                + ((d * 134553) >> 16)
-                + (((d + b) * -25570) >> 16)
-                + (((d + a) * -167963) >> 16);
-            t = n
-                + ((b * 98390) >> 16)
-                + (((d + b) * -25570) >> 16)
-                + (((c + b) * -58980) >> 16);
-            s = n
-                + ((a * 201373) >> 16)
-                + (((c + a) * -128553) >> 16)
-                + (((d + a) * -167963) >> 16);
-
-            lp1[0x00] = w + t;
-            lp1[0x38] = w - t;
-            lp1[0x08] = y + s;
-            lp1[0x30] = y - s;
-            lp1[0x10] = z + v;
-            lp1[0x28] = z - v;
-            lp1[0x18] = x + u;
-            lp1[0x20] = x - u;
-        }
-
-        lp1++;
-        lp2++;
-    }
-
-    lp1 = dct_table.data();
-
-    for (const auto i : algo::range(8))
-    {
-        a = lp1[0];
-        c = lp1[2];
-        b = lp1[4];
-        d = lp1[6];
-        x = (((c + d) * 35467) >> 16);
-        c = ((c * 50159) >> 16) + x;
-        d = ((d * -121094) >> 16) + x;
-        w = a + b + c;
-        x = a + b - c;
-        y = a - b + d;
-        z = a - b - d;
-
-        d = lp1[5];
-        b = lp1[1];
-        c = lp1[7];
-        a = lp1[3];
-        n = (((a + b + c + d) * 77062) >> 16);
-
-        s = n + ((a * 201373) >> 16)
-              + (((a + c) * -128553) >> 16)
-              + (((a + d) * -167963) >> 16);
-
-        t = n + ((b * 98390) >> 16)
-              + (((b + d) * -25570) >> 16)
-              + (((b + c) * -58980) >> 16);
-
-        u = n + ((c * 19571) >> 16)
-              + (((b + c) * -58980) >> 16)
-              + (((a + c) * -128553) >> 16);
-
-        v = n + ((d * 134553) >> 16)
-              + (((b + d) * -25570) >> 16)
-              + (((a + d) * -167963) >> 16);
-
-        lp1[0] = (w + t) >> 3;
-        lp1[7] = (w - t) >> 3;
-        lp1[1] = (y + s) >> 3;
-        lp1[6] = (y - s) >> 3;
-        lp1[2] = (z + v) >> 3;
-        lp1[5] = (z - v) >> 3;
-        lp1[3] = (x + u) >> 3;
-        lp1[4] = (x - u) >> 3;
-
-        lp1 += 8;
+        nodes[i].is_leaf = i < tree.input_size;
+        nodes[i].symbol = i;
+        nodes[i].children[0] = tree.neighbour[i];
+        nodes[i].children[1] = tree.neighbour[0x200 + i];
     }
+    return algo::pack::HuffmanTable(nodes, tree.root);
 }
 
-static void ycc2rgb(u8 *dc, u8 *ac, short *iy, short *cbcr, const size_t stride)
+static std::array<u8, 0x300> make_lookup_table()
 {
-    static bool initialized = false;
-    static std::array<u8, 0x300> lookup_table;
+    std::array<u8, 0x300> lookup_table;
+    for (const auto n : algo::range(0x100))
+        lookup_table[n] = 0;
 
-    if (!initialized)
-    {
-        for (const auto n : algo::range(0x100))
-            lookup_table[n] = 0;
+    for (const auto n : algo::range(0x100))
+        lookup_table[n + 0x100] = n;
 
-        for (const auto n : algo::range(0x100))
-            lookup_table[n + 0x100] = n;
+    for (const auto n : algo::range(0x100))
+        lookup_table[n + 0x200] = 0xFF;
 
-        for (const auto n : algo::range(0x100))
-            lookup_table[n + 0x200] = 0xFF;
+    return lookup_table;
+}
 
-        initialized = true;
-    }
+static void ycc2rgb(
+    u8 *dc, u8 *ac, const s16 *iy, const s16 *cbcr, const size_t stride)
+{
+    static const auto lookup_table = make_lookup_table();
 
     for (const auto y : algo::range(4))
     {
@@ -355,21 +222,22 @@ static void ycc2rgb(u8 *dc, u8 *ac, short *iy, short *cbcr, const size_t stride)
 static bstr decode_blocks(
     const BasicInfo &info,
     const bstr &tree_input,
-    io::BaseBitStream &bit_stream_1,
-    io::BaseBitStream &bit_stream_2,
+    io::MsbBitReader &bit_stream_1,
+    io::MsbBitReader &bit_stream_2,
     std::array<u32, 0x80> &freq_dc,
     std::array<u32, 0x80> &freq_ac,
     const std::array<s16, 64> &quant_y,
-    const std::array<s16, 64> &quant_c)
+    const std::array<s16, 64> &quant_c,
+    const size_t thread_count)
 {
-    const auto tree_dc = make_tree(tree_input, freq_dc);
-    const auto tree_ac = make_tree(tree_input, freq_ac);
+    const auto table_dc = make_table(make_tree(tree_input, freq_dc));
+    const auto table_ac = make_table(make_tree(tree_input, freq_ac));
 
     std::vector<u32> tmp(info.x_block_count * info.y_block_count * 3 * 2);
 
     for (const auto i : algo::range(tmp.size()))
     {
-        const auto bit_count = read_from_tree(tree_dc, bit_stream_1);
+        const auto bit_count = table_dc.decode(bit_stream_1);
         u32 x = bit_stream_1.read(bit_count);
         if (x < (1u << (bit_count - 1)))
             x = x - (1 << bit_count) + 1;
@@ -379,92 +247,95 @@ static bstr decode_blocks(
             tmp[i] += tmp[i - 1];
     }
 
-    bstr block_output(info.blocks_width * info.blocks_height * 4);
-    static const u8 original_order[64] =
+    // The coefficients of all the blocks come from a single bit stream, so
+    // they are decoded upfront; the rows of macroblocks are then transformed
+    // in parallel.
+    std::vector<MacroBlock> macro_blocks(
+        info.x_block_count * info.y_block_count);
+    for (const auto block : algo::range(macro_blocks.size()))
     {
-        1,  8,  16, 9,  2,  3,  10, 17,
-        24, 32, 25, 18, 11, 4,  5,  12,
-        19, 26, 33, 40, 48, 41, 34, 27,
-        20, 13, 6,  7,  14, 21, 28, 35,
-        42, 49, 56, 57, 50, 43, 36, 29,
-        22, 15, 23, 30, 37, 44, 51, 58,
-        59, 52, 45, 38, 31, 39, 46, 53,
-        60, 61, 54, 47, 55, 62, 63, 0
-    };
-
-    for (const auto y : algo::range(info.y_block_count))
-    {
-        auto target_base = &block_output[(info.blocks_width * 64) * y];
-        u8 *target1 = target_base + 32;
-        u8 *target2 = target_base + info.block_stride * 9;
-
-        for (const auto x : algo::range(info.x_block_count))
+        auto &dct_table = macro_blocks[block];
+        for (const auto n : algo::range(6))
         {
-            std::array<s16, 64> dct_table[6] = {0, 0, 0, 0, 0, 0};
+            dct_table[n][0] = tmp.at(block * 6 + n);
 
-            for (const auto n : algo::range(6))
+            for (int i = 0; i < 63;)
             {
-                dct_table[n][0] = tmp.at((y * info.x_block_count + x) * 6 + n);
+                const auto bit_count = table_ac.decode(bit_stream_2);
 
-                for (int i = 0; i < 63;)
+                if (bit_count == 15)
+                    break;
+
+                if (!bit_count)
+                {
+                    auto tree_input_pos = 0;
+                    while (bit_stream_2.read(1))
+                        tree_input_pos++;
+                    i += tree_input.at(tree_input_pos);
+                }
+                else
                 {
-                    const auto bit_count
-                        = read_from_tree(tree_ac, bit_stream_2);
-
-                    if (bit_count == 15)
-                        break;
-
-                    if (!bit_count)
-                    {
-                        auto tree_input_pos = 0;
-                        while (bit_stream_2.read(1))
-                            tree_input_pos++;
-                        i += tree_input.at(tree_input_pos);
-                    }
-                    else
-                    {
-                        u32 x = bit_stream_2.read(bit_count);
-                        if (x < (1u << (bit_count - 1)))
-                            x = x - (1 << bit_count) + 1;
-                        dct_table[n][original_order[i]] = x;
-                        i++;
-                    }
+                    u32 x = bit_stream_2.read(bit_count);
+                    if (x < (1u << (bit_count - 1)))
+                        x = x - (1 << bit_count) + 1;
+                    // the DC coefficient is not part of the scan
+                    dct_table[n][algo::jpeg::zigzag_order[i + 1]] = x;
+                    i++;
                 }
             }
-
-            dct(dct_table[0], quant_y);
-            dct(dct_table[1], quant_y);
-            dct(dct_table[2], quant_y);
-            dct(dct_table[3], quant_y);
-            dct(dct_table[4], quant_c);
-            dct(dct_table[5], quant_c);
-
-            u8 *dc, *ac;
-
-            dc = target1 - 32;
-            ac = target1 - 32 + info.block_stride;
-            ycc2rgb(
-                dc, ac, &dct_table[0][0], &dct_table[5][0], info.block_stride);
-
-            dc = target1;
-            ac = target2 + 32 - info.block_stride * 8;
-            ycc2rgb(
-                dc, ac, &dct_table[1][0], &dct_table[5][4], info.block_stride);
-
-            dc = target1 + ((info.block_stride) << 3) - 32;
-            ac = target2;
-            ycc2rgb(
-                dc, ac, &dct_table[2][0], &dct_table[5][32], info.block_stride);
-
-            dc = target2 + 32 - info.block_stride;
-            ac = target2 + 32;
-            ycc2rgb(
-                dc, ac, &dct_table[3][0], &dct_table[5][36], info.block_stride);
-
-            target1 += 64;
-            target2 += 64;
         }
     }
+
+    bstr block_output(info.blocks_width * info.blocks_height * 4);
+    algo::run_in_parallel(
+        info.y_block_count,
+        thread_count,
+        [&](const size_t y)
+        {
+            auto target_base = &block_output[(info.blocks_width * 64) * y];
+            u8 *target1 = target_base + 32;
+            u8 *target2 = target_base + info.block_stride * 9;
+
+            for (const auto x : algo::range(info.x_block_count))
+            {
+                auto &dct_table = macro_blocks[y * info.x_block_count + x];
+                algo::jpeg::idct_int(dct_table[0].data(), quant_y.data());
+                algo::jpeg::idct_int(dct_table[1].data(), quant_y.data());
+                algo::jpeg::idct_int(dct_table[2].data(), quant_y.data());
+                algo::jpeg::idct_int(dct_table[3].data(), quant_y.data());
+                algo::jpeg::idct_int(dct_table[4].data(), quant_c.data());
+                algo::jpeg::idct_int(dct_table[5].data(), quant_c.data());
+
+                u8 *dc, *ac;
+
+                dc = target1 - 32;
+                ac = target1 - 32 + info.block_stride;
+                ycc2rgb(
+                    dc, ac,
+                    &dct_table[0][0], &dct_table[5][0], info.block_stride);
+
+                dc = target1;
+                ac = target2 + 32 - info.block_stride * 8;
+                ycc2rgb(
+                    dc, ac,
+                    &dct_table[1][0], &dct_table[5][4], info.block_stride);
+
+                dc = target1 + ((info.block_stride) << 3) - 32;
+                ac = target2;
+                ycc2rgb(
+                    dc, ac,
+                    &dct_table[2][0], &dct_table[5][32], info.block_stride);
+
+                dc = target2 + 32 - info.block_stride;
+                ac = target2 + 32;
+                ycc2rgb(
+                    dc, ac,
+                    &dct_table[3][0], &dct_table[5][36], info.block_stride);
+
+                target1 += 64;
+                target2 += 64;
+            }
+        });
     return block_output;
 }
 
@@ -515,7 +386,8 @@ static BasicInfo read_basic_info(io::BaseByteStream &input_stream)
     return info;
 }
 
-bstr dec::purple_software::jbp1_decompress(const bstr &input)
+bstr dec::purple_software::jbp1_decompress(
+    const bstr &input, const size_t thread_count)
 {
     io::MemoryByteStream input_stream(input);
     const auto info = read_basic_info(input_stream);
@@ -545,8 +417,12 @@ bstr dec::purple_software::jbp1_decompress(const bstr &input)
             quant_c[i] =  input_stream.read<u8>();
     }
 
-    CustomBitStream bit_stream_1(input_stream.read(info.bit_pool_1_size));
-    CustomBitStream bit_stream_2(input_stream.read(info.bit_pool_2_size));
+    const auto bit_pool_1
+        = reverse_bits(input_stream.read(info.bit_pool_1_size));
+    const auto bit_pool_2
+        = reverse_bits(input_stream.read(info.bit_pool_2_size));
+    io::MsbBitReader bit_stream_1(bit_pool_1);
+    io::MsbBitReader bit_stream_2(bit_pool_2);
     const auto block_output = decode_blocks(
         info,
         tree_input,
@@ -555,7 +431,8 @@ bstr dec::purple_software::jbp1_decompress(const bstr &input)
         freq_dc,
         freq_ac,
         quant_y,
-        quant_c);
+        quant_c,
+        thread_count);
 
     const auto channel_count = info.depth >> 3;
     bstr pixel_output(info.width * info.height * channel_count);
@@ -23,6 +23,9 @@ namespace au {
 namespace dec {
 namespace purple_software {
 
-    bstr jbp1_decompress(const bstr &main_data);
+    // Rows of macroblocks are transformed on thread_count threads; 0 stands
+    // for the thread budget of the calling thread (see
+    // algo::get_thread_budget).
+    bstr jbp1_decompress(const bstr &main_data, const size_t thread_count = 0);
 
 } } }
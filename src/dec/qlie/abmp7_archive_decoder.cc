@@ -79,4 +79,5 @@ std::vector<std::string> Abmp7ArchiveDecoder::get_linked_formats() const
     return {"qlie/abmp7", "qlie/abmp10", "qlie/dpng"};
 }
 
-static auto _ = dec::register_decoder<Abmp7ArchiveDecoder>("qlie/abmp7");
+static auto _ = dec::register_decoder<Abmp7ArchiveDecoder>(
+    "qlie/abmp7").with_magic(magic);
@@ -127,4 +127,5 @@ res::Image Pdt10ImageDecoder::decode_impl(
     return output_image;
 }
 
-static auto _ = dec::register_decoder<Pdt10ImageDecoder>("real-live/pdt10");
+static auto _ = dec::register_decoder<Pdt10ImageDecoder>(
+    "real-live/pdt10").with_magic(magic);
@@ -20,12 +20,80 @@
 #include <map>
 #include "dec/idecoder.h"
 #include "err.h"
+#include "io/file.h"
 
+using namespace au;
 using namespace au::dec;
 
+namespace
+{
+    struct MagicTrieNode final
+    {
+        std::map<u8, size_t> children;
+        std::vector<std::string> decoder_names;
+    };
+
+    // Byte trie of all magic strings declared at the same offset, so that
+    // the header needs to be walked only once per offset.
+    struct MagicTrie final
+    {
+        MagicTrie();
+        void insert(const bstr &magic, const std::string &decoder_name);
+        void match(const bstr &input, std::set<std::string> &output) const;
+
+        std::vector<MagicTrieNode> nodes;
+    };
+
+    struct DecoderSignature final
+    {
+        bool has_magic = false;
+        std::vector<std::string> extensions;
+    };
+}
+
+MagicTrie::MagicTrie() : nodes(1)
+{
+}
+
+void MagicTrie::insert(const bstr &magic, const std::string &decoder_name)
+{
+    size_t node = 0;
+    for (const auto c : magic)
+    {
+        const auto it = nodes[node].children.find(c);
+        if (it != nodes[node].children.end())
+        {
+            node = it->second;
+            continue;
+        }
+        nodes.push_back(MagicTrieNode());
+        nodes[node].children[c] = nodes.size() - 1;
+        node = nodes.size() - 1;
+    }
+    nodes[node].decoder_names.push_back(decoder_name);
+}
+
+void MagicTrie::match(const bstr &input, std::set<std::string> &output) const
+{
+    size_t node = 0;
+    for (const auto c : input)
+    {
+        const auto it = nodes[node].children.find(c);
+        if (it == nodes[node].children.end())
+            return;
+        node = it->second;
+        output.insert(
+            nodes[node].decoder_names.begin(),
+            nodes[node].decoder_names.end());
+    }
+}
+
 struct Registry::Priv final
 {
     std::map<std::string, DecoderCreator> decoder_map;
+    std::map<std::string, DecoderSignature> signature_map;
+    std::map<uoff_t, MagicTrie> magic_tries;
+    uoff_t header_size = 0;
 };
 
 Registry::Registry() : p(new Priv)
@@ -68,6 +136,81 @@ void Registry::add_decoder(const std::string &name, DecoderCreator creator)
     p->decoder_map[name] = creator;
 }
 
+void Registry::add_magic(
+    const std::string &name, const bstr &magic, const uoff_t offset)
+{
+    if (!has_decoder(name))
+        throw std::logic_error("Unknown decoder: " + name);
+    if (magic.empty())
+        throw std::logic_error("Empty magic for decoder " + name);
+    p->signature_map[name].has_magic = true;
+    p->magic_tries[offset].insert(magic, name);
+    p->header_size = std::max<uoff_t>(p->header_size, offset + magic.size());
+}
+
+void Registry::add_extension(
+    const std::string &name, const std::string &extension)
+{
+    if (!has_decoder(name))
+        throw std::logic_error("Unknown decoder: " + name);
+    p->signature_map[name].extensions.push_back(extension);
+}
+
+std::vector<std::string> Registry::get_decoder_candidates(
+    io::File &input_file, const std::set<std::string> &decoder_names) const
+{
+    std::set<std::string> magic_matches;
+    try
+    {
+        const auto header = input_file.stream.seek(0).read(
+            std::min<uoff_t>(p->header_size, input_file.stream.size()));
+        for (const auto &it : p->magic_tries)
+        {
+            if (it.first < header.size())
+                it.second.match(header.substr(it.first), magic_matches);
+        }
+    }
+    catch (...)
+    {
+        return std::vector<std::string>(
+            decoder_names.begin(), decoder_names.end());
+    }
+
+    std::vector<std::string> candidates;
+    for (const auto &name : decoder_names)
+    {
+        const auto it = p->signature_map.find(name);
+        if (it != p->signature_map.end())
+        {
+            const auto &signature = it->second;
+            if (signature.has_magic
+                && magic_matches.find(name) == magic_matches.end())
+            {
+                continue;
+            }
+            if (!accepts_extension(name, input_file.path))
+                continue;
+        }
+        candidates.push_back(name);
+    }
+    return candidates;
+}
+
+bool Registry::accepts_extension(
+    const std::string &name, const io::path &path) const
+{
+    const auto it = p->signature_map.find(name);
+    if (it == p->signature_map.end() || it->second.extensions.empty())
+        return true;
+    return std::any_of(
+        it->second.extensions.begin(),
+        it->second.extensions.end(),
+        [&](const std::string &extension)
+        {
+            return path.has_extension(extension);
+        });
+}
+
 Registry &Registry::instance()
 {
     static Registry instance;
@@ -78,3 +221,23 @@ std::unique_ptr<Registry> Registry::create_mock()
 {
     return std::unique_ptr<Registry>(new Registry());
 }
+
+DecoderRegistration::DecoderRegistration(
+    Registry &registry, const std::string &name) :
+        registry(registry), name(name)
+{
+}
+
+DecoderRegistration &DecoderRegistration::with_magic(
+    const bstr &magic, const uoff_t offset)
+{
+    registry.add_magic(name, magic, offset);
+    return *this;
+}
+
+DecoderRegistration &DecoderRegistration::with_extension(
+    const std::string &extension)
+{
+    registry.add_extension(name, extension);
+    return *this;
+}
@@ -19,9 +19,12 @@
 
 #include <functional>
 #include <memory>
+#include <set>
 #include <vector>
+#include "types.h"
 
 namespace au {
+namespace io { class File; class path; }
 namespace dec {
 
     class IDecoder;
@@ -42,6 +45,26 @@ namespace dec {
         void add_decoder(const std::string &name, DecoderCreator creator);
         std::shared_ptr<IDecoder> create_decoder(const std::string &name) const;
 
+        // Signatures are optional prerequisites for recognition: a decoder
+        // with declared magic is considered only if at least one of its
+        // magic strings is present, and likewise for declared extensions.
+        void add_magic(
+            const std::string &name, const bstr &magic, const uoff_t offset);
+        void add_extension(
+            const std::string &name, const std::string &extension);
+
+        // Narrows decoders down to these whose signatures match the file,
+        // reading its header only once. Decoders that declare no signature
+        // are always kept, as they can be ruled out only by probing.
+        std::vector<std::string> get_decoder_candidates(
+            io::File &input_file,
+            const std::set<std::string> &decoder_names) const;
+
+        // Tells whether the path has one of the extensions declared for given
+        // decoder. Decoders that declare no extension accept any path.
+        bool accepts_extension(
+            const std::string &name, const io::path &path) const;
+
     private:
         Registry();
 
@@ -49,12 +72,28 @@ namespace dec {
         std::unique_ptr<Priv> p;
     };
 
-    template <typename T, typename ...Params> bool register_decoder(
-        const std::string &name, Params&&... params)
+    class DecoderRegistration final
+    {
+    public:
+        DecoderRegistration(Registry &registry, const std::string &name);
+
+        DecoderRegistration &with_magic(
+            const bstr &magic, const uoff_t offset = 0);
+
+        DecoderRegistration &with_extension(const std::string &extension);
+
+    private:
+        Registry &registry;
+        std::string name;
+    };
+
+    template <typename T, typename ...Params>
+        DecoderRegistration register_decoder(
+            const std::string &name, Params&&... params)
     {
         Registry::instance().add_decoder(
             name, [=]() { return std::make_shared<T>(params...); });
-        return true;
+        return DecoderRegistration(Registry::instance(), name);
     }
 
 } }
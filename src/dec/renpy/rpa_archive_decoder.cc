@@ -310,4 +310,41 @@ std::unique_ptr<io::File> RpaArchiveDecoder::read_file_impl(
     return std::make_unique<io::File>(entry->path, entry->prefix + data);
 }
 
+bstr RpaArchiveDecoder::serialize_meta_impl(const dec::ArchiveMeta &meta) const
+{
+    io::MemoryByteStream output_stream;
+    output_stream.write_le<u32>(meta.entries.size());
+    for (const auto &e : meta.entries)
+    {
+        const auto entry = static_cast<const CustomArchiveEntry*>(e.get());
+        const auto path = entry->path.str();
+        output_stream.write_le<u32>(path.size());
+        output_stream.write(path);
+        output_stream.write_le<u32>(entry->prefix.size());
+        output_stream.write(entry->prefix);
+        output_stream.write_le<u64>(entry->offset);
+        output_stream.write_le<u64>(entry->size);
+    }
+    return output_stream.seek(0).read_to_eof();
+}
+
+std::unique_ptr<dec::ArchiveMeta> RpaArchiveDecoder::deserialize_meta_impl(
+    const Logger &logger,
+    io::File &input_file,
+    io::BaseByteStream &input_stream) const
+{
+    auto meta = std::make_unique<ArchiveMeta>();
+    const auto file_count = input_stream.read_le<u32>();
+    for (const auto i : algo::range(file_count))
+    {
+        auto entry = std::make_unique<CustomArchiveEntry>();
+        entry->path = input_stream.read(input_stream.read_le<u32>()).str();
+        entry->prefix = input_stream.read(input_stream.read_le<u32>());
+        entry->offset = input_stream.read_le<u64>();
+        entry->size = input_stream.read_le<u64>();
+        meta->entries.push_back(std::move(entry));
+    }
+    return meta;
+}
+
 static auto _ = dec::register_decoder<RpaArchiveDecoder>("renpy/rpa");
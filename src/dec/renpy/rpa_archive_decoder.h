@@ -37,6 +37,13 @@ namespace renpy {
             io::File &input_file,
             const ArchiveMeta &m,
             const ArchiveEntry &e) const override;
+
+        bstr serialize_meta_impl(const ArchiveMeta &meta) const override;
+
+        std::unique_ptr<ArchiveMeta> deserialize_meta_impl(
+            const Logger &logger,
+            io::File &input_file,
+            io::BaseByteStream &input_stream) const override;
     };
 
 } } }
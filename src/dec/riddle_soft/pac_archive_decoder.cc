@@ -18,6 +18,7 @@
 #include "dec/riddle_soft/pac_archive_decoder.h"
 #include "algo/range.h"
 #include "err.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::riddle_soft;
@@ -61,8 +62,10 @@ std::unique_ptr<io::File> PacArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
 std::vector<std::string> PacArchiveDecoder::get_linked_formats() const
@@ -70,4 +73,5 @@ std::vector<std::string> PacArchiveDecoder::get_linked_formats() const
     return {"riddle-soft/cmp"};
 }
 
-static auto _ = dec::register_decoder<PacArchiveDecoder>("riddle-soft/pac");
+static auto _ = dec::register_decoder<PacArchiveDecoder>(
+    "riddle-soft/pac").with_magic(magic);
@@ -72,4 +72,5 @@ std::unique_ptr<io::File> RgssadArchiveDecoder::read_file_impl(
         input_file, *static_cast<const rgs::CustomArchiveEntry*>(&e));
 }
 
-static auto _ = dec::register_decoder<RgssadArchiveDecoder>("rpgmaker/rgssad");
+static auto _ = dec::register_decoder<RgssadArchiveDecoder>(
+    "rpgmaker/rgssad").with_magic(magic);
@@ -44,4 +44,5 @@ res::Image XyzImageDecoder::decode_impl(
     return res::Image(width, height, pix_data, palette);
 }
 
-static auto _ = dec::register_decoder<XyzImageDecoder>("rpgmaker/xyz");
+static auto _ = dec::register_decoder<XyzImageDecoder>(
+    "rpgmaker/xyz").with_magic(magic);
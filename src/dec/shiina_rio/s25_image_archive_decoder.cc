@@ -264,4 +264,5 @@ algo::NamingStrategy S25ImageArchiveDecoder::naming_strategy() const
     return algo::NamingStrategy::Sibling;
 }
 
-static auto _ = dec::register_decoder<S25ImageArchiveDecoder>("shiina-rio/s25");
+static auto _ = dec::register_decoder<S25ImageArchiveDecoder>(
+    "shiina-rio/s25").with_magic(magic);
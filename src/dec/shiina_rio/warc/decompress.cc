@@ -16,97 +16,50 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "dec/shiina_rio/warc/decompress.h"
+#include "algo/endian.h"
+#include "algo/pack/huffman.h"
 #include "algo/pack/zlib.h"
 #include "algo/range.h"
 #include "err.h"
-#include "io/memory_byte_stream.h"
-#include "io/msb_bit_stream.h"
 
 using namespace au;
 using namespace au::dec::shiina_rio;
 using namespace au::dec::shiina_rio::warc;
 
-namespace
+// The bits are consumed MSB-first from little endian dwords. When fewer than
+// four bytes remain, they get shifted into the previous dword, so the already
+// consumed low bits of that dword are read once more before them. Reorder the
+// input so that it can be read with a plain MSB-first reader.
+static bstr reorder_bits(const bstr &input)
 {
-    class CustomBitStream final : public io::BaseBitStream
+    const auto word_count = (input.size() + 3) / 4;
+    bstr output(word_count * 4);
+    auto output_ptr = output.get<u32>();
+    auto input_ptr = input.get<const u8>();
+    const auto input_end = input.end<const u8>();
+    u32 buffer = 0;
+    while (input_end - input_ptr >= 4)
     {
-    public:
-        CustomBitStream(const bstr &input);
-        u32 read(const size_t bits) override;
-    private:
-        void fetch();
-    };
-}
-
-CustomBitStream::CustomBitStream(const bstr &input) : io::BaseBitStream(input)
-{
-}
-
-void CustomBitStream::fetch()
-{
-    if (input_stream->left() >= 4)
-    {
-        buffer = input_stream->read_le<u32>();
-        return;
+        buffer = algo::from_little_endian(
+            *reinterpret_cast<const u32*>(input_ptr));
+        *output_ptr++ = algo::to_big_endian(buffer);
+        input_ptr += 4;
     }
-    while (input_stream->left())
+    if (input_ptr < input_end)
     {
-        buffer <<= 8;
-        buffer |= input_stream->read<u8>();
+        while (input_ptr < input_end)
+            buffer = (buffer << 8) | *input_ptr++;
+        *output_ptr = algo::to_big_endian(buffer);
     }
-}
-
-u32 CustomBitStream::read(size_t requested_bits)
-{
-    u32 value = 0;
-    if (bits_available < requested_bits)
-    {
-        do
-        {
-            requested_bits -= bits_available;
-            const u32 mask = (1ull << bits_available) - 1;
-            value |= (buffer & mask) << requested_bits;
-            fetch();
-            bits_available = 32;
-        }
-        while (requested_bits > 32);
-    }
-    bits_available -= requested_bits;
-    const u32 mask = (1ull << requested_bits) - 1;
-    return value | ((buffer >> bits_available) & mask);
-}
-
-static int init_huffman(
-    io::BaseBitStream &bit_stream, u16 nodes[2][512], int &size)
-{
-    if (!bit_stream.read(1))
-        return bit_stream.read(8);
-    const auto pos = size;
-    if (pos > 511)
-        return -1;
-    size++;
-    nodes[0][pos] = init_huffman(bit_stream, nodes, size);
-    nodes[1][pos] = init_huffman(bit_stream, nodes, size);
-    return pos;
+    return output;
 }
 
 static bstr decode_huffman(const bstr &input, const size_t size_orig)
 {
-    bstr output(size_orig);
-    auto output_ptr = output.get<u8>();
-    const auto output_end = output.end<const u8>();
-    CustomBitStream bit_stream(input);
-    u16 nodes[2][512];
-    auto size = 256;
-    const auto root = init_huffman(bit_stream, nodes, size);
-    while (output_ptr < output_end)
-    {
-        auto byte = root;
-        while (byte >= 256 && byte <= 511)
-            byte = nodes[bit_stream.read(1)][byte];
-        *output_ptr++ = byte;
-    }
-    return output;
+    const auto data = reorder_bits(input);
+    io::MsbBitReader reader(data);
+    const algo::pack::HuffmanTree huffman_tree(reader);
+    return algo::pack::decode_huffman(huffman_tree, reader, size_orig);
 }
 
 bstr warc::decompress_yh1(
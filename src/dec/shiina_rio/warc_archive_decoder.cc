@@ -172,4 +172,5 @@ std::vector<std::string> WarcArchiveDecoder::get_linked_formats() const
     return {"shiina-rio/ogv", "shiina-rio/s25"};
 }
 
-static auto _ = dec::register_decoder<WarcArchiveDecoder>("shiina-rio/warc");
+static auto _ = dec::register_decoder<WarcArchiveDecoder>(
+    "shiina-rio/warc").with_magic(magic);
@@ -47,4 +47,5 @@ res::Image PgaImageDecoder::decode_impl(
     return png_decoder.decode(logger, png_file);
 }
 
-static auto _ = dec::register_decoder<PgaImageDecoder>("sysadv/pga");
+static auto _ = dec::register_decoder<PgaImageDecoder>(
+    "sysadv/pga").with_magic(magic);
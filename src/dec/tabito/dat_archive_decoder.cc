@@ -77,4 +77,5 @@ std::vector<std::string> DatArchiveDecoder::get_linked_formats() const
     return {"tabito/gwd"};
 }
 
-static auto _ = dec::register_decoder<DatArchiveDecoder>("tabito/dat");
+static auto _ = dec::register_decoder<DatArchiveDecoder>(
+    "tabito/dat").with_extension("dat");
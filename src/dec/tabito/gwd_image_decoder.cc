@@ -165,4 +165,5 @@ res::Image GwdImageDecoder::decode_impl(
     return image;
 }
 
-static auto _ = dec::register_decoder<GwdImageDecoder>("tabito/gwd");
+static auto _ = dec::register_decoder<GwdImageDecoder>(
+    "tabito/gwd").with_magic(magic, 4);
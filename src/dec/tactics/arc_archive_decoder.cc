@@ -277,4 +277,5 @@ std::vector<std::string> ArcArchiveDecoder::get_linked_formats() const
     return {"microsoft/dds"};
 }
 
-static auto _ = dec::register_decoder<ArcArchiveDecoder>("tactics/arc");
+static auto _ = dec::register_decoder<ArcArchiveDecoder>(
+    "tactics/arc").with_magic(magic);
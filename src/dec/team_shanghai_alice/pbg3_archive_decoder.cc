@@ -112,4 +112,4 @@ std::vector<std::string> Pbg3ArchiveDecoder::get_linked_formats() const
 }
 
 static auto _ = dec::register_decoder<Pbg3ArchiveDecoder>(
-    "team-shanghai-alice/pbg3");
+    "team-shanghai-alice/pbg3").with_magic(magic);
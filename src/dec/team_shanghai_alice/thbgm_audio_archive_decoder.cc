@@ -139,4 +139,4 @@ std::unique_ptr<io::File> ThbgmAudioArchiveDecoder::read_file_impl(
 }
 
 static auto _ = dec::register_decoder<ThbgmAudioArchiveDecoder>(
-    "team-shanghai-alice/thbgm");
+    "team-shanghai-alice/thbgm").with_magic(magic);
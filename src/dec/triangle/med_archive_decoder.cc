@@ -18,6 +18,7 @@
 #include "dec/triangle/med_archive_decoder.h"
 #include "algo/range.h"
 #include "err.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::triangle;
@@ -57,8 +58,10 @@ std::unique_ptr<io::File> MedArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
 std::vector<std::string> MedArchiveDecoder::get_linked_formats() const
@@ -66,4 +69,5 @@ std::vector<std::string> MedArchiveDecoder::get_linked_formats() const
     return {"triangle/yb", "triangle/wady"};
 }
 
-static auto _ = dec::register_decoder<MedArchiveDecoder>("triangle/med");
+static auto _ = dec::register_decoder<MedArchiveDecoder>(
+    "triangle/med").with_magic(magic);
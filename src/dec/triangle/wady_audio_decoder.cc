@@ -91,4 +91,5 @@ res::Audio WadyAudioDecoder::decode_impl(
     return audio;
 }
 
-static auto _ = dec::register_decoder<WadyAudioDecoder>("triangle/wady");
+static auto _ = dec::register_decoder<WadyAudioDecoder>(
+    "triangle/wady").with_magic(magic);
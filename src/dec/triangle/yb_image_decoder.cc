@@ -136,4 +136,5 @@ res::Image YbImageDecoder::decode_impl(
     return res::Image(width, height, output, fmt);
 }
 
-static auto _ = dec::register_decoder<YbImageDecoder>("triangle/yb");
+static auto _ = dec::register_decoder<YbImageDecoder>(
+    "triangle/yb").with_magic(magic);
@@ -155,4 +155,4 @@ std::unique_ptr<io::File> Pak1ImageArchiveDecoder::read_file_impl(
 }
 
 static auto _ = dec::register_decoder<Pak1ImageArchiveDecoder>(
-    "twilight-frontier/pak1-gfx");
+    "twilight-frontier/pak1-gfx").with_extension("dat");
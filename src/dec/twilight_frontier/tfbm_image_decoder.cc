@@ -106,4 +106,4 @@ res::Image TfbmImageDecoder::decode_impl(
 }
 
 static auto _ = dec::register_decoder<TfbmImageDecoder>(
-    "twilight-frontier/tfbm");
+    "twilight-frontier/tfbm").with_magic(magic);
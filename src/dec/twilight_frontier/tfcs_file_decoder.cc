@@ -74,4 +74,4 @@ std::unique_ptr<io::File> TfcsFileDecoder::decode_impl(
 }
 
 static auto _ = dec::register_decoder<TfcsFileDecoder>(
-    "twilight-frontier/tfcs");
+    "twilight-frontier/tfcs").with_magic(magic);
@@ -50,4 +50,4 @@ res::Audio TfwaAudioDecoder::decode_impl(
 }
 
 static auto _ = dec::register_decoder<TfwaAudioDecoder>(
-    "twilight-frontier/tfwa");
+    "twilight-frontier/tfwa").with_magic(magic);
@@ -155,4 +155,5 @@ std::unique_ptr<io::File> PackedOggAudioDecoder::decode_impl(
     return output_file;
 }
 
-static auto _ = dec::register_decoder<PackedOggAudioDecoder>("vorbis/wav");
+static auto _ = dec::register_decoder<PackedOggAudioDecoder>(
+    "vorbis/wav").with_extension("wav");
@@ -402,4 +402,5 @@ std::vector<std::string> DatArchiveDecoder::get_linked_formats() const
     return {"kirikiri/tlg"};
 }
 
-static auto _ = dec::register_decoder<DatArchiveDecoder>("whale/dat");
+static auto _ = dec::register_decoder<DatArchiveDecoder>(
+    "whale/dat").with_extension("dat");
@@ -111,4 +111,5 @@ res::Image WbmImageDecoder::decode_impl(
     return image;
 }
 
-static auto _ = dec::register_decoder<WbmImageDecoder>("wild-bug/wbm");
+static auto _ = dec::register_decoder<WbmImageDecoder>(
+    "wild-bug/wbm").with_magic(magic);
@@ -18,6 +18,7 @@
 #include "dec/wild_bug/wbp_archive_decoder.h"
 #include <map>
 #include "algo/range.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::wild_bug;
@@ -102,8 +103,10 @@ std::unique_ptr<io::File> WbpArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
 std::vector<std::string> WbpArchiveDecoder::get_linked_formats() const
@@ -111,4 +114,5 @@ std::vector<std::string> WbpArchiveDecoder::get_linked_formats() const
     return {"wild-bug/wbi", "wild-bug/wbm", "wild-bug/wpn", "wild-bug/wwa"};
 }
 
-static auto _ = dec::register_decoder<WbpArchiveDecoder>("wild-bug/wbp");
+static auto _ = dec::register_decoder<WbpArchiveDecoder>(
+    "wild-bug/wbp").with_magic(magic);
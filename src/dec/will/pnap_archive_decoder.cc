@@ -66,4 +66,5 @@ std::unique_ptr<io::File> PnapArchiveDecoder::read_file_impl(
     return output_file;
 }
 
-static auto _ = dec::register_decoder<PnapArchiveDecoder>("will/pnap");
+static auto _ = dec::register_decoder<PnapArchiveDecoder>(
+    "will/pnap").with_magic(magic);
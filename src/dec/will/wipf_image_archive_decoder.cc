@@ -198,4 +198,5 @@ std::unique_ptr<io::File> WipfImageArchiveDecoder::read_file_impl(
     return encoder.encode(logger, *image, entry->path);
 }
 
-static auto _ = dec::register_decoder<WipfImageArchiveDecoder>("will/wipf");
+static auto _ = dec::register_decoder<WipfImageArchiveDecoder>(
+    "will/wipf").with_magic(magic);
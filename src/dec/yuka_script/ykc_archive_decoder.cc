@@ -18,6 +18,7 @@
 #include "dec/yuka_script/ykc_archive_decoder.h"
 #include "algo/locale.h"
 #include "algo/range.h"
+#include "io/slice_byte_stream.h"
 
 using namespace au;
 using namespace au::dec::yuka_script;
@@ -64,8 +65,10 @@ std::unique_ptr<io::File> YkcArchiveDecoder::read_file_impl(
     const dec::ArchiveEntry &e) const
 {
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
-    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
-    return std::make_unique<io::File>(entry->path, data);
+    return std::make_unique<io::File>(
+        entry->path,
+        std::make_unique<io::SliceByteStream>(
+            input_file.stream, entry->offset, entry->size));
 }
 
 std::vector<std::string> YkcArchiveDecoder::get_linked_formats() const
@@ -73,4 +76,5 @@ std::vector<std::string> YkcArchiveDecoder::get_linked_formats() const
     return {"yuka-script/ykg"};
 }
 
-static auto _ = dec::register_decoder<YkcArchiveDecoder>("yuka-script/ykc");
+static auto _ = dec::register_decoder<YkcArchiveDecoder>(
+    "yuka-script/ykc").with_magic(magic);
@@ -44,4 +44,5 @@ res::Image EpfImageDecoder::decode_impl(
     return res::Image(width, height, data, res::PixelFormat::BGRA8888);
 }
 
-static auto _ = dec::register_decoder<EpfImageDecoder>("yumemiru/epf");
+static auto _ = dec::register_decoder<EpfImageDecoder>(
+    "yumemiru/epf").with_magic(magic);
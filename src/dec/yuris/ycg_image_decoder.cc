@@ -62,4 +62,5 @@ res::Image YcgImageDecoder::decode_impl(
     return res::Image(width, height, data, res::PixelFormat::BGRA8888);
 }
 
-static auto _ = dec::register_decoder<YcgImageDecoder>("yuris/ycg");
+static auto _ = dec::register_decoder<YcgImageDecoder>(
+    "yuris/ycg").with_magic(magic);
@@ -198,7 +198,7 @@ std::unique_ptr<io::File> YpfArchiveDecoder::read_file_impl(
     const auto entry = static_cast<const CustomArchiveEntry*>(&e);
     auto data = input_file.stream.seek(entry->offset).read(entry->size_comp);
     if (entry->compressed)
-        data = algo::pack::zlib_inflate(data);
+        data = algo::pack::zlib_inflate(data, entry->size_orig);
     return std::make_unique<io::File>(entry->path, data);
 }
 
@@ -207,4 +207,5 @@ std::vector<std::string> YpfArchiveDecoder::get_linked_formats() const
     return {"yuris/ycg"};
 }
 
-static auto _ = dec::register_decoder<YpfArchiveDecoder>("yuris/ypf");
+static auto _ = dec::register_decoder<YpfArchiveDecoder>(
+    "yuris/ypf").with_magic(magic);
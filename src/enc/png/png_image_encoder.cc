@@ -16,7 +16,11 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "enc/png/png_image_encoder.h"
-#include <png.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <zlib.h>
+#include "algo/parallel.h"
 #include "algo/range.h"
 #include "err.h"
 #include "io/memory_byte_stream.h"
@@ -24,15 +28,317 @@
 using namespace au;
 using namespace au::enc::png;
 
-static void write_handler(
-    png_structp png_ptr, png_bytep input, png_size_t size)
+static const bstr magic = "\x89PNG\r\n\x1A\n"_b;
+
+// each band ends on a byte boundary, so bands compressed independently can
+// be concatenated into a single deflate stream
+static const size_t min_band_size = 256 * 1024;
+static const size_t max_band_size = 64 * 1024 * 1024;
+
+namespace
+{
+    enum ColorTypeId : u8
+    {
+        Gray = 0,
+        Rgb = 2,
+        Indexed = 3,
+        GrayAlpha = 4,
+        Rgba = 6,
+    };
+
+    struct ImageLayout final
+    {
+        ColorTypeId color_type;
+        size_t channels;
+        std::vector<res::Pixel> palette;
+
+        // sorted by pixel key, so that lookups are binary searches over at
+        // most 256 entries
+        std::vector<std::pair<u32, u8>> palette_indices;
+    };
+}
+
+static inline u32 pixel_key(const res::Pixel &c)
+{
+    u32 key;
+    std::memcpy(&key, &c, sizeof(key));
+    return key;
+}
+
+static std::vector<std::pair<u32, u8>>::const_iterator find_palette_index(
+    const std::vector<std::pair<u32, u8>> &palette_indices, const u32 key)
+{
+    return std::lower_bound(
+        palette_indices.begin(),
+        palette_indices.end(),
+        key,
+        [](const std::pair<u32, u8> &entry, const u32 key)
+        {
+            return entry.first < key;
+        });
+}
+
+static ImageLayout analyze_image(
+    const res::Image &image, const PngColorType color_type)
+{
+    ImageLayout layout;
+    layout.color_type = ColorTypeId::Rgba;
+    layout.channels = 4;
+    if (color_type == PngColorType::Rgba)
+        return layout;
+
+    bool is_gray = true;
+    bool is_opaque = true;
+    bool fits_palette = true;
+    u32 last_key = 0;
+    for (const auto &c : image)
+    {
+        is_gray &= c.r == c.g && c.g == c.b;
+        is_opaque &= c.a == 0xFF;
+        if (!fits_palette)
+            continue;
+        const auto key = pixel_key(c);
+        if (key == last_key && !layout.palette.empty())
+            continue;
+        last_key = key;
+        const auto it = find_palette_index(layout.palette_indices, key);
+        if (it != layout.palette_indices.end() && it->first == key)
+            continue;
+        if (layout.palette.size() == 256)
+        {
+            fits_palette = false;
+            continue;
+        }
+        layout.palette_indices.emplace(it, key, layout.palette.size());
+        layout.palette.push_back(c);
+    }
+
+    if (is_gray && is_opaque)
+    {
+        layout.color_type = ColorTypeId::Gray;
+        layout.channels = 1;
+    }
+    else if (fits_palette
+        && layout.palette.size() < image.width() * image.height())
+    {
+        layout.color_type = ColorTypeId::Indexed;
+        layout.channels = 1;
+        return layout;
+    }
+    else if (is_gray)
+    {
+        layout.color_type = ColorTypeId::GrayAlpha;
+        layout.channels = 2;
+    }
+    else if (is_opaque)
+    {
+        layout.color_type = ColorTypeId::Rgb;
+        layout.channels = 3;
+    }
+    layout.palette.clear();
+    layout.palette_indices.clear();
+    return layout;
+}
+
+static void convert_row(
+    const res::Image &image, const ImageLayout &layout, const size_t y, u8 *out)
+{
+    const auto *source = &image.at(0, y);
+    const auto *source_end = source + image.width();
+    switch (layout.color_type)
+    {
+        case ColorTypeId::Gray:
+            for (; source < source_end; source++)
+                *out++ = source->r;
+            break;
+
+        case ColorTypeId::GrayAlpha:
+            for (; source < source_end; source++)
+            {
+                *out++ = source->r;
+                *out++ = source->a;
+            }
+            break;
+
+        case ColorTypeId::Indexed:
+            for (; source < source_end; source++)
+            {
+                *out++ = find_palette_index(
+                    layout.palette_indices, pixel_key(*source))->second;
+            }
+            break;
+
+        case ColorTypeId::Rgb:
+            for (; source < source_end; source++)
+            {
+                *out++ = source->r;
+                *out++ = source->g;
+                *out++ = source->b;
+            }
+            break;
+
+        case ColorTypeId::Rgba:
+            for (; source < source_end; source++)
+            {
+                *out++ = source->r;
+                *out++ = source->g;
+                *out++ = source->b;
+                *out++ = source->a;
+            }
+            break;
+    }
+}
+
+static inline u8 paeth_predictor(const int a, const int b, const int c)
+{
+    const auto p = a + b - c;
+    const auto pa = std::abs(p - a);
+    const auto pb = std::abs(p - b);
+    const auto pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc)
+        return a;
+    if (pb <= pc)
+        return b;
+    return c;
+}
+
+static void apply_filter(
+    const PngFilterStrategy filter,
+    const u8 *row,
+    const u8 *prev_row,
+    const size_t size,
+    const size_t bpp,
+    u8 *out)
+{
+    *out++ = static_cast<u8>(filter);
+    switch (filter)
+    {
+        case PngFilterStrategy::None:
+            std::memcpy(out, row, size);
+            break;
+
+        case PngFilterStrategy::Sub:
+            for (size_t i = 0; i < size; i++)
+                out[i] = row[i] - (i >= bpp ? row[i - bpp] : 0);
+            break;
+
+        case PngFilterStrategy::Up:
+            for (size_t i = 0; i < size; i++)
+                out[i] = row[i] - prev_row[i];
+            break;
+
+        case PngFilterStrategy::Average:
+            for (size_t i = 0; i < size; i++)
+            {
+                const auto left = i >= bpp ? row[i - bpp] : 0;
+                out[i] = row[i] - ((left + prev_row[i]) >> 1);
+            }
+            break;
+
+        case PngFilterStrategy::Paeth:
+            for (size_t i = 0; i < size; i++)
+            {
+                const auto left = i >= bpp ? row[i - bpp] : 0;
+                const auto up_left = i >= bpp ? prev_row[i - bpp] : 0;
+                out[i] = row[i] - paeth_predictor(left, prev_row[i], up_left);
+            }
+            break;
+
+        default:
+            throw std::logic_error("Bad PNG filter");
+    }
+}
+
+static size_t estimate_cost(const u8 *filtered_row, const size_t size)
+{
+    // minimum sum of absolute differences, as recommended by the PNG spec
+    size_t sum = 0;
+    for (size_t i = 0; i < size; i++)
+        sum += std::abs(static_cast<s8>(filtered_row[i]));
+    return sum;
+}
+
+static void filter_row(
+    const PngFilterStrategy strategy,
+    const u8 *row,
+    const u8 *prev_row,
+    const size_t size,
+    const size_t bpp,
+    u8 *out,
+    bstr &scratch)
+{
+    if (strategy != PngFilterStrategy::Adaptive)
+    {
+        apply_filter(strategy, row, prev_row, size, bpp, out);
+        return;
+    }
+
+    apply_filter(PngFilterStrategy::None, row, prev_row, size, bpp, out);
+    auto best_cost = estimate_cost(out + 1, size);
+    for (const auto filter : {
+        PngFilterStrategy::Sub,
+        PngFilterStrategy::Up,
+        PngFilterStrategy::Average,
+        PngFilterStrategy::Paeth})
+    {
+        apply_filter(filter, row, prev_row, size, bpp, scratch.get<u8>());
+        const auto cost = estimate_cost(scratch.get<u8>() + 1, size);
+        if (cost < best_cost)
+        {
+            best_cost = cost;
+            std::memcpy(out, scratch.get<u8>(), size + 1);
+        }
+    }
+}
+
+static bstr deflate_band(
+    const u8 *input,
+    const size_t input_size,
+    const u8 *dictionary,
+    const size_t dictionary_size,
+    const int level,
+    const int strategy,
+    const bool is_last)
+{
+    z_stream s;
+    std::memset(&s, 0, sizeof(s));
+    if (deflateInit2(&s, level, Z_DEFLATED, -MAX_WBITS, 8, strategy) != Z_OK)
+        throw std::logic_error("Failed to initialize zlib stream");
+    if (dictionary_size)
+        deflateSetDictionary(&s, dictionary, dictionary_size);
+
+    // the bound doesn't account for the empty block of the sync flush
+    bstr output(deflateBound(&s, input_size) + 16);
+    s.next_in = const_cast<Bytef*>(input);
+    s.avail_in = input_size;
+    s.next_out = output.get<Bytef>();
+    s.avail_out = output.size();
+    const auto ret = deflate(&s, is_last ? Z_FINISH : Z_SYNC_FLUSH);
+    output.resize(s.total_out);
+    deflateEnd(&s);
+    if (ret != (is_last ? Z_STREAM_END : Z_OK) || s.avail_in)
+        throw std::logic_error("Failed to deflate image data");
+    return output;
+}
+
+static void write_chunk(
+    io::BaseByteStream &output_stream, const bstr &type, const bstr &data)
+{
+    auto crc = ::crc32(0, type.get<const Bytef>(), type.size());
+    if (!data.empty())
+        crc = ::crc32(crc, data.get<const Bytef>(), data.size());
+    output_stream.write_be<u32>(data.size());
+    output_stream.write(type);
+    output_stream.write(data);
+    output_stream.write_be<u32>(crc);
+}
+
+PngImageEncoder::PngImageEncoder() : PngImageEncoder(PngImageEncoderOptions())
 {
-    auto output_stream
-        = reinterpret_cast<io::BaseByteStream*>(png_get_io_ptr(png_ptr));
-    output_stream->write(bstr(input, size));
 }
 
-static void flush_handler(png_structp)
+PngImageEncoder::PngImageEncoder(const PngImageEncoderOptions &options)
+    : options(options)
 {
 }
 
@@ -41,44 +347,139 @@ void PngImageEncoder::encode_impl(
     const res::Image &input_image,
     io::File &output_file) const
 {
-    png_structp png_ptr = png_create_write_struct(
-        PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-    if (!png_ptr)
-        throw std::logic_error("Failed to create PNG write structure");
-
-    png_infop info_ptr = png_create_info_struct(png_ptr);
-    if (!info_ptr)
-        throw std::logic_error("Failed to create PNG info structure");
-
     const auto width = input_image.width();
     const auto height = input_image.height();
     if (!width || !height)
         throw err::BadDataSizeError();
-    const auto bpp = 4;
-    const auto color_type = PNG_COLOR_TYPE_RGBA;
-    int transformations = PNG_TRANSFORM_BGR;
-
-    png_set_IHDR(
-        png_ptr, info_ptr, width, height, 8, color_type,
-        PNG_INTERLACE_NONE,
-        PNG_COMPRESSION_TYPE_BASE,
-        PNG_FILTER_TYPE_BASE);
-
-    // 0 = no compression, 9 = max compression
-    // 1 produces good file size and is still fast.
-    png_set_filter(png_ptr, 0, PNG_FILTER_NONE);
-    png_set_compression_level(png_ptr, 1);
-
-    png_set_write_fn(
-        png_ptr, &output_file.stream, &write_handler, &flush_handler);
-    png_write_info(png_ptr, info_ptr);
-
-    auto rows = std::make_unique<const u8*[]>(height);
-    for (const auto y : algo::range(height))
-        rows.get()[y] = reinterpret_cast<const u8*>(&input_image.at(0, y));
-    png_set_rows(png_ptr, info_ptr, const_cast<u8**>(rows.get()));
-    png_write_png(png_ptr, info_ptr, transformations, nullptr);
-    png_destroy_write_struct(&png_ptr, &info_ptr);
+
+    const auto layout = analyze_image(input_image, options.color_type);
+    const auto row_size = width * layout.channels;
+    const auto stride = row_size + 1;
+
+    // palette images compress best unfiltered
+    const auto filter_strategy = layout.color_type == ColorTypeId::Indexed
+        ? PngFilterStrategy::None
+        : options.filter_strategy;
+
+    auto thread_count = options.thread_count
+        ? options.thread_count
+        : algo::get_thread_budget();
+    const auto band_size = thread_count > 1 ? min_band_size : max_band_size;
+    const auto rows_per_band = std::max<size_t>(1, band_size / stride);
+    const auto band_count = (height + rows_per_band - 1) / rows_per_band;
+    thread_count = std::min(thread_count, band_count);
+
+    bstr filtered(height * stride);
+    algo::run_in_parallel(band_count, thread_count, [&](const size_t band)
+    {
+        const auto first_row = band * rows_per_band;
+        const auto last_row = std::min(height, first_row + rows_per_band);
+        bstr row(row_size), prev_row(row_size), scratch(stride);
+        if (first_row > 0)
+            convert_row(input_image, layout, first_row - 1, prev_row.get<u8>());
+        for (const auto y : algo::range(first_row, last_row))
+        {
+            convert_row(input_image, layout, y, row.get<u8>());
+            filter_row(
+                filter_strategy,
+                row.get<const u8>(),
+                prev_row.get<const u8>(),
+                row_size,
+                layout.channels,
+                filtered.get<u8>() + y * stride,
+                scratch);
+            std::swap(row, prev_row);
+        }
+    });
+
+    static const std::vector<int> levels = {9, 6, 1, 0};
+    const auto level = levels.at(static_cast<int>(options.compression_level));
+    const auto strategy = filter_strategy == PngFilterStrategy::None
+        ? Z_DEFAULT_STRATEGY
+        : Z_FILTERED;
+
+    const auto data_size = height * stride;
+    const auto band_stride = rows_per_band * stride;
+    std::vector<bstr> compressed(band_count);
+    std::vector<uLong> checksums(band_count);
+    algo::run_in_parallel(band_count, thread_count, [&](const size_t band)
+    {
+        // prime each band with the tail of the previous one to keep the
+        // ratio close to compressing everything at once
+        const auto offset = band * band_stride;
+        const auto size = std::min(data_size - offset, band_stride);
+        const auto dictionary_size = std::min<size_t>(offset, 1 << MAX_WBITS);
+        const auto input = filtered.get<const u8>() + offset;
+        compressed[band] = deflate_band(
+            input,
+            size,
+            input - dictionary_size,
+            dictionary_size,
+            level,
+            strategy,
+            band == band_count - 1);
+        checksums[band] = adler32(adler32(0, nullptr, 0), input, size);
+    });
+
+    auto checksum = checksums[0];
+    for (const auto band : algo::range(1, band_count))
+    {
+        const auto offset = band * band_stride;
+        const auto size = std::min(data_size - offset, band_stride);
+        checksum = adler32_combine(checksum, checksums[band], size);
+    }
+
+    const auto level_flags
+        = level < 2 ? 0
+        : level < 6 ? 1
+        : level == 6 ? 2
+        : 3;
+    const u16 zlib_header = 0x7800 | (level_flags << 6);
+    io::MemoryByteStream prefix_stream, suffix_stream;
+    prefix_stream.write_be<u16>(zlib_header + (31 - zlib_header % 31) % 31);
+    suffix_stream.write_be<u32>(checksum);
+    compressed.front() = prefix_stream.seek(0).read_to_eof()
+        + compressed.front();
+    compressed.back() += suffix_stream.seek(0).read_to_eof();
+
+    auto &output_stream = output_file.stream;
+    output_stream.write(magic);
+
+    {
+        io::MemoryByteStream header_stream;
+        header_stream.write_be<u32>(width);
+        header_stream.write_be<u32>(height);
+        header_stream.write<u8>(8);
+        header_stream.write<u8>(layout.color_type);
+        header_stream.write<u8>(0); // deflate
+        header_stream.write<u8>(0); // adaptive filtering
+        header_stream.write<u8>(0); // no interlacing
+        write_chunk(
+            output_stream, "IHDR"_b, header_stream.seek(0).read_to_eof());
+    }
+
+    if (layout.color_type == ColorTypeId::Indexed)
+    {
+        bstr palette_data, transparency_data;
+        size_t transparency_size = 0;
+        for (const auto &c : layout.palette)
+        {
+            palette_data += c.r;
+            palette_data += c.g;
+            palette_data += c.b;
+            transparency_data += c.a;
+            if (c.a != 0xFF)
+                transparency_size = transparency_data.size();
+        }
+        transparency_data.resize(transparency_size);
+        write_chunk(output_stream, "PLTE"_b, palette_data);
+        if (!transparency_data.empty())
+            write_chunk(output_stream, "tRNS"_b, transparency_data);
+    }
+
+    for (const auto &data : compressed)
+        write_chunk(output_stream, "IDAT"_b, data);
+    write_chunk(output_stream, "IEND"_b, ""_b);
 
     output_file.path.change_extension("png");
 }
@@ -17,19 +17,56 @@
 
 #pragma once
 
+#include "algo/pack/compression_level.h"
 #include "enc/base_image_encoder.h"
 
 namespace au {
 namespace enc {
 namespace png {
 
+    enum class PngColorType : u8
+    {
+        Rgba = 0,
+        Auto = 1, // the smallest of gray, RGB and palette that fits the image
+    };
+
+    enum class PngFilterStrategy : u8
+    {
+        None = 0,
+        Sub = 1,
+        Up = 2,
+        Average = 3,
+        Paeth = 4,
+        Adaptive = 5, // picks the best filter for each row
+    };
+
+    struct PngImageEncoderOptions final
+    {
+        PngColorType color_type = PngColorType::Rgba;
+        PngFilterStrategy filter_strategy = PngFilterStrategy::None;
+        algo::pack::CompressionLevel compression_level
+            = algo::pack::CompressionLevel::Fast;
+
+        // large images are compressed in row bands on this many threads; 0
+        // stands for the thread budget of the calling thread (see
+        // algo::get_thread_budget)
+        size_t thread_count = 0;
+    };
+
     class PngImageEncoder final : public BaseImageEncoder
     {
+    public:
+        PngImageEncoder();
+        PngImageEncoder(const PngImageEncoderOptions &options);
+
     protected:
         void encode_impl(
             const Logger &logger,
             const res::Image &input_image,
             io::File &output_file) const override;
+
+    private:
+        const PngImageEncoderOptions options;
     };
 
 } } }
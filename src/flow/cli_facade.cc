@@ -17,13 +17,19 @@
 
 #include "flow/cli_facade.h"
 #include <algorithm>
+#include <limits>
 #include <map>
+#include <boost/lexical_cast.hpp>
 #include "algo/range.h"
 #include "algo/str.h"
 #include "arg_parser.h"
 #include "dec/idecoder.h"
 #include "dec/registry.h"
+#include "enc/png/png_image_encoder.h"
+#include "err.h"
+#include "flow/entry_filter.h"
 #include "flow/file_saver_hdd.h"
+#include "flow/output_cache.h"
 #include "flow/parallel_unpacker.h"
 #include "io/file_system.h"
 #include "version.h"
@@ -38,6 +44,8 @@ namespace
     {
         std::string decoder;
         io::path output_dir;
+        io::path cache_dir;
+        bool should_list_entries;
         std::vector<io::path> input_paths;
         bool overwrite;
         bool enable_nested_decoding;
@@ -47,6 +55,27 @@ namespace
         bool should_list_decoders;
         int verbosity = 3;
         unsigned int thread_count;
+        uoff_t memory_limit;
+        algo::pack::CompressionLevel png_level;
+        enc::png::PngFilterStrategy png_filter;
+    };
+
+    const std::map<std::string, algo::pack::CompressionLevel> png_levels =
+    {
+        {"best", algo::pack::CompressionLevel::Best},
+        {"good", algo::pack::CompressionLevel::Good},
+        {"fast", algo::pack::CompressionLevel::Fast},
+        {"store", algo::pack::CompressionLevel::Store},
+    };
+
+    const std::map<std::string, enc::png::PngFilterStrategy> png_filters =
+    {
+        {"none", enc::png::PngFilterStrategy::None},
+        {"sub", enc::png::PngFilterStrategy::Sub},
+        {"up", enc::png::PngFilterStrategy::Up},
+        {"average", enc::png::PngFilterStrategy::Average},
+        {"paeth", enc::png::PngFilterStrategy::Paeth},
+        {"adaptive", enc::png::PngFilterStrategy::Adaptive},
     };
 }
 
@@ -61,6 +90,7 @@ private:
     void print_decoder_list() const;
     void print_cli_help() const;
     void parse_cli_options();
+    void parse_entry_filter_options();
 
     Logger &logger;
     const std::vector<std::string> arguments;
@@ -68,6 +98,7 @@ private:
 
     ArgParser arg_parser;
     Options options;
+    EntryFilter entry_filter;
 };
 
 CliFacade::Priv::Priv(Logger &logger, const std::vector<std::string> &arguments)
@@ -179,6 +210,99 @@ void CliFacade::Priv::register_cli_options()
         ->set_value_name("NUM")
         ->set_description("Sets worker thread count.");
 
+    arg_parser.register_switch({"--memory-limit"})
+        ->set_value_name("MB")
+        ->set_description(
+            "Holds back decoding of new files while decoded files that wait "
+            "to be saved take more than given amount of memory. "
+            "By default, there is no limit.");
+
+    arg_parser.register_switch({"--png-level"})
+        ->set_value_name("LEVEL")
+        ->set_description(
+            "Sets how hard decoded images are compressed when saved as PNG "
+            "(defaults to fast).")
+        ->add_possible_value("best")
+        ->add_possible_value("good")
+        ->add_possible_value("fast")
+        ->add_possible_value("store");
+
+    arg_parser.register_switch({"--png-filter"})
+        ->set_value_name("FILTER")
+        ->set_description(
+            "Sets the row filter used when saving decoded images as PNG "
+            "(defaults to adaptive, which picks a filter for each row).")
+        ->add_possible_value("none")
+        ->add_possible_value("sub")
+        ->add_possible_value("up")
+        ->add_possible_value("average")
+        ->add_possible_value("paeth")
+        ->add_possible_value("adaptive");
+
+    arg_parser.register_switch({"--cache"})
+        ->set_value_name("DIR")
+        ->set_description(
+            "Keeps decoded files in given directory and reuses them when "
+            "the same input is decoded again with the same options. "
+            "By default, nothing is cached. "
+            "Archive indexes are cached as well, which speeds up repeated "
+            "--list and --filter runs over the same archives.");
+
+    arg_parser.register_flag({"--list"})
+        ->set_description(
+            "Prints the paths of the entries of input archives instead of "
+            "extracting them.");
+
+    arg_parser.register_switch({"--include", "--filter"})
+        ->set_value_name("GLOB")
+        ->set_description(
+            "Extracts (or lists) only the archive entries whose paths match "
+            "given pattern, for example \"voice/*.ogg\". The matching "
+            "ignores case; \"*\" matches any sequence of characters and "
+            "\"?\" matches any single character. Can be given multiple "
+            "times. Archive entries are filtered at every nesting level; "
+            "nested archives that don't match are still searched for "
+            "matching entries, unless they are excluded.");
+
+    arg_parser.register_switch({"--exclude"})
+        ->set_value_name("GLOB")
+        ->set_description(
+            "Skips the archive entries whose paths match given pattern. "
+            "Can be given multiple times.");
+
+    arg_parser.register_switch({"--include-regex"})
+        ->set_value_name("REGEX")
+        ->set_description(
+            "Like --include, but with a regular expression that is searched "
+            "for anywhere in the path.");
+
+    arg_parser.register_switch({"--exclude-regex"})
+        ->set_value_name("REGEX")
+        ->set_description(
+            "Like --exclude, but with a regular expression that is searched "
+            "for anywhere in the path.");
+
+    arg_parser.register_switch({"--include-ext"})
+        ->set_value_name("EXT[,EXT...]")
+        ->set_description(
+            "Extracts only the archive entries with given extensions.");
+
+    arg_parser.register_switch({"--exclude-ext"})
+        ->set_value_name("EXT[,EXT...]")
+        ->set_description("Skips the archive entries with given extensions.");
+
+    arg_parser.register_switch({"--min-size"})
+        ->set_value_name("BYTES")
+        ->set_description(
+            "Skips the archive entries smaller than given size, if the "
+            "archive index tells their size.");
+
+    arg_parser.register_switch({"--max-size"})
+        ->set_value_name("BYTES")
+        ->set_description(
+            "Skips the archive entries larger than given size, if the "
+            "archive index tells their size.");
+
     {
         auto sw = arg_parser.register_switch({"-v", "--verbosity"})
             ->set_description(
@@ -196,6 +320,11 @@ void CliFacade::Priv::register_cli_options()
             ->hide_possible_values();
     }
 
+    arg_parser.register_flag({"-q", "--quiet"})
+        ->set_description(
+            "Logs only the outcome of each file, written in one piece per "
+            "file (same as --verbosity=2).");
+
     arg_parser.register_flag({"--no-color", "--no-colors"})
         ->set_description("Disables colors in console output.");
 
@@ -209,6 +338,19 @@ void CliFacade::Priv::register_cli_options()
         ->set_description("Shows arc_unpacker version.");
 }
 
+static u64 parse_unsigned(const std::string &name, const std::string &value)
+{
+    try
+    {
+        return algo::from_string<u64>(value);
+    }
+    catch (const boost::bad_lexical_cast &)
+    {
+        throw err::UsageError(
+            "Invalid value for " + name + ": \"" + value + "\"");
+    }
+}
+
 void CliFacade::Priv::parse_cli_options()
 {
     options.should_show_help
@@ -225,6 +367,8 @@ void CliFacade::Priv::parse_cli_options()
     if (arg_parser.has_flag("--no-color") || arg_parser.has_flag("--no-colors"))
         logger.disable_colors();
 
+    if (arg_parser.has_flag("-q") || arg_parser.has_flag("--quiet"))
+        options.verbosity = 2;
     if (arg_parser.has_switch("-v"))
         options.verbosity = algo::from_string<int>(arg_parser.get_switch("-v"));
     if (arg_parser.has_switch("--verbosity"))
@@ -244,6 +388,24 @@ void CliFacade::Priv::parse_cli_options()
     else
         options.thread_count = 0;
 
+    if (arg_parser.has_switch("--memory-limit"))
+    {
+        const auto megabytes = parse_unsigned(
+            "--memory-limit", arg_parser.get_switch("--memory-limit"));
+        if (megabytes > std::numeric_limits<uoff_t>::max() / 1024 / 1024)
+            throw err::UsageError("Memory limit is too large");
+        options.memory_limit = megabytes * 1024 * 1024;
+    }
+    else
+        options.memory_limit = 0;
+
+    options.png_level = arg_parser.has_switch("--png-level")
+        ? png_levels.at(arg_parser.get_switch("--png-level"))
+        : algo::pack::CompressionLevel::Fast;
+    options.png_filter = arg_parser.has_switch("--png-filter")
+        ? png_filters.at(arg_parser.get_switch("--png-filter"))
+        : enc::png::PngFilterStrategy::Adaptive;
+
     if (arg_parser.has_flag("--no-vfs"))
         VirtualFileSystem::disable();
 
@@ -254,6 +416,12 @@ void CliFacade::Priv::parse_cli_options()
     else
         options.output_dir = "./";
 
+    if (arg_parser.has_switch("--cache"))
+        options.cache_dir = arg_parser.get_switch("--cache");
+
+    options.should_list_entries = arg_parser.has_flag("--list");
+    parse_entry_filter_options();
+
     if (arg_parser.has_switch("-d"))
         options.decoder = arg_parser.get_switch("-d");
     if (arg_parser.has_switch("--dec"))
@@ -274,6 +442,35 @@ void CliFacade::Priv::parse_cli_options()
     }
 }
 
+void CliFacade::Priv::parse_entry_filter_options()
+{
+    for (const auto &glob : arg_parser.get_switch_values("--include"))
+        entry_filter.add_include_glob(glob);
+    for (const auto &glob : arg_parser.get_switch_values("--exclude"))
+        entry_filter.add_exclude_glob(glob);
+    for (const auto &regex : arg_parser.get_switch_values("--include-regex"))
+        entry_filter.add_include_regex(regex);
+    for (const auto &regex : arg_parser.get_switch_values("--exclude-regex"))
+        entry_filter.add_exclude_regex(regex);
+    for (const auto &value : arg_parser.get_switch_values("--include-ext"))
+        for (const auto &extension : algo::split(value, ',', false))
+            entry_filter.add_include_extension(extension);
+    for (const auto &value : arg_parser.get_switch_values("--exclude-ext"))
+        for (const auto &extension : algo::split(value, ',', false))
+            entry_filter.add_exclude_extension(extension);
+
+    if (arg_parser.has_switch("--min-size"))
+    {
+        entry_filter.set_min_size(parse_unsigned(
+            "--min-size", arg_parser.get_switch("--min-size")));
+    }
+    if (arg_parser.has_switch("--max-size"))
+    {
+        entry_filter.set_max_size(parse_unsigned(
+            "--max-size", arg_parser.get_switch("--max-size")));
+    }
+}
+
 int CliFacade::Priv::run() const
 {
     if (options.should_show_help)
@@ -307,13 +504,21 @@ int CliFacade::Priv::run() const
         : std::set<std::string>{options.decoder};
 
     FileSaverHdd file_saver(options.output_dir, options.overwrite);
+    std::unique_ptr<OutputCache> output_cache;
+    if (!options.cache_dir.str().empty())
+        output_cache = std::make_unique<OutputCache>(options.cache_dir);
     ParallelUnpackerContext context(
         logger,
         file_saver,
         registry,
         options.enable_nested_decoding,
         arguments,
-        available_decoders);
+        available_decoders,
+        output_cache.get(),
+        &entry_filter,
+        options.should_list_entries);
+    context.png_options.compression_level = options.png_level;
+    context.png_options.filter_strategy = options.png_filter;
 
     ParallelUnpacker unpacker(context);
     for (const auto &input_path : options.input_paths)
@@ -328,7 +533,7 @@ int CliFacade::Priv::run() const
                     io::absolute(input_path), io::FileMode::Read);
             });
     }
-    return unpacker.run(options.thread_count) ? 0 : 1;
+    return unpacker.run(options.thread_count, options.memory_limit) ? 0 : 1;
 }
 
 CliFacade::CliFacade(Logger &logger, const std::vector<std::string> &arguments)
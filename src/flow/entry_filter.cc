@@ -0,0 +1,223 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "flow/entry_filter.h"
+#include <limits>
+#include <regex>
+#include <vector>
+#include "err.h"
+
+using namespace au;
+using namespace au::flow;
+
+static char normalize_char(const char c)
+{
+    if (c == '\\')
+        return '/';
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A' + 'a';
+    return c;
+}
+
+static bool glob_matches(const std::string &pattern, const std::string &text)
+{
+    // greedy matching that backtracks only to the most recent star, which is
+    // enough since a later star can absorb anything an earlier one would
+    size_t pattern_pos = 0;
+    size_t text_pos = 0;
+    size_t star_pos = std::string::npos;
+    size_t star_text_pos = 0;
+    while (text_pos < text.size())
+    {
+        if (pattern_pos < pattern.size() && pattern[pattern_pos] == '*')
+        {
+            star_pos = pattern_pos++;
+            star_text_pos = text_pos;
+        }
+        else if (pattern_pos < pattern.size()
+            && (pattern[pattern_pos] == '?'
+                || normalize_char(pattern[pattern_pos])
+                    == normalize_char(text[text_pos])))
+        {
+            pattern_pos++;
+            text_pos++;
+        }
+        else if (star_pos != std::string::npos)
+        {
+            pattern_pos = star_pos + 1;
+            text_pos = ++star_text_pos;
+        }
+        else
+            return false;
+    }
+    while (pattern_pos < pattern.size() && pattern[pattern_pos] == '*')
+        pattern_pos++;
+    return pattern_pos == pattern.size();
+}
+
+static std::string normalize_extension(const std::string &extension)
+{
+    std::string result;
+    for (const auto c : extension)
+        result += normalize_char(c);
+    if (!result.empty() && result[0] == '.')
+        result.erase(0, 1);
+    return result;
+}
+
+namespace
+{
+    struct Patterns final
+    {
+        bool empty() const;
+        bool matches(const io::path &path) const;
+
+        std::vector<std::string> globs;
+        std::vector<std::regex> regexes;
+        std::vector<std::string> extensions;
+    };
+}
+
+bool Patterns::empty() const
+{
+    return globs.empty() && regexes.empty() && extensions.empty();
+}
+
+bool Patterns::matches(const io::path &path) const
+{
+    const auto text = path.str();
+    for (const auto &glob : globs)
+        if (glob_matches(glob, text))
+            return true;
+    for (const auto &regex : regexes)
+        if (std::regex_search(text, regex))
+            return true;
+    if (!extensions.empty() && path.has_extension())
+    {
+        const auto extension = normalize_extension(path.extension());
+        for (const auto &wanted_extension : extensions)
+            if (extension == wanted_extension)
+                return true;
+    }
+    return false;
+}
+
+static std::regex make_regex(const std::string &pattern)
+{
+    try
+    {
+        return std::regex(
+            pattern,
+            std::regex_constants::ECMAScript | std::regex_constants::icase);
+    }
+    catch (const std::regex_error &e)
+    {
+        throw err::UsageError(
+            "Bad regular expression \"" + pattern + "\" (" + e.what() + ")");
+    }
+}
+
+struct EntryFilter::Priv final
+{
+    Patterns includes;
+    Patterns excludes;
+    uoff_t min_size = 0;
+    uoff_t max_size = std::numeric_limits<uoff_t>::max();
+};
+
+EntryFilter::EntryFilter() : p(new Priv)
+{
+}
+
+EntryFilter::~EntryFilter()
+{
+}
+
+void EntryFilter::add_include_glob(const std::string &pattern)
+{
+    p->includes.globs.push_back(pattern);
+}
+
+void EntryFilter::add_exclude_glob(const std::string &pattern)
+{
+    p->excludes.globs.push_back(pattern);
+}
+
+void EntryFilter::add_include_regex(const std::string &pattern)
+{
+    p->includes.regexes.push_back(make_regex(pattern));
+}
+
+void EntryFilter::add_exclude_regex(const std::string &pattern)
+{
+    p->excludes.regexes.push_back(make_regex(pattern));
+}
+
+void EntryFilter::add_include_extension(const std::string &extension)
+{
+    p->includes.extensions.push_back(normalize_extension(extension));
+}
+
+void EntryFilter::add_exclude_extension(const std::string &extension)
+{
+    p->excludes.extensions.push_back(normalize_extension(extension));
+}
+
+void EntryFilter::set_min_size(const uoff_t size)
+{
+    p->min_size = size;
+}
+
+void EntryFilter::set_max_size(const uoff_t size)
+{
+    p->max_size = size;
+}
+
+bool EntryFilter::matches(const io::path &path) const
+{
+    if (p->excludes.matches(path))
+        return false;
+    return p->includes.empty() || p->includes.matches(path);
+}
+
+bool EntryFilter::matches(const dec::ArchiveEntry &entry) const
+{
+    if (!matches(entry.path))
+        return false;
+
+    // entries of other types don't reveal their size until they're read,
+    // which is what filtering tries to avoid
+    uoff_t size;
+    if (const auto plain_entry
+        = dynamic_cast<const dec::PlainArchiveEntry*>(&entry))
+    {
+        size = plain_entry->size;
+    }
+    else if (const auto compressed_entry
+        = dynamic_cast<const dec::CompressedArchiveEntry*>(&entry))
+    {
+        size = compressed_entry->size_orig;
+    }
+    else
+        return true;
+    return size >= p->min_size && size <= p->max_size;
+}
+
+bool EntryFilter::is_excluded(const io::path &path) const
+{
+    return p->excludes.matches(path);
+}
@@ -0,0 +1,64 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include "dec/base_archive_decoder.h"
+#include "io/path.h"
+
+namespace au {
+namespace flow {
+
+    // Decides which archive entries get extracted. An entry is extracted if
+    // it matches none of the exclusions and, if there are any inclusions, at
+    // least one of them, and if its size (when known from the archive index)
+    // falls within the size range.
+    //
+    // is_excluded() checks the exclusions alone, for entries that may still
+    // be unpacked further even though they aren't extracted themselves.
+    //
+    // Globs match the whole entry path case-insensitively; "*" matches any
+    // sequence of characters (including directory separators) and "?"
+    // matches a single character. Regexes are searched for anywhere in the
+    // path, also case-insensitively.
+    class EntryFilter final
+    {
+    public:
+        EntryFilter();
+        ~EntryFilter();
+
+        void add_include_glob(const std::string &pattern);
+        void add_exclude_glob(const std::string &pattern);
+        void add_include_regex(const std::string &pattern);
+        void add_exclude_regex(const std::string &pattern);
+        void add_include_extension(const std::string &extension);
+        void add_exclude_extension(const std::string &extension);
+        void set_min_size(const uoff_t size);
+        void set_max_size(const uoff_t size);
+
+        bool matches(const io::path &path) const;
+        bool matches(const dec::ArchiveEntry &entry) const;
+        bool is_excluded(const io::path &path) const;
+
+    private:
+        struct Priv;
+        std::unique_ptr<Priv> p;
+    };
+
+} }
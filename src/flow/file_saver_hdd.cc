@@ -16,6 +16,7 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "flow/file_saver_hdd.h"
+#include <atomic>
 #include <mutex>
 #include <set>
 #include "algo/format.h"
@@ -25,19 +26,25 @@
 using namespace au;
 using namespace au::flow;
 
+// guards only path reservation - creating directories and writing the files
+// happens outside of it, so that the threads can save files in parallel
 static std::mutex mutex;
 
+// paths reserved by any saver whose files might not exist on the disk yet
+static std::set<io::path> pending_paths;
+
 struct FileSaverHdd::Priv final
 {
     Priv(
         const io::path &output_dir,
         const bool overwrite);
 
-    io::path make_path_unique(const io::path &path);
+    io::path reserve_unique_path(const io::path &path);
+    void release_path(const io::path &path);
 
     io::path output_dir;
     bool overwrite;
-    size_t saved_file_count;
+    std::atomic<size_t> saved_file_count;
     std::set<io::path> paths;
 };
 
@@ -46,19 +53,29 @@ FileSaverHdd::Priv::Priv(const io::path &output_dir, const bool overwrite)
 {
 }
 
-io::path FileSaverHdd::Priv::make_path_unique(const io::path &path)
+io::path FileSaverHdd::Priv::reserve_unique_path(const io::path &path)
 {
+    std::unique_lock<std::mutex> lock(mutex);
     io::path new_path = path;
     int i = 1;
     while (paths.find(new_path) != paths.end()
-        || (!overwrite && io::exists(new_path)))
+        || (!overwrite
+            && (pending_paths.find(new_path) != pending_paths.end()
+                || io::exists(new_path))))
     {
         new_path.change_stem(path.stem() + algo::format("(%d)", i++));
     }
     paths.insert(new_path);
+    pending_paths.insert(new_path);
     return new_path;
 }
 
+void FileSaverHdd::Priv::release_path(const io::path &path)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    pending_paths.erase(path);
+}
+
 FileSaverHdd::FileSaverHdd(
     const io::path &output_dir, const bool overwrite)
     : p(new Priv(output_dir, overwrite))
@@ -71,12 +88,20 @@ FileSaverHdd::~FileSaverHdd()
 
 io::path FileSaverHdd::save(std::shared_ptr<io::File> file) const
 {
-    std::unique_lock<std::mutex> lock(mutex);
-    const auto full_path = p->make_path_unique(p->output_dir / file->path);
-    io::create_directories(full_path.parent());
-    io::FileByteStream output_stream(full_path, io::FileMode::Write);
-    file->stream.seek(0);
-    output_stream.write(file->stream);
+    const auto full_path = p->reserve_unique_path(p->output_dir / file->path);
+    try
+    {
+        io::create_directories(full_path.parent());
+        io::FileByteStream output_stream(full_path, io::FileMode::Write);
+        file->stream.seek(0);
+        output_stream.write(file->stream);
+    }
+    catch (...)
+    {
+        p->release_path(full_path);
+        throw;
+    }
+    p->release_path(full_path);
     ++p->saved_file_count;
     return full_path;
 }
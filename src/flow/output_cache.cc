@@ -0,0 +1,170 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "flow/output_cache.h"
+#include <atomic>
+#include <random>
+#include "algo/crypt/sha1.h"
+#include "algo/format.h"
+#include "algo/str.h"
+#include "io/file_byte_stream.h"
+#include "io/file_system.h"
+
+using namespace au;
+using namespace au::flow;
+
+struct OutputCache::Priv final
+{
+    Priv(const io::path &cache_dir);
+
+    io::path get_data_path(const std::string &key) const;
+    io::path get_name_path(const std::string &key) const;
+    std::string make_temporary_suffix();
+
+    io::path cache_dir;
+    std::atomic<size_t> hit_count;
+    std::atomic<size_t> temporary_file_count;
+    const u32 process_token;
+};
+
+OutputCache::Priv::Priv(const io::path &cache_dir) :
+    cache_dir(cache_dir),
+    hit_count(0),
+    temporary_file_count(0),
+    process_token(std::random_device()())
+{
+}
+
+io::path OutputCache::Priv::get_data_path(const std::string &key) const
+{
+    // spread the files among subdirectories so that none grows too large
+    const auto hash = algo::hex(algo::crypt::sha1(bstr(key)));
+    return cache_dir / hash.substr(0, 2) / hash;
+}
+
+io::path OutputCache::Priv::get_name_path(const std::string &key) const
+{
+    auto path = get_data_path(key);
+    path.change_extension("name");
+    return path;
+}
+
+std::string OutputCache::Priv::make_temporary_suffix()
+{
+    // other threads and processes may be storing the same key at the same
+    // time
+    return algo::format(
+        ".%08x-%d.tmp",
+        process_token,
+        static_cast<int>(temporary_file_count++));
+}
+
+OutputCache::OutputCache(const io::path &cache_dir) : p(new Priv(cache_dir))
+{
+}
+
+OutputCache::~OutputCache()
+{
+}
+
+std::shared_ptr<io::File> OutputCache::load(const std::string &key) const
+{
+    const auto data_path = p->get_data_path(key);
+    const auto name_path = p->get_name_path(key);
+    if (!io::exists(data_path) || !io::exists(name_path))
+        return nullptr;
+
+    io::FileByteStream name_stream(name_path, io::FileMode::Read);
+    auto file = std::make_shared<io::File>(data_path, io::FileMode::Read);
+    file->path = name_stream.read_to_eof().str();
+    ++p->hit_count;
+    return file;
+}
+
+std::shared_ptr<io::File> OutputCache::store(
+    const std::string &key, io::File &file) const
+{
+    const auto data_path = p->get_data_path(key);
+    const auto name_path = p->get_name_path(key);
+    const auto suffix = p->make_temporary_suffix();
+    const auto tmp_data_path = io::path(data_path.str() + suffix);
+    const auto tmp_name_path = io::path(name_path.str() + suffix);
+
+    try
+    {
+        io::create_directories(data_path.parent());
+        {
+            io::FileByteStream name_stream(tmp_name_path, io::FileMode::Write);
+            name_stream.write(file.path.str());
+        }
+        {
+            io::FileByteStream data_stream(tmp_data_path, io::FileMode::Write);
+            file.stream.seek(0);
+            data_stream.write(file.stream);
+        }
+
+        // the data is what load() checks for, so it goes last
+        io::rename(tmp_name_path, name_path);
+        io::rename(tmp_data_path, data_path);
+    }
+    catch (...)
+    {
+        if (io::exists(tmp_name_path)) io::remove(tmp_name_path);
+        if (io::exists(tmp_data_path)) io::remove(tmp_data_path);
+        throw;
+    }
+
+    auto cached_file = std::make_shared<io::File>(
+        data_path, io::FileMode::Read);
+    cached_file->path = file.path;
+    return cached_file;
+}
+
+bstr OutputCache::load_data(const std::string &key) const
+{
+    const auto data_path = p->get_data_path(key);
+    if (!io::exists(data_path))
+        return ""_b;
+    io::FileByteStream data_stream(data_path, io::FileMode::Read);
+    return data_stream.read_to_eof();
+}
+
+void OutputCache::store_data(const std::string &key, const bstr &data) const
+{
+    const auto data_path = p->get_data_path(key);
+    const auto tmp_data_path
+        = io::path(data_path.str() + p->make_temporary_suffix());
+    try
+    {
+        io::create_directories(data_path.parent());
+        {
+            io::FileByteStream data_stream(tmp_data_path, io::FileMode::Write);
+            data_stream.write(data);
+        }
+        io::rename(tmp_data_path, data_path);
+    }
+    catch (...)
+    {
+        if (io::exists(tmp_data_path)) io::remove(tmp_data_path);
+        throw;
+    }
+}
+
+size_t OutputCache::get_hit_count() const
+{
+    return p->hit_count;
+}
@@ -0,0 +1,60 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <memory>
+#include "io/file.h"
+
+namespace au {
+namespace flow {
+
+    // Keeps decoded files on the disk, so that running the unpacker again over
+    // the same inputs can skip decoding them. The keys are arbitrary strings
+    // that need to change whenever the output could change (the unpacker
+    // derives them from the input contents, decoder name, its options and the
+    // program version); the files are stored under their hashes. Outputs of
+    // decoders that look up other files through the virtual file system
+    // aren't stored, since the keys can't cover those files.
+    class OutputCache final
+    {
+    public:
+        OutputCache(const io::path &cache_dir);
+        ~OutputCache();
+
+        // returns nullptr if there is no file stored under given key
+        std::shared_ptr<io::File> load(const std::string &key) const;
+
+        // the returned file reads from the cache, which spares lazily decoded
+        // streams from being decoded again when the file is saved
+        std::shared_ptr<io::File> store(
+            const std::string &key, io::File &file) const;
+
+        // Small blobs (such as archive indexes) kept alongside the files. An
+        // empty result means that nothing is stored under given key. These
+        // don't count as hits.
+        bstr load_data(const std::string &key) const;
+        void store_data(const std::string &key, const bstr &data) const;
+
+        size_t get_hit_count() const;
+
+    private:
+        struct Priv;
+        std::unique_ptr<Priv> p;
+    };
+
+} }
@@ -16,18 +16,25 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "flow/parallel_decoder_adapter.h"
+#include <algorithm>
+#include "algo/format.h"
 #include "algo/naming_strategies.h"
+#include "algo/range.h"
 #include "enc/microsoft/wav_audio_encoder.h"
 #include "enc/png/png_image_encoder.h"
 #include "flow/vfs_bridge.h"
+#include "virtual_file_system.h"
 
 using namespace au;
 using namespace au::flow;
 
 ParallelDecoderAdapter::ParallelDecoderAdapter(
     const std::shared_ptr<const BaseParallelUnpackingTask> parent_task,
-    const std::shared_ptr<io::File> input_file)
-    : parent_task(parent_task), input_file(input_file)
+    const std::shared_ptr<io::File> input_file,
+    const std::string &cache_key) :
+        parent_task(parent_task),
+        input_file(input_file),
+        cache_key(cache_key)
 {
 }
 
@@ -35,14 +42,120 @@ ParallelDecoderAdapter::~ParallelDecoderAdapter()
 {
 }
 
+// uses_other_files tells whether the index depends on files other than the
+// archive, in which case neither it nor the entries may be cached
+static std::unique_ptr<dec::ArchiveMeta> read_meta(
+    const BaseParallelUnpackingTask &task,
+    const dec::BaseArchiveDecoder &decoder,
+    io::File &input_file,
+    const std::string &cache_key,
+    bool &uses_other_files)
+{
+    uses_other_files = false;
+    const auto output_cache = task.task_context.unpacker_context.output_cache;
+    if (!output_cache || cache_key.empty())
+        return decoder.read_meta(task.logger, input_file);
+
+    const auto index_key = cache_key + "\nindex";
+    try
+    {
+        const auto data = output_cache->load_data(index_key);
+        if (!data.empty())
+        {
+            auto meta = decoder.deserialize_meta(task.logger, input_file, data);
+            task.logger.info("archive index found in cache.\n");
+            return meta;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        task.logger.warn(
+            "error reading archive index from cache (%s)\n", e.what());
+    }
+
+    const auto vfs_lookup_count = VirtualFileSystem::get_lookup_count();
+    auto meta = decoder.read_meta(task.logger, input_file);
+    if (VirtualFileSystem::get_lookup_count() != vfs_lookup_count)
+    {
+        task.logger.info(
+            "archive index depends on other files; not caching.\n");
+        uses_other_files = true;
+        return meta;
+    }
+    try
+    {
+        const auto data = decoder.serialize_meta(*meta);
+        if (!data.empty())
+            output_cache->store_data(index_key, data);
+    }
+    catch (const std::exception &e)
+    {
+        task.logger.warn(
+            "error writing archive index to cache (%s)\n", e.what());
+    }
+    return meta;
+}
+
+static void list_paths(
+    const BaseParallelUnpackingTask &task, const std::vector<io::path> &paths)
+{
+    task.logger.flush();
+    Logger list_logger(task.logger);
+    list_logger.set_prefix("");
+    for (const auto &path : paths)
+        list_logger.log(Logger::MessageType::Summary, "%s\n", path.c_str());
+    list_logger.flush();
+}
+
+// with --list, files that would be converted are named rather than decoded
+static bool list_instead_of_decoding(
+    const BaseParallelUnpackingTask &task, const io::File &input_file)
+{
+    if (!task.task_context.unpacker_context.list_entries)
+        return false;
+    list_paths(task, {input_file.path});
+    return true;
+}
+
+// images and audio can't contain anything the entry filter could still match
+static bool skip_filtered_out(const BaseParallelUnpackingTask &task)
+{
+    if (!task.filtered_out)
+        return false;
+    task.logger.info("skipped by the entry filter.\n");
+    task.logger.flush();
+    return true;
+}
+
 void ParallelDecoderAdapter::visit(const dec::BaseArchiveDecoder &decoder)
 {
     auto input_file = this->input_file;
+    bool uses_other_files;
     auto meta = std::shared_ptr<dec::ArchiveMeta>(
-        decoder.read_meta(parent_task->logger, *input_file));
+        read_meta(
+            *parent_task, decoder, *input_file, cache_key, uses_other_files));
     parent_task->logger.info(
         "archive contains %d files.\n", meta->entries.size());
 
+    // entries are filtered before any task is created, so that the
+    // excluded ones are never read, decompressed nor decrypted. With nested
+    // decoding, entries that fail only the inclusion rules or the size range
+    // are still read if their paths don't rule out all the archive decoders
+    // that would be tried on them, since their own entries might match.
+    // They're never saved.
+    const auto &unpacker_context = parent_task->task_context.unpacker_context;
+    const auto entry_filter = unpacker_context.entry_filter;
+
+    if (unpacker_context.list_entries)
+    {
+        std::vector<io::path> paths;
+        for (const auto &entry : meta->entries)
+            if (!entry_filter || entry_filter->matches(*entry))
+                paths.push_back(entry->path);
+        list_paths(*parent_task, paths);
+        return;
+    }
+
     const auto vfs_bridge = std::make_shared<VirtualFileSystemBridge>(
         parent_task->logger,
         decoder,
@@ -50,8 +163,39 @@ void ParallelDecoderAdapter::visit(const dec::BaseArchiveDecoder &decoder)
         input_file,
         parent_task->base_name);
 
-    for (const auto &entry : meta->entries)
+    const auto &registry = unpacker_context.registry;
+    std::unique_ptr<std::vector<std::string>> nested_archive_decoders;
+    const auto may_be_archive = [&](const io::path &path)
     {
+        if (!nested_archive_decoders)
+        {
+            nested_archive_decoders
+                = std::make_unique<std::vector<std::string>>(
+                    parent_task->get_nested_archive_decoders(decoder));
+        }
+        return std::any_of(
+            nested_archive_decoders->begin(),
+            nested_archive_decoders->end(),
+            [&](const std::string &name)
+            {
+                return registry.accepts_extension(name, path);
+            });
+    };
+
+    for (const auto i : algo::range(meta->entries.size()))
+    {
+        const auto &entry = meta->entries[i];
+        auto filtered_out = false;
+        if (entry_filter && !entry_filter->matches(*entry))
+        {
+            if (!unpacker_context.enable_nested_decoding
+                || entry_filter->is_excluded(entry->path)
+                || !may_be_archive(entry->path))
+            {
+                continue;
+            }
+            filtered_out = true;
+        }
         parent_task->save_file(
             input_file,
             [meta, &entry, &decoder, vfs_bridge]
@@ -61,36 +205,62 @@ void ParallelDecoderAdapter::visit(const dec::BaseArchiveDecoder &decoder)
                     logger, input_file_copy, *meta, *entry);
             },
             decoder,
-            entry->path.str());
+            entry->path.str(),
+            cache_key.empty() || uses_other_files
+                ? ""
+                : algo::format(
+                    "%s\nentry %d: %s",
+                    cache_key.c_str(),
+                    static_cast<int>(i),
+                    entry->path.c_str()),
+            filtered_out);
     }
 }
 
 void ParallelDecoderAdapter::visit(const dec::BaseFileDecoder &decoder)
 {
+    if (list_instead_of_decoding(*parent_task, *input_file))
+        return;
     parent_task->save_file(
         input_file,
         [&decoder](io::File &input_file_copy, const Logger &logger)
         {
             return decoder.decode(logger, input_file_copy);
         },
-        decoder);
+        decoder,
+        "",
+        cache_key,
+        parent_task->filtered_out);
 }
 
 void ParallelDecoderAdapter::visit(const dec::BaseImageDecoder &decoder)
 {
+    if (list_instead_of_decoding(*parent_task, *input_file))
+        return;
+    if (skip_filtered_out(*parent_task))
+        return;
+    const auto &png_options
+        = parent_task->task_context.unpacker_context.png_options;
     parent_task->save_file(
         input_file,
-        [&decoder](io::File &input_file_copy, const Logger &logger)
+        [&decoder, &png_options]
+        (io::File &input_file_copy, const Logger &logger)
         {
             auto output_file = decoder.decode(logger, input_file_copy);
-            const auto encoder = enc::png::PngImageEncoder();
+            const auto encoder = enc::png::PngImageEncoder(png_options);
             return encoder.encode(logger, output_file, input_file_copy.path);
         },
-        decoder);
+        decoder,
+        "",
+        cache_key);
 }
 
 void ParallelDecoderAdapter::visit(const dec::BaseAudioDecoder &decoder)
 {
+    if (list_instead_of_decoding(*parent_task, *input_file))
+        return;
+    if (skip_filtered_out(*parent_task))
+        return;
     parent_task->save_file(
         input_file,
         [&decoder](io::File &input_file_copy, const Logger &logger)
@@ -99,5 +269,7 @@ void ParallelDecoderAdapter::visit(const dec::BaseAudioDecoder &decoder)
             const auto encoder = enc::microsoft::WavAudioEncoder();
             return encoder.encode(logger, output_file, input_file_copy.path);
         },
-        decoder);
+        decoder,
+        "",
+        cache_key);
 }
@@ -28,7 +28,8 @@ namespace flow {
     public:
         ParallelDecoderAdapter(
             const std::shared_ptr<const BaseParallelUnpackingTask> parent_task,
-            const std::shared_ptr<io::File> input_file);
+            const std::shared_ptr<io::File> input_file,
+            const std::string &cache_key = "");
         ~ParallelDecoderAdapter();
 
         void visit(const dec::BaseArchiveDecoder &decoder) override;
@@ -39,6 +40,7 @@ namespace flow {
     private:
         const std::shared_ptr<const BaseParallelUnpackingTask> parent_task;
         const std::shared_ptr<io::File> input_file;
+        const std::string cache_key;
     };
 
 } }
@@ -16,20 +16,28 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "flow/parallel_unpacker.h"
+#include <atomic>
 #include <chrono>
 #include <set>
 #include <stack>
+#include "algo/crypt/sha1.h"
 #include "algo/format.h"
+#include "algo/parallel.h"
+#include "algo/str.h"
+#include "dec/base_archive_decoder.h"
 #include "dec/idecoder.h"
 #include "err.h"
 #include "flow/parallel_decoder_adapter.h"
+#include "io/file_system.h"
+#include "io/memory_byte_stream.h"
+#include "version.h"
+#include "virtual_file_system.h"
 
 using namespace au;
 using namespace au::flow;
 
 static const auto max_depth = 10;
-static int task_count = 0;
-static std::mutex mutex;
+static std::atomic<int> task_count(0);
 
 namespace
 {
@@ -41,11 +49,19 @@ namespace
             const io::path &base_name,
             const std::shared_ptr<const BaseParallelUnpackingTask> parent_task,
             const std::set<std::string> &decoders_to_check,
-            const InputFileFactory file_factory);
+            const InputFileFactory file_factory,
+            const uoff_t memory_usage,
+            const bool filtered_out = false);
+        ~DecodeInputFileTask();
 
         bool work() const override;
+        bool allocates_memory() const override;
 
         const InputFileFactory file_factory;
+
+        // size of the data held in memory until this task and its children
+        // are destroyed
+        const uoff_t memory_usage;
     };
 
     struct ProcessOutputFileTask final : public BaseParallelUnpackingTask
@@ -59,20 +75,44 @@ namespace
             const std::shared_ptr<io::File> input_file,
             const DecoderFileFactory file_factory,
             const std::shared_ptr<const dec::IDecoder> origin_decoder,
-            const std::string &target_name);
+            const std::string &target_name,
+            const std::string &cache_key,
+            const bool filtered_out);
 
         bool work() const override;
+        bool allocates_memory() const override;
+
+        // names the file and either saves it or decodes it further
+        bool process_output_file(
+            const std::shared_ptr<io::File> output_file) const;
 
         const std::shared_ptr<io::File> input_file;
         const DecoderFileFactory file_factory;
         const std::shared_ptr<const dec::IDecoder> origin_decoder;
         const std::string target_name;
+        const std::string cache_key; // empty if the output isn't cached
     };
 }
 
+// lazily decoded streams, such as slices of their parent archive, don't hold
+// their contents in memory, so only memory streams count against the budget
+static uoff_t get_memory_usage(const io::File &file)
+{
+    if (dynamic_cast<const io::MemoryByteStream*>(&file.stream))
+        return file.stream.size();
+    return 0;
+}
+
 static bool save(
     const BaseParallelUnpackingTask &task, std::shared_ptr<io::File> file)
 {
+    if (task.filtered_out)
+    {
+        task.logger.info("skipped by the entry filter.\n");
+        task.logger.flush();
+        return true;
+    }
+
     try
     {
         const auto full_path
@@ -81,8 +121,9 @@ static bool save(
         task.logger.flush();
         return true;
     }
-    catch (const err::IoError &e)
+    catch (const std::exception &e)
     {
+        // lazily decoded files can fail with data errors only when saved
         task.logger.err(
             "error saving (%s)\n", e.what() ? e.what() : "unknown error");
         task.logger.flush();
@@ -90,6 +131,74 @@ static bool save(
     }
 }
 
+// the key covers everything the output depends on; the adapter extends it
+// with the entry identity for archives
+static std::string make_cache_key(
+    io::File &input_file,
+    const TaskSourceType source_type,
+    const std::string &decoder_name,
+    const ArgParser &decoder_arg_parser)
+{
+    std::string cache_key;
+    if (source_type == TaskSourceType::InitialUserInput
+        && io::is_regular_file(input_file.path))
+    {
+        // files given by the user are identified by their location, size and
+        // modification time, which spares hashing multi-gigabyte archives on
+        // every run; the location is made absolute so that relative paths
+        // given from different directories don't collide
+        const auto path = io::absolute(input_file.path);
+        cache_key = path.str()
+            + "\n" + std::to_string(input_file.stream.size())
+            + "\n" + std::to_string(io::last_write_time(path));
+    }
+    else
+    {
+        input_file.stream.seek(0);
+        cache_key = algo::hex(algo::crypt::sha1(input_file.stream));
+    }
+    cache_key += "\n" + decoder_name + "\n" + au::version_long;
+    for (const auto &arg : decoder_arg_parser.get_recognized())
+        cache_key += "\n" + arg;
+    return cache_key;
+}
+
+static std::shared_ptr<io::File> load_cached_file(
+    const BaseParallelUnpackingTask &task, const std::string &cache_key)
+{
+    const auto output_cache = task.task_context.unpacker_context.output_cache;
+    if (!output_cache || cache_key.empty())
+        return nullptr;
+    try
+    {
+        return output_cache->load(cache_key);
+    }
+    catch (const std::exception &e)
+    {
+        task.logger.warn("error reading from cache (%s)\n", e.what());
+        return nullptr;
+    }
+}
+
+static std::shared_ptr<io::File> store_cached_file(
+    const BaseParallelUnpackingTask &task,
+    const std::string &cache_key,
+    const std::shared_ptr<io::File> file)
+{
+    const auto output_cache = task.task_context.unpacker_context.output_cache;
+    if (!output_cache || cache_key.empty())
+        return file;
+    try
+    {
+        return output_cache->store(cache_key, *file);
+    }
+    catch (const std::exception &e)
+    {
+        task.logger.warn("error writing to cache (%s)\n", e.what());
+        return file;
+    }
+}
+
 static std::set<std::string> collect_linked_decoders(
     const dec::IDecoder &base_decoder, const dec::Registry &registry)
 {
@@ -118,24 +227,30 @@ static std::shared_ptr<dec::IDecoder> guess_decoder(
     const BaseParallelUnpackingTask &task,
     const std::set<std::string> &decoders_to_check,
     io::File &file,
-    const TaskSourceType source_type)
+    const TaskSourceType source_type,
+    std::string &decoder_name)
 {
+    const auto &registry = task.task_context.unpacker_context.registry;
+    const auto candidates
+        = registry.get_decoder_candidates(file, decoders_to_check);
+
     task.logger.info(
-        "guessing decoder among %d decoders...\n", decoders_to_check.size());
+        "guessing decoder among %d decoders (%d candidates)...\n",
+        decoders_to_check.size(),
+        candidates.size());
 
     std::map<std::string, std::shared_ptr<dec::IDecoder>> matching_decoders;
-    for (const auto &name : decoders_to_check)
+    for (const auto &name : candidates)
     {
-        const auto current_decoder
-            = task.task_context.unpacker_context.registry.create_decoder(name);
+        const auto current_decoder = registry.create_decoder(name);
         if (current_decoder->is_recognized(file))
             matching_decoders[name] = std::move(current_decoder);
     }
 
     if (matching_decoders.size() == 1)
     {
-        task.logger.success(
-            "recognized as %s.\n", matching_decoders.begin()->first.c_str());
+        decoder_name = matching_decoders.begin()->first;
+        task.logger.success("recognized as %s.\n", decoder_name.c_str());
         return matching_decoders.begin()->second;
     }
 
@@ -172,14 +287,43 @@ ParallelUnpackerContext::ParallelUnpackerContext(
     const dec::Registry &registry,
     const bool enable_nested_decoding,
     const std::vector<std::string> &arguments,
-    const std::set<std::string> &decoders_to_check) :
+    const std::set<std::string> &decoders_to_check,
+    const OutputCache *output_cache,
+    const EntryFilter *entry_filter,
+    const bool list_entries) :
         logger(logger),
         file_saver(file_saver),
         registry(registry),
         enable_nested_decoding(enable_nested_decoding),
         arguments(arguments),
-        decoders_to_check(decoders_to_check)
+        decoders_to_check(decoders_to_check),
+        output_cache(output_cache),
+        entry_filter(entry_filter),
+        list_entries(list_entries)
+{
+    png_options.color_type = enc::png::PngColorType::Auto;
+    png_options.filter_strategy = enc::png::PngFilterStrategy::Adaptive;
+}
+
+static std::set<std::string> collect_archive_decoders(
+    const ParallelUnpackerContext &unpacker_context)
 {
+    std::set<std::string> archive_decoders;
+    if (!unpacker_context.entry_filter
+        || !unpacker_context.enable_nested_decoding)
+    {
+        return archive_decoders;
+    }
+    const auto &registry = unpacker_context.registry;
+    for (const auto &name : registry.get_decoder_names())
+    {
+        if (std::dynamic_pointer_cast<const dec::BaseArchiveDecoder>(
+            registry.create_decoder(name)))
+        {
+            archive_decoders.insert(name);
+        }
+    }
+    return archive_decoders;
 }
 
 ParallelTaskContext::ParallelTaskContext(
@@ -188,7 +332,8 @@ ParallelTaskContext::ParallelTaskContext(
     TaskScheduler &task_scheduler) :
         unpacker(unpacker),
         unpacker_context(unpacker_context),
-        task_scheduler(task_scheduler)
+        task_scheduler(task_scheduler),
+        archive_decoders(collect_archive_decoders(unpacker_context))
 {
 }
 
@@ -197,19 +342,22 @@ BaseParallelUnpackingTask::BaseParallelUnpackingTask(
     const TaskSourceType source_type,
     const io::path &base_name,
     const std::shared_ptr<const BaseParallelUnpackingTask> parent_task,
-    const std::set<std::string> &decoders_to_check) :
+    const std::set<std::string> &decoders_to_check,
+    const bool filtered_out) :
         logger(task_context.unpacker_context.logger),
         task_context(task_context),
         source_type(source_type),
         base_name(base_name),
         parent_task(parent_task),
-        decoders_to_check(decoders_to_check)
+        decoders_to_check(decoders_to_check),
+        filtered_out(filtered_out)
 {
-    mutex.lock();
     const auto task_id = task_count++;
-    mutex.unlock();
     logger.set_prefix(
         algo::format("[task %d] %s: ", task_id, base_name.c_str()));
+    // keeps the lines of each task together and spares the workers from
+    // waiting for one another while logging
+    logger.set_batching(true);
 }
 
 size_t BaseParallelUnpackingTask::get_depth() const
@@ -224,12 +372,34 @@ size_t BaseParallelUnpackingTask::get_depth() const
     return depth;
 }
 
+std::vector<std::string> BaseParallelUnpackingTask::get_nested_archive_decoders(
+    const dec::BaseDecoder &origin_decoder) const
+{
+    // mirrors the decoders that save_file() and process_output_file() pass on
+    auto decoder_names = collect_linked_decoders(
+        origin_decoder, task_context.unpacker_context.registry);
+    if (source_type != TaskSourceType::InitialUserInput)
+    {
+        decoder_names.insert(
+            decoders_to_check.begin(), decoders_to_check.end());
+    }
+
+    std::vector<std::string> archive_decoders;
+    for (const auto &name : decoder_names)
+        if (task_context.archive_decoders.count(name))
+            archive_decoders.push_back(name);
+    return archive_decoders;
+}
+
 void BaseParallelUnpackingTask::save_file(
     const std::shared_ptr<io::File> input_file,
     const DecoderFileFactory file_factory,
     const dec::BaseDecoder &origin_decoder,
-    const std::string &target_name) const
+    const std::string &target_name,
+    const std::string &cache_key,
+    const bool filtered_out) const
 {
+    logger.flush();
     task_context.task_scheduler.push_front(
         std::make_shared<ProcessOutputFileTask>(
             task_context,
@@ -241,7 +411,9 @@ void BaseParallelUnpackingTask::save_file(
             input_file,
             file_factory,
             origin_decoder.shared_from_this(),
-            target_name));
+            target_name,
+            cache_key,
+            filtered_out));
 }
 
 DecodeInputFileTask::DecodeInputFileTask(
@@ -250,15 +422,32 @@ DecodeInputFileTask::DecodeInputFileTask(
     const io::path &base_name,
     const std::shared_ptr<const BaseParallelUnpackingTask> parent_task,
     const std::set<std::string> &decoders_to_check,
-    const InputFileFactory file_factory) :
+    const InputFileFactory file_factory,
+    const uoff_t memory_usage,
+    const bool filtered_out) :
         BaseParallelUnpackingTask(
             task_context,
             source_type,
             base_name,
             parent_task,
-            decoders_to_check),
-        file_factory(file_factory)
+            decoders_to_check,
+            filtered_out),
+        file_factory(file_factory),
+        memory_usage(memory_usage)
+{
+    task_context.task_scheduler.reserve_memory(memory_usage);
+}
+
+DecodeInputFileTask::~DecodeInputFileTask()
+{
+    task_context.task_scheduler.release_memory(memory_usage);
+}
+
+bool DecodeInputFileTask::allocates_memory() const
 {
+    // nested files are already in memory and decoding them is the only way
+    // to get rid of them
+    return source_type == TaskSourceType::InitialUserInput;
 }
 
 bool DecodeInputFileTask::work() const
@@ -283,8 +472,9 @@ bool DecodeInputFileTask::work() const
     {
         logger.info("initial recognition...\n");
 
+        std::string decoder_name;
         const auto decoder = guess_decoder(
-            *this, decoders_to_check, *input_file, source_type);
+            *this, decoders_to_check, *input_file, source_type, decoder_name);
 
         if (!decoder)
         {
@@ -301,7 +491,13 @@ bool DecodeInputFileTask::work() const
         for (const auto &decorator : decorators)
             decorator.parse_cli_options(decoder_arg_parser);
 
-        ParallelDecoderAdapter adapter(shared_from_this(), input_file);
+        const auto cache_key = task_context.unpacker_context.output_cache
+            ? make_cache_key(
+                *input_file, source_type, decoder_name, decoder_arg_parser)
+            : "";
+
+        ParallelDecoderAdapter adapter(
+            shared_from_this(), input_file, cache_key);
         decoder->accept(adapter);
         return true;
     }
@@ -323,18 +519,27 @@ ProcessOutputFileTask::ProcessOutputFileTask(
     const std::shared_ptr<io::File> input_file,
     const DecoderFileFactory file_factory,
     const std::shared_ptr<const dec::IDecoder> origin_decoder,
-    const std::string &target_name) :
+    const std::string &target_name,
+    const std::string &cache_key,
+    const bool filtered_out) :
         BaseParallelUnpackingTask(
             task_context,
             source_type,
             base_name,
             parent_task,
-            decoders_to_check),
+            decoders_to_check,
+            filtered_out),
         input_file(input_file),
         file_factory(file_factory),
         origin_decoder(origin_decoder),
-        target_name(target_name)
+        target_name(target_name),
+        cache_key(cache_key)
+{
+}
+
+bool ProcessOutputFileTask::allocates_memory() const
 {
+    return true;
 }
 
 bool ProcessOutputFileTask::work() const
@@ -350,10 +555,21 @@ bool ProcessOutputFileTask::work() const
         return false;
     }
 
+    auto output_file = load_cached_file(*this, cache_key);
+    if (output_file)
+    {
+        logger.info("found in cache.\n");
+        return process_output_file(output_file);
+    }
+
     io::File input_file_copy(*input_file);
-    std::shared_ptr<io::File> output_file;
+    const auto vfs_lookup_count = VirtualFileSystem::get_lookup_count();
     try
     {
+        // decoders and encoders may borrow the workers that have nothing
+        // else to do, e.g. when unpacking a single large file
+        const algo::ThreadBudget thread_budget(
+            1 + task_context.task_scheduler.get_idle_thread_count());
         output_file = file_factory(input_file_copy, logger);
         if (!output_file)
         {
@@ -387,6 +603,25 @@ bool ProcessOutputFileTask::work() const
             : "decoding of \"%s\" finished.\n",
         target_name.c_str());
 
+    // filtered out entries are never saved, so caching them would only
+    // read them in full
+    if (filtered_out)
+        return process_output_file(output_file);
+
+    // the cache key covers only the input, so outputs that depend on other
+    // files (such as palettes or plugins) would go stale
+    if (VirtualFileSystem::get_lookup_count() != vfs_lookup_count)
+    {
+        logger.info("output depends on other files; not caching.\n");
+        return process_output_file(output_file);
+    }
+    return process_output_file(
+        store_cached_file(*this, cache_key, output_file));
+}
+
+bool ProcessOutputFileTask::process_output_file(
+    const std::shared_ptr<io::File> output_file) const
+{
     const auto naming_strategy = origin_decoder->naming_strategy();
     output_file->path = algo::apply_naming_strategy(
         naming_strategy, base_name, output_file->path);
@@ -408,6 +643,22 @@ bool ProcessOutputFileTask::work() const
         return save(*this, output_file);
     }
 
+    if (filtered_out)
+    {
+        // only archives are of interest; their signatures are checked
+        // against the header alone, which lazily decoded entries provide
+        // without being decoded in full
+        std::set<std::string> archive_decoders;
+        for (const auto &name : linked_decoders)
+            if (task_context.archive_decoders.count(name))
+                archive_decoders.insert(name);
+        const auto candidates = task_context.unpacker_context.registry
+            .get_decoder_candidates(*output_file, archive_decoders);
+        if (candidates.empty())
+            return save(*this, output_file);
+    }
+
+    logger.flush();
     task_context.task_scheduler.push_front(
         std::make_shared<DecodeInputFileTask>(
             task_context,
@@ -415,7 +666,9 @@ bool ProcessOutputFileTask::work() const
             output_file->path,
             shared_from_this(),
             linked_decoders,
-            [=]() { return output_file; }));
+            [=]() { return output_file; },
+            get_memory_usage(*output_file),
+            filtered_out));
 
     return true;
 }
@@ -459,13 +712,15 @@ void ParallelUnpacker::add_input_file(
             base_name,
             nullptr,
             p->unpacker_context.decoders_to_check,
-            file_factory));
+            file_factory,
+            0));
 }
 
-bool ParallelUnpacker::run(const size_t thread_count)
+bool ParallelUnpacker::run(
+    const size_t thread_count, const uoff_t memory_limit)
 {
     const auto begin = std::chrono::steady_clock::now();
-    const auto results = p->task_scheduler.run(thread_count);
+    const auto results = p->task_scheduler.run(thread_count, memory_limit);
     const auto end = std::chrono::steady_clock::now();
     const auto diff
         = std::chrono::duration_cast<std::chrono::milliseconds>(end - begin);
@@ -492,8 +747,16 @@ bool ParallelUnpacker::run(const size_t thread_count)
 
     logger.log(
         Logger::MessageType::Summary,
-        "%d saved files)\n",
+        "%d saved files",
         p->unpacker_context.file_saver.get_saved_file_count());
+    if (p->unpacker_context.output_cache)
+    {
+        logger.log(
+            Logger::MessageType::Summary,
+            ", %d from cache",
+            p->unpacker_context.output_cache->get_hit_count());
+    }
+    logger.log(Logger::MessageType::Summary, ")\n");
 
     return results.error_count == 0;
 }
@@ -22,7 +22,10 @@
 #include <set>
 #include "dec/base_decoder.h"
 #include "dec/registry.h"
+#include "enc/png/png_image_encoder.h"
+#include "flow/entry_filter.h"
 #include "flow/ifile_saver.h"
+#include "flow/output_cache.h"
 #include "flow/task_scheduler.h"
 #include "logger.h"
 
@@ -49,7 +52,10 @@ namespace flow {
             const dec::Registry &registry,
             const bool enable_nested_decoding,
             const std::vector<std::string> &arguments,
-            const std::set<std::string> &decoders_to_check);
+            const std::set<std::string> &decoders_to_check,
+            const OutputCache *output_cache = nullptr,
+            const EntryFilter *entry_filter = nullptr,
+            const bool list_entries = false);
 
         const Logger &logger;
         const IFileSaver &file_saver;
@@ -57,6 +63,17 @@ namespace flow {
         const bool enable_nested_decoding;
         const std::vector<std::string> arguments;
         const std::set<std::string> decoders_to_check;
+        const OutputCache *output_cache; // nullptr disables caching
+
+        // applied to the entries of archives at every nesting depth; with
+        // nested decoding, entries that fail only the inclusion rules but
+        // could be archives are still searched for matching entries
+        const EntryFilter *entry_filter; // nullptr lets everything through
+        const bool list_entries; // print entry paths instead of extracting
+
+        // decoded images are saved with these; by default the color type
+        // and the filters are picked for each image
+        enc::png::PngImageEncoderOptions png_options;
     };
 
     struct ParallelTaskContext final
@@ -69,6 +86,10 @@ namespace flow {
         ParallelUnpacker &unpacker;
         const ParallelUnpackerContext &unpacker_context;
         TaskScheduler &task_scheduler;
+
+        // names of all archive decoders; collected only when the entry
+        // filter needs to tell which entries could be archives
+        const std::set<std::string> archive_decoders;
     };
 
     struct BaseParallelUnpackingTask :
@@ -80,17 +101,25 @@ namespace flow {
             const TaskSourceType source_type,
             const io::path &base_name,
             const std::shared_ptr<const BaseParallelUnpackingTask> parent_task,
-            const std::set<std::string> &decoders_to_check);
+            const std::set<std::string> &decoders_to_check,
+            const bool filtered_out = false);
 
         virtual ~BaseParallelUnpackingTask() {}
 
         size_t get_depth() const;
 
+        // Archive decoders that nested decoding would try on the entries of
+        // an archive decoded with given decoder.
+        std::vector<std::string> get_nested_archive_decoders(
+            const dec::BaseDecoder &origin_decoder) const;
+
         void save_file(
             const std::shared_ptr<io::File> input_file,
             const DecoderFileFactory,
             const dec::BaseDecoder &origin_decoder,
-            const std::string &custom_name = "") const;
+            const std::string &custom_name = "",
+            const std::string &cache_key = "",
+            const bool filtered_out = false) const;
 
         Logger logger;
         ParallelTaskContext &task_context;
@@ -98,6 +127,11 @@ namespace flow {
         const io::path base_name;
         const std::shared_ptr<const BaseParallelUnpackingTask> parent_task;
         const std::set<std::string> decoders_to_check;
+
+        // The archive entry failed the inclusion rules of the entry filter.
+        // It is still decoded since it could be an archive whose own entries
+        // match, but it is neither converted nor saved.
+        const bool filtered_out;
     };
 
     class ParallelUnpacker final
@@ -107,7 +141,11 @@ namespace flow {
         ~ParallelUnpacker();
 
         void add_input_file(const io::path &base_name, const InputFileFactory);
-        bool run(const size_t thread_count = 0);
+
+        // memory_limit caps (softly) the total size of decoded files that
+        // wait in memory to be processed; lazily decoded files don't count.
+        // 0 means no limit
+        bool run(const size_t thread_count = 0, const uoff_t memory_limit = 0);
 
     private:
         struct Priv;
@@ -16,8 +16,10 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "flow/task_scheduler.h"
-#include <chrono>
+#include <atomic>
+#include <condition_variable>
 #include <deque>
+#include <mutex>
 #include <thread>
 #include <vector>
 #include "algo/range.h"
@@ -25,12 +27,217 @@
 using namespace au;
 using namespace au::flow;
 
+namespace
+{
+    struct TaskQueue final
+    {
+        void push_front(std::shared_ptr<ITask> task);
+        void push_back(std::shared_ptr<ITask> task);
+        std::shared_ptr<ITask> pop_front(const bool allocating);
+        std::shared_ptr<ITask> pop_back(const bool allocating);
+
+        std::mutex mutex;
+        std::deque<std::shared_ptr<ITask>> releasing_tasks;
+        std::deque<std::shared_ptr<ITask>> allocating_tasks;
+    };
+
+    struct Worker final
+    {
+        const void *scheduler;
+        size_t index;
+    };
+}
+
+// identifies the scheduler and queue of the worker running on this thread,
+// so that tasks spawned from within other tasks stay local
+static thread_local Worker current_worker = {nullptr, 0};
+
+void TaskQueue::push_front(std::shared_ptr<ITask> task)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    (task->allocates_memory() ? allocating_tasks : releasing_tasks)
+        .push_front(task);
+}
+
+void TaskQueue::push_back(std::shared_ptr<ITask> task)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    (task->allocates_memory() ? allocating_tasks : releasing_tasks)
+        .push_back(task);
+}
+
+std::shared_ptr<ITask> TaskQueue::pop_front(const bool allocating)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto &tasks = allocating ? allocating_tasks : releasing_tasks;
+    if (tasks.empty())
+        return nullptr;
+    auto task = tasks.front();
+    tasks.pop_front();
+    return task;
+}
+
+std::shared_ptr<ITask> TaskQueue::pop_back(const bool allocating)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto &tasks = allocating ? allocating_tasks : releasing_tasks;
+    if (tasks.empty())
+        return nullptr;
+    auto task = tasks.back();
+    tasks.pop_back();
+    return task;
+}
+
 struct TaskScheduler::Priv final
 {
-    std::deque<std::shared_ptr<ITask>> tasks;
-    std::vector<std::unique_ptr<std::thread>> threads;
+    Priv();
+
+    TaskQueue *get_local_queue();
+    void push(std::shared_ptr<ITask> task, const bool front);
+    std::shared_ptr<ITask> pop(const size_t worker_index, const bool allocating);
+    std::shared_ptr<ITask> pop(const size_t worker_index);
+    bool can_allocate(const bool is_running) const;
+    bool has_work() const;
+    void work(const size_t worker_index, TaskSchedulerResult &result);
+
+    TaskQueue shared_queue;
+    std::vector<std::unique_ptr<TaskQueue>> worker_queues;
+
+    // tasks that were pushed, but didn't finish yet
+    std::atomic<size_t> pending_count;
+    // tasks that wait in the queues
+    std::atomic<size_t> queued_releasing_count;
+    std::atomic<size_t> queued_allocating_count;
+    // tasks that are being executed
+    std::atomic<size_t> running_count;
+
+    uoff_t memory_limit;
+    std::atomic<uoff_t> reserved_memory;
+
+    // guards changes to anything that can wake up idle workers
+    std::mutex idle_mutex;
+    std::condition_variable idle_cv;
 };
 
+TaskScheduler::Priv::Priv() :
+    pending_count(0),
+    queued_releasing_count(0),
+    queued_allocating_count(0),
+    running_count(0),
+    memory_limit(0),
+    reserved_memory(0)
+{
+}
+
+TaskQueue *TaskScheduler::Priv::get_local_queue()
+{
+    if (current_worker.scheduler != this)
+        return &shared_queue;
+    return worker_queues.at(current_worker.index).get();
+}
+
+void TaskScheduler::Priv::push(std::shared_ptr<ITask> task, const bool front)
+{
+    {
+        // pairs with the predicate check in work(), so that the wakeup
+        // can't be lost between the check and the wait
+        std::unique_lock<std::mutex> lock(idle_mutex);
+        ++pending_count;
+        ++(task->allocates_memory()
+            ? queued_allocating_count
+            : queued_releasing_count);
+    }
+
+    auto queue = get_local_queue();
+    if (front)
+        queue->push_front(task);
+    else
+        queue->push_back(task);
+    idle_cv.notify_one();
+}
+
+std::shared_ptr<ITask> TaskScheduler::Priv::pop(
+    const size_t worker_index, const bool allocating)
+{
+    auto task = worker_queues[worker_index]->pop_front(allocating);
+    if (!task)
+        task = shared_queue.pop_front(allocating);
+    for (const auto i : algo::range(1, worker_queues.size()))
+    {
+        if (task)
+            break;
+        const auto victim_index = (worker_index + i) % worker_queues.size();
+        task = worker_queues[victim_index]->pop_back(allocating);
+    }
+    if (task)
+        --(allocating ? queued_allocating_count : queued_releasing_count);
+    return task;
+}
+
+std::shared_ptr<ITask> TaskScheduler::Priv::pop(const size_t worker_index)
+{
+    auto task = pop(worker_index, false);
+    if (!task && can_allocate(true))
+        task = pop(worker_index, true);
+    return task;
+}
+
+bool TaskScheduler::Priv::can_allocate(const bool is_running) const
+{
+    // when no other task is running, nothing can free the memory either, so
+    // let the tasks through to guarantee progress
+    return !memory_limit
+        || reserved_memory < memory_limit
+        || running_count <= (is_running ? 1 : 0);
+}
+
+bool TaskScheduler::Priv::has_work() const
+{
+    return queued_releasing_count > 0
+        || (queued_allocating_count > 0 && can_allocate(false));
+}
+
+void TaskScheduler::Priv::work(
+    const size_t worker_index, TaskSchedulerResult &result)
+{
+    current_worker = {this, worker_index};
+
+    while (true)
+    {
+        std::shared_ptr<ITask> task;
+        {
+            std::unique_lock<std::mutex> lock(idle_mutex);
+            idle_cv.wait(lock, [&]()
+            {
+                return has_work() || pending_count == 0;
+            });
+            if (pending_count == 0)
+                break;
+            ++running_count;
+        }
+
+        task = pop(worker_index);
+        const auto local_success = task ? task->work() : true;
+        const auto executed = task != nullptr;
+        task.reset();
+
+        {
+            std::unique_lock<std::mutex> lock(idle_mutex);
+            --running_count;
+            if (executed)
+            {
+                result.success_count += local_success;
+                result.error_count += !local_success;
+                --pending_count;
+            }
+        }
+        if (executed && (pending_count == 0 || memory_limit))
+            idle_cv.notify_all();
+    }
+
+    current_worker = {nullptr, 0};
+}
+
 TaskScheduler::TaskScheduler() : p(new Priv())
 {
 }
@@ -41,17 +248,41 @@ TaskScheduler::~TaskScheduler()
 
 void TaskScheduler::push_front(std::shared_ptr<ITask> task)
 {
-    std::unique_lock<std::mutex> lock(mutex);
-    p->tasks.push_front(task);
+    p->push(task, true);
 }
 
 void TaskScheduler::push_back(std::shared_ptr<ITask> task)
 {
-    std::unique_lock<std::mutex> lock(mutex);
-    p->tasks.push_back(task);
+    p->push(task, false);
+}
+
+void TaskScheduler::reserve_memory(const uoff_t bytes)
+{
+    std::unique_lock<std::mutex> lock(p->idle_mutex);
+    p->reserved_memory += bytes;
+}
+
+void TaskScheduler::release_memory(const uoff_t bytes)
+{
+    {
+        std::unique_lock<std::mutex> lock(p->idle_mutex);
+        p->reserved_memory -= bytes;
+    }
+    if (p->memory_limit)
+        p->idle_cv.notify_all();
+}
+
+size_t TaskScheduler::get_idle_thread_count() const
+{
+    std::unique_lock<std::mutex> lock(p->idle_mutex);
+    if (p->queued_releasing_count || p->queued_allocating_count)
+        return 0;
+    return p->worker_queues.size() - std::min<size_t>(
+        p->running_count, p->worker_queues.size());
 }
 
-TaskSchedulerResult TaskScheduler::run(size_t number_of_threads)
+TaskSchedulerResult TaskScheduler::run(
+    size_t number_of_threads, const uoff_t memory_limit)
 {
     if (!number_of_threads)
         number_of_threads = std::thread::hardware_concurrency();
@@ -61,46 +292,25 @@ TaskSchedulerResult TaskScheduler::run(size_t number_of_threads)
     TaskSchedulerResult result;
     result.success_count = 0;
     result.error_count = 0;
-    bool still_running = true;
 
+    p->memory_limit = memory_limit;
+    p->worker_queues.clear();
     for (const auto i : algo::range(number_of_threads))
+        p->worker_queues.push_back(std::make_unique<TaskQueue>());
+
+    std::vector<std::unique_ptr<std::thread>> threads;
+    for (const auto i : algo::range(1, number_of_threads))
     {
-        p->threads.push_back(std::make_unique<std::thread>([&]()
+        threads.push_back(std::make_unique<std::thread>([&, i]()
         {
-            while (true)
-            {
-                std::shared_ptr<ITask> task;
-
-                {
-                    std::unique_lock<std::mutex> lock(mutex);
-                    if (p->tasks.empty())
-                    {
-                        if (still_running && number_of_threads > 1)
-                        {
-                            lock.unlock();
-                            std::this_thread::sleep_for(
-                                std::chrono::milliseconds(10));
-                            continue;
-                        }
-                        break;
-                    }
-                    task = p->tasks.front();
-                    p->tasks.pop_front();
-                }
-
-                const auto local_success = task->work();
-
-                {
-                    std::unique_lock<std::mutex> lock(mutex);
-                    result.success_count += local_success;
-                    result.error_count += !local_success;
-                    still_running = !p->tasks.empty();
-                }
-            }
+            p->work(i, result);
         }));
     }
 
-    for (auto &t : p->threads)
+    // the calling thread acts as the first worker
+    p->work(0, result);
+
+    for (auto &t : threads)
         t->join();
 
     return result;
@@ -18,7 +18,7 @@
 #pragma once
 
 #include <memory>
-#include <mutex>
+#include "types.h"
 
 namespace au {
 namespace flow {
@@ -28,6 +28,12 @@ namespace flow {
     public:
         virtual ~ITask() {}
         virtual bool work() const = 0;
+
+        // Tasks that bring new data into memory (e.g. decode archive
+        // entries) are held back while the memory reserved with
+        // TaskScheduler::reserve_memory exceeds the limit, and the other
+        // tasks, which move the data towards being freed, are run first.
+        virtual bool allocates_memory() const { return false; }
     };
 
     struct TaskSchedulerResult final
@@ -36,16 +42,31 @@ namespace flow {
         int error_count;
     };
 
+    // Each worker owns a deque of tasks and steals from the others once its
+    // own runs dry. Tasks pushed by a worker stay in its own deque: with
+    // push_front they are picked up next (depth-first), with push_back they
+    // are queued behind its other tasks. Tasks pushed from outside the
+    // workers go to a shared queue. run() returns once there are no queued
+    // nor running tasks left. Setting memory_limit to 0 disables throttling
+    // of memory allocating tasks.
     class TaskScheduler final
     {
     public:
         TaskScheduler();
         ~TaskScheduler();
-        TaskSchedulerResult run(const size_t number_of_threads = 0);
+        TaskSchedulerResult run(
+            const size_t number_of_threads = 0,
+            const uoff_t memory_limit = 0);
         void push_front(std::shared_ptr<ITask> task);
         void push_back(std::shared_ptr<ITask> task);
-        void join();
-        std::mutex mutex;
+
+        void reserve_memory(const uoff_t bytes);
+        void release_memory(const uoff_t bytes);
+
+        // Workers that have nothing to do, counted only while no tasks are
+        // queued; tasks can hand them parallel work of their own.
+        size_t get_idle_thread_count() const;
+
     private:
         struct Priv;
         std::unique_ptr<Priv> p;
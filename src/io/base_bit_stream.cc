@@ -27,17 +27,23 @@ BaseBitStream::~BaseBitStream() {}
 BaseBitStream::BaseBitStream(const bstr &input) :
     buffer(0),
     bits_available(0),
-    position(0),
-    own_stream_holder(new MemoryByteStream(input)),
-    input_stream(own_stream_holder.get())
+    position(0)
 {
+    auto data = std::make_shared<bstr>(input);
+    own_stream_holder = std::make_unique<MemoryByteStream>(data);
+    input_stream = own_stream_holder.get();
+    own_data = data;
+    data_ptr = own_data->get<const u8>();
+    data_end = data_ptr + own_data->size();
 }
 
 BaseBitStream::BaseBitStream(io::BaseByteStream &input_stream) :
     buffer(0),
     bits_available(0),
     position(0),
-    input_stream(&input_stream)
+    input_stream(&input_stream),
+    data_ptr(nullptr),
+    data_end(nullptr)
 {
 }
 
@@ -49,6 +55,8 @@ BaseStream &BaseBitStream::seek(const uoff_t new_pos)
     bits_available = 0;
     buffer = 0;
     input_stream->seek(position / 8);
+    if (own_data)
+        data_ptr = own_data->get<const u8>() + position / 8;
     read(new_pos % 32);
     return *this;
 }
@@ -47,6 +47,13 @@ namespace io {
         size_t position;
         std::unique_ptr<io::BaseByteStream> own_stream_holder;
         io::BaseByteStream *input_stream;
+
+        // Set when the bits come from a buffer that nobody but this stream
+        // can see, so that the readers can take whole words out of it
+        // directly instead of going through input_stream byte by byte.
+        std::shared_ptr<const bstr> own_data;
+        const u8 *data_ptr;
+        const u8 *data_end;
     };
 
 } }
@@ -22,6 +22,11 @@
 using namespace au;
 using namespace au::io;
 
+BaseByteStream::BaseByteStream()
+    : has_view(false), view_ptr(nullptr), view_end(nullptr)
+{
+}
+
 BaseByteStream::~BaseByteStream() {}
 
 bstr BaseByteStream::read_to_zero()
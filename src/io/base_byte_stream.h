@@ -17,9 +17,11 @@
 
 #pragma once
 
+#include <cstring>
 #include <functional>
 #include <memory>
 #include "algo/endian.h"
+#include "err.h"
 #include "io/base_stream.h"
 #include "types.h"
 
@@ -60,17 +62,32 @@ namespace io {
             if (!bytes)
                 return ""_b;
             bstr ret(bytes);
-            read_impl(&ret[0], bytes);
+            read(&ret[0], bytes);
             return ret;
         }
 
+        void read(void *destination, const size_t bytes)
+        {
+            // streams without a view have null view pointers, which memcpy
+            // mustn't be given even for zero bytes
+            if (!bytes)
+                return;
+            if (static_cast<size_t>(view_end - view_ptr) >= bytes)
+            {
+                std::memcpy(destination, view_ptr, bytes);
+                view_ptr += bytes;
+                return;
+            }
+            read_impl(destination, bytes);
+        }
+
         template<typename T> T read()
         {
             static_assert(
                 sizeof(T) == 1,
                 "For multiple bytes, must specify endianness");
             T x;
-            read_impl(&x, sizeof(x));
+            read(&x, sizeof(x));
             return x;
         }
 
@@ -80,7 +97,7 @@ namespace io {
                 sizeof(T) > 1,
                 "Endianness does not make sense for single bytes");
             T x;
-            read_impl(&x, sizeof(x));
+            read(&x, sizeof(x));
             return algo::from_little_endian(x);
         }
 
@@ -90,10 +107,26 @@ namespace io {
                 sizeof(T) > 1,
                 "Endianness does not make sense for single bytes");
             T x;
-            read_impl(&x, sizeof(x));
+            read(&x, sizeof(x));
             return algo::from_big_endian(x);
         }
 
+        // For streams keeping their data contiguously in memory (memory
+        // buffers, mapped files and slices of those), returns the next
+        // bytes without copying them and advances past them. The data stays
+        // valid until the stream is written to or resized. Other streams
+        // return nullptr without moving, in which case read() must be used.
+        const u8 *read_view(const size_t bytes)
+        {
+            if (!has_view)
+                return nullptr;
+            if (static_cast<size_t>(view_end - view_ptr) < bytes)
+                throw err::EofError();
+            const auto ret = view_ptr;
+            view_ptr += bytes;
+            return ret;
+        }
+
         io::BaseByteStream &write(const bstr &bytes)
         {
             if (!bytes.size())
@@ -152,6 +185,17 @@ namespace io {
         virtual std::unique_ptr<BaseByteStream> clone() const = 0;
 
     protected:
+        BaseByteStream();
+
+        // Streams with contiguous data point these at the bytes between the
+        // current position and the end, so that reads which fit are served
+        // inline instead of through read_impl. Such streams must derive
+        // their position from view_ptr and update both pointers whenever
+        // they seek or their storage changes.
+        bool has_view;
+        const u8 *view_ptr;
+        const u8 *view_end;
+
         virtual void read_impl(void *input, const size_t size) = 0;
         virtual void write_impl(const void *str, const size_t size) = 0;
         virtual void seek_impl(const uoff_t offset) = 0;
@@ -0,0 +1,148 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstring>
+#include "algo/endian.h"
+#include "err.h"
+#include "types.h"
+
+namespace au {
+namespace io {
+
+    enum class BitOrder : u8
+    {
+        Msb,
+        Lsb,
+    };
+
+    // Non-virtual bit reader over a contiguous buffer, meant for tight
+    // decoding loops where MsbBitStream and LsbBitStream are too slow.
+    // Each refill tops the buffer up to at least 56 bits with a single
+    // unaligned load, so a peek() followed by consume() of up to 32 bits
+    // needs at most one refill. Peeking past the end yields zeros;
+    // consuming past the end throws. The reader doesn't copy the data, so
+    // it must outlive the reader.
+    template<BitOrder order> class BitReader final
+    {
+    public:
+        BitReader(const u8 *data, const size_t size) :
+            data_ptr(data),
+            data_end(data + size),
+            buffer(0),
+            bits_available(0),
+            position(0),
+            size_in_bits(static_cast<uoff_t>(size) * 8)
+        {
+        }
+
+        BitReader(const bstr &data)
+            : BitReader(data.get<const u8>(), data.size())
+        {
+        }
+
+        BitReader(const bstr &&data) = delete;
+
+        inline u32 peek(const size_t bits)
+        {
+            if (bits_available < bits)
+                refill();
+            if (order == BitOrder::Msb)
+                return (buffer >> 1) >> (63 - bits);
+            return buffer & ((1ull << bits) - 1);
+        }
+
+        inline void consume(const size_t bits)
+        {
+            if (position + bits > size_in_bits)
+                throw err::EofError();
+            if (order == BitOrder::Msb)
+                buffer <<= bits;
+            else
+                buffer >>= bits;
+            bits_available -= bits;
+            position += bits;
+        }
+
+        inline u32 read(const size_t bits)
+        {
+            const auto value = peek(bits);
+            consume(bits);
+            return value;
+        }
+
+        inline uoff_t pos() const
+        {
+            return position;
+        }
+
+        inline uoff_t size() const
+        {
+            return size_in_bits;
+        }
+
+        inline uoff_t left() const
+        {
+            return size_in_bits - position;
+        }
+
+        inline bool eof() const
+        {
+            return position >= size_in_bits;
+        }
+
+    private:
+        inline void refill()
+        {
+            if (data_end - data_ptr >= 8)
+            {
+                u64 word;
+                std::memcpy(&word, data_ptr, sizeof(word));
+                if (order == BitOrder::Msb)
+                    buffer |= algo::from_big_endian(word) >> bits_available;
+                else
+                    buffer |= algo::from_little_endian(word) << bits_available;
+                data_ptr += (63 - bits_available) >> 3;
+                bits_available |= 56;
+                return;
+            }
+
+            // near the end, go byte by byte and pad with zeros
+            while (bits_available <= 56)
+            {
+                const u64 byte = data_ptr < data_end ? *data_ptr++ : 0;
+                if (order == BitOrder::Msb)
+                    buffer |= byte << (56 - bits_available);
+                else
+                    buffer |= byte << bits_available;
+                bits_available += 8;
+            }
+        }
+
+        const u8 *data_ptr;
+        const u8 *data_end;
+        u64 buffer;
+        size_t bits_available;
+        uoff_t position;
+        const uoff_t size_in_bits;
+    };
+
+    using MsbBitReader = BitReader<BitOrder::Msb>;
+    using LsbBitReader = BitReader<BitOrder::Lsb>;
+
+} }
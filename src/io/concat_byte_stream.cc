@@ -0,0 +1,105 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "io/concat_byte_stream.h"
+#include <algorithm>
+#include "err.h"
+
+using namespace au;
+using namespace au::io;
+
+ConcatByteStream::ConcatByteStream(
+    std::vector<std::unique_ptr<BaseByteStream>> streams) :
+        streams(std::move(streams)),
+        total_size(0),
+        current_pos(0)
+{
+    for (const auto &stream : this->streams)
+    {
+        offsets.push_back(total_size);
+        total_size += stream->size();
+    }
+}
+
+ConcatByteStream::~ConcatByteStream()
+{
+}
+
+void ConcatByteStream::seek_impl(const uoff_t offset)
+{
+    if (offset > total_size)
+        throw err::EofError();
+    current_pos = offset;
+}
+
+void ConcatByteStream::read_impl(void *destination, const size_t size)
+{
+    // destination MUST exist and size MUST be at least 1
+    if (current_pos + size > total_size)
+        throw err::EofError();
+
+    auto destination_ptr = reinterpret_cast<u8*>(destination);
+    auto left = size;
+    // last stream that starts at or before the current position
+    auto i = std::upper_bound(offsets.begin(), offsets.end(), current_pos)
+        - offsets.begin() - 1;
+    while (left)
+    {
+        auto &stream = *streams[i];
+        stream.seek(current_pos - offsets[i]);
+        const auto chunk_size = std::min<uoff_t>(left, stream.left());
+        if (chunk_size)
+        {
+            const auto chunk = stream.read(chunk_size);
+            std::copy(chunk.begin(), chunk.end(), destination_ptr);
+            destination_ptr += chunk_size;
+            current_pos += chunk_size;
+            left -= chunk_size;
+        }
+        ++i;
+    }
+}
+
+void ConcatByteStream::write_impl(const void *source, const size_t size)
+{
+    throw err::NotSupportedError("Not implemented");
+}
+
+uoff_t ConcatByteStream::pos() const
+{
+    return current_pos;
+}
+
+uoff_t ConcatByteStream::size() const
+{
+    return total_size;
+}
+
+void ConcatByteStream::resize_impl(const uoff_t new_size)
+{
+    throw err::NotSupportedError("Not implemented");
+}
+
+std::unique_ptr<BaseByteStream> ConcatByteStream::clone() const
+{
+    std::vector<std::unique_ptr<BaseByteStream>> stream_clones;
+    for (const auto &stream : streams)
+        stream_clones.push_back(stream->clone());
+    auto ret = std::make_unique<ConcatByteStream>(std::move(stream_clones));
+    ret->seek(pos());
+    return std::move(ret);
+}
@@ -17,8 +17,10 @@
 
 #include "io/file.h"
 #include <string>
+#include "err.h"
 #include "io/file_byte_stream.h"
 #include "io/memory_byte_stream.h"
+#include "io/mmap_byte_stream.h"
 
 using namespace au;
 using namespace au::io;
@@ -36,6 +38,23 @@ static const std::vector<std::pair<bstr, std::string>> magic_definitions
     {"\x00\x00\x00\x14""ftypisom"_b, "mp4"},
 };
 
+static std::unique_ptr<BaseByteStream> open_stream(
+    const io::path &path, const FileMode mode)
+{
+    if (mode == FileMode::Read)
+    {
+        try
+        {
+            return std::make_unique<MmapByteStream>(path);
+        }
+        catch (const err::IoError &)
+        {
+            // pipes and other special files can't be mapped
+        }
+    }
+    return std::make_unique<FileByteStream>(path, mode);
+}
+
 File::File(File &other_file) :
     stream_holder(other_file.stream.clone()),
     stream(*stream_holder),
@@ -51,7 +70,7 @@ File::File(const io::path &path, std::unique_ptr<BaseByteStream> stream) :
 }
 
 File::File(const io::path &path, const FileMode mode) :
-    File(path, std::make_unique<FileByteStream>(path, mode))
+    File(path, open_stream(path, mode))
 {
 }
 
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <ctime>
 #include <boost/filesystem.hpp>
 #include "io/path.h"
 
@@ -28,9 +29,11 @@ namespace io {
     bool is_directory(const path &p);
     bool is_regular_file(const path &p);
     path absolute(const path &p);
+    std::time_t last_write_time(const path &p);
 
     void create_directories(const path &p);
     void remove(const path &p);
+    void rename(const path &old_path, const path &new_path);
 
     template<typename T> class BaseDirectoryRange final
     {
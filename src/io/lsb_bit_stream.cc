@@ -16,6 +16,7 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "io/lsb_bit_stream.h"
+#include "err.h"
 
 using namespace au;
 using namespace au::io;
@@ -31,12 +32,8 @@ LsbBitStream::LsbBitStream(io::BaseByteStream &input_stream)
 
 u32 LsbBitStream::read(const size_t bits)
 {
-    while (bits_available < bits)
-    {
-        const auto tmp = input_stream->read<u8>();
-        buffer |= tmp << bits_available;
-        bits_available += 8;
-    }
+    if (bits_available < bits)
+        refill(bits);
     const auto mask = (1ull << bits) - 1;
     const auto value = buffer & mask;
     buffer >>= bits;
@@ -44,3 +41,31 @@ u32 LsbBitStream::read(const size_t bits)
     position += bits;
     return value;
 }
+
+void LsbBitStream::refill(const size_t bits)
+{
+    // bits_available < bits <= 32, so a whole word always fits in
+    if (data_end - data_ptr >= 4)
+    {
+        buffer |= static_cast<u64>(
+            data_ptr[0]
+            | (static_cast<u32>(data_ptr[1]) << 8)
+            | (static_cast<u32>(data_ptr[2]) << 16)
+            | (static_cast<u32>(data_ptr[3]) << 24)) << bits_available;
+        data_ptr += 4;
+        bits_available += 32;
+        return;
+    }
+    while (bits_available < bits)
+    {
+        u8 tmp;
+        if (!own_data)
+            tmp = input_stream->read<u8>();
+        else if (data_ptr < data_end)
+            tmp = *data_ptr++;
+        else
+            throw err::EofError();
+        buffer |= static_cast<u64>(tmp) << bits_available;
+        bits_available += 8;
+    }
+}
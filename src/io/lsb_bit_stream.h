@@ -29,6 +29,8 @@ namespace io {
         LsbBitStream(const bstr &input);
         LsbBitStream(io::BaseByteStream &input_stream);
         u32 read(const size_t n) override;
+    private:
+        void refill(const size_t bits);
     };
 
 } }
@@ -16,6 +16,7 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "io/memory_byte_stream.h"
+#include <algorithm>
 #include <cstring>
 #include "err.h"
 
@@ -23,8 +24,10 @@ using namespace au;
 using namespace au::io;
 
 MemoryByteStream::MemoryByteStream(const std::shared_ptr<bstr> input)
-    : buffer(input), buffer_pos(0)
+    : buffer(input)
 {
+    has_view = true;
+    update_view(0);
 }
 
 MemoryByteStream::MemoryByteStream()
@@ -56,10 +59,32 @@ MemoryByteStream::~MemoryByteStream()
 {
 }
 
+void MemoryByteStream::update_view(const uoff_t new_pos)
+{
+    view_ptr = buffer->get<const u8>() + new_pos;
+    view_end = buffer->get<const u8>() + buffer->size();
+}
+
+void MemoryByteStream::resize_buffer(const uoff_t new_size)
+{
+    // clones share the buffer and read it through their views, so rather
+    // than moving or truncating the data under them, detach from them
+    if (buffer.use_count() > 1
+        && (new_size < buffer->size() || new_size > buffer->capacity()))
+    {
+        buffer = std::make_shared<bstr>(*buffer);
+    }
+    buffer->resize(new_size);
+}
+
 io::BaseByteStream &MemoryByteStream::reserve(const uoff_t size)
 {
     if (buffer->size() < size)
-        buffer->resize(size);
+    {
+        const auto old_pos = pos();
+        resize_buffer(size);
+        update_view(old_pos);
+    }
     return *this;
 }
 
@@ -67,33 +92,33 @@ void MemoryByteStream::seek_impl(const uoff_t offset)
 {
     if (offset > buffer->size())
         throw err::EofError();
-    buffer_pos = offset;
+    update_view(offset);
 }
 
 void MemoryByteStream::read_impl(void *destination, const size_t size)
 {
-    // destination MUST exist and size MUST be at least 1
-    if (buffer_pos + size > buffer->size())
+    // reached only when the view is too short, which might be because
+    // a clone has grown the buffer since
+    const auto old_pos = pos();
+    if (old_pos + size > buffer->size())
         throw err::EofError();
-    auto source_ptr = buffer->get<const u8>() + buffer_pos;
-    auto destination_ptr = reinterpret_cast<u8*>(destination);
-    buffer_pos += size;
-    std::memcpy(destination_ptr, source_ptr, size);
+    std::memcpy(destination, buffer->get<const u8>() + old_pos, size);
+    update_view(old_pos + size);
 }
 
 void MemoryByteStream::write_impl(const void *source, size_t size)
 {
     // source MUST exist and size MUST be at least 1
-    reserve(buffer_pos + size);
-    auto source_ptr = reinterpret_cast<const u8*>(source);
-    auto destination_ptr = buffer->get<u8>() + buffer_pos;
-    buffer_pos += size;
-    std::memcpy(destination_ptr, source_ptr, size);
+    const auto old_pos = pos();
+    if (old_pos + size > buffer->size())
+        resize_buffer(old_pos + size);
+    std::memcpy(buffer->get<u8>() + old_pos, source, size);
+    update_view(old_pos + size);
 }
 
 uoff_t MemoryByteStream::pos() const
 {
-    return buffer_pos;
+    return view_ptr - buffer->get<const u8>();
 }
 
 uoff_t MemoryByteStream::size() const
@@ -103,9 +128,9 @@ uoff_t MemoryByteStream::size() const
 
 void MemoryByteStream::resize_impl(const uoff_t new_size)
 {
-    buffer->resize(new_size);
-    if (buffer_pos > new_size)
-        buffer_pos = new_size;
+    const auto old_pos = pos();
+    resize_buffer(new_size);
+    update_view(std::min<uoff_t>(old_pos, new_size));
 }
 
 std::unique_ptr<io::BaseByteStream> MemoryByteStream::clone() const
@@ -33,6 +33,8 @@ namespace io {
         MemoryByteStream(const bstr &buffer);
         MemoryByteStream(BaseByteStream &other_stream, const size_t size);
         MemoryByteStream(BaseByteStream &other_stream);
+        // shares the buffer instead of copying it
+        MemoryByteStream(const std::shared_ptr<bstr> buffer);
         ~MemoryByteStream();
 
         uoff_t size() const override;
@@ -49,10 +51,10 @@ namespace io {
         void resize_impl(const uoff_t new_size) override;
 
     private:
-        MemoryByteStream(const std::shared_ptr<bstr> buffer);
+        void resize_buffer(const uoff_t new_size);
+        void update_view(const uoff_t new_pos);
 
         std::shared_ptr<bstr> buffer;
-        uoff_t buffer_pos;
     };
 
 } }
@@ -0,0 +1,205 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "io/mmap_byte_stream.h"
+#include <limits>
+#include "err.h"
+
+#if _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+using namespace au;
+using namespace au::io;
+
+struct MmapByteStream::Mapping final
+{
+    Mapping(const path &path);
+    ~Mapping();
+
+    const u8 *data;
+    uoff_t size;
+
+    #if _WIN32
+        HANDLE file_handle;
+        HANDLE mapping_handle;
+    #endif
+};
+
+#if _WIN32
+    MmapByteStream::Mapping::Mapping(const path &path) :
+        data(nullptr), size(0), mapping_handle(nullptr)
+    {
+        file_handle = CreateFileW(
+            path.wstr().c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL,
+            nullptr);
+        if (file_handle == INVALID_HANDLE_VALUE)
+            throw err::FileNotFoundError("Could not open " + path.str());
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file_handle, &file_size))
+        {
+            CloseHandle(file_handle);
+            throw err::IoError("Could not stat " + path.str());
+        }
+        // a view that the address space can't hold is left to
+        // FileByteStream
+        if (static_cast<u64>(file_size.QuadPart)
+            > std::numeric_limits<size_t>::max())
+        {
+            CloseHandle(file_handle);
+            throw err::IoError("Too large to map " + path.str());
+        }
+        size = file_size.QuadPart;
+        if (!size)
+            return;
+
+        mapping_handle = CreateFileMappingW(
+            file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_handle)
+        {
+            data = reinterpret_cast<const u8*>(
+                MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (!data)
+        {
+            if (mapping_handle)
+                CloseHandle(mapping_handle);
+            CloseHandle(file_handle);
+            throw err::IoError("Could not map " + path.str());
+        }
+    }
+
+    MmapByteStream::Mapping::~Mapping()
+    {
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping_handle)
+            CloseHandle(mapping_handle);
+        CloseHandle(file_handle);
+    }
+#else
+    MmapByteStream::Mapping::Mapping(const path &path) : data(nullptr), size(0)
+    {
+        const auto fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1)
+            throw err::FileNotFoundError("Could not open " + path.str());
+
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode))
+        {
+            close(fd);
+            throw err::IoError("Could not stat " + path.str());
+        }
+        // a view that the address space can't hold is left to
+        // FileByteStream
+        if (static_cast<u64>(file_stat.st_size)
+            > std::numeric_limits<size_t>::max())
+        {
+            close(fd);
+            throw err::IoError("Too large to map " + path.str());
+        }
+        size = file_stat.st_size;
+        if (!size)
+        {
+            close(fd);
+            return;
+        }
+
+        // the mapping outlives the descriptor
+        const auto ret = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (ret == MAP_FAILED)
+            throw err::IoError("Could not map " + path.str());
+        data = reinterpret_cast<const u8*>(ret);
+    }
+
+    MmapByteStream::Mapping::~Mapping()
+    {
+        if (data)
+            munmap(const_cast<u8*>(data), size);
+    }
+#endif
+
+MmapByteStream::MmapByteStream(const std::shared_ptr<const Mapping> mapping)
+    : mapping(mapping)
+{
+    has_view = true;
+    view_ptr = mapping->data;
+    view_end = mapping->data + mapping->size;
+}
+
+MmapByteStream::MmapByteStream(const path &path)
+    : MmapByteStream(std::make_shared<const Mapping>(path))
+{
+}
+
+MmapByteStream::~MmapByteStream()
+{
+}
+
+void MmapByteStream::seek_impl(const uoff_t offset)
+{
+    if (offset > mapping->size)
+        throw err::EofError();
+    view_ptr = mapping->data + offset;
+}
+
+void MmapByteStream::read_impl(void *destination, const size_t size)
+{
+    // reads that fit are served from the view, so this is past the end
+    throw err::EofError();
+}
+
+void MmapByteStream::write_impl(const void *source, const size_t size)
+{
+    throw err::NotSupportedError("Writing to mapped files is not supported");
+}
+
+uoff_t MmapByteStream::pos() const
+{
+    return view_ptr - mapping->data;
+}
+
+uoff_t MmapByteStream::size() const
+{
+    return mapping->size;
+}
+
+void MmapByteStream::resize_impl(const uoff_t new_size)
+{
+    if (new_size == size())
+        return;
+    throw err::NotSupportedError("Resizing mapped files is not supported");
+}
+
+std::unique_ptr<io::BaseByteStream> MmapByteStream::clone() const
+{
+    auto ret = std::unique_ptr<MmapByteStream>(new MmapByteStream(mapping));
+    ret->seek(pos());
+    return std::move(ret);
+}
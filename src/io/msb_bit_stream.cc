@@ -16,6 +16,7 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "io/msb_bit_stream.h"
+#include "err.h"
 
 using namespace au;
 using namespace au::io;
@@ -46,16 +47,40 @@ void MsbBitStream::flush()
 
 u32 MsbBitStream::read(const size_t bits)
 {
+    if (bits_available < bits)
+        refill(bits);
+    const auto mask = (1ull << bits) - 1;
+    bits_available -= bits;
+    position += bits;
+    return (buffer >> bits_available) & mask;
+}
+
+void MsbBitStream::refill(const size_t bits)
+{
+    // bits_available < bits <= 32, so a whole word always fits in
+    if (data_end - data_ptr >= 4)
+    {
+        buffer = (buffer << 32)
+            | (static_cast<u32>(data_ptr[0]) << 24)
+            | (static_cast<u32>(data_ptr[1]) << 16)
+            | (static_cast<u32>(data_ptr[2]) << 8)
+            | data_ptr[3];
+        data_ptr += 4;
+        bits_available += 32;
+        return;
+    }
     while (bits_available < bits)
     {
-        const auto tmp = input_stream->read<u8>();
+        u8 tmp;
+        if (!own_data)
+            tmp = input_stream->read<u8>();
+        else if (data_ptr < data_end)
+            tmp = *data_ptr++;
+        else
+            throw err::EofError();
         buffer = (buffer << 8) | tmp;
         bits_available += 8;
     }
-    const auto mask = (1ull << bits) - 1;
-    bits_available -= bits;
-    position += bits;
-    return (buffer >> bits_available) & mask;
 }
 
 void MsbBitStream::write(const size_t bits, const u32 value)
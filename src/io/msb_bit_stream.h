@@ -33,6 +33,8 @@ namespace io {
         void flush() override;
         void write(const size_t bits, const u32 value) override;
     private:
+        void refill(const size_t bits);
+
         bool dirty;
     };
 
@@ -16,7 +16,6 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "io/slice_byte_stream.h"
-#include <cstring>
 
 using namespace au;
 using namespace au::io;
@@ -36,8 +35,19 @@ SliceByteStream::SliceByteStream(
         slice_offset(slice_offset),
         slice_size(slice_size)
 {
-    if (slice_size > parent_stream.size() - slice_offset)
+    if (slice_offset > parent_stream.size()
+        || slice_size > parent_stream.size() - slice_offset)
+    {
         throw err::BadDataSizeError();
+    }
+    this->parent_stream->seek(slice_offset);
+    slice_data = this->parent_stream->read_view(slice_size);
+    if (slice_data)
+    {
+        has_view = true;
+        view_ptr = slice_data;
+        view_end = slice_data + slice_size;
+    }
 }
 
 SliceByteStream::~SliceByteStream()
@@ -46,13 +56,20 @@ SliceByteStream::~SliceByteStream()
 
 void SliceByteStream::seek_impl(const uoff_t offset)
 {
-    parent_stream->seek(slice_offset + offset);
+    if (offset > slice_size)
+        throw err::EofError();
+    if (slice_data)
+        view_ptr = slice_data + offset;
+    else
+        parent_stream->seek(slice_offset + offset);
 }
 
 void SliceByteStream::read_impl(void *destination, const size_t size)
 {
-    const auto chunk = parent_stream->read(size);
-    std::memcpy(destination, chunk.get<u8>(), size);
+    // with a view, reads that fit never get here
+    if (slice_data || pos() + size > slice_size)
+        throw err::EofError();
+    parent_stream->read(destination, size);
 }
 
 void SliceByteStream::write_impl(const void *source, const size_t size)
@@ -62,6 +79,8 @@ void SliceByteStream::write_impl(const void *source, const size_t size)
 
 uoff_t SliceByteStream::pos() const
 {
+    if (slice_data)
+        return view_ptr - slice_data;
     return parent_stream->pos() - slice_offset;
 }
 
@@ -24,6 +24,9 @@
 namespace au {
 namespace io {
 
+    // Slices of streams with contiguous data (see BaseByteStream::read_view)
+    // read straight from the parent's memory; the others go through the
+    // parent stream.
     class SliceByteStream final : public BaseByteStream
     {
     public:
@@ -48,6 +51,7 @@ namespace io {
         std::unique_ptr<io::BaseByteStream> parent_stream;
         const uoff_t slice_offset;
         const uoff_t slice_size;
+        const u8 *slice_data;
     };
 
 } }
@@ -16,30 +16,225 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstdarg>
 #include <iostream>
 #include <mutex>
+#include <thread>
+#include <vector>
 #include "algo/format.h"
 #include "algo/str.h"
+#include "types.h"
 
 using namespace au;
 
-static std::mutex mutex;
+namespace
+{
+    struct LogRecord final
+    {
+        u64 sequence;
+        std::ostream *stream; // nullptr for plain color changes
+        Logger::Color color;
+        std::string prefix;
+        std::string text;
+    };
+
+    // Each thread appends to its own buffer, so the producers never wait
+    // on one another nor on the console; the lock is only ever shared with
+    // the writer thread when it swaps the buffer out.
+    struct ThreadBuffer final
+    {
+        std::mutex mutex;
+        std::vector<LogRecord> records;
+    };
+
+    class LogWriter final
+    {
+    public:
+        LogWriter(void (*write_color)(const Logger::Color));
+        ~LogWriter();
+
+        void push(std::vector<LogRecord> &records);
+
+        // writes everything pushed so far before returning
+        void flush();
+
+    private:
+        ThreadBuffer &get_thread_buffer();
+        void drain();
+        void work();
+
+        void (*write_color)(const Logger::Color);
+        std::atomic<u64> sequence;
+
+        std::mutex buffers_mutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+        std::mutex write_mutex;
+        std::vector<LogRecord> records_to_write;
+
+        std::mutex wake_mutex;
+        std::condition_variable wake_cv;
+        bool has_records;
+        bool stopping;
+        std::thread thread;
+    };
+}
+
+LogWriter::LogWriter(void (*write_color)(const Logger::Color)) :
+    write_color(write_color),
+    sequence(0),
+    has_records(false),
+    stopping(false),
+    thread([this]() { work(); })
+{
+}
+
+LogWriter::~LogWriter()
+{
+    {
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        stopping = true;
+    }
+    wake_cv.notify_one();
+    thread.join();
+    drain();
+}
+
+ThreadBuffer &LogWriter::get_thread_buffer()
+{
+    // a single writer lives for the whole program, so the thread local
+    // doesn't need to remember which writer it belongs to
+    static thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if (!buffer)
+    {
+        buffer = std::make_shared<ThreadBuffer>();
+        std::unique_lock<std::mutex> lock(buffers_mutex);
+        buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+void LogWriter::push(std::vector<LogRecord> &records)
+{
+    auto &buffer = get_thread_buffer();
+    {
+        // the whole range is reserved at once, so that the records of a
+        // batch stay together when the writer sorts them
+        auto next_sequence = sequence.fetch_add(records.size());
+        std::unique_lock<std::mutex> lock(buffer.mutex);
+        for (auto &record : records)
+        {
+            record.sequence = next_sequence++;
+            buffer.records.push_back(std::move(record));
+        }
+    }
+    records.clear();
+    {
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        if (has_records)
+            return;
+        has_records = true;
+    }
+    wake_cv.notify_one();
+}
+
+void LogWriter::flush()
+{
+    drain();
+}
+
+void LogWriter::drain()
+{
+    std::unique_lock<std::mutex> write_lock(write_mutex);
+    {
+        std::unique_lock<std::mutex> lock(buffers_mutex);
+        for (auto &buffer : buffers)
+        {
+            std::unique_lock<std::mutex> buffer_lock(buffer->mutex);
+            for (auto &record : buffer->records)
+                records_to_write.push_back(std::move(record));
+            buffer->records.clear();
+        }
+
+        // forget the buffers of finished threads
+        buffers.erase(
+            std::remove_if(
+                buffers.begin(),
+                buffers.end(),
+                [](const std::shared_ptr<ThreadBuffer> &buffer)
+                {
+                    return buffer.use_count() == 1;
+                }),
+            buffers.end());
+    }
+
+    std::sort(
+        records_to_write.begin(),
+        records_to_write.end(),
+        [](const LogRecord &a, const LogRecord &b)
+        {
+            return a.sequence < b.sequence;
+        });
+
+    for (const auto &record : records_to_write)
+    {
+        if (!record.stream)
+        {
+            write_color(record.color);
+            continue;
+        }
+        (*record.stream) << record.prefix;
+        if (record.color != Logger::Color::Original)
+            write_color(record.color);
+        (*record.stream) << record.text;
+        if (record.color != Logger::Color::Original)
+            write_color(Logger::Color::Original);
+    }
+    records_to_write.clear();
+    std::cout.flush();
+}
+
+void LogWriter::work()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake_cv.wait(lock, [&]() { return stopping || has_records; });
+            if (stopping)
+                break;
+            // cleared before draining, so that records pushed meanwhile
+            // wake the writer up again
+            has_records = false;
+        }
+        drain();
+    }
+}
 
 struct Logger::Priv final
 {
-    Priv(Logger &logger);
+    Priv();
     void log(
-        const MessageType type, const std::string fmt, std::va_list args) const;
+        const MessageType type, const std::string fmt, std::va_list args);
+    void push(std::vector<LogRecord> &records);
+    void flush();
+
+    static LogWriter &get_writer();
 
-    Logger &logger;
     Color colors[6];
     int muted = 0;
     bool colors_enabled = true;
+    bool batching = false;
     std::string prefix;
+
+    std::mutex pending_records_mutex;
+    std::vector<LogRecord> pending_records;
 };
 
-Logger::Priv::Priv(Logger &logger) : logger(logger)
+Logger::Priv::Priv()
 {
     colors[MessageType::Summary] = Color::Original;
     colors[MessageType::Info] = Color::Original;
@@ -49,41 +244,77 @@ Logger::Priv::Priv(Logger &logger) : logger(logger)
     colors[MessageType::Debug] = Color::Cyan;
 }
 
+LogWriter &Logger::Priv::get_writer()
+{
+    static LogWriter writer(&Logger::write_color);
+    return writer;
+}
+
 void Logger::Priv::log(
-    const MessageType type, const std::string fmt, std::va_list args) const
+    const MessageType type, const std::string fmt, std::va_list args)
 {
-    std::unique_lock<std::mutex> lock(mutex);
+    // checked before formatting, so that muted messages cost nothing
     if (muted & (1 << type))
         return;
     auto *out = &std::cout;
     if (type == MessageType::Warning || type == MessageType::Error)
         out = &std::cerr;
+    const auto color = colors_enabled ? colors[type] : Color::Original;
     const auto output = algo::format(fmt, args);
+    std::vector<LogRecord> records;
     for (const auto line : algo::split(output, '\n', true))
+        records.push_back({0, out, color, prefix, line});
+    push(records);
+}
+
+void Logger::Priv::push(std::vector<LogRecord> &records)
+{
+    if (!batching)
     {
-        (*out) << prefix;
-        if (colors_enabled && colors[type] != Color::Original)
-            logger.set_color(colors[type]);
-        (*out) << line;
-        if (colors_enabled && colors[type] != Color::Original)
-            logger.set_color(Color::Original);
+        get_writer().push(records);
+        return;
     }
+    std::unique_lock<std::mutex> lock(pending_records_mutex);
+    for (auto &record : records)
+        pending_records.push_back(std::move(record));
 }
 
-Logger::Logger(const Logger &other_logger) : p(new Priv(*this))
+void Logger::Priv::flush()
+{
+    std::unique_lock<std::mutex> lock(pending_records_mutex);
+    if (!pending_records.empty())
+        get_writer().push(pending_records);
+}
+
+Logger::Logger(const Logger &other_logger) : p(new Priv())
 {
     p->muted = other_logger.p->muted;
     p->colors_enabled = other_logger.p->colors_enabled;
     p->prefix = other_logger.p->prefix;
+    p->batching = other_logger.p->batching;
 }
 
-Logger::Logger() : p(new Priv(*this))
+Logger::Logger() : p(new Priv())
 {
     unmute();
 }
 
 Logger::~Logger()
 {
+    p->flush();
+}
+
+void Logger::set_batching(const bool enabled)
+{
+    p->batching = enabled;
+    if (!enabled)
+        p->flush();
+}
+
+void Logger::set_color(const Color c)
+{
+    std::vector<LogRecord> records = {{0, nullptr, c, "", ""}};
+    p->push(records);
 }
 
 void Logger::set_prefix(const std::string &prefix)
@@ -142,8 +373,13 @@ void Logger::debug(const std::string fmt, ...) const
 
 void Logger::flush() const
 {
-    std::cout.flush();
-    // stderr should be nonbuffered
+    p->flush();
+}
+
+void Logger::flush_and_wait() const
+{
+    p->flush();
+    Priv::get_writer().flush();
 }
 
 void Logger::mute()
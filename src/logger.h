@@ -61,6 +61,13 @@ namespace au {
         Logger(const Logger &other_logger);
         ~Logger();
 
+        // The messages are written asynchronously by a background thread.
+        // In batch mode, the messages of this logger are additionally held
+        // back until flush() and then written all at once. flush() only
+        // hands them over to the writer; flush_and_wait() also returns once
+        // everything logged so far has been written, e.g. before exiting.
+        void set_batching(const bool enabled);
+
         void set_color(const Color c);
         void set_prefix(const std::string &prefix);
         void log(const MessageType type, const std::string fmt, ...) const;
@@ -70,6 +77,7 @@ namespace au {
         void err(const std::string str, ...) const;
         void debug(const std::string str, ...) const;
         void flush() const;
+        void flush_and_wait() const;
 
         void mute();
         void unmute();
@@ -81,6 +89,8 @@ namespace au {
         void enable_colors();
 
     private:
+        static void write_color(const Color c);
+
         struct Priv;
         std::unique_ptr<Priv> p;
     };
@@ -19,6 +19,6 @@
 
 using namespace au;
 
-void Logger::set_color(const Color c)
+void Logger::write_color(const Color c)
 {
 }
@@ -29,11 +29,14 @@ ENTRY_POINT(
         io::set_program_path_from_arg(arguments[0]);
         arguments.erase(arguments.begin());
         flow::CliFacade cli_facade(logger, arguments);
-        return cli_facade.run();
+        const auto result = cli_facade.run();
+        logger.flush_and_wait();
+        return result;
     }
     catch (const std::exception &e)
     {
         logger.err("Error: " + std::string(e.what()) + "\n");
+        logger.flush_and_wait();
         return 1;
     }
 )
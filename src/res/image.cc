@@ -17,8 +17,10 @@
 
 #include "res/image.h"
 #include <algorithm>
+#include <cstring>
 #include "algo/format.h"
 #include "algo/range.h"
+#include "algo/simd.h"
 #include "err.h"
 
 using namespace au;
@@ -82,24 +84,26 @@ Image::Image(
 
 Image &Image::invert()
 {
-    for (const auto y : algo::range(_height))
-    for (const auto x : algo::range(_width))
+    for (auto &c : content)
     {
-        at(x, y).r ^= 0xFF;
-        at(x, y).g ^= 0xFF;
-        at(x, y).b ^= 0xFF;
+        c.r ^= 0xFF;
+        c.g ^= 0xFF;
+        c.b ^= 0xFF;
     }
     return *this;
 }
 
 Image &Image::flip_vertically()
 {
+    std::vector<Pixel> row(_width);
+    const auto row_size = _width * sizeof(Pixel);
     for (const auto y : algo::range(_height >> 1))
-    for (const auto x : algo::range(_width))
     {
-        const auto t = at(x, _height - 1 - y);
-        at(x, _height - 1 - y) = at(x, y);
-        at(x, y) = t;
+        auto row1 = &content[y * _width];
+        auto row2 = &content[(_height - 1 - y) * _width];
+        std::memcpy(row.data(), row1, row_size);
+        std::memcpy(row1, row2, row_size);
+        std::memcpy(row2, row.data(), row_size);
     }
     return *this;
 }
@@ -107,45 +111,112 @@ Image &Image::flip_vertically()
 Image &Image::flip_horizontally()
 {
     for (const auto y : algo::range(_height))
-    for (const auto x : algo::range(_width >> 1))
     {
-        const auto t = at(_width - 1 - x, y);
-        at(_width - 1 - x, y) = at(x, y);
-        at(x, y) = t;
+        const auto row = content.begin() + y * _width;
+        std::reverse(row, row + _width);
     }
     return *this;
 }
 
+// Changes the width of every row in place, moving the columns starting at
+// source_x to target_x and making the remaining ones transparent. Growing
+// rows are moved from the last one so that they don't overwrite the rows not
+// moved yet, shrinking ones from the first one.
+static void reshape_columns(
+    std::vector<Pixel> &content,
+    const size_t height,
+    const size_t old_width,
+    const size_t new_width,
+    const size_t source_x,
+    const size_t target_x)
+{
+    const auto count = std::min(old_width - source_x, new_width - target_x);
+    const auto move_row = [&](const size_t y)
+    {
+        const auto row = &content[y * new_width];
+        std::memmove(
+            row + target_x,
+            &content[y * old_width + source_x],
+            count * sizeof(Pixel));
+        std::fill(row, row + target_x, transparent_pixel);
+        std::fill(row + target_x + count, row + new_width, transparent_pixel);
+    };
+
+    if (new_width > old_width)
+    {
+        content.resize(height * new_width);
+        for (auto y = height; y-- > 0; )
+            move_row(y);
+    }
+    else
+    {
+        for (const auto y : algo::range(height))
+            move_row(y);
+        content.resize(height * new_width);
+    }
+}
+
+// Same as above, for whole rows, which are contiguous and can be moved at once.
+static void reshape_rows(
+    std::vector<Pixel> &content,
+    const size_t width,
+    const size_t old_height,
+    const size_t new_height,
+    const size_t source_y,
+    const size_t target_y)
+{
+    const auto count = std::min(old_height - source_y, new_height - target_y);
+    if (new_height > old_height)
+        content.resize(width * new_height);
+    std::memmove(
+        &content[target_y * width],
+        &content[source_y * width],
+        count * width * sizeof(Pixel));
+    std::fill(
+        content.begin(),
+        content.begin() + target_y * width,
+        transparent_pixel);
+    std::fill(
+        content.begin() + (target_y + count) * width,
+        content.begin() + new_height * width,
+        transparent_pixel);
+    if (new_height < old_height)
+        content.resize(width * new_height);
+}
+
 Image &Image::offset(const int x_offset, const int y_offset)
 {
-    res::Image old_image(*this);
-    crop(_width + x_offset, _height + y_offset);
-    for (auto &c : content)
-        c = transparent_pixel;
-    return overlay(old_image, x_offset, y_offset, OverlayKind::OverwriteAll);
+    const auto new_width = static_cast<int>(_width) + x_offset;
+    const auto new_height = static_cast<int>(_height) + y_offset;
+    if (new_width <= 0 || new_height <= 0)
+        throw err::BadDataSizeError();
+    reshape_columns(
+        content,
+        _height,
+        _width,
+        new_width,
+        std::max(0, -x_offset),
+        std::max(0, x_offset));
+    _width = new_width;
+    reshape_rows(
+        content,
+        _width,
+        _height,
+        new_height,
+        std::max(0, -y_offset),
+        std::max(0, y_offset));
+    _height = new_height;
+    return *this;
 }
 
 Image &Image::crop(const size_t new_width, const size_t new_height)
 {
-    std::vector<Pixel> old_content(content.begin(), content.end());
     if (!new_width || !new_height)
         throw err::BadDataSizeError();
-    const auto old_width = _width;
-    const auto old_height = _height;
+    reshape_columns(content, _height, _width, new_width, 0, 0);
     _width = new_width;
+    reshape_rows(content, _width, _height, new_height, 0, 0);
     _height = new_height;
-    content.resize(new_width * new_height);
-    for (const auto y : algo::range(std::min(old_height, new_height)))
-    for (const auto x : algo::range(std::min(old_width, new_width)))
-    {
-        content[y * new_width + x] = old_content[y * old_width + x];
-    }
-    for (const auto y : algo::range(old_height, new_height))
-    for (const auto x : algo::range(new_width))
-        content[y * new_width + x] = transparent_pixel;
-    for (const auto y : algo::range(old_height))
-    for (const auto x : algo::range(old_width, new_width))
-        content[y * new_width + x] = transparent_pixel;
     return *this;
 }
 
@@ -153,25 +224,195 @@ Image &Image::apply_mask(const Image &other)
 {
     if (other.width() != _width || other.height() != _height)
         throw std::logic_error("Mask image size is different from image size");
-    for (const auto y : algo::range(_height))
-    for (const auto x : algo::range(_width))
-        at(x, y).a = other.at(x, y).r;
+    for (const auto i : algo::range(content.size()))
+        content[i].a = other.content[i].r;
     return *this;
 }
 
 Image &Image::apply_palette(const Palette &palette)
 {
+    // look up both the color and what to keep from the original pixel, so
+    // that indices outside of the palette (which only lose their alpha)
+    // don't need a branch
+    u32 colors[0x100];
+    u32 keep_masks[0x100];
     const auto palette_size = palette.size();
-    for (auto &c : content)
+    for (const auto i : algo::range(0x100))
     {
-        if (c.r < palette_size)
-            c = palette[c.r];
+        if (static_cast<size_t>(i) < palette_size)
+        {
+            std::memcpy(&colors[i], &palette[i], 4);
+            keep_masks[i] = 0;
+        }
         else
-            c.a = 0;
+        {
+            colors[i] = 0;
+            keep_masks[i] = 0x00FFFFFF;
+        }
+    }
+
+    auto pixel_ptr = reinterpret_cast<u32*>(content.data());
+    const auto pixel_end = pixel_ptr + content.size();
+    while (pixel_ptr < pixel_end)
+    {
+        const auto index = (*pixel_ptr >> 16) & 0xFF;
+        *pixel_ptr = colors[index] | (*pixel_ptr & keep_masks[index]);
+        pixel_ptr++;
     }
     return *this;
 }
 
+// Row kernels for overlay(). They operate on whole BGRA dwords, so they rely
+// on the layout of Pixel and on the machine being little endian.
+
+static const u32 alpha_mask = 0xFF000000;
+
+static inline u32 div_255(const u32 x)
+{
+    return (x + 128 + ((x + 128) >> 8)) >> 8;
+}
+
+static inline u32 blend_alpha_over(const u32 source, const u32 target)
+{
+    const auto source_alpha = source >> 24;
+    const auto target_alpha = target >> 24;
+    if (source_alpha == 0xFF || !target_alpha)
+        return source_alpha ? source : target;
+    if (!source_alpha)
+        return target;
+
+    // composite the premultiplied colors, then divide the result back by
+    // its alpha; everything is scaled by 255 to keep the precision
+    const auto inverse_alpha = 0xFF - source_alpha;
+    const auto result_alpha
+        = source_alpha + div_255(target_alpha * inverse_alpha);
+    const auto divisor = result_alpha * 0xFF;
+    u32 result = result_alpha << 24;
+    for (const auto shift : {0, 8, 16})
+    {
+        const auto source_color = (source >> shift) & 0xFF;
+        const auto target_color = (target >> shift) & 0xFF;
+        const auto value
+            = source_color * source_alpha * 0xFF
+            + target_color * target_alpha * inverse_alpha;
+        result |= ((value + divisor / 2) / divisor) << shift;
+    }
+    return result;
+}
+
+#ifdef AU_USE_SSE2
+// Blends two pixels held in 16-bit lanes over an opaque background. For an
+// opaque target the generic formula reduces to a single division by 255.
+static inline __m128i blend_alpha_over_opaque(
+    const __m128i source, const __m128i target)
+{
+    const auto max = _mm_set1_epi16(0xFF);
+    const auto source_alpha = _mm_shufflehi_epi16(
+        _mm_shufflelo_epi16(source, _MM_SHUFFLE(3, 3, 3, 3)),
+        _MM_SHUFFLE(3, 3, 3, 3));
+    auto value = _mm_add_epi16(
+        _mm_mullo_epi16(source, source_alpha),
+        _mm_mullo_epi16(target, _mm_sub_epi16(max, source_alpha)));
+    value = _mm_add_epi16(value, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+}
+#endif
+
+static void overlay_row_non_transparent(
+    const u32 *source_ptr, u32 *target_ptr, size_t count)
+{
+#ifdef AU_USE_SSE2
+    const auto zero = _mm_setzero_si128();
+    const auto alpha = _mm_set1_epi32(alpha_mask);
+    for (; count >= 4; count -= 4)
+    {
+        const auto source = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(source_ptr));
+        const auto target = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(target_ptr));
+        const auto transparent
+            = _mm_cmpeq_epi32(_mm_and_si128(source, alpha), zero);
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(target_ptr),
+            _mm_or_si128(
+                _mm_and_si128(transparent, target),
+                _mm_andnot_si128(transparent, source)));
+        source_ptr += 4;
+        target_ptr += 4;
+    }
+#endif
+    for (; count; count--, source_ptr++, target_ptr++)
+        if (*source_ptr & alpha_mask)
+            *target_ptr = *source_ptr;
+}
+
+static void overlay_row_add_simple(
+    const u32 *source_ptr, u32 *target_ptr, size_t count)
+{
+#ifdef AU_USE_SSE2
+    const auto color = _mm_set1_epi32(~alpha_mask);
+    for (; count >= 4; count -= 4)
+    {
+        const auto source = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(source_ptr));
+        const auto target = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(target_ptr));
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(target_ptr),
+            _mm_add_epi8(target, _mm_and_si128(source, color)));
+        source_ptr += 4;
+        target_ptr += 4;
+    }
+#endif
+    for (; count; count--, source_ptr++, target_ptr++)
+    {
+        auto source = reinterpret_cast<const Pixel*>(source_ptr);
+        auto target = reinterpret_cast<Pixel*>(target_ptr);
+        target->r += source->r;
+        target->g += source->g;
+        target->b += source->b;
+    }
+}
+
+static void overlay_row_alpha_over(
+    const u32 *source_ptr, u32 *target_ptr, size_t count)
+{
+#ifdef AU_USE_SSE2
+    const auto zero = _mm_setzero_si128();
+    const auto alpha = _mm_set1_epi32(alpha_mask);
+    for (; count >= 4; count -= 4)
+    {
+        const auto source = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(source_ptr));
+        const auto target = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(target_ptr));
+        const auto opaque
+            = _mm_cmpeq_epi32(_mm_and_si128(target, alpha), alpha);
+        if (_mm_movemask_epi8(opaque) == 0xFFFF)
+        {
+            const auto lo = blend_alpha_over_opaque(
+                _mm_unpacklo_epi8(source, zero),
+                _mm_unpacklo_epi8(target, zero));
+            const auto hi = blend_alpha_over_opaque(
+                _mm_unpackhi_epi8(source, zero),
+                _mm_unpackhi_epi8(target, zero));
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(target_ptr),
+                _mm_or_si128(_mm_packus_epi16(lo, hi), alpha));
+        }
+        else
+        {
+            for (const auto i : algo::range(4))
+                target_ptr[i] = blend_alpha_over(source_ptr[i], target_ptr[i]);
+        }
+        source_ptr += 4;
+        target_ptr += 4;
+    }
+#endif
+    for (; count; count--, source_ptr++, target_ptr++)
+        *target_ptr = blend_alpha_over(*source_ptr, *target_ptr);
+}
+
 Image &Image::overlay(
     const Image &other,
     const OverlayKind overlay_kind)
@@ -191,37 +432,33 @@ Image &Image::overlay(
     const int y2 = std::min<int>(height(), target_y + other.height());
     const int source_x = -target_x;
     const int source_y = -target_y;
+    if (x1 >= x2 || y1 >= y2)
+        return *this;
+
+    void (*overlay_row)(const u32 *, u32 *, size_t);
     if (overlay_kind == OverlayKind::OverwriteAll)
     {
-        for (const auto y : algo::range(y1, y2))
-        for (const auto x : algo::range(x1, x2))
-            at(x, y) = other.at(source_x + x, source_y + y);
-    }
-    else if (overlay_kind == OverlayKind::OverwriteNonTransparent)
-    {
-        for (const auto y : algo::range(y1, y2))
-        for (const auto x : algo::range(x1, x2))
+        overlay_row = [](const u32 *source_ptr, u32 *target_ptr, size_t count)
         {
-            const auto &source_pixel = other.at(source_x + x, source_y + y);
-            if (source_pixel.a)
-                at(x, y) = source_pixel;
-        }
+            std::memcpy(target_ptr, source_ptr, count * sizeof(u32));
+        };
     }
+    else if (overlay_kind == OverlayKind::OverwriteNonTransparent)
+        overlay_row = overlay_row_non_transparent;
     else if (overlay_kind == OverlayKind::AddSimple)
-    {
-        for (const auto y : algo::range(y1, y2))
-        for (const auto x : algo::range(x1, x2))
-        {
-            auto &target_pixel = at(x, y);
-            const auto &source_pixel = other.at(source_x + x, source_y + y);
-            target_pixel.r += source_pixel.r;
-            target_pixel.g += source_pixel.g;
-            target_pixel.b += source_pixel.b;
-        }
-    }
+        overlay_row = overlay_row_add_simple;
+    else if (overlay_kind == OverlayKind::AlphaOver)
+        overlay_row = overlay_row_alpha_over;
     else
-    {
         throw std::logic_error("Unknown overlay kind");
+
+    for (const auto y : algo::range(y1, y2))
+    {
+        overlay_row(
+            reinterpret_cast<const u32*>(
+                &other.at(source_x + x1, source_y + y)),
+            reinterpret_cast<u32*>(&at(x1, y)),
+            x2 - x1);
     }
     return *this;
 }
@@ -35,6 +35,11 @@ namespace res {
             OverwriteAll,
             OverwriteNonTransparent,
             AddSimple,
+
+            // Porter-Duff "over" for non-premultiplied pixels: the colors
+            // are premultiplied by their alpha for compositing and divided
+            // back afterwards
+            AlphaOver,
         };
 
         Image(const Image &other);
@@ -19,6 +19,7 @@
 #include <cstring>
 #include "algo/format.h"
 #include "algo/range.h"
+#include "algo/simd.h"
 
 namespace au {
 namespace res {
@@ -255,47 +256,286 @@ namespace res {
         return c;
     }
 
-    void read_pixels(
-        const u8 *input_ptr, std::vector<Pixel> &output, const PixelFormat fmt)
+    namespace
+    {
+        // A channel of a 16-bit format: the field selected by the mask is
+        // moved to the top of its byte within the output BGRA dword.
+        struct PackedField final
+        {
+            u32 mask;
+            int shift_left;
+            int shift_right;
+        };
+
+        struct PackedFormat final
+        {
+            PackedField fields[4];
+            u32 alpha_or;
+            u32 alpha_xor;
+            bool alpha_bit;
+        };
+
+        struct WideFormat final
+        {
+            bool swap_red_blue;
+            u32 alpha_or;
+            u32 alpha_xor;
+        };
+    }
+
+    static const u32 alpha_mask = 0xFF000000;
+    static const PackedField no_field = {0, 0, 0};
+
+    static const PackedFormat bgr555x = {
+        {{0x001F, 3, 0}, {0x03E0, 6, 0}, {0x7C00, 9, 0}, no_field},
+        alpha_mask, 0, false};
+    static const PackedFormat bgr565 = {
+        {{0x001F, 3, 0}, {0x07E0, 5, 0}, {0xF800, 8, 0}, no_field},
+        alpha_mask, 0, false};
+    static const PackedFormat bgra4444 = {
+        {{0x000F, 4, 0}, {0x00F0, 8, 0}, {0x0F00, 12, 0}, {0xF000, 16, 0}},
+        0, 0, false};
+    static const PackedFormat bgra5551 = {
+        {{0x001F, 3, 0}, {0x03E0, 6, 0}, {0x7C00, 9, 0}, no_field},
+        0, 0, true};
+    static const PackedFormat bgrna4444 = {
+        {{0x000F, 4, 0}, {0x00F0, 8, 0}, {0x0F00, 12, 0}, {0xF000, 16, 0}},
+        0, alpha_mask, false};
+    static const PackedFormat bgrna5551 = {
+        {{0x001F, 3, 0}, {0x03E0, 6, 0}, {0x7C00, 9, 0}, no_field},
+        0, alpha_mask, true};
+    static const PackedFormat rgb555x = {
+        {{0x001F, 19, 0}, {0x03E0, 6, 0}, {0x7C00, 0, 7}, no_field},
+        alpha_mask, 0, false};
+    static const PackedFormat rgb565 = {
+        {{0x001F, 19, 0}, {0x07E0, 5, 0}, {0xF800, 0, 8}, no_field},
+        alpha_mask, 0, false};
+    static const PackedFormat rgba4444 = {
+        {{0x000F, 20, 0}, {0x00F0, 8, 0}, {0x0F00, 0, 4}, {0xF000, 16, 0}},
+        0, 0, false};
+    static const PackedFormat rgba5551 = {
+        {{0x001F, 19, 0}, {0x03E0, 6, 0}, {0x7C00, 0, 7}, no_field},
+        0, 0, true};
+    static const PackedFormat rgbna4444 = {
+        {{0x000F, 20, 0}, {0x00F0, 8, 0}, {0x0F00, 0, 4}, {0xF000, 16, 0}},
+        0, alpha_mask, false};
+    static const PackedFormat rgbna5551 = {
+        {{0x001F, 19, 0}, {0x03E0, 6, 0}, {0x7C00, 0, 7}, no_field},
+        0, alpha_mask, true};
+
+    static const WideFormat bgr888x = {false, alpha_mask, 0};
+    static const WideFormat bgrna8888 = {false, 0, alpha_mask};
+    static const WideFormat rgb888x = {true, alpha_mask, 0};
+    static const WideFormat rgba8888 = {true, 0, 0};
+    static const WideFormat rgbna8888 = {true, 0, alpha_mask};
+
+    static inline u32 convert_packed(const PackedFormat &format, const u32 x)
+    {
+        u32 ret = format.alpha_or;
+        for (const auto &field : format.fields)
+            ret |= ((x & field.mask) << field.shift_left) >> field.shift_right;
+        if (format.alpha_bit && (x & 0x8000))
+            ret |= alpha_mask;
+        return ret ^ format.alpha_xor;
+    }
+
+    static inline u32 convert_wide(const WideFormat &format, u32 x)
+    {
+        if (format.swap_red_blue)
+            x = (x & 0xFF00FF00) | ((x >> 16) & 0xFF) | ((x & 0xFF) << 16);
+        return (x | format.alpha_or) ^ format.alpha_xor;
+    }
+
+#ifdef AU_USE_SSE2
+    static inline __m128i convert_packed(
+        const PackedFormat &format, const __m128i x)
     {
-        // save those precious CPU cycles
-        if (fmt == PixelFormat::BGRA8888)
+        auto ret = _mm_set1_epi32(format.alpha_or);
+        for (const auto &field : format.fields)
         {
-            std::memcpy(output.data(), input_ptr, output.size() * 4);
+            const auto value = _mm_and_si128(x, _mm_set1_epi32(field.mask));
+            ret = _mm_or_si128(ret, _mm_srl_epi32(
+                _mm_sll_epi32(value, _mm_cvtsi32_si128(field.shift_left)),
+                _mm_cvtsi32_si128(field.shift_right)));
+        }
+        if (format.alpha_bit)
+        {
+            ret = _mm_or_si128(ret, _mm_and_si128(
+                _mm_srai_epi32(_mm_slli_epi32(x, 16), 31),
+                _mm_set1_epi32(alpha_mask)));
+        }
+        return _mm_xor_si128(ret, _mm_set1_epi32(format.alpha_xor));
+    }
+
+    static inline __m128i convert_wide(const WideFormat &format, __m128i x)
+    {
+        if (format.swap_red_blue)
+        {
+            const auto low_byte = _mm_set1_epi32(0xFF);
+            x = _mm_or_si128(
+                _mm_and_si128(x, _mm_set1_epi32(0xFF00FF00)),
+                _mm_or_si128(
+                    _mm_and_si128(_mm_srli_epi32(x, 16), low_byte),
+                    _mm_slli_epi32(_mm_and_si128(x, low_byte), 16)));
+        }
+        x = _mm_or_si128(x, _mm_set1_epi32(format.alpha_or));
+        return _mm_xor_si128(x, _mm_set1_epi32(format.alpha_xor));
+    }
+#endif
+
+    // The kernels below write whole BGRA dwords, relying on the layout of
+    // Pixel and on the machine being little endian.
+
+    static void read_packed_pixels(
+        const PackedFormat &format, const u8 *input_ptr, u32 *output_ptr,
+        size_t count)
+    {
+#ifdef AU_USE_SSE2
+        const auto zero = _mm_setzero_si128();
+        for (; count >= 8; count -= 8)
+        {
+            const auto x = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(input_ptr));
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(output_ptr),
+                convert_packed(format, _mm_unpacklo_epi16(x, zero)));
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(output_ptr + 4),
+                convert_packed(format, _mm_unpackhi_epi16(x, zero)));
+            input_ptr += 16;
+            output_ptr += 8;
+        }
+#endif
+        for (; count; count--)
+        {
+            u16 x;
+            std::memcpy(&x, input_ptr, 2);
+            *output_ptr++ = convert_packed(format, x);
+            input_ptr += 2;
+        }
+    }
+
+    static void read_wide_pixels(
+        const WideFormat &format, const u8 *input_ptr, u32 *output_ptr,
+        size_t count)
+    {
+#ifdef AU_USE_SSE2
+        for (; count >= 4; count -= 4)
+        {
+            const auto x = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(input_ptr));
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(output_ptr),
+                convert_wide(format, x));
+            input_ptr += 16;
+            output_ptr += 4;
+        }
+#endif
+        for (; count; count--)
+        {
+            u32 x;
+            std::memcpy(&x, input_ptr, 4);
+            *output_ptr++ = convert_wide(format, x);
+            input_ptr += 4;
+        }
+    }
+
+    // 24-bit pixels are loaded as dwords, so the last one, which could end
+    // right at the end of the input, is converted separately.
+    static void read_triple_pixels(
+        const bool swap_red_blue, const u8 *input_ptr, u32 *output_ptr,
+        const size_t count)
+    {
+        if (!count)
             return;
+        const WideFormat format = {swap_red_blue, alpha_mask, 0};
+        for (const auto i : algo::range(count - 1))
+        {
+            u32 x;
+            std::memcpy(&x, input_ptr, 4);
+            *output_ptr++ = convert_wide(format, x & 0xFFFFFF);
+            input_ptr += 3;
         }
+        const u32 x = input_ptr[0] | (input_ptr[1] << 8) | (input_ptr[2] << 16);
+        *output_ptr = convert_wide(format, x);
+    }
+
+    static void read_gray_pixels(
+        const u8 *input_ptr, u32 *output_ptr, size_t count)
+    {
+#ifdef AU_USE_SSE2
+        const auto alpha = _mm_set1_epi32(alpha_mask);
+        for (; count >= 16; count -= 16)
+        {
+            const auto x = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(input_ptr));
+            const auto lo = _mm_unpacklo_epi8(x, x);
+            const auto hi = _mm_unpackhi_epi8(x, x);
+            const __m128i pixels[4] = {
+                _mm_unpacklo_epi16(lo, lo),
+                _mm_unpackhi_epi16(lo, lo),
+                _mm_unpacklo_epi16(hi, hi),
+                _mm_unpackhi_epi16(hi, hi),
+            };
+            for (const auto i : algo::range(4))
+            {
+                _mm_storeu_si128(
+                    reinterpret_cast<__m128i*>(output_ptr + i * 4),
+                    _mm_or_si128(pixels[i], alpha));
+            }
+            input_ptr += 16;
+            output_ptr += 16;
+        }
+#endif
+        for (; count; count--)
+            *output_ptr++ = *input_ptr++ * 0x010101 | alpha_mask;
+    }
 
-        // I don't think there is a better alternative to this
+    void read_pixels(
+        const u8 *input_ptr, std::vector<Pixel> &output, const PixelFormat fmt)
+    {
         using PF = PixelFormat;
-        std::function<void(const u8 *, std::vector<Pixel> &)> impl;
+        const auto output_ptr = reinterpret_cast<u32*>(output.data());
+        const auto count = output.size();
         switch (fmt)
         {
-            case PF::Gray8:     impl = read_pixels<PF::Gray8>; break;
-            case PF::BGR555X:   impl = read_pixels<PF::BGR555X>; break;
-            case PF::BGR565:    impl = read_pixels<PF::BGR565>; break;
-            case PF::BGR888:    impl = read_pixels<PF::BGR888>; break;
-            case PF::BGR888X:   impl = read_pixels<PF::BGR888X>; break;
-            case PF::BGRA4444:  impl = read_pixels<PF::BGRA4444>; break;
-            case PF::BGRA5551:  impl = read_pixels<PF::BGRA5551>; break;
-            case PF::BGRA8888:  impl = read_pixels<PF::BGRA8888>; break;
-            case PF::BGRnA4444: impl = read_pixels<PF::BGRnA4444>; break;
-            case PF::BGRnA5551: impl = read_pixels<PF::BGRnA5551>; break;
-            case PF::BGRnA8888: impl = read_pixels<PF::BGRnA8888>; break;
-            case PF::RGB555X:   impl = read_pixels<PF::RGB555X>; break;
-            case PF::RGB565:    impl = read_pixels<PF::RGB565>; break;
-            case PF::RGB888:    impl = read_pixels<PF::RGB888>; break;
-            case PF::RGB888X:   impl = read_pixels<PF::RGB888X>; break;
-            case PF::RGBA4444:  impl = read_pixels<PF::RGBA4444>; break;
-            case PF::RGBA5551:  impl = read_pixels<PF::RGBA5551>; break;
-            case PF::RGBA8888:  impl = read_pixels<PF::RGBA8888>; break;
-            case PF::RGBnA4444: impl = read_pixels<PF::RGBnA4444>; break;
-            case PF::RGBnA5551: impl = read_pixels<PF::RGBnA5551>; break;
-            case PF::RGBnA8888: impl = read_pixels<PF::RGBnA8888>; break;
+            case PF::Gray8:
+                return read_gray_pixels(input_ptr, output_ptr, count);
+
+            case PF::BGR888:
+                return read_triple_pixels(false, input_ptr, output_ptr, count);
+            case PF::RGB888:
+                return read_triple_pixels(true, input_ptr, output_ptr, count);
+
+            case PF::BGRA8888:
+                std::memcpy(output_ptr, input_ptr, count * 4);
+                return;
+
+#define CASE(fmt, func, format) \
+            case PF::fmt: return func(format, input_ptr, output_ptr, count)
+            CASE(BGR555X,   read_packed_pixels, bgr555x);
+            CASE(BGR565,    read_packed_pixels, bgr565);
+            CASE(BGRA4444,  read_packed_pixels, bgra4444);
+            CASE(BGRA5551,  read_packed_pixels, bgra5551);
+            CASE(BGRnA4444, read_packed_pixels, bgrna4444);
+            CASE(BGRnA5551, read_packed_pixels, bgrna5551);
+            CASE(RGB555X,   read_packed_pixels, rgb555x);
+            CASE(RGB565,    read_packed_pixels, rgb565);
+            CASE(RGBA4444,  read_packed_pixels, rgba4444);
+            CASE(RGBA5551,  read_packed_pixels, rgba5551);
+            CASE(RGBnA4444, read_packed_pixels, rgbna4444);
+            CASE(RGBnA5551, read_packed_pixels, rgbna5551);
+            CASE(BGR888X,   read_wide_pixels,   bgr888x);
+            CASE(BGRnA8888, read_wide_pixels,   bgrna8888);
+            CASE(RGB888X,   read_wide_pixels,   rgb888x);
+            CASE(RGBA8888,  read_wide_pixels,   rgba8888);
+            CASE(RGBnA8888, read_wide_pixels,   rgbna8888);
+#undef CASE
+
             default:
                 throw std::logic_error(
                     algo::format("Unsupported pixel format: %d", fmt));
         }
-        impl(input_ptr, output);
     }
 
 } }
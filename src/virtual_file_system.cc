@@ -29,6 +29,7 @@ static std::mutex mutex;
 static std::map<io::path, std::function<std::unique_ptr<io::File>()>> factories;
 static std::set<io::path> directories;
 static bool enabled = true;
+static thread_local size_t lookup_count = 0;
 
 void VirtualFileSystem::disable()
 {
@@ -82,6 +83,7 @@ std::unique_ptr<io::File> VirtualFileSystem::get_by_stem(
     std::unique_lock<std::mutex> lock(mutex);
     if (!enabled)
         return nullptr;
+    ++lookup_count;
 
     const auto check = algo::lower(stem);
     for (const auto &kv : factories)
@@ -102,6 +104,7 @@ std::unique_ptr<io::File> VirtualFileSystem::get_by_name(
     std::unique_lock<std::mutex> lock(mutex);
     if (!enabled)
         return nullptr;
+    ++lookup_count;
 
     const auto check = algo::lower(name);
     for (const auto &kv : factories)
@@ -121,6 +124,7 @@ std::unique_ptr<io::File> VirtualFileSystem::get_by_path(const io::path &path)
     std::unique_lock<std::mutex> lock(mutex);
     if (!enabled)
         return nullptr;
+    ++lookup_count;
 
     const auto check = io::path(algo::lower(path.str()));
     if (factories.find(check) != factories.end())
@@ -135,3 +139,8 @@ std::unique_ptr<io::File> VirtualFileSystem::get_by_path(const io::path &path)
 
     return nullptr;
 }
+
+size_t VirtualFileSystem::get_lookup_count()
+{
+    return lookup_count;
+}
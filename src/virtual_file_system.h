@@ -42,6 +42,11 @@ namespace au {
         static std::unique_ptr<io::File> get_by_stem(const std::string &stem);
         static std::unique_ptr<io::File> get_by_name(const std::string &name);
         static std::unique_ptr<io::File> get_by_path(const io::path &path);
+
+        // Number of lookups made so far by the calling thread. Comparing it
+        // before and after decoding tells whether the output depends on
+        // files other than the input.
+        static size_t get_lookup_count();
     };
 
 }
@@ -16,6 +16,8 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "algo/crypt/sha1.h"
+#include "algo/range.h"
+#include "io/memory_byte_stream.h"
 #include "test_support/catch.h"
 #include "test_support/common.h"
 
@@ -24,11 +26,25 @@ using namespace au::algo::crypt;
 
 TEST_CASE("SHA1", "[algo][crypt]")
 {
-    tests::compare_binary(
-        algo::crypt::sha1("test"_b),
-        "\xA9\x4A\x8F\xE5"
-        "\xCC\xB1\x9B\xA6"
-        "\x1C\x4C\x08\x73"
-        "\xD3\x91\xE9\x87"
-        "\x98\x2F\xBB\xD3"_b);
+    SECTION("Hashing strings")
+    {
+        tests::compare_binary(
+            algo::crypt::sha1("test"_b),
+            "\xA9\x4A\x8F\xE5"
+            "\xCC\xB1\x9B\xA6"
+            "\x1C\x4C\x08\x73"
+            "\xD3\x91\xE9\x87"
+            "\x98\x2F\xBB\xD3"_b);
+    }
+
+    SECTION("Hashing streams")
+    {
+        bstr input(3 * 1024 * 1024 + 5);
+        for (const auto i : algo::range(input.size()))
+            input[i] = i * 7;
+        io::MemoryByteStream input_stream(input);
+        tests::compare_binary(
+            algo::crypt::sha1(input_stream), algo::crypt::sha1(input));
+        REQUIRE(input_stream.left() == 0);
+    }
 }
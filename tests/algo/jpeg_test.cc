@@ -0,0 +1,89 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "algo/jpeg.h"
+#include <algorithm>
+#include "algo/range.h"
+#include "test_support/catch.h"
+
+using namespace au;
+
+TEST_CASE("JPEG building blocks", "[algo]")
+{
+    SECTION("Zigzag order")
+    {
+        auto order = algo::jpeg::zigzag_order;
+        REQUIRE(order[0] == 0);
+        REQUIRE(order[1] == 1);
+        REQUIRE(order[2] == 8);
+        REQUIRE(order[63] == 63);
+        std::sort(order.begin(), order.end());
+        for (const auto i : algo::range(64))
+            REQUIRE(order[i] == i);
+    }
+
+    SECTION("Float IDCT")
+    {
+        std::array<u8, 64> quantization_table;
+        quantization_table.fill(1);
+        const auto dequantization_table
+            = algo::jpeg::make_float_dequantization_table(
+                quantization_table.data());
+
+        const auto test = [&](const s16 dc, const u8 expected)
+        {
+            std::array<s16, 64> input = {0};
+            input[0] = dc;
+            std::array<u8, 64> output;
+            algo::jpeg::idct_float(
+                input.data(), dequantization_table, output.data());
+            for (const auto sample : output)
+                REQUIRE(sample == expected);
+        };
+
+        test(0, 0x80);
+        test(80, 0x8A);
+        test(1000, 0xFD);
+        test(1200, 0xFF);
+        test(-1100, 0);
+        test(2048, 0);
+    }
+
+    SECTION("Integer IDCT")
+    {
+        std::array<s16, 64> quantization_table;
+        quantization_table.fill(2);
+        std::array<s16, 64> block = {0};
+        block[0] = 100;
+        algo::jpeg::idct_int(block.data(), quantization_table.data());
+        for (const auto sample : block)
+            REQUIRE(sample == 25);
+    }
+
+    SECTION("YCbCr to BGRA")
+    {
+        const u8 y[5] = {100, 0, 255, 100, 100};
+        const u8 cb[5] = {128, 0, 128, 128, 128};
+        const u8 cr[5] = {128, 128, 255, 128, 128};
+        u8 output[5 * 4];
+        algo::jpeg::ycbcr_to_bgra(y, cb, cr, output, 5);
+        REQUIRE(bstr(output, 4) == "\x64\x64\x64\xFF"_b);
+        REQUIRE(output[4 + 0] == 0);
+        REQUIRE(output[8 + 2] == 0xFF);
+        REQUIRE(bstr(output + 16, 4) == "\x64\x64\x64\xFF"_b);
+    }
+}
@@ -50,6 +50,44 @@ TEST_CASE("Converting text encoding", "[algo]")
     {
         tests::compare_binary(algo::utf8_to_sjis(utf8), sjis);
     }
+
+    SECTION("Converting ASCII")
+    {
+        tests::compare_binary(algo::sjis_to_utf8("abc\\~"_b), "abc\\~"_b);
+        tests::compare_binary(algo::utf8_to_sjis("abc\\~"_b), "abc\\~"_b);
+        tests::compare_binary(algo::sjis_to_utf8(""_b), ""_b);
+    }
+
+    SECTION("Converting half-width SJIS to UTF8")
+    {
+        // "ｱｲｳ"
+        tests::compare_binary(
+            algo::sjis_to_utf8("\xB1\xB2\xB3"_b),
+            "\xEF\xBD\xB1\xEF\xBD\xB2\xEF\xBD\xB3"_b);
+    }
+
+    SECTION("Converting invalid SJIS")
+    {
+        REQUIRE_THROWS(algo::sjis_to_utf8("\x82"_b));
+        // the converter must recover after a failure
+        tests::compare_binary(algo::sjis_to_utf8(sjis), utf8);
+    }
+
+    SECTION("Converting UTF16 to UTF8")
+    {
+        // "aあ𝄞"
+        const auto utf16 = "a\x00\x42\x30\x34\xD8\x1E\xDD"_b;
+        const auto utf8 = "a\xE3\x81\x82\xF0\x9D\x84\x9E"_b;
+        tests::compare_binary(algo::utf16_to_utf8(utf16), utf8);
+        tests::compare_binary(algo::utf8_to_utf16(utf8), utf16);
+    }
+
+    SECTION("Converting invalid UTF16")
+    {
+        REQUIRE_THROWS(algo::utf16_to_utf8("a"_b));
+        REQUIRE_THROWS(algo::utf16_to_utf8("\x34\xD8"_b));
+        REQUIRE_THROWS(algo::utf16_to_utf8("\x1E\xDD" "a\x00"_b));
+    }
 }
 
 TEST_CASE("Normalizing SJIS strings", "[algo]")
@@ -0,0 +1,113 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "algo/pack/huffman.h"
+#include "algo/range.h"
+#include "io/memory_byte_stream.h"
+#include "io/msb_bit_stream.h"
+#include "test_support/catch.h"
+#include "test_support/common.h"
+
+using namespace au;
+using namespace au::algo::pack;
+
+// Builds a tree where symbol N is encoded as N ones followed by a zero, so
+// that the later symbols don't fit in the root table.
+static std::vector<HuffmanTable::Node> make_unary_tree(const size_t count)
+{
+    std::vector<HuffmanTable::Node> nodes;
+    for (const auto i : algo::range(count))
+    {
+        HuffmanTable::Node leaf;
+        leaf.is_leaf = true;
+        leaf.symbol = i;
+        nodes.push_back(leaf);
+    }
+    for (size_t i = 0; i + 1 < count; i++)
+    {
+        HuffmanTable::Node branch;
+        branch.is_leaf = false;
+        branch.children[0] = i;
+        branch.children[1] = i == count - 2 ? count - 1 : count + i + 1;
+        nodes.push_back(branch);
+    }
+    return nodes;
+}
+
+TEST_CASE("Huffman decoding", "[algo][pack]")
+{
+    SECTION("Codes longer than the root table")
+    {
+        const size_t count = 30;
+        const HuffmanTable table(make_unary_tree(count), count, 4);
+
+        io::MemoryByteStream byte_stream;
+        io::MsbBitStream bit_stream(byte_stream);
+        std::vector<u16> expected;
+        for (const auto i : algo::range(200))
+        {
+            const auto symbol = (i * 7) % count;
+            for (const auto j : algo::range(symbol))
+                bit_stream.write(1, 1);
+            if (symbol != count - 1)
+                bit_stream.write(1, 0);
+            expected.push_back(symbol);
+        }
+        bit_stream.flush();
+
+        const auto input = byte_stream.seek(0).read_to_eof();
+        io::MsbBitReader reader(input);
+        for (const auto symbol : expected)
+            REQUIRE(table.decode(reader) == symbol);
+        REQUIRE(reader.left() < 8);
+    }
+
+    SECTION("Single symbol")
+    {
+        std::vector<HuffmanTable::Node> nodes(1);
+        nodes[0].is_leaf = true;
+        nodes[0].symbol = 5;
+        const HuffmanTable table(nodes, 0);
+        const auto input = "\xFF"_b;
+        io::MsbBitReader reader(input);
+        REQUIRE(table.decode(reader) == 5);
+        REQUIRE(reader.pos() == 0);
+    }
+
+    SECTION("Serialized byte tree")
+    {
+        // 1 (0 'a') (1 (0 'b') (0 'c')), followed by "abcab"
+        io::MemoryByteStream byte_stream;
+        io::MsbBitStream bit_stream(byte_stream);
+        bit_stream.write(1, 1);
+        bit_stream.write(1, 0);
+        bit_stream.write(8, 'a');
+        bit_stream.write(1, 1);
+        bit_stream.write(1, 0);
+        bit_stream.write(8, 'b');
+        bit_stream.write(1, 0);
+        bit_stream.write(8, 'c');
+        for (const auto c : {0b0, 0b10, 0b11, 0b0, 0b10})
+            bit_stream.write(c ? 2 : 1, c);
+        bit_stream.flush();
+
+        const auto input = byte_stream.seek(0).read_to_eof();
+        io::MsbBitReader reader(input);
+        const HuffmanTree tree(reader);
+        tests::compare_binary(decode_huffman(tree, reader, 5), "abcab"_b);
+    }
+}
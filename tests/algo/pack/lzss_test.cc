@@ -17,6 +17,8 @@
 
 #include "algo/pack/lzss.h"
 #include "algo/range.h"
+#include "io/memory_byte_stream.h"
+#include "io/msb_bit_stream.h"
 #include "test_support/catch.h"
 #include "test_support/common.h"
 
@@ -151,3 +153,64 @@ TEST_CASE("LZSS packing", "[algo][pack]")
             input);
     }
 }
+
+TEST_CASE("LZSS unpacking with various settings", "[algo][pack]")
+{
+    // zeros at the start reference the initial dictionary, the short
+    // repeats overlap with the copied data and the input is long enough
+    // for the dictionary to wrap around
+    bstr input(64);
+    u32 seed = 1;
+    while (input.size() < 20000)
+    {
+        seed = seed * 1103515245 + 12345;
+        const auto word = "lorem ipsum dolor sit amet "_b.substr(
+            (seed >> 16) % 20, 3 + (seed >> 8) % 7);
+        for (const auto i : algo::range(1 + (seed >> 4) % 5))
+            input += word;
+        input += static_cast<u8>(seed >> 24);
+    }
+
+    SECTION("Bitwise")
+    {
+        for (const auto position_bits : {8, 10, 11, 12, 13})
+        for (const auto size_bits : {3, 4, 5})
+        {
+            INFO("Position bits: " << position_bits
+                << ", size bits: " << size_bits);
+            BitwiseLzssSettings settings;
+            settings.position_bits = position_bits;
+            settings.size_bits = size_bits;
+            settings.min_match_size = 2;
+            settings.initial_dictionary_pos = (1 << position_bits) - 0x12;
+            const auto packed = lzss_compress(input, settings);
+            tests::compare_binary(
+                lzss_decompress(packed, input.size(), settings), input);
+
+            io::MemoryByteStream byte_stream(packed);
+            io::MsbBitStream bit_stream(byte_stream);
+            tests::compare_binary(
+                lzss_decompress(bit_stream, input.size(), settings), input);
+        }
+    }
+
+    SECTION("Bytewise")
+    {
+        BytewiseLzssSettings settings;
+        const auto packed = lzss_compress(input, settings);
+        tests::compare_binary(
+            lzss_decompress(packed, input.size(), settings), input);
+    }
+
+    SECTION("Output shorter than the last match")
+    {
+        BitwiseLzssSettings settings;
+        settings.position_bits = 12;
+        settings.size_bits = 4;
+        settings.min_match_size = 3;
+        settings.initial_dictionary_pos = 0xFEE;
+        const auto packed = lzss_compress(input, settings);
+        tests::compare_binary(
+            lzss_decompress(packed, 1000, settings), input.substr(0, 1000));
+    }
+}
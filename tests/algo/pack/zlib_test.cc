@@ -16,6 +16,8 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "algo/pack/zlib.h"
+#include "algo/pack/zlib_inflate_stream.h"
+#include "algo/range.h"
 #include "io/memory_byte_stream.h"
 #include "test_support/catch.h"
 #include "test_support/common.h"
@@ -43,6 +45,40 @@ TEST_CASE("ZLIB compression", "[algo][pack]")
         REQUIRE(input_stream.left() == 0);
     }
 
+    SECTION("Inflating ZLIB with known size")
+    {
+        tests::compare_binary(zlib_inflate(input, output.size()), output);
+    }
+
+    SECTION("Inflating ZLIB with wrong size hints")
+    {
+        tests::compare_binary(zlib_inflate(input, 1), output);
+        tests::compare_binary(zlib_inflate(input, 0), output);
+        tests::compare_binary(zlib_inflate(input, 1000), output);
+        REQUIRE(zlib_inflate(input, 1000).capacity() == output.size());
+        REQUIRE(zlib_inflate(input).capacity() == output.size());
+    }
+
+    SECTION("Inflating ZLIB into a buffer")
+    {
+        bstr buffer(output.size());
+        zlib_inflate(input, buffer.get<u8>(), buffer.size());
+        tests::compare_binary(buffer, output);
+        REQUIRE_THROWS(zlib_inflate(input, buffer.get<u8>(), 5));
+        buffer.resize(output.size() + 1);
+        REQUIRE_THROWS(zlib_inflate(input, buffer.get<u8>(), buffer.size()));
+    }
+
+    SECTION("Inflating corrupt ZLIB")
+    {
+        REQUIRE_THROWS(zlib_inflate(input.substr(0, 10)));
+        REQUIRE_THROWS(zlib_inflate(input.substr(0, 10), output.size()));
+        io::MemoryByteStream input_stream(input.substr(0, 10));
+        REQUIRE_THROWS(zlib_inflate(input_stream));
+        // the state of the reused inflater mustn't leak into the next call
+        tests::compare_binary(zlib_inflate(input), output);
+    }
+
     SECTION("Deflating ZLIB from bstr")
     {
         tests::compare_binary(zlib_inflate(zlib_deflate(output)), output);
@@ -54,4 +90,36 @@ TEST_CASE("ZLIB compression", "[algo][pack]")
         const auto inflated = zlib_inflate(deflated, ZlibKind::RawDeflate);
         tests::compare_binary(inflated, output);
     }
+
+    SECTION("Inflating ZLIB lazily")
+    {
+        ZlibInflateStream stream(
+            std::make_unique<io::MemoryByteStream>(input), output.size());
+        REQUIRE(stream.size() == output.size());
+        tests::compare_binary(stream.read(4), output.substr(0, 4));
+        tests::compare_binary(stream.seek(8).read(4), output.substr(8, 4));
+        tests::compare_binary(stream.seek(1).read(3), output.substr(1, 3));
+        tests::compare_binary(stream.clone()->read_to_eof(), output.substr(4));
+        tests::compare_binary(stream.read_to_eof(), output.substr(4));
+        REQUIRE_THROWS(stream.read<u8>());
+    }
+
+    SECTION("Inflating big ZLIB lazily")
+    {
+        bstr big_output;
+        for (const auto i : algo::range(100000))
+            big_output += static_cast<u8>(i * i / 7);
+        ZlibInflateStream stream(
+            std::make_unique<io::MemoryByteStream>(zlib_deflate(big_output)),
+            big_output.size());
+        tests::compare_binary(stream.read_to_eof(), big_output);
+    }
+
+    SECTION("Inflating truncated ZLIB lazily")
+    {
+        ZlibInflateStream stream(
+            std::make_unique<io::MemoryByteStream>(input.substr(0, 10)),
+            output.size());
+        REQUIRE_THROWS(stream.read_to_eof());
+    }
 }
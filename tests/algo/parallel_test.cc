@@ -0,0 +1,77 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "algo/parallel.h"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include "test_support/catch.h"
+
+using namespace au;
+
+TEST_CASE("Running tasks in parallel", "[algo]")
+{
+    for (const size_t thread_count : {0, 1, 4})
+    {
+        SECTION("Every task runs once")
+        {
+            std::vector<std::atomic<int>> runs(100);
+            algo::run_in_parallel(
+                runs.size(), thread_count, [&](const size_t task)
+                {
+                    runs[task]++;
+                });
+            for (const auto &run_count : runs)
+                REQUIRE(run_count == 1);
+        }
+
+        SECTION("Exceptions are forwarded")
+        {
+            REQUIRE_THROWS_AS(
+                algo::run_in_parallel(
+                    100, thread_count, [](const size_t task)
+                    {
+                        if (task == 50)
+                            throw std::runtime_error("task failed");
+                    }),
+                std::runtime_error);
+        }
+    }
+
+    SECTION("Thread budget")
+    {
+        REQUIRE(algo::get_thread_budget() == 1);
+        {
+            const algo::ThreadBudget thread_budget(4);
+            REQUIRE(algo::get_thread_budget() == 4);
+            {
+                const algo::ThreadBudget inner_thread_budget(0);
+                REQUIRE(algo::get_thread_budget() == 1);
+            }
+            REQUIRE(algo::get_thread_budget() == 4);
+
+            std::atomic<size_t> budget_sum(0);
+            algo::run_in_parallel(4, 0, [&](const size_t)
+            {
+                // the helper threads don't inherit the budget
+                budget_sum += algo::get_thread_budget();
+            });
+            REQUIRE(budget_sum == 4);
+        }
+        REQUIRE(algo::get_thread_budget() == 1);
+    }
+}
@@ -104,6 +104,19 @@ TEST_CASE("ArgParser", "[core]")
         REQUIRE(ap.get_switch("--long") == "long2");
     }
 
+    SECTION("Switches given multiple times")
+    {
+        ArgParser ap;
+        ap.register_switch({"-s", "--switch"});
+        ap.parse(std::vector<std::string>{"-s=1", "--switch=2", "-s=3"});
+        REQUIRE(ap.get_switch("-s") == "3");
+        const auto values = ap.get_switch_values("--switch");
+        REQUIRE(values.size() == 3);
+        REQUIRE(values[0] == "1");
+        REQUIRE(values[1] == "2");
+        REQUIRE(values[2] == "3");
+    }
+
     SECTION("Switches with values containing spaces")
     {
         ArgParser ap;
@@ -231,4 +244,24 @@ TEST_CASE("ArgParser", "[core]")
         REQUIRE(stray[0] == "stray1");
         REQUIRE(stray[1] == "stray2");
     }
+
+    SECTION("Recognized arguments")
+    {
+        ArgParser ap;
+        ap.register_switch({"--switch"});
+        ap.register_flag({"--flag"});
+        const std::vector<std::string> args
+        {
+            "stray",
+            "--flag",
+            "--unknown",
+            "--switch=s",
+        };
+        ap.parse(args);
+
+        const auto recognized = ap.get_recognized();
+        REQUIRE(recognized.size() == 2);
+        REQUIRE(recognized[0] == "--flag");
+        REQUIRE(recognized[1] == "--switch=s");
+    }
 }
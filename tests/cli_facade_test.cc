@@ -16,6 +16,7 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "flow/cli_facade.h"
+#include "err.h"
 #include "io/file_system.h"
 #include "test_support/catch.h"
 
@@ -60,4 +61,25 @@ TEST_CASE("CLI facade", "[core]")
         io::remove("./xp3-v2~.xp3/123.txt");
         io::remove("./xp3-v2~.xp3");
     }
+
+    SECTION("Rejecting malformed sizes")
+    {
+        REQUIRE_THROWS_AS(
+            flow::CliFacade(logger, {"--min-size=-1"}), err::UsageError);
+        REQUIRE_THROWS_AS(
+            flow::CliFacade(logger, {"--max-size=1k"}), err::UsageError);
+        REQUIRE_THROWS_AS(
+            flow::CliFacade(logger, {"--memory-limit=-1"}), err::UsageError);
+    }
+
+    SECTION("Rejecting unknown PNG options")
+    {
+        REQUIRE_THROWS_AS(
+            flow::CliFacade(logger, {"--png-level=9"}), err::UsageError);
+        REQUIRE_THROWS_AS(
+            flow::CliFacade(logger, {"--png-filter=all"}), err::UsageError);
+        REQUIRE_NOTHROW(
+            flow::CliFacade(
+                logger, {"--png-level=store", "--png-filter=paeth"}));
+    }
 }
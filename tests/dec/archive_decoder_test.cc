@@ -229,3 +229,40 @@ TEST_CASE("Archive files get proper fallback names", "[dec]")
         test_naming_strategy<algo::NamingStrategy::Sibling>("test");
     }
 }
+
+TEST_CASE("Archive indexes", "[dec]")
+{
+    const TestArchiveDecoder decoder(algo::NamingStrategy::Child);
+    auto archive_file = make_archive(
+        "test.archive",
+        {
+            tests::stub_file("abc.txt", "abc"_b),
+            tests::stub_file("", "nameless"_b),
+        });
+
+    SECTION("Plain entries survive serialization")
+    {
+        const auto expected_files = tests::unpack(decoder, *archive_file);
+        const auto actual_files
+            = tests::unpack_via_index(decoder, *archive_file);
+        tests::compare_files(actual_files, expected_files, true);
+    }
+
+    SECTION("Corrupt indexes")
+    {
+        Logger dummy_logger;
+        dummy_logger.mute();
+        REQUIRE_THROWS(decoder.deserialize_meta(
+            dummy_logger, *archive_file, "\x01\x00\x00\x00\x07"_b));
+        REQUIRE_THROWS(decoder.deserialize_meta(
+            dummy_logger, *archive_file, "\x00\x00\x00\x00junk"_b));
+    }
+
+    SECTION("Custom metas are not serialized by default")
+    {
+        struct CustomArchiveMeta final : ArchiveMeta
+        {
+        };
+        REQUIRE(decoder.serialize_meta(CustomArchiveMeta()).empty());
+    }
+}
@@ -15,6 +15,8 @@
 // You should have received a copy of the GNU General Public License
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
+#include "dec/bgi/cbg/cbg2_decoder.h"
+#include "algo/parallel.h"
 #include "dec/bgi/cbg_image_decoder.h"
 #include "test_support/catch.h"
 #include "test_support/decoder_support.h"
@@ -67,4 +69,22 @@ TEST_CASE("BGI CBG images", "[dec]")
     {
         do_test("v2/ms_wn_base", "v2/ms_wn_base-out.png");
     }
+
+    SECTION("Version 2, rows decoded on several threads")
+    {
+        const auto input_file
+            = tests::file_from_path(dir + "v2/l_card000");
+        const auto expected_file
+            = tests::file_from_path(dir + "v2/l_card000-out.png");
+        input_file->stream.seek(0x10);
+        const auto actual_image
+            = dec::bgi::cbg::Cbg2Decoder(4).decode(input_file->stream);
+        tests::compare_images(*actual_image, *expected_file);
+    }
+
+    SECTION("Version 2, decoded within a thread budget")
+    {
+        const algo::ThreadBudget thread_budget(4);
+        do_test("v2/l_card000", "v2/l_card000-out.png");
+    }
 }
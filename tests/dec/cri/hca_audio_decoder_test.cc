@@ -27,9 +27,12 @@ using namespace au::dec::cri;
 static const std::string dir = "tests/dec/cri/files/hca/";
 
 static void do_test(
-    const std::string &input_path, const std::string &expected_path)
+    const std::string &input_path,
+    const std::string &expected_path,
+    const size_t thread_count = 0,
+    const size_t blocks_per_segment = 64)
 {
-    const auto decoder = HcaAudioDecoder();
+    const auto decoder = HcaAudioDecoder(thread_count, blocks_per_segment);
     const auto input_file = tests::file_from_path(dir + input_path);
     const auto expected_file = tests::file_from_path(dir + expected_path);
     const auto actual_audio = tests::decode(decoder, *input_file);
@@ -42,4 +45,14 @@ TEST_CASE("CRI HCA audio", "[dec]")
     {
         do_test("test.hca", "test-out.wav");
     }
+
+    SECTION("Decoded in segments on multiple threads")
+    {
+        for (const auto thread_count : {1, 2, 4})
+        for (const auto blocks_per_segment : {1, 3})
+        {
+            do_test(
+                "test.hca", "test-out.wav", thread_count, blocks_per_segment);
+        }
+    }
 }
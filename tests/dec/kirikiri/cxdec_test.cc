@@ -0,0 +1,73 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "dec/kirikiri/cxdec.h"
+#include "algo/crypt/sha1.h"
+#include "algo/range.h"
+#include "algo/str.h"
+#include "test_support/catch.h"
+
+using namespace au;
+using namespace au::dec::kirikiri;
+
+static bstr create_control_block()
+{
+    bstr control_block(4096);
+    for (const auto i : algo::range(control_block.size()))
+        control_block[i] = (i * 7) ^ (i >> 8);
+    return control_block;
+}
+
+static std::string decrypt(const Xp3Plugin &plugin)
+{
+    const auto decrypt_func = plugin.create_decrypt_func("test.xp3");
+    bstr output;
+    for (const auto i : algo::range(200))
+    {
+        bstr data(0x300 + i);
+        decrypt_func(data, 0x9E3779B9 * (i + 1));
+        output += data;
+    }
+    // decrypting an entry again must give the same result
+    bstr data(0x300);
+    decrypt_func(data, 0x9E3779B9);
+    output += data;
+    return algo::hex(algo::crypt::sha1(output));
+}
+
+TEST_CASE("KiriKiri CXDEC decryption", "[dec]")
+{
+    const auto control_block = create_control_block();
+
+    SECTION("Key derivation order 1")
+    {
+        const auto plugin = create_cxdec_plugin(
+            0x143, 0x787, {0,1,2}, {0,1,2,3,4,5,6,7}, {0,1,2,3,4,5},
+            control_block);
+        REQUIRE(decrypt(plugin)
+            == "4803C2F6FC79544EC7A09F9DD1AF95F6F78E6461");
+    }
+
+    SECTION("Key derivation order 2")
+    {
+        const auto plugin = create_cxdec_plugin(
+            0x181, 0x635, {2,1,0}, {7,5,2,3,6,1,4,0}, {4,0,1,5,2,3},
+            control_block);
+        REQUIRE(decrypt(plugin)
+            == "05EE32AF27615248350F721BA222ECA6A062D31F");
+    }
+}
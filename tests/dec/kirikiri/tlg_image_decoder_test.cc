@@ -16,6 +16,8 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "dec/kirikiri/tlg_image_decoder.h"
+#include "algo/parallel.h"
+#include "dec/kirikiri/tlg/tlg6_decoder.h"
 #include "test_support/catch.h"
 #include "test_support/decoder_support.h"
 #include "test_support/file_support.h"
@@ -48,6 +50,26 @@ TEST_CASE("KiriKiri TLG images", "[dec]")
         do_test("tlg6.tlg", "tlg6-out.png");
     }
 
+    SECTION("TLG6 decoded with multiple threads")
+    {
+        for (const auto thread_count : {1, 2, 4})
+        {
+            const auto input_file = tests::file_from_path(dir + "tlg6.tlg");
+            const auto expected_file
+                = tests::file_from_path(dir + "tlg6-out.png");
+            input_file->stream.seek("TLG6.0\x00raw\x1A"_b.size());
+            const auto actual_image
+                = tlg::Tlg6Decoder(thread_count).decode(*input_file);
+            tests::compare_images(actual_image, *expected_file);
+        }
+    }
+
+    SECTION("TLG6 decoded within a thread budget")
+    {
+        const algo::ThreadBudget thread_budget(4);
+        do_test("tlg6.tlg", "tlg6-out.png");
+    }
+
     SECTION("TLG0")
     {
         do_test("bg08d.tlg", "bg08d-out.png");
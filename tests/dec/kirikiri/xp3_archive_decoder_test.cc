@@ -37,6 +37,8 @@ static void do_test(const std::string &input_path)
     const auto input_file = tests::file_from_path(dir + input_path);
     const auto actual_files = tests::unpack(decoder, *input_file);
     tests::compare_files(actual_files, expected_files, true);
+    const auto indexed_files = tests::unpack_via_index(decoder, *input_file);
+    tests::compare_files(indexed_files, expected_files, true);
 }
 
 TEST_CASE("KiriKiri XP3 archives", "[dec]")
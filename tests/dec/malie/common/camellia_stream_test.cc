@@ -0,0 +1,105 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "dec/malie/common/camellia_stream.h"
+#include "algo/range.h"
+#include "io/memory_byte_stream.h"
+#include "test_support/catch.h"
+#include "test_support/common.h"
+
+using namespace au;
+using namespace au::dec::malie::common;
+
+static const std::vector<u32> key = {
+    0x364F9A3E, 0x873B57D7, 0x920C8F7C, 0x2CCCC422,
+    0x0309410A, 0xC7DFDB3F, 0x3180EB15, 0xE5D35D62,
+    0x3FA9D12A, 0x34EF8ECB, 0x8A62FA9C, 0x537EB987,
+    0x502947E1, 0x3A65CB88, 0x85A91735, 0x87E77D3D,
+    0xB563DBCA, 0x1B009542, 0x16573462, 0x84C47A65,
+    0x057C13F5, 0xC6598E67, 0xB444FBF1, 0x6157D19F,
+    0x77ED2698, 0xE6E57501, 0xEACADAAD, 0xAAD676B2,
+    0x266968F1, 0xEC566ACE, 0x261B7E2E, 0x1C46FE7C,
+    0x8AA8675B, 0x6CF5157A, 0xC1717A59, 0x36982E47,
+    0x5D4C7804, 0xE2E976F7, 0x7592E4C7, 0x304A48B3,
+    0xC8E3D3FF, 0xFF8B759A, 0x9EF24637, 0xC98FE507,
+    0x04767A7A, 0x693DB6A7, 0x084FAE8D, 0x90DBB24A,
+    0x2CAA8502, 0x4DDBE69D, 0x9CF7D7AF, 0xF3D06D0A,
+};
+
+static bstr encrypt(const bstr &input)
+{
+    algo::crypt::Camellia camellia(key);
+    io::MemoryByteStream output_stream;
+    io::MemoryByteStream input_stream(input);
+    for (const auto i : algo::range(input.size() / 0x10))
+    {
+        u32 input_block[4];
+        u32 output_block[4];
+        for (const auto j : algo::range(4))
+            input_block[j] = input_stream.read_be<u32>();
+        camellia.encrypt_block_128(i * 0x10, input_block, output_block);
+        for (const auto j : algo::range(4))
+            output_stream.write_le<u32>(output_block[j]);
+    }
+    return output_stream.seek(0).read_to_eof();
+}
+
+TEST_CASE("Malie Camellia streams", "[dec]")
+{
+    bstr input(0x30000);
+    for (const auto i : algo::range(input.size()))
+        input[i] = i * 7 + (i >> 8);
+    io::MemoryByteStream encrypted_stream(encrypt(input));
+
+    SECTION("Small reads")
+    {
+        CamelliaStream stream(encrypted_stream, key);
+        bstr output;
+        while (stream.left())
+            output += stream.read(std::min<size_t>(stream.left(), 7));
+        tests::compare_binary(output, input);
+    }
+
+    SECTION("Large reads")
+    {
+        CamelliaStream stream(encrypted_stream, key);
+        stream.seek(3);
+        tests::compare_binary(
+            stream.read(0x2FFF0), input.substr(3, 0x2FFF0));
+        REQUIRE(stream.pos() == 0x2FFF3);
+    }
+
+    SECTION("Unaligned entries")
+    {
+        CamelliaStream stream(encrypted_stream, key, 0x1005, 0x20000);
+        REQUIRE(stream.size() == 0x20000);
+        REQUIRE(stream.read(5) == input.substr(0x1005, 5));
+        stream.seek(0x100);
+        tests::compare_binary(
+            stream.read(0x1FF00), input.substr(0x1105, 0x1FF00));
+        REQUIRE(stream.seek(0x10).read(3) == input.substr(0x1015, 3));
+        const auto clone = stream.clone();
+        REQUIRE(clone->read(3) == input.substr(0x1018, 3));
+    }
+
+    SECTION("Empty keys")
+    {
+        CamelliaStream stream(encrypted_stream, {}, 0x10, 0x20);
+        REQUIRE(stream.read_to_eof()
+            == encrypted_stream.seek(0x10).read(0x20));
+    }
+}
@@ -94,16 +94,44 @@ TEST_CASE("NScripter NSA encryption", "[dec]")
             std::max<size_t>(0, std::min<size_t>(input.size() - i, 1024)));
     }
 
-    const size_t chunk_size = 555;
     io::MemoryByteStream base_stream(encrypted_input);
     dec::nscripter::NsaEncryptedStream encrypted_stream(base_stream, key);
 
-    bstr output;
-    while (encrypted_stream.left())
+    SECTION("Small reads")
     {
-        output += encrypted_stream.read(
-            std::min<size_t>(encrypted_stream.left(), chunk_size));
+        bstr output;
+        while (encrypted_stream.left())
+        {
+            output += encrypted_stream.read(
+                std::min<size_t>(encrypted_stream.left(), 555));
+        }
+        tests::compare_binary(output, input);
+    }
+
+    SECTION("Reads spanning multiple blocks")
+    {
+        bstr output;
+        while (encrypted_stream.left())
+        {
+            output += encrypted_stream.read(
+                std::min<size_t>(encrypted_stream.left(), 3333));
+        }
+        tests::compare_binary(output, input);
+    }
+
+    SECTION("Seeking back")
+    {
+        encrypted_stream.seek(5000);
+        REQUIRE(encrypted_stream.read(20) == input.substr(5000, 20));
+        REQUIRE(encrypted_stream.read(2000) == input.substr(5020, 2000));
+        encrypted_stream.seek(1020);
+        REQUIRE(encrypted_stream.read(10) == input.substr(1020, 10));
+        REQUIRE(encrypted_stream.pos() == 1030);
     }
 
-    tests::compare_binary(output, input);
+    SECTION("Reading past the end")
+    {
+        encrypted_stream.seek(input.size() - 10);
+        REQUIRE_THROWS(encrypted_stream.read(11));
+    }
 }
@@ -16,6 +16,7 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "dec/purple_software/pb3_image_decoder.h"
+#include "algo/parallel.h"
 #include "test_support/catch.h"
 #include "test_support/decoder_support.h"
 #include "test_support/file_support.h"
@@ -49,6 +50,12 @@ TEST_CASE("Purple Software PB3 images", "[dec]")
         do_test("bg401i1.pb3", "bg401i1-out.png");
     }
 
+    SECTION("Version 2, decoded within a thread budget")
+    {
+        const algo::ThreadBudget thread_budget(4);
+        do_test("bg401i1.pb3", "bg401i1-out.png");
+    }
+
     SECTION("Version 3")
     {
         do_test("mask009a.pb3", "mask009a-out.png");
@@ -0,0 +1,78 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "dec/registry.h"
+#include "io/file.h"
+#include "test_support/catch.h"
+
+using namespace au;
+using namespace au::dec;
+
+static std::unique_ptr<Registry> create_registry()
+{
+    auto registry = Registry::create_mock();
+    for (const auto &name : {"test/a", "test/b", "test/c", "test/d"})
+        registry->add_decoder(name, []() { return nullptr; });
+    registry->add_magic("test/a", "ABC"_b, 0);
+    registry->add_magic("test/a", "XYZ"_b, 0);
+    registry->add_magic("test/b", "AB"_b, 2);
+    registry->add_extension("test/c", "dat");
+    return registry;
+}
+
+static std::vector<std::string> get_candidates(
+    const Registry &registry, const io::path &path, const bstr &content)
+{
+    io::File input_file(path, content);
+    return registry.get_decoder_candidates(
+        input_file, {"test/a", "test/b", "test/c", "test/d"});
+}
+
+TEST_CASE("Decoder registry", "[dec]")
+{
+    const auto registry = create_registry();
+
+    SECTION("Decoders without signatures are always candidates")
+    {
+        REQUIRE(get_candidates(*registry, "test.bin", ""_b)
+            == std::vector<std::string>({"test/d"}));
+    }
+
+    SECTION("Matching by magic")
+    {
+        REQUIRE(get_candidates(*registry, "test.bin", "ABCD"_b)
+            == std::vector<std::string>({"test/a", "test/d"}));
+        REQUIRE(get_candidates(*registry, "test.bin", "XYZ"_b)
+            == std::vector<std::string>({"test/a", "test/d"}));
+        REQUIRE(get_candidates(*registry, "test.bin", "ABAB"_b)
+            == std::vector<std::string>({"test/b", "test/d"}));
+        REQUIRE(get_candidates(*registry, "test.bin", "AB"_b)
+            == std::vector<std::string>({"test/d"}));
+    }
+
+    SECTION("Matching by extension")
+    {
+        REQUIRE(get_candidates(*registry, "test.DAT", "ABC"_b)
+            == std::vector<std::string>({"test/a", "test/c", "test/d"}));
+    }
+
+    SECTION("Declaring signatures for unknown decoders")
+    {
+        REQUIRE_THROWS(registry->add_magic("test/x", "ABC"_b, 0));
+        REQUIRE_THROWS(registry->add_extension("test/x", "dat"));
+    }
+}
@@ -36,6 +36,8 @@ static void test(const std::string &path)
     const auto input_file = tests::file_from_path(dir + path);
     const auto actual_files = tests::unpack(decoder, *input_file);
     tests::compare_files(actual_files, expected_files, true);
+    const auto indexed_files = tests::unpack_via_index(decoder, *input_file);
+    tests::compare_files(indexed_files, expected_files, true);
 }
 
 TEST_CASE("Ren'py RPA archives", "[dec]")
@@ -0,0 +1,181 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "enc/png/png_image_encoder.h"
+#include "algo/range.h"
+#include "dec/png/png_image_decoder.h"
+#include "test_support/catch.h"
+#include "test_support/common.h"
+#include "test_support/image_support.h"
+
+using namespace au;
+using namespace au::enc::png;
+
+static u8 get_color_type(io::File &png_file)
+{
+    return png_file.stream.seek(25).read<u8>();
+}
+
+static void test_round_trip(
+    const res::Image &input_image,
+    const PngImageEncoderOptions &options,
+    const u8 expected_color_type)
+{
+    Logger dummy_logger;
+    dummy_logger.mute();
+    const auto encoder = PngImageEncoder(options);
+    const auto decoder = dec::png::PngImageDecoder();
+    const auto output_file
+        = encoder.encode(dummy_logger, input_image, "test.dat");
+    REQUIRE(output_file->path.name() == "test.png");
+    REQUIRE(get_color_type(*output_file) == expected_color_type);
+    output_file->stream.seek(0);
+    const auto output_image = decoder.decode(dummy_logger, *output_file);
+    tests::compare_images(output_image, input_image);
+}
+
+static res::Image make_opaque(res::Image image)
+{
+    for (auto &c : image)
+        c.a = 0xFF;
+    return image;
+}
+
+static res::Image make_gray(res::Image image, const bool keep_alpha)
+{
+    for (auto &c : image)
+    {
+        c.g = c.b = c.r;
+        if (!keep_alpha)
+            c.a = 0xFF;
+    }
+    return image;
+}
+
+static res::Image make_paletted(res::Image image)
+{
+    for (auto &c : image)
+    {
+        c.r &= 0xC0;
+        c.g &= 0xC0;
+        c.b &= 0xE0;
+        c.a = c.a > 0x80 ? 0xFF : 0x00;
+    }
+    return image;
+}
+
+TEST_CASE("PNG images encoding", "[enc]")
+{
+    PngImageEncoderOptions options;
+
+    SECTION("Default settings")
+    {
+        test_round_trip(tests::get_opaque_test_image(), options, 6);
+        test_round_trip(tests::get_transparent_test_image(), options, 6);
+    }
+
+    SECTION("Automatic color type")
+    {
+        options.color_type = PngColorType::Auto;
+
+        SECTION("RGB")
+        {
+            test_round_trip(
+                make_opaque(tests::get_transparent_test_image()), options, 2);
+        }
+
+        SECTION("RGBA")
+        {
+            test_round_trip(tests::get_transparent_test_image(), options, 6);
+        }
+
+        SECTION("Gray")
+        {
+            test_round_trip(
+                make_gray(tests::get_opaque_test_image(), false), options, 0);
+        }
+
+        SECTION("Gray with alpha")
+        {
+            test_round_trip(
+                make_gray(tests::get_transparent_test_image(), true),
+                options,
+                4);
+        }
+
+        SECTION("Palette")
+        {
+            test_round_trip(
+                make_paletted(tests::get_transparent_test_image()),
+                options,
+                3);
+        }
+
+        SECTION("Single pixel")
+        {
+            res::Image image(1, 1);
+            image.at(0, 0) = {1, 2, 3, 4};
+            test_round_trip(image, options, 6);
+        }
+    }
+
+    SECTION("Filters")
+    {
+        options.color_type = PngColorType::Auto;
+        for (const auto filter_strategy : {
+            PngFilterStrategy::Sub,
+            PngFilterStrategy::Up,
+            PngFilterStrategy::Average,
+            PngFilterStrategy::Paeth,
+            PngFilterStrategy::Adaptive})
+        {
+            options.filter_strategy = filter_strategy;
+            test_round_trip(
+                make_opaque(tests::get_transparent_test_image()), options, 2);
+            test_round_trip(tests::get_transparent_test_image(), options, 6);
+        }
+    }
+
+    SECTION("Compression levels")
+    {
+        for (const auto compression_level : {
+            algo::pack::CompressionLevel::Best,
+            algo::pack::CompressionLevel::Good,
+            algo::pack::CompressionLevel::Fast,
+            algo::pack::CompressionLevel::Store})
+        {
+            options.compression_level = compression_level;
+            test_round_trip(tests::get_transparent_test_image(), options, 6);
+        }
+    }
+
+    SECTION("Multiple threads")
+    {
+        res::Image image(1024, 512);
+        for (const auto y : algo::range(image.height()))
+        for (const auto x : algo::range(image.width()))
+        {
+            image.at(x, y).r = x ^ y;
+            image.at(x, y).g = x * y;
+            image.at(x, y).b = x + y;
+            image.at(x, y).a = 0xFF - (x >> 2);
+        }
+        options.filter_strategy = PngFilterStrategy::Adaptive;
+        options.thread_count = 4;
+        test_round_trip(image, options, 6);
+    }
+}
@@ -0,0 +1,142 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "flow/entry_filter.h"
+#include "test_support/catch.h"
+
+using namespace au;
+
+TEST_CASE("EntryFilter", "[flow]")
+{
+    SECTION("Empty filters match everything")
+    {
+        const flow::EntryFilter filter;
+        REQUIRE(filter.matches("anything.txt"));
+        REQUIRE(filter.matches(""));
+    }
+
+    SECTION("Globs")
+    {
+        flow::EntryFilter filter;
+        filter.add_include_glob("voice/*.ogg");
+        REQUIRE(filter.matches("voice/a001.ogg"));
+        REQUIRE(filter.matches("voice/sub/a001.ogg"));
+        REQUIRE(filter.matches("VOICE/A001.OGG"));
+        REQUIRE(filter.matches("voice\\a001.ogg"));
+        REQUIRE(!filter.matches("bgm/a001.ogg"));
+        REQUIRE(!filter.matches("voice/a001.ogg.bak"));
+    }
+
+    SECTION("Question marks")
+    {
+        flow::EntryFilter filter;
+        filter.add_include_glob("ev??.png");
+        REQUIRE(filter.matches("ev01.png"));
+        REQUIRE(!filter.matches("ev1.png"));
+        REQUIRE(!filter.matches("ev001.png"));
+    }
+
+    SECTION("Backtracking stars")
+    {
+        flow::EntryFilter filter;
+        filter.add_include_glob("*a*b*c");
+        REQUIRE(filter.matches("abc"));
+        REQUIRE(filter.matches("xaxbxbxc"));
+        REQUIRE(!filter.matches("xaxbxbxcx"));
+        REQUIRE(!filter.matches("cba"));
+    }
+
+    SECTION("Multiple globs")
+    {
+        flow::EntryFilter filter;
+        filter.add_include_glob("*.ogg");
+        filter.add_include_glob("*.wav");
+        REQUIRE(filter.matches("a.ogg"));
+        REQUIRE(filter.matches("a.wav"));
+        REQUIRE(!filter.matches("a.png"));
+    }
+
+    SECTION("Exclusions")
+    {
+        flow::EntryFilter filter;
+        filter.add_exclude_glob("*.bak");
+        REQUIRE(filter.matches("a.ogg"));
+        REQUIRE(!filter.matches("a.ogg.bak"));
+
+        filter.add_include_glob("voice/*");
+        REQUIRE(filter.matches("voice/a.ogg"));
+        REQUIRE(!filter.matches("voice/a.ogg.bak"));
+        REQUIRE(!filter.matches("bgm/a.ogg"));
+    }
+
+    SECTION("Regular expressions")
+    {
+        flow::EntryFilter filter;
+        filter.add_include_regex("^ev[0-9]+\\.png$");
+        filter.add_exclude_regex("99");
+        REQUIRE(filter.matches("ev01.png"));
+        REQUIRE(filter.matches("EV01.PNG"));
+        REQUIRE(!filter.matches("ev99.png"));
+        REQUIRE(!filter.matches("eva.png"));
+        REQUIRE(!filter.matches("ev01.png.bak"));
+    }
+
+    SECTION("Invalid regular expressions")
+    {
+        flow::EntryFilter filter;
+        REQUIRE_THROWS(filter.add_include_regex("("));
+    }
+
+    SECTION("Extensions")
+    {
+        flow::EntryFilter filter;
+        filter.add_include_extension("ogg");
+        filter.add_include_extension(".WAV");
+        REQUIRE(filter.matches("a.ogg"));
+        REQUIRE(filter.matches("a.OGG"));
+        REQUIRE(filter.matches("a.wav"));
+        REQUIRE(!filter.matches("a.png"));
+        REQUIRE(!filter.matches("ogg"));
+
+        filter.add_exclude_extension("wav");
+        REQUIRE(!filter.matches("a.wav"));
+    }
+
+    SECTION("Size ranges")
+    {
+        flow::EntryFilter filter;
+        filter.set_min_size(10);
+        filter.set_max_size(20);
+
+        dec::PlainArchiveEntry entry;
+        entry.path = "a.ogg";
+        entry.size = 9;
+        REQUIRE(!filter.matches(entry));
+        entry.size = 10;
+        REQUIRE(filter.matches(entry));
+        entry.size = 20;
+        REQUIRE(filter.matches(entry));
+        entry.size = 21;
+        REQUIRE(!filter.matches(entry));
+
+        dec::CompressedArchiveEntry compressed_entry;
+        compressed_entry.path = "a.ogg";
+        compressed_entry.size_comp = 5;
+        compressed_entry.size_orig = 15;
+        REQUIRE(filter.matches(compressed_entry));
+    }
+}
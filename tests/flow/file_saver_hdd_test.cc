@@ -16,6 +16,9 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "flow/file_saver_hdd.h"
+#include <thread>
+#include "algo/format.h"
+#include "algo/range.h"
 #include "io/file_system.h"
 #include "test_support/catch.h"
 
@@ -95,4 +98,37 @@ TEST_CASE("FileSaver", "[core]")
         const flow::FileSaverHdd file_saver(".", true);
         do_test_overwriting(file_saver, file_saver, true);
     }
+
+    SECTION("Saving from multiple threads")
+    {
+        const auto thread_count = 8;
+        std::vector<io::path> paths;
+        for (const auto i : algo::range(thread_count))
+        {
+            paths.push_back(i == 0
+                ? io::path("test.txt")
+                : io::path(algo::format("test(%d).txt", i)));
+            REQUIRE(!io::exists(paths.back()));
+        }
+
+        const flow::FileSaverHdd file_saver(".", true);
+        std::vector<std::thread> threads;
+        for (const auto i : algo::range(thread_count))
+        {
+            threads.push_back(std::thread([&]()
+            {
+                file_saver.save(
+                    std::make_shared<io::File>("test.txt", "test"_b));
+            }));
+        }
+        for (auto &thread : threads)
+            thread.join();
+
+        REQUIRE(file_saver.get_saved_file_count() == thread_count);
+        for (const auto &path : paths)
+        {
+            REQUIRE(io::exists(path));
+            io::remove(path);
+        }
+    }
 }
@@ -0,0 +1,167 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "flow/output_cache.h"
+#include "dec/base_file_decoder.h"
+#include "io/file_system.h"
+#include "test_support/catch.h"
+#include "test_support/common.h"
+#include "test_support/flow_support.h"
+#include "virtual_file_system.h"
+
+using namespace au;
+
+namespace
+{
+    class TestFileDecoder final : public dec::BaseFileDecoder
+    {
+    public:
+        mutable int decode_count = 0;
+        bool uses_other_files = false;
+
+    protected:
+        bool is_recognized_impl(io::File &input_file) const override;
+
+        std::unique_ptr<io::File> decode_impl(
+            const Logger &logger, io::File &input_file) const override;
+    };
+
+    struct CacheDirectoryGuard final
+    {
+        CacheDirectoryGuard(const io::path &path) : path(path)
+        {
+            boost::filesystem::remove_all(path.str());
+        }
+
+        ~CacheDirectoryGuard()
+        {
+            boost::filesystem::remove_all(path.str());
+        }
+
+        const io::path path;
+    };
+}
+
+bool TestFileDecoder::is_recognized_impl(io::File &input_file) const
+{
+    return input_file.path.has_extension("rgb");
+}
+
+std::unique_ptr<io::File> TestFileDecoder::decode_impl(
+    const Logger &logger, io::File &input_file) const
+{
+    ++decode_count;
+    if (uses_other_files)
+        VirtualFileSystem::get_by_name("palette.pal");
+    auto output_file = std::make_unique<io::File>();
+    output_file->stream.write("decoded "_b + input_file.stream.read_to_eof());
+    output_file->path = input_file.path;
+    output_file->path.change_extension("png");
+    return output_file;
+}
+
+TEST_CASE("OutputCache", "[flow]")
+{
+    const CacheDirectoryGuard cache_dir("test_cache");
+    const flow::OutputCache output_cache(cache_dir.path);
+
+    SECTION("Loading missing files")
+    {
+        REQUIRE(!output_cache.load("key"));
+        REQUIRE(output_cache.get_hit_count() == 0);
+    }
+
+    SECTION("Storing and loading files")
+    {
+        io::File input_file("dir/test.txt", "content"_b);
+        const auto stored_file = output_cache.store("key", input_file);
+        tests::compare_paths(stored_file->path, "dir/test.txt");
+        REQUIRE(stored_file->stream.seek(0).read_to_eof() == "content"_b);
+
+        const auto loaded_file = output_cache.load("key");
+        REQUIRE(loaded_file);
+        tests::compare_paths(loaded_file->path, "dir/test.txt");
+        REQUIRE(loaded_file->stream.read_to_eof() == "content"_b);
+        REQUIRE(!output_cache.load("other key"));
+        REQUIRE(output_cache.get_hit_count() == 1);
+    }
+
+    SECTION("Storing files under existing keys")
+    {
+        io::File input_file1("test1.txt", "content1"_b);
+        io::File input_file2("test2.txt", "content2"_b);
+        output_cache.store("key", input_file1);
+        output_cache.store("key", input_file2);
+
+        const auto loaded_file = output_cache.load("key");
+        REQUIRE(loaded_file);
+        tests::compare_paths(loaded_file->path, "test2.txt");
+        REQUIRE(loaded_file->stream.read_to_eof() == "content2"_b);
+    }
+
+    SECTION("Unpacking the same input again")
+    {
+        auto registry = dec::Registry::create_mock();
+        const auto decoder = std::make_shared<TestFileDecoder>();
+        registry->add_decoder("test/test-image", [&]() { return decoder; });
+
+        io::File input_file1("image.rgb", "image"_b);
+        const auto saved_files1 = tests::flow_unpack(
+            *registry, false, input_file1, &output_cache);
+        REQUIRE(decoder->decode_count == 1);
+        REQUIRE(output_cache.get_hit_count() == 0);
+
+        io::File input_file2("image.rgb", "image"_b);
+        const auto saved_files2 = tests::flow_unpack(
+            *registry, false, input_file2, &output_cache);
+        REQUIRE(decoder->decode_count == 1);
+        REQUIRE(output_cache.get_hit_count() == 1);
+
+        io::File input_file3("image.rgb", "other image"_b);
+        const auto saved_files3 = tests::flow_unpack(
+            *registry, false, input_file3, &output_cache);
+        REQUIRE(decoder->decode_count == 2);
+        REQUIRE(output_cache.get_hit_count() == 1);
+
+        REQUIRE(saved_files1.size() == 1);
+        REQUIRE(saved_files2.size() == 1);
+        REQUIRE(saved_files3.size() == 1);
+        tests::compare_paths(saved_files1[0]->path, saved_files2[0]->path);
+        REQUIRE(saved_files1[0]->stream.read_to_eof() == "decoded image"_b);
+        REQUIRE(saved_files2[0]->stream.read_to_eof() == "decoded image"_b);
+        REQUIRE(saved_files3[0]->stream.read_to_eof()
+            == "decoded other image"_b);
+    }
+
+    SECTION("Not caching outputs that depend on other files")
+    {
+        auto registry = dec::Registry::create_mock();
+        const auto decoder = std::make_shared<TestFileDecoder>();
+        decoder->uses_other_files = true;
+        registry->add_decoder("test/test-image", [&]() { return decoder; });
+
+        io::File input_file1("image.rgb", "image"_b);
+        tests::flow_unpack(*registry, false, input_file1, &output_cache);
+        io::File input_file2("image.rgb", "image"_b);
+        const auto saved_files = tests::flow_unpack(
+            *registry, false, input_file2, &output_cache);
+        REQUIRE(decoder->decode_count == 2);
+        REQUIRE(output_cache.get_hit_count() == 0);
+        REQUIRE(saved_files.size() == 1);
+        REQUIRE(saved_files[0]->stream.read_to_eof() == "decoded image"_b);
+    }
+}
@@ -0,0 +1,264 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "flow/task_scheduler.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "algo/range.h"
+#include "test_support/catch.h"
+
+using namespace au;
+using namespace au::flow;
+
+namespace
+{
+    struct CountingTask final : public ITask
+    {
+        CountingTask(
+            TaskScheduler &task_scheduler,
+            std::atomic<int> &counter,
+            const int depth);
+
+        bool work() const override;
+
+        TaskScheduler &task_scheduler;
+        std::atomic<int> &counter;
+        const int depth;
+    };
+
+    struct IdleCountingTask final : public ITask
+    {
+        IdleCountingTask(TaskScheduler &task_scheduler, size_t &idle_count)
+            : task_scheduler(task_scheduler), idle_count(idle_count)
+        {
+        }
+
+        bool work() const override
+        {
+            // the other workers may be in the middle of looking for work
+            for (const auto i : algo::range(100))
+            {
+                idle_count = task_scheduler.get_idle_thread_count();
+                if (idle_count)
+                    break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return true;
+        }
+
+        TaskScheduler &task_scheduler;
+        size_t &idle_count;
+    };
+
+    struct MemoryStats final
+    {
+        MemoryStats() : reserved(0), peak(0), consumed(0) {}
+
+        void reserve(const int bytes);
+        void release(const int bytes);
+
+        std::atomic<int> reserved;
+        std::atomic<int> peak;
+        std::atomic<int> consumed;
+    };
+
+    struct ConsumerTask final : public ITask
+    {
+        ConsumerTask(
+            TaskScheduler &task_scheduler, MemoryStats &stats, const int size);
+
+        bool work() const override;
+
+        TaskScheduler &task_scheduler;
+        MemoryStats &stats;
+        const int size;
+    };
+
+    struct ProducerTask final : public ITask
+    {
+        ProducerTask(
+            TaskScheduler &task_scheduler, MemoryStats &stats, const int size);
+
+        bool work() const override;
+        bool allocates_memory() const override;
+
+        TaskScheduler &task_scheduler;
+        MemoryStats &stats;
+        const int size;
+    };
+}
+
+CountingTask::CountingTask(
+    TaskScheduler &task_scheduler,
+    std::atomic<int> &counter,
+    const int depth) :
+        task_scheduler(task_scheduler),
+        counter(counter),
+        depth(depth)
+{
+}
+
+bool CountingTask::work() const
+{
+    ++counter;
+    if (depth > 0)
+    {
+        task_scheduler.push_front(
+            std::make_shared<CountingTask>(task_scheduler, counter, depth - 1));
+        task_scheduler.push_back(
+            std::make_shared<CountingTask>(task_scheduler, counter, depth - 1));
+    }
+    return depth % 2 == 0;
+}
+
+void MemoryStats::reserve(const int bytes)
+{
+    const auto new_reserved = reserved += bytes;
+    auto old_peak = peak.load();
+    while (old_peak < new_reserved
+        && !peak.compare_exchange_weak(old_peak, new_reserved))
+    {
+    }
+}
+
+void MemoryStats::release(const int bytes)
+{
+    reserved -= bytes;
+}
+
+ConsumerTask::ConsumerTask(
+    TaskScheduler &task_scheduler, MemoryStats &stats, const int size) :
+        task_scheduler(task_scheduler),
+        stats(stats),
+        size(size)
+{
+}
+
+bool ConsumerTask::work() const
+{
+    ++stats.consumed;
+    stats.release(size);
+    task_scheduler.release_memory(size);
+    return true;
+}
+
+ProducerTask::ProducerTask(
+    TaskScheduler &task_scheduler, MemoryStats &stats, const int size) :
+        task_scheduler(task_scheduler),
+        stats(stats),
+        size(size)
+{
+}
+
+bool ProducerTask::work() const
+{
+    stats.reserve(size);
+    task_scheduler.reserve_memory(size);
+    task_scheduler.push_back(
+        std::make_shared<ConsumerTask>(task_scheduler, stats, size));
+    return true;
+}
+
+bool ProducerTask::allocates_memory() const
+{
+    return true;
+}
+
+static void test_memory_limit(const size_t thread_count)
+{
+    TaskScheduler task_scheduler;
+    MemoryStats stats;
+    for (const auto i : algo::range(50))
+    {
+        task_scheduler.push_back(
+            std::make_shared<ProducerTask>(task_scheduler, stats, 10));
+    }
+    const auto result = task_scheduler.run(thread_count, 20);
+    REQUIRE(result.success_count == 100);
+    REQUIRE(result.error_count == 0);
+    REQUIRE(stats.consumed == 50);
+    REQUIRE(stats.reserved == 0);
+    // the limit is checked before running a task, so each worker can
+    // overshoot it by one task
+    REQUIRE(stats.peak <= 20 + 10 * static_cast<int>(thread_count));
+}
+
+static void test_scheduler(const size_t thread_count)
+{
+    TaskScheduler task_scheduler;
+    std::atomic<int> counter(0);
+    for (const auto i : algo::range(3))
+    {
+        task_scheduler.push_back(
+            std::make_shared<CountingTask>(task_scheduler, counter, 6));
+    }
+    const auto result = task_scheduler.run(thread_count);
+    REQUIRE(counter == 3 * 127);
+    REQUIRE(result.success_count == 3 * (1 + 4 + 16 + 64));
+    REQUIRE(result.error_count == 3 * (2 + 8 + 32));
+}
+
+TEST_CASE("Task scheduler", "[flow]")
+{
+    SECTION("Single thread")
+    {
+        test_scheduler(1);
+    }
+
+    SECTION("Multiple threads")
+    {
+        test_scheduler(8);
+    }
+
+    SECTION("No tasks")
+    {
+        TaskScheduler task_scheduler;
+        const auto result = task_scheduler.run(4);
+        REQUIRE(result.success_count == 0);
+        REQUIRE(result.error_count == 0);
+    }
+
+    SECTION("Idle threads")
+    {
+        size_t idle_count = 0;
+        TaskScheduler task_scheduler;
+        task_scheduler.push_back(
+            std::make_shared<IdleCountingTask>(task_scheduler, idle_count));
+        task_scheduler.run(1);
+        REQUIRE(idle_count == 0);
+
+        task_scheduler.push_back(
+            std::make_shared<IdleCountingTask>(task_scheduler, idle_count));
+        task_scheduler.run(4);
+        REQUIRE(idle_count >= 1);
+        REQUIRE(idle_count <= 3);
+    }
+}
+
+TEST_CASE("Task scheduler memory limit", "[flow]")
+{
+    SECTION("Single thread")
+    {
+        test_memory_limit(1);
+    }
+
+    SECTION("Multiple threads")
+    {
+        test_memory_limit(4);
+    }
+}
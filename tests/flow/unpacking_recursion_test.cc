@@ -15,6 +15,8 @@
 // You should have received a copy of the GNU General Public License
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
+#include <mutex>
+#include <set>
 #include "dec/base_archive_decoder.h"
 #include "dec/base_file_decoder.h"
 #include "io/memory_byte_stream.h"
@@ -44,6 +46,8 @@ namespace
     class TestArchiveDecoder final : public BaseArchiveDecoder
     {
     public:
+        std::function<void(const ArchiveEntry &)> read_callback;
+
         std::vector<std::string> get_linked_formats() const override;
 
     protected:
@@ -139,6 +143,8 @@ std::unique_ptr<io::File> TestArchiveDecoder::read_file_impl(
     const ArchiveMeta &,
     const ArchiveEntry &e) const
 {
+    if (read_callback)
+        read_callback(e);
     const auto entry = static_cast<const PlainArchiveEntry*>(&e);
     const auto data = input_file.stream.seek(entry->offset).read(entry->size);
     return std::make_unique<io::File>(entry->path, data);
@@ -265,3 +271,141 @@ TEST_CASE(
     tests::compare_paths(
         saved_files[0]->path, "outer.arc/inner.arc/nested/test.png");
 }
+
+TEST_CASE("Unpacking only entries that match the filter", "[flow]")
+{
+    const auto registry = create_registry();
+
+    const auto inner_arc_content = make_archive(
+        {
+            tests::stub_file("nested/voice.ogg", "voice"_b),
+            tests::stub_file("nested/text.txt", "text"_b),
+        });
+
+    const auto outer_arc_content = make_archive(
+        {
+            tests::stub_file("inner.arc", inner_arc_content),
+            tests::stub_file("voice.ogg", "voice"_b),
+            tests::stub_file("text.txt", "text"_b),
+        });
+
+    io::File dummy_file("outer.arc", outer_arc_content);
+
+    SECTION("Inclusions don't stop recursion into nested archives")
+    {
+        flow::EntryFilter entry_filter;
+        entry_filter.add_include_extension("ogg");
+        const auto saved_files = tests::flow_unpack(
+            *registry, true, dummy_file, nullptr, &entry_filter);
+        REQUIRE(saved_files.size() == 2);
+        tests::compare_paths(saved_files[0]->path, "outer.arc/voice.ogg");
+        tests::compare_paths(
+            saved_files[1]->path, "outer.arc/inner.arc/nested/voice.ogg");
+    }
+
+    SECTION("Exclusions apply at every nesting depth")
+    {
+        flow::EntryFilter entry_filter;
+        entry_filter.add_exclude_glob("nested/*.txt");
+        entry_filter.add_exclude_glob("text.txt");
+        const auto saved_files = tests::flow_unpack(
+            *registry, true, dummy_file, nullptr, &entry_filter);
+        REQUIRE(saved_files.size() == 2);
+        tests::compare_paths(saved_files[0]->path, "outer.arc/voice.ogg");
+        tests::compare_paths(
+            saved_files[1]->path, "outer.arc/inner.arc/nested/voice.ogg");
+    }
+
+    SECTION("Excluded archives aren't entered")
+    {
+        flow::EntryFilter entry_filter;
+        entry_filter.add_exclude_extension("arc");
+        const auto saved_files = tests::flow_unpack(
+            *registry, true, dummy_file, nullptr, &entry_filter);
+        REQUIRE(saved_files.size() == 2);
+        tests::compare_paths(saved_files[0]->path, "outer.arc/text.txt");
+        tests::compare_paths(saved_files[1]->path, "outer.arc/voice.ogg");
+    }
+
+    SECTION("Entries that can't be archives aren't read")
+    {
+        std::mutex mutex;
+        std::set<std::string> read_paths;
+        auto tracking_registry = Registry::create_mock();
+        tracking_registry->add_decoder(
+            "test/test-archive",
+            [&]()
+            {
+                auto decoder = std::make_shared<TestArchiveDecoder>();
+                decoder->read_callback = [&](const ArchiveEntry &entry)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    read_paths.insert(entry.path.str());
+                };
+                return decoder;
+            });
+        tracking_registry->add_extension("test/test-archive", "arc");
+        tracking_registry->add_decoder(
+            "test/test-image",
+            []() { return std::make_shared<TestFileDecoder>(); });
+
+        flow::EntryFilter entry_filter;
+        entry_filter.add_include_extension("ogg");
+        const auto saved_files = tests::flow_unpack(
+            *tracking_registry, true, dummy_file, nullptr, &entry_filter);
+        REQUIRE(saved_files.size() == 2);
+        REQUIRE(read_paths.count("inner.arc"));
+        REQUIRE(!read_paths.count("text.txt"));
+        REQUIRE(!read_paths.count("nested/text.txt"));
+    }
+
+    SECTION("Without recursion, inclusions apply to archives too")
+    {
+        flow::EntryFilter entry_filter;
+        entry_filter.add_include_extension("ogg");
+        const auto saved_files = tests::flow_unpack(
+            *registry, false, dummy_file, nullptr, &entry_filter);
+        REQUIRE(saved_files.size() == 1);
+        tests::compare_paths(saved_files[0]->path, "outer.arc/voice.ogg");
+    }
+}
+
+TEST_CASE("Listing entries doesn't decode nor save anything", "[flow]")
+{
+    bool converted = false;
+    auto registry = Registry::create_mock();
+    registry->add_decoder(
+        "test/test-archive",
+        []() { return std::make_shared<TestArchiveDecoder>(); });
+    registry->add_decoder(
+        "test/test-image",
+        [&]()
+        {
+            auto decoder = std::make_shared<TestFileDecoder>();
+            decoder->conversion_callback = [&](io::File &)
+                { converted = true; };
+            return decoder;
+        });
+
+    SECTION("Archives")
+    {
+        const auto arc_content = make_archive(
+            {
+                tests::stub_file("image.rgb", "discard"_b),
+            });
+        io::File dummy_file("archive.arc", arc_content);
+        const auto saved_files = tests::flow_unpack(
+            *registry, true, dummy_file, nullptr, nullptr, true);
+        REQUIRE(saved_files.empty());
+    }
+
+    SECTION("Converted files")
+    {
+        io::File dummy_file("image.rgb", "discard"_b);
+        const auto saved_files = tests::flow_unpack(
+            *registry, true, dummy_file, nullptr, nullptr, true);
+        REQUIRE(saved_files.empty());
+    }
+
+    REQUIRE(!converted);
+}
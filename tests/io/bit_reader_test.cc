@@ -0,0 +1,104 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "io/bit_reader.h"
+#include <random>
+#include "algo/range.h"
+#include "io/lsb_bit_stream.h"
+#include "io/msb_bit_stream.h"
+#include "test_support/catch.h"
+
+using namespace au;
+using namespace au::io;
+
+static bstr get_random_data(const size_t size)
+{
+    std::mt19937 generator(size);
+    bstr data(size);
+    for (auto &c : data)
+        c = generator();
+    return data;
+}
+
+template<typename TReader, typename TStream> static void compare_with_stream()
+{
+    const auto data = get_random_data(1000);
+    std::mt19937 generator(1);
+    TReader reader(data);
+    TStream stream(data);
+    while (reader.left() >= 32)
+    {
+        const auto bits = generator() % 33;
+        const auto expected = stream.read(bits);
+        REQUIRE(reader.peek(bits) == expected);
+        REQUIRE(reader.read(bits) == expected);
+        REQUIRE(reader.pos() == stream.pos());
+    }
+    const auto rest = reader.left();
+    REQUIRE(reader.read(rest) == stream.read(rest));
+    REQUIRE(reader.eof());
+    REQUIRE_THROWS(reader.read(1));
+    REQUIRE_THROWS(stream.read(1));
+}
+
+TEST_CASE("Bit readers", "[io]")
+{
+    SECTION("MSB")
+    {
+        const auto data = "\x8F\x01"_b; // 10001111 00000001
+        MsbBitReader reader(data);
+        REQUIRE(reader.read(1) == 1);
+        REQUIRE(reader.peek(3) == 0);
+        REQUIRE(reader.read(7) == 0b0001111);
+        REQUIRE(reader.peek(0) == 0);
+        REQUIRE(reader.read(8) == 1);
+        REQUIRE(reader.peek(32) == 0);
+        REQUIRE_THROWS(reader.read(1));
+    }
+
+    SECTION("LSB")
+    {
+        const auto data = "\x8F\x01"_b; // 10001111 00000001
+        LsbBitReader reader(data);
+        REQUIRE(reader.read(1) == 1);
+        REQUIRE(reader.peek(3) == 0b111);
+        REQUIRE(reader.read(7) == 0b1000111);
+        REQUIRE(reader.peek(0) == 0);
+        REQUIRE(reader.read(8) == 1);
+        REQUIRE(reader.peek(32) == 0);
+        REQUIRE_THROWS(reader.read(1));
+    }
+
+    SECTION("Empty input")
+    {
+        const auto data = ""_b;
+        MsbBitReader reader(data);
+        REQUIRE(reader.eof());
+        REQUIRE(reader.peek(8) == 0);
+        REQUIRE_THROWS(reader.read(1));
+    }
+
+    SECTION("MSB reader matches MsbBitStream")
+    {
+        compare_with_stream<MsbBitReader, MsbBitStream>();
+    }
+
+    SECTION("LSB reader matches LsbBitStream")
+    {
+        compare_with_stream<LsbBitReader, LsbBitStream>();
+    }
+}
@@ -0,0 +1,78 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "io/concat_byte_stream.h"
+#include "io/memory_byte_stream.h"
+#include "test_support/catch.h"
+#include "test_support/common.h"
+
+using namespace au;
+
+static std::unique_ptr<io::BaseByteStream> create_stream()
+{
+    std::vector<std::unique_ptr<io::BaseByteStream>> streams;
+    streams.push_back(std::make_unique<io::MemoryByteStream>("abc"_b));
+    streams.push_back(std::make_unique<io::MemoryByteStream>(""_b));
+    streams.push_back(std::make_unique<io::MemoryByteStream>("de"_b));
+    streams.push_back(std::make_unique<io::MemoryByteStream>("fghi"_b));
+    return std::make_unique<io::ConcatByteStream>(std::move(streams));
+}
+
+TEST_CASE("ConcatByteStream", "[io][stream]")
+{
+    SECTION("Reading across the streams")
+    {
+        auto stream = create_stream();
+        REQUIRE(stream->size() == 9);
+        tests::compare_binary(stream->read(2), "ab"_b);
+        tests::compare_binary(stream->read(4), "cdef"_b);
+        tests::compare_binary(stream->read_to_eof(), "ghi"_b);
+        REQUIRE_THROWS(stream->read<u8>());
+    }
+
+    SECTION("Reading nothing")
+    {
+        auto stream = create_stream();
+        u8 byte = 0;
+        stream->read(&byte, 0);
+        REQUIRE(stream->pos() == 0);
+        tests::compare_binary(stream->read(0), ""_b);
+    }
+
+    SECTION("Seeking")
+    {
+        auto stream = create_stream();
+        tests::compare_binary(stream->seek(3).read(1), "d"_b);
+        tests::compare_binary(stream->seek(1).read(1), "b"_b);
+        REQUIRE_THROWS(stream->seek(10));
+    }
+
+    SECTION("Cloning")
+    {
+        auto stream = create_stream();
+        stream->seek(4);
+        auto clone = stream->clone();
+        tests::compare_binary(clone->read_to_eof(), "efghi"_b);
+        REQUIRE(stream->pos() == 4);
+    }
+
+    SECTION("Writing")
+    {
+        auto stream = create_stream();
+        REQUIRE_THROWS(stream->write("x"_b));
+    }
+}
@@ -15,8 +15,11 @@
 // You should have received a copy of the GNU General Public License
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
+#include "io/concat_byte_stream.h"
 #include "io/memory_byte_stream.h"
+#include "io/slice_byte_stream.h"
 #include "test_support/catch.h"
+#include "test_support/common.h"
 #include "test_support/stream_test.h"
 
 using namespace au;
@@ -29,4 +32,61 @@ TEST_CASE("MemoryByteStream", "[io][stream]")
             []() { return std::make_unique<io::MemoryByteStream>(); },
             []() { });
     }
+
+    SECTION("Reading views")
+    {
+        io::MemoryByteStream stream("abcdef"_b);
+        stream.seek(1);
+        const auto view = stream.read_view(3);
+        REQUIRE(view);
+        REQUIRE(bstr(view, 3) == "bcd"_b);
+        REQUIRE(stream.pos() == 4);
+        REQUIRE_THROWS(stream.read_view(3));
+        REQUIRE(stream.pos() == 4);
+        REQUIRE(stream.read_le<u16>() == 0x6665);
+    }
+
+    SECTION("Clones keep their data when the buffer is reallocated")
+    {
+        io::MemoryByteStream stream("abc"_b);
+        const auto clone = stream.clone();
+        const auto slice = io::SliceByteStream(stream, 1, 2).clone();
+        stream.seek(3);
+        stream.write(bstr(1024 * 1024, 'x'));
+        stream.resize(2);
+        tests::compare_binary(clone->read_to_eof(), "abc"_b);
+        tests::compare_binary(slice->read_to_eof(), "bc"_b);
+        REQUIRE(stream.size() == 2);
+        REQUIRE(stream.pos() == 2);
+    }
+}
+
+TEST_CASE("SliceByteStream", "[io][stream]")
+{
+    io::MemoryByteStream parent_stream("abcdefgh"_b);
+
+    SECTION("Reading from contiguous data")
+    {
+        io::SliceByteStream stream(parent_stream, 2, 4);
+        REQUIRE(stream.read_le<u16>() == 0x6463);
+        REQUIRE(bstr(stream.read_view(1), 1) == "e"_b);
+        REQUIRE(stream.pos() == 3);
+        REQUIRE_THROWS(stream.read(2));
+        tests::compare_binary(stream.read(1), "f"_b);
+        REQUIRE(stream.left() == 0);
+        stream.seek(1);
+        tests::compare_binary(stream.clone()->read_to_eof(), "def"_b);
+    }
+
+    SECTION("Reading from other streams")
+    {
+        std::vector<std::unique_ptr<io::BaseByteStream>> streams;
+        streams.push_back(parent_stream.clone());
+        io::ConcatByteStream concat_stream(std::move(streams));
+        io::SliceByteStream stream(concat_stream, 2, 4);
+        REQUIRE(!stream.read_view(1));
+        REQUIRE(stream.read_le<u16>() == 0x6463);
+        tests::compare_binary(stream.read(2), "ef"_b);
+        REQUIRE_THROWS(stream.read(1));
+    }
 }
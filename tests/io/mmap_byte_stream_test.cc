@@ -0,0 +1,92 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "io/mmap_byte_stream.h"
+#include "err.h"
+#include "io/file_byte_stream.h"
+#include "io/file_system.h"
+#include "test_support/catch.h"
+#include "test_support/common.h"
+
+using namespace au;
+
+TEST_CASE("MmapByteStream", "[io][stream]")
+{
+    SECTION("Reading from existing files")
+    {
+        static const bstr png_magic = "\x89PNG"_b;
+        io::MmapByteStream stream("tests/dec/png/files/reimu_transparent.png");
+        tests::compare_binary(stream.read(png_magic.size()), png_magic);
+        io::FileByteStream file_stream(
+            "tests/dec/png/files/reimu_transparent.png", io::FileMode::Read);
+        REQUIRE(stream.size() == file_stream.size());
+        tests::compare_binary(
+            stream.seek(0).read_to_eof(), file_stream.read_to_eof());
+    }
+
+    SECTION("Reading from empty files")
+    {
+        REQUIRE(!io::exists("tests/trash.out"));
+        {
+            io::FileByteStream stream("tests/trash.out", io::FileMode::Write);
+        }
+        {
+            io::MmapByteStream stream("tests/trash.out");
+            REQUIRE(stream.size() == 0);
+            REQUIRE(stream.read_to_eof() == ""_b);
+            REQUIRE_THROWS(stream.read<u8>());
+        }
+        io::remove("tests/trash.out");
+    }
+
+    SECTION("Reading from missing files")
+    {
+        REQUIRE_THROWS_AS(
+            io::MmapByteStream("tests/nonexistent.file"),
+            err::FileNotFoundError);
+    }
+
+    SECTION("Zero-copy views")
+    {
+        io::MmapByteStream stream("tests/io/mmap_byte_stream_test.cc");
+        const auto view = stream.read_view(2);
+        REQUIRE(view[0] == '/');
+        REQUIRE(view[1] == '/');
+        REQUIRE(stream.pos() == 2);
+        REQUIRE_THROWS(stream.read_view(stream.size()));
+    }
+
+    SECTION("Clones have independent positions")
+    {
+        io::MmapByteStream stream("tests/io/mmap_byte_stream_test.cc");
+        stream.seek(3);
+        const auto clone = stream.clone();
+        REQUIRE(clone->pos() == 3);
+        clone->seek(0);
+        REQUIRE(stream.pos() == 3);
+        REQUIRE(clone->read(2) == "//"_b);
+        REQUIRE(stream.pos() == 3);
+    }
+
+    SECTION("Writing")
+    {
+        io::MmapByteStream stream("tests/io/mmap_byte_stream_test.cc");
+        REQUIRE_THROWS(stream.write("test"_b));
+        REQUIRE_THROWS(stream.resize(0));
+        REQUIRE_NOTHROW(stream.resize(stream.size()));
+    }
+}
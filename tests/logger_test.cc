@@ -0,0 +1,86 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "logger.h"
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "algo/range.h"
+#include "algo/str.h"
+#include "test_support/catch.h"
+
+using namespace au;
+
+TEST_CASE("Logger", "[core]")
+{
+    // write whatever the previous tests left behind
+    Logger().flush_and_wait();
+    std::stringstream output;
+    const auto old_buffer = std::cout.rdbuf(output.rdbuf());
+
+    Logger logger;
+    logger.disable_colors();
+
+    SECTION("Flushing and waiting writes the pending messages")
+    {
+        logger.info("first\n");
+        logger.info("second\n");
+        logger.flush_and_wait();
+        std::cout.rdbuf(old_buffer);
+        REQUIRE(output.str() == "first\nsecond\n");
+    }
+
+    SECTION("Flushing and waiting writes the batched messages")
+    {
+        logger.set_batching(true);
+        logger.info("batched\n");
+        logger.flush_and_wait();
+        std::cout.rdbuf(old_buffer);
+        REQUIRE(output.str() == "batched\n");
+    }
+
+    SECTION("Concurrent batches stay contiguous")
+    {
+        std::vector<std::thread> threads;
+        for (const auto i : algo::range(4))
+        {
+            threads.push_back(std::thread([&logger, i]()
+            {
+                Logger task_logger(logger);
+                task_logger.set_batching(true);
+                for (const auto j : algo::range(100))
+                    task_logger.info("%d\n", i);
+                task_logger.flush();
+            }));
+        }
+        for (auto &thread : threads)
+            thread.join();
+        logger.flush_and_wait();
+        std::cout.rdbuf(old_buffer);
+
+        const auto lines = algo::split(output.str(), '\n', false);
+        REQUIRE(lines.size() == 400);
+        auto run_count = 1;
+        for (const auto i : algo::range(1, lines.size()))
+            if (lines[i] != lines[i - 1])
+                ++run_count;
+        REQUIRE(run_count == 4);
+    }
+
+    std::cout.rdbuf(old_buffer);
+}
@@ -16,6 +16,7 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "res/image.h"
+#include "res/palette.h"
 #include "algo/range.h"
 #include "test_support/catch.h"
 
@@ -269,3 +270,92 @@ TEST_CASE("Image offsetting", "[res]")
         }
     }
 }
+
+TEST_CASE("Applying palettes", "[res]")
+{
+    res::Palette palette(3);
+    palette[0] = {1, 2, 3, 4};
+    palette[1] = {5, 6, 7, 8};
+    palette[2] = {9, 10, 11, 12};
+    res::Image image(5, 1, "\x02\x00\x01\x03\xFF"_b, palette);
+    REQUIRE(image.at(0, 0) == palette[2]);
+    REQUIRE(image.at(1, 0) == palette[0]);
+    REQUIRE(image.at(2, 0) == palette[1]);
+    REQUIRE(image.at(3, 0) == res::Pixel({3, 3, 3, 0}));
+    REQUIRE(image.at(4, 0) == res::Pixel({0xFF, 0xFF, 0xFF, 0}));
+}
+
+TEST_CASE("Image overlay kinds", "[res]")
+{
+    // wide enough for both the vectorized part and the remainder
+    const size_t width = 11;
+    res::Image source(width, 1);
+    res::Image target(width, 1);
+    for (const auto x : algo::range(width))
+    {
+        source.at(x, 0) = {
+            static_cast<u8>(x * 23),
+            static_cast<u8>(x * 41),
+            static_cast<u8>(250 - x * 7),
+            static_cast<u8>(x % 3 ? x * 25 : 0)};
+        target.at(x, 0) = {
+            static_cast<u8>(x * 13),
+            200,
+            static_cast<u8>(x * 3),
+            static_cast<u8>(x < 8 ? 0xFF : x * 20)};
+    }
+
+    // the kernels must produce the same result as blending pixels one by
+    // one, which never reaches the vectorized code
+    for (const auto kind : {
+        res::Image::OverlayKind::OverwriteNonTransparent,
+        res::Image::OverlayKind::AddSimple,
+        res::Image::OverlayKind::AlphaOver})
+    {
+        res::Image actual(target);
+        actual.overlay(source, kind);
+        for (const auto x : algo::range(width))
+        {
+            res::Image expected(1, 1);
+            expected.at(0, 0) = target.at(x, 0);
+            expected.overlay(source, -x, 0, kind);
+            REQUIRE(actual.at(x, 0) == expected.at(0, 0));
+        }
+    }
+
+    SECTION("Alpha over")
+    {
+        res::Image base(2, 1);
+        base.at(0, 0) = {0, 0, 200, 0xFF};
+        base.at(1, 0) = {0, 0, 0xFF, 128};
+        res::Image overlay(2, 1);
+        overlay.at(0, 0) = {100, 50, 0, 128};
+        overlay.at(1, 0) = {0xFF, 0, 0, 128};
+        base.overlay(overlay, res::Image::OverlayKind::AlphaOver);
+        REQUIRE(base.at(0, 0) == res::Pixel({50, 25, 100, 0xFF}));
+        REQUIRE(base.at(1, 0) == res::Pixel({170, 0, 85, 192}));
+    }
+}
+
+TEST_CASE("Image flipping", "[res]")
+{
+    const auto image = create_test_image(3, 5);
+
+    SECTION("Vertically")
+    {
+        res::Image flipped(image);
+        flipped.flip_vertically();
+        for (const auto y : algo::range(5))
+        for (const auto x : algo::range(3))
+            REQUIRE(flipped.at(x, y) == image.at(x, 4 - y));
+    }
+
+    SECTION("Horizontally")
+    {
+        res::Image flipped(image);
+        flipped.flip_horizontally();
+        for (const auto y : algo::range(5))
+        for (const auto x : algo::range(3))
+            REQUIRE(flipped.at(x, y) == image.at(2 - x, y));
+    }
+}
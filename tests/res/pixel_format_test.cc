@@ -126,4 +126,29 @@ TEST_CASE("PixelFormat", "[res]")
         test_read(
             0b11111110000000010000001000000011, PF::RGBnA8888, {1, 2, 3, 1});
     }
+
+    SECTION("Reading many pixels at once")
+    {
+        // vectorized kernels must agree with converting one pixel at a time
+        const size_t pixel_count = 37;
+        const auto format_count = static_cast<int>(res::PixelFormat::Count);
+        for (const auto i : algo::range(format_count))
+        {
+            const auto fmt = static_cast<res::PixelFormat>(i);
+            const auto bpp = res::pixel_format_to_bpp(fmt);
+            bstr input(pixel_count * bpp);
+            for (const auto j : algo::range(input.size()))
+                input[j] = j * 73 + i * 11;
+
+            std::vector<res::Pixel> actual_pixels(pixel_count);
+            res::read_pixels(input.get<u8>(), actual_pixels, fmt);
+            for (const auto j : algo::range(pixel_count))
+            {
+                std::vector<res::Pixel> expected_pixels(1);
+                res::read_pixels(
+                    input.get<u8>() + j * bpp, expected_pixels, fmt);
+                compare_pixels(actual_pixels[j], expected_pixels[0]);
+            }
+        }
+    }
 }
@@ -46,6 +46,26 @@ std::vector<std::shared_ptr<io::File>> tests::unpack(
     return files;
 }
 
+std::vector<std::shared_ptr<io::File>> tests::unpack_via_index(
+    const dec::BaseArchiveDecoder &decoder, io::File &input_file)
+{
+    Logger dummy_logger;
+    dummy_logger.mute();
+    const auto index = decoder.serialize_meta(
+        *decoder.read_meta(dummy_logger, input_file));
+    REQUIRE(!index.empty());
+    navigate_to_random_place(input_file.stream);
+    const auto meta = decoder.deserialize_meta(
+        dummy_logger, input_file, index);
+    std::vector<std::shared_ptr<io::File>> files;
+    for (const auto &entry : meta->entries)
+    {
+        files.push_back(decoder.read_file(
+            dummy_logger, input_file, *meta, *entry));
+    }
+    return files;
+}
+
 std::unique_ptr<io::File> tests::decode(
     const dec::BaseFileDecoder &decoder, io::File &input_file)
 {
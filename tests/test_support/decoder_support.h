@@ -28,6 +28,10 @@ namespace tests {
     std::vector<std::shared_ptr<io::File>> unpack(
         const au::dec::BaseArchiveDecoder &decoder, io::File &input_file);
 
+    // same as unpack, but goes through a serialized archive index
+    std::vector<std::shared_ptr<io::File>> unpack_via_index(
+        const au::dec::BaseArchiveDecoder &decoder, io::File &input_file);
+
     std::unique_ptr<io::File> decode(
         const au::dec::BaseFileDecoder &decoder, io::File &input_file);
 
@@ -24,7 +24,10 @@ using namespace au;
 std::vector<std::shared_ptr<io::File>> tests::flow_unpack(
     const dec::Registry &registry,
     const bool enable_nested_decoding,
-    io::File &input_file)
+    io::File &input_file,
+    const flow::OutputCache *output_cache,
+    const flow::EntryFilter *entry_filter,
+    const bool list_entries)
 {
     Logger dummy_logger;
     dummy_logger.mute();
@@ -44,7 +47,10 @@ std::vector<std::shared_ptr<io::File>> tests::flow_unpack(
         registry,
         enable_nested_decoding,
         {},
-        std::set<std::string>(name_list.begin(), name_list.end()));
+        std::set<std::string>(name_list.begin(), name_list.end()),
+        output_cache,
+        entry_filter,
+        list_entries);
 
     flow::ParallelUnpacker unpacker(context);
     unpacker.add_input_file(
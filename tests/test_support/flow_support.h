@@ -18,6 +18,8 @@
 #pragma once
 
 #include "dec/registry.h"
+#include "flow/entry_filter.h"
+#include "flow/output_cache.h"
 #include "io/file.h"
 
 namespace au {
@@ -26,6 +28,9 @@ namespace tests {
     std::vector<std::shared_ptr<io::File>> flow_unpack(
         const dec::Registry &registry,
         const bool enable_ensted_decoding,
-        io::File &input_file);
+        io::File &input_file,
+        const flow::OutputCache *output_cache = nullptr,
+        const flow::EntryFilter *entry_filter = nullptr,
+        const bool list_entries = false);
 
 } }